@@ -25,6 +25,23 @@
 
 namespace aidl::android::hardware::graphics::composer3::impl {
 
+namespace {
+
+/*
+ * validate/present outputs. The engine only lives for one executeCommands
+ * call, so they are kept per binder thread to keep their capacity.
+ */
+struct FrameOutputs {
+    std::vector<int64_t> changedLayers;
+    std::vector<Composition> compositionTypes;
+    std::vector<int64_t> requestedLayers;
+    std::vector<int32_t> requestMasks;
+    std::vector<int64_t> releasedLayers;
+};
+thread_local FrameOutputs gFrameOutputs;
+
+} // namespace
+
 #define DISPATCH_LAYER_COMMAND(display, layerCmd, field, funcName)               \
     do {                                                                         \
         if (layerCmd.field) {                                                    \
@@ -172,11 +189,15 @@ void ComposerCommandEngine::dispatchLayerCommand(int64_t display, const LayerCom
 }
 
 int32_t ComposerCommandEngine::executeValidateDisplayInternal(int64_t display) {
-    std::vector<int64_t> changedLayers;
-    std::vector<Composition> compositionTypes;
+    auto& changedLayers = gFrameOutputs.changedLayers;
+    auto& compositionTypes = gFrameOutputs.compositionTypes;
     uint32_t displayRequestMask = 0x0;
-    std::vector<int64_t> requestedLayers;
-    std::vector<int32_t> requestMasks;
+    auto& requestedLayers = gFrameOutputs.requestedLayers;
+    auto& requestMasks = gFrameOutputs.requestMasks;
+    changedLayers.clear();
+    compositionTypes.clear();
+    requestedLayers.clear();
+    requestMasks.clear();
     ClientTargetProperty clientTargetProperty{common::PixelFormat::RGBA_8888,
                                               common::Dataspace::UNKNOWN};
     DimmingStage dimmingStage;
@@ -314,7 +335,9 @@ void ComposerCommandEngine::executeAcceptDisplayChanges(int64_t display) {
 
 int ComposerCommandEngine::executePresentDisplay(int64_t display) {
     ndk::ScopedFileDescriptor presentFence;
-    std::vector<int64_t> layers;
+    auto& layers = gFrameOutputs.releasedLayers;
+    layers.clear();
+    // moved into the writer
     std::vector<ndk::ScopedFileDescriptor> fences;
     auto err = mHal->presentDisplay(display, presentFence, &layers, &fences);
     if (!err) {
@@ -34,6 +34,19 @@ namespace {
 
 static constexpr int32_t kMinComposerInterfaceVersionForVrrApi = 3;
 static constexpr int32_t kMinComposerInterfaceVersionForHwcBatching = 3;
+
+/*
+ * Scratch buffers for the HAL-side layer and value arrays of validate and
+ * present. They keep their capacity across frames, as do the output vectors
+ * of the command engine. The results the command writer serializes and the
+ * atomic request of each commit are still allocated per frame.
+ */
+struct FrameScratch {
+    std::vector<hwc2_layer_t> layers;
+    std::vector<int32_t> values;
+    std::vector<hwc2_layer_t> requestedLayers;
+};
+thread_local FrameScratch gFrameScratch;
 };
 
 namespace aidl::android::hardware::graphics::composer3::impl {
@@ -195,9 +208,11 @@ int32_t HalImpl::getHalLayer(int64_t display, int64_t layer, ExynosLayer*& halLa
     ExynosDisplay* halDisplay;
     RET_IF_ERR(getHalDisplay(display, halDisplay));
 
-    hwc2_layer_t mapped_layer;
-    RET_IF_ERR(layerSf2Hwc(display, layer, mapped_layer));
-    halLayer = halDisplay->checkLayer(mapped_layer);
+    auto iter = mSfLayerToHalLayerMap.find(layer);
+    if (iter == mSfLayerToHalLayerMap.end()) { [[unlikely]]
+        return HWC2_ERROR_BAD_LAYER;
+    }
+    halLayer = halDisplay->checkLayer(iter->second);
     if (!halLayer) { [[unlikely]]
         return HWC2_ERROR_BAD_LAYER;
     }
@@ -769,21 +784,23 @@ int32_t HalImpl::presentDisplay(int64_t display, ndk::ScopedFileDescriptor& fenc
     uint32_t count = 0;
     RET_IF_ERR(halDisplay->getReleaseFences(&count, nullptr, nullptr));
 
-    std::vector<hwc2_layer_t> hwcLayers(count);
-    std::vector<int32_t> hwcFences(count);
+    auto& hwcLayers = gFrameScratch.layers;
+    auto& hwcFences = gFrameScratch.values;
+    hwcLayers.resize(count);
+    hwcFences.resize(count);
     RET_IF_ERR(halDisplay->getReleaseFences(&count, hwcLayers.data(), hwcFences.data()));
-    std::vector<int64_t> sfLayers(count);
 
+    outLayers->assign(count, 0);
+    outReleaseFences->resize(count);
     for (int i = 0; i < count; i++) {
         auto iter = mHalLayerToSfLayerMap.find(hwcLayers[i]);
         if (iter != mHalLayerToSfLayerMap.end()) {
-            sfLayers[i] = iter->second;
+            (*outLayers)[i] = iter->second;
         } else {
             LOG(ERROR) << "HalImpl::presentDisplay incorrect hal mapping. ";
         }
+        h2a::translate(hwcFences[i], (*outReleaseFences)[i]);
     }
-    h2a::translate(sfLayers, *outLayers);
-    h2a::translate(hwcFences, *outReleaseFences);
 
     return HWC2_ERROR_NONE;
 }
@@ -1220,40 +1237,42 @@ int32_t HalImpl::validateDisplay(int64_t display, std::vector<int64_t>* outChang
         return err;
     }
 
-    std::vector<hwc2_layer_t> hwcChangedLayers(typesCount);
-    std::vector<int32_t> hwcCompositionTypes(typesCount);
+    auto& hwcChangedLayers = gFrameScratch.layers;
+    auto& hwcCompositionTypes = gFrameScratch.values;
+    hwcChangedLayers.resize(typesCount);
+    hwcCompositionTypes.resize(typesCount);
     RET_IF_ERR(halDisplay->getChangedCompositionTypes(&typesCount, hwcChangedLayers.data(),
                                                       hwcCompositionTypes.data()));
 
     int32_t displayReqs;
-    std::vector<hwc2_layer_t> hwcRequestedLayers(reqsCount);
+    auto& hwcRequestedLayers = gFrameScratch.requestedLayers;
+    hwcRequestedLayers.resize(reqsCount);
     outRequestMasks->resize(reqsCount);
     RET_IF_ERR(halDisplay->getDisplayRequests(&displayReqs, &reqsCount,
                                               hwcRequestedLayers.data(), outRequestMasks->data()));
-    std::vector<int64_t> sfChangedLayers(typesCount);
 
+    outChangedLayers->assign(typesCount, 0);
+    outCompositionTypes->resize(typesCount);
     for (int i = 0; i < typesCount; i++) {
         auto iter = mHalLayerToSfLayerMap.find(hwcChangedLayers[i]);
         if (iter != mHalLayerToSfLayerMap.end()) {
-            sfChangedLayers[i] = iter->second;
+            (*outChangedLayers)[i] = iter->second;
         } else {
             LOG(ERROR) << "HalImpl::validateDisplay incorrect hal mapping. ";
         }
+        h2a::translate(hwcCompositionTypes[i], (*outCompositionTypes)[i]);
     }
-    h2a::translate(sfChangedLayers, *outChangedLayers);
-    h2a::translate(hwcCompositionTypes, *outCompositionTypes);
     *outDisplayRequestMask = displayReqs;
-    std::vector<int64_t> sfRequestedLayers(reqsCount);
 
+    outRequestedLayers->assign(reqsCount, 0);
     for (int i = 0; i < reqsCount; i++) {
         auto iter = mHalLayerToSfLayerMap.find(hwcRequestedLayers[i]);
         if (iter != mHalLayerToSfLayerMap.end()) {
-            sfRequestedLayers[i] = iter->second;
+            (*outRequestedLayers)[i] = iter->second;
         } else {
             LOG(ERROR) << "HalImpl::validateDisplay incorrect hal mapping. ";
         }
     }
-    h2a::translate(sfRequestedLayers, *outRequestedLayers);
     hwc_client_target_property hwcProperty;
     HwcDimmingStage hwcDimmingStage;
     if (!halDisplay->getClientTargetProperty(&hwcProperty, &hwcDimmingStage)) {
@@ -18,6 +18,7 @@
 
 #include <map>
 #include <memory>
+#include <unordered_map>
 #include <unordered_set>
 
 #include <hardware/hwcomposer2.h>
@@ -198,8 +199,8 @@ class HalImpl : public IComposerHal {
     std::unique_ptr<ExynosHWCCtx> mHwcCtx;
 #endif
     std::unordered_set<Capability> mCaps;
-    std::map<int64_t, hwc2_layer_t> mSfLayerToHalLayerMap;
-    std::map<hwc2_layer_t, int64_t> mHalLayerToSfLayerMap;
+    std::unordered_map<int64_t, hwc2_layer_t> mSfLayerToHalLayerMap;
+    std::unordered_map<hwc2_layer_t, int64_t> mHalLayerToSfLayerMap;
 };
 
 } // namespace aidl::android::hardware::graphics::composer3::impl
@@ -38,7 +38,10 @@ LOCAL_SRC_FILES := \
 	libdrmresource/drm/drmmode.cpp \
 	libdrmresource/drm/drmplane.cpp \
 	libdrmresource/drm/drmproperty.cpp \
+	libdrmresource/drm/drmcommittedstate.cpp \
 	libdrmresource/drm/drmeventlistener.cpp \
+	libdrmresource/drm/ueventparser.cpp \
+	libdrmresource/drm/vsyncpredictor.cpp \
 	libdrmresource/drm/vsyncworker.cpp
 
 LOCAL_CFLAGS := -DHLOG_CODE=0
@@ -135,8 +138,11 @@ LOCAL_SRC_FILES := \
 	libdevice/ExynosDisplay.cpp \
 	libdevice/ExynosDevice.cpp \
 	libdevice/ExynosLayer.cpp \
+	libdevice/LayerFpsTracker.cpp \
 	libdevice/HistogramDevice.cpp \
 	libdevice/DisplayTe2Manager.cpp \
+	libdevice/ReadbackRing.cpp \
+	libdevice/DisplayReadbackRing.cpp \
 	libmaindisplay/ExynosPrimaryDisplay.cpp \
 	libresource/ExynosMPP.cpp \
 	libresource/ExynosResourceManager.cpp \
@@ -146,12 +152,16 @@ LOCAL_SRC_FILES := \
 	libdisplayinterface/ExynosDisplayInterface.cpp \
 	libdisplayinterface/ExynosDeviceDrmInterface.cpp \
 	libdisplayinterface/ExynosDisplayDrmInterface.cpp \
+	libdisplayinterface/FramebufferCache.cpp \
 	libvrr/display/common/CommonDisplayContextProvider.cpp \
 	libvrr/display/exynos/ExynosDisplayContextProvider.cpp \
 	libvrr/Power/PowerStatsProfileTokenGenerator.cpp \
 	libvrr/Power/DisplayStateResidencyProvider.cpp \
 	libvrr/Power/DisplayStateResidencyWatcher.cpp \
 	libvrr/FileNode.cpp \
+	libvrr/FrameInsertionScheduler.cpp \
+	libvrr/PresentCadencePredictor.cpp \
+	libvrr/PresentRecordQueue.cpp \
 	libvrr/RefreshRateCalculator/InstantRefreshRateCalculator.cpp \
 	libvrr/RefreshRateCalculator/ExitIdleRefreshRateCalculator.cpp \
 	libvrr/RefreshRateCalculator/PeriodRefreshRateCalculator.cpp \
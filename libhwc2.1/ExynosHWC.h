@@ -40,6 +40,7 @@ enum {
     HWC_CTL_SKIP_VALIDATE = 112,
     HWC_CTL_DUMP_MID_BUF = 200,
     HWC_CTL_CAPTURE_READBACK = 201,
+    HWC_CTL_CAPTURE_READBACK_RING = 202,
     HWC_CTL_ENABLE_COMPOSITION_CROP = 300,
     HWC_CTL_ENABLE_EXYNOSCOMPOSITION_OPT = 301,
     HWC_CTL_ENABLE_CLIENTCOMPOSITION_OPT = 302,
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DisplayReadbackRing.h"
+
+#include <sync/sync.h>
+
+#include "ExynosDisplay.h"
+#include "ExynosHWCHelper.h"
+
+bool DisplayReadbackRing::isFenceSignaled(int32_t fence) {
+    return sync_wait(fence, 0) == 0;
+}
+
+void DisplayReadbackRing::waitFence(int32_t fence) {
+    if (sync_wait(fence, kWritebackTimeoutMs) < 0) {
+        ALOGE("%s: readback fence(%d) did not signal", __func__, fence);
+    }
+}
+
+void DisplayReadbackRing::onReleaseFence(int32_t fence) {
+    setFenceInfo(fence, mDisplay, FENCE_TYPE_READBACK_RELEASE, FENCE_IP_FB,
+                 HwcFenceDirection::FROM);
+}
+
+void DisplayReadbackRing::closeAcquireFence(int32_t fence) {
+    fence_close(fence, mDisplay, FENCE_TYPE_READBACK_ACQUIRE, FENCE_IP_DPP);
+}
+
+void DisplayReadbackRing::closeReleaseFence(int32_t fence) {
+    fence_close(fence, mDisplay, FENCE_TYPE_READBACK_RELEASE, FENCE_IP_FB);
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _DISPLAY_READBACK_RING_H_
+#define _DISPLAY_READBACK_RING_H_
+
+#include "ReadbackRing.h"
+
+class ExynosDisplay;
+
+/* The readback ring of a display, its fences are tracked by the fence debugger */
+class DisplayReadbackRing : public ReadbackRing {
+public:
+    explicit DisplayReadbackRing(ExynosDisplay* display) : mDisplay(display) {}
+    ~DisplayReadbackRing() override { setBuffers({}); }
+
+protected:
+    bool isFenceSignaled(int32_t fence) override;
+    void waitFence(int32_t fence) override;
+    void onReleaseFence(int32_t fence) override;
+    void closeAcquireFence(int32_t fence) override;
+    void closeReleaseFence(int32_t fence) override;
+
+private:
+    /* Long enough for the writeback of one frame at the lowest refresh rate */
+    static constexpr int kWritebackTimeoutMs = 1000;
+
+    ExynosDisplay* const mDisplay;
+};
+
+#endif // _DISPLAY_READBACK_RING_H_
@@ -239,7 +239,11 @@ void ExynosDevice::initDeviceInterface(uint32_t interfaceType)
 }
 
 ExynosDevice::~ExynosDevice() {
-    mDRLoopStatus = false;
+    {
+        std::lock_guard<std::mutex> lock(mDRWakeUpMutex);
+        mDRLoopStatus = false;
+    }
+    mDRWakeUpCondition.notify_one();
     mDRThread.join();
     for(auto& display : mDisplays) {
         delete display;
@@ -315,7 +319,10 @@ void ExynosDevice::checkDynamicRecompositionThread()
                 return;
         }
         ALOGI("Destroying dynamic recomposition thread");
-        mDRLoopStatus = false;
+        {
+            std::lock_guard<std::mutex> lock(mDRWakeUpMutex);
+            mDRLoopStatus = false;
+        }
         mDRWakeUpCondition.notify_one();
         mDRThread.join();
     }
@@ -330,45 +337,73 @@ void ExynosDevice::dynamicRecompositionThreadCreate()
     }
 }
 
+void ExynosDevice::armDynamicRecompositionTimer(ExynosDisplay *display)
+{
+    nsecs_t deadline = systemTime(SYSTEM_TIME_MONOTONIC) + kDynamicRecompIdleTimeNs;
+    bool wasArmed;
+    {
+        std::lock_guard<std::mutex> lock(mDRWakeUpMutex);
+        wasArmed = (display->mDRIdleDeadline != 0);
+        display->mDRIdleDeadline = deadline;
+    }
+    /* A later deadline is picked up when the thread wakes for the earlier one */
+    if (!wasArmed)
+        mDRWakeUpCondition.notify_one();
+}
+
+/*
+ * Sleeps until the earliest idle deadline armed by validateDisplay(). A display
+ * that has not been updated by its deadline is checked once for DEVICE_2_CLIENT,
+ * and the thread doesn't wake again until a display is updated.
+ *
+ * The check has to run when nothing else happens on the display, and no
+ * existing timer fires then: vsync callbacks are disabled by SurfaceFlinger
+ * once it stops updating, the drm event and uevent threads only wake on kernel
+ * events, and the VRR controller thread exists on VRR panels only. So this
+ * thread stays, but as a one-shot timer rather than a poll.
+ */
 void *ExynosDevice::dynamicRecompositionThreadLoop(void *data)
 {
     ExynosDevice *dev = (ExynosDevice *)data;
-    ExynosDisplay *display[dev->mDisplays.size()];
-    uint64_t event_cnt[dev->mDisplays.size()];
 
-    for (uint32_t i = 0; i < dev->mDisplays.size(); i++) {
-        display[i] = dev->mDisplays[i];
-        event_cnt[i] = 0;
-    }
     android_atomic_inc(&(dev->mDRThreadStatus));
 
+    std::unique_lock<std::mutex> lock(dev->mDRWakeUpMutex);
     while (dev->mDRLoopStatus) {
-        for (uint32_t i = 0; i < dev->mDisplays.size(); i++)
-            event_cnt[i] = display[i]->mUpdateEventCnt;
+        nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        nsecs_t nextDeadline = 0;
 
-        /*
-         * If there is no update for more than 5s, favor the client composition mode.
-         * If all other conditions are met, mode will be switched to client composition.
-         */
-        {
-            std::unique_lock<std::mutex> lock(dev->mDRWakeUpMutex);
-            dev->mDRWakeUpCondition.wait_for(lock, std::chrono::seconds(5));
-            if (!dev->mDRLoopStatus) {
-                break;
-            }
-        }
         for (uint32_t i = 0; i < dev->mDisplays.size(); i++) {
-            if (display[i]->mDREnable &&
-                display[i]->mPlugState == true &&
-                event_cnt[i] == display[i]->mUpdateEventCnt) {
-                if (display[i]->checkDynamicReCompMode() == DEVICE_2_CLIENT) {
-                    display[i]->mUpdateEventCnt = 0;
-                    display[i]->setGeometryChanged(GEOMETRY_DISPLAY_DYNAMIC_RECOMPOSITION);
-                    dev->onRefresh(display[i]->mDisplayId);
-                }
+            ExynosDisplay *display = dev->mDisplays[i];
+            if (display->mDRIdleDeadline == 0)
+                continue;
+            if (display->mDRIdleDeadline > now) {
+                if ((nextDeadline == 0) || (display->mDRIdleDeadline < nextDeadline))
+                    nextDeadline = display->mDRIdleDeadline;
+                continue;
             }
+
+            display->mDRIdleDeadline = 0;
+            lock.unlock();
+            if (display->mDREnable &&
+                display->mPlugState == true &&
+                display->checkDynamicReCompMode() == DEVICE_2_CLIENT) {
+                display->mUpdateEventCnt = 0;
+                display->setGeometryChanged(GEOMETRY_DISPLAY_DYNAMIC_RECOMPOSITION);
+                dev->onRefresh(display->mDisplayId);
+            }
+            lock.lock();
         }
+
+        if (!dev->mDRLoopStatus)
+            break;
+
+        if (nextDeadline == 0)
+            dev->mDRWakeUpCondition.wait(lock);
+        else
+            dev->mDRWakeUpCondition.wait_for(lock, std::chrono::nanoseconds(nextDeadline - now));
     }
+    lock.unlock();
 
     android_atomic_dec(&(dev->mDRThreadStatus));
 
@@ -840,6 +875,9 @@ void ExynosDevice::setHWCControl(uint32_t displayId, uint32_t ctrl, int32_t val)
         case HWC_CTL_CAPTURE_READBACK:
             captureScreenWithReadback(displayId);
             break;
+        case HWC_CTL_CAPTURE_READBACK_RING:
+            captureFramesWithReadbackRing(displayId, (uint32_t)val);
+            break;
         case HWC_CTL_DISPLAY_MODE:
             ALOGI("%s::HWC_CTL_DISPLAY_MODE mode=%d", __func__, val);
             setDisplayMode((uint32_t)val);
@@ -1232,6 +1270,69 @@ void ExynosDevice::captureScreenWithReadback(uint32_t displayId) {
     captureClass.saveToFile(fileName);
 }
 
+void ExynosDevice::captureFramesWithReadbackRing(uint32_t displayId, uint32_t numFrames) {
+    constexpr size_t kRingBufferCount = 3;
+
+    ExynosDisplay *display = getDisplay(displayId);
+    if (display == nullptr) {
+        ALOGE("There is no display(%d)", displayId);
+        return;
+    }
+
+    int32_t outFormat;
+    int32_t outDataspace;
+    int32_t ret = 0;
+    if ((ret = display->getReadbackBufferAttributes(
+                &outFormat, &outDataspace)) != HWC2_ERROR_NONE) {
+        ALOGE("getReadbackBufferAttributes fail, ret(%d)", ret);
+        return;
+    }
+
+    std::vector<std::unique_ptr<captureReadbackClass>> captureClasses;
+    std::vector<buffer_handle_t> buffers;
+    for (size_t i = 0; i < kRingBufferCount; i++) {
+        captureClasses.push_back(std::make_unique<captureReadbackClass>(this));
+        if (captureClasses.back()->allocBuffer(outFormat, display->mXres, display->mYres) !=
+            NO_ERROR) {
+            return;
+        }
+        buffers.push_back(captureClasses.back()->getBuffer());
+    }
+    if (display->setReadbackRing(buffers) != HWC2_ERROR_NONE) {
+        ALOGE("setReadbackRing fail");
+        return;
+    }
+
+    /* Each refresh captures at most one frame, give up after twice as many as requested */
+    uint32_t captured = 0;
+    for (uint32_t refresh = 0; (captured < numFrames) && (refresh < 2 * numFrames); refresh++) {
+        onRefresh(displayId);
+        usleep(display->mVsyncPeriod / 1000);
+
+        ReadbackRing::Frame frame;
+        while ((captured < numFrames) && display->acquireReadbackFrame(frame)) {
+            if (sync_wait(frame.fence, 1000) < 0) {
+                ALOGE("sync wait error, fence(%d)", frame.fence);
+            }
+            hwcFdClose(frame.fence);
+
+            for (auto &captureClass : captureClasses) {
+                if (captureClass->getBuffer() != frame.buffer) continue;
+                String8 fileName;
+                fileName.appendFormat("capture_ring_format%d_%dx%d_%" PRIu64 ".raw", outFormat,
+                                      display->mXres, display->mYres, frame.sequence);
+                captureClass->saveToFile(fileName);
+            }
+            display->releaseReadbackFrame(frame.buffer, -1);
+            captured++;
+        }
+    }
+    ALOGD("captured %u of %u frames with the readback ring", captured, numFrames);
+
+    /* Waits for the frames still being written before the buffers are freed */
+    display->setReadbackRing({});
+}
+
 int32_t ExynosDevice::setDisplayDeviceMode(int32_t display_id, int32_t mode)
 {
     int32_t ret = HWC2_ERROR_NONE;
@@ -180,6 +180,7 @@ class ExynosDevice {
         volatile int32_t mDRThreadStatus;
         std::atomic<bool> mDRLoopStatus;
         bool mPrimaryBlank;
+        /* Guards mDRLoopStatus changes and ExynosDisplay::mDRIdleDeadline */
         std::mutex mDRWakeUpMutex;
         std::condition_variable mDRWakeUpCondition;
 
@@ -234,6 +235,8 @@ class ExynosDevice {
 
         void dynamicRecompositionThreadCreate();
         static void* dynamicRecompositionThreadLoop(void *data);
+        /* Schedules an idle check of the display for dynamic recomposition */
+        void armDynamicRecompositionTimer(ExynosDisplay *display);
 
 
         /**
@@ -329,6 +332,7 @@ class ExynosDevice {
                 ExynosDevice* mDevice = nullptr;
         };
         void captureScreenWithReadback(uint32_t displayType);
+        void captureFramesWithReadbackRing(uint32_t displayId, uint32_t numFrames);
         void cleanupCaptureScreen(void *buffer);
         void signalReadbackDone();
         void clearWaitingReadbackReqDone() {
@@ -64,8 +64,6 @@ extern struct update_time_info updateTimeInfo;
 
 constexpr const char* kBufferDumpPath = "/data/vendor/log/hwc";
 
-constexpr float kDynamicRecompFpsThreshold = 1.0 / 5.0; // 1 frame update per 5 second
-
 constexpr float nsecsPerSec = std::chrono::nanoseconds(1s).count();
 constexpr int64_t nsecsIdleHintTimeout = std::chrono::nanoseconds(100ms).count();
 
@@ -1185,6 +1183,7 @@ int32_t ExynosDisplay::destroyLayer(hwc2_layer_t outLayer) {
         return HWC2_ERROR_BAD_LAYER;
     }
 
+    mLayerIndex.erase(layer);
     if (mLayers.remove(layer) < 0) {
         auto it = std::find(mIgnoreLayers.begin(), mIgnoreLayers.end(), layer);
         if (it == mIgnoreLayers.end()) {
@@ -1226,21 +1225,14 @@ void ExynosDisplay::destroyLayers() {
         it = mIgnoreLayers.erase(it);
         delete layer;
     }
+    mLayerIndex.clear();
 }
 
 ExynosLayer *ExynosDisplay::checkLayer(hwc2_layer_t addr) {
     ExynosLayer *temp = (ExynosLayer *)addr;
-    if (!mLayers.isEmpty()) {
-        for (size_t i = 0; i < mLayers.size(); i++) {
-            if (mLayers[i] == temp)
-                return mLayers[i];
-        }
-    }
-
-    if (mIgnoreLayers.size()) {
-        auto it = std::find(mIgnoreLayers.begin(), mIgnoreLayers.end(), temp);
-        return (it == mIgnoreLayers.end()) ? NULL : *it;
-    }
+    /* Moving a layer between mLayers and mIgnoreLayers keeps it in mLayerIndex */
+    if (mLayerIndex.count(temp))
+        return temp;
 
     ALOGE("HWC2 : %s : %d, wrong layer request!", __func__, __LINE__);
     return NULL;
@@ -1274,6 +1266,7 @@ void ExynosDisplay::checkIgnoreLayers() {
             layer->mAcquireFence = -1;
 
             layer->mReleaseFence = -1;
+            layer->mSharedReleaseFence.reset();
             mIgnoreLayers.push_back(layer);
             mLayers.removeAt(index);
         } else {
@@ -1355,8 +1348,10 @@ int ExynosDisplay::checkLayerFps() {
     Mutex::Autolock lock(mDRMutex);
 
     for (size_t i=0; i < mLayers.size(); i++) {
+        /* Let layers that stopped updating fall to low fps */
+        mLayers[i]->checkFps(/* increaseCount */ false);
         if ((mLayers[i]->mOverlayPriority < ePriorityHigh) &&
-            (mLayers[i]->getFps() < LOW_FPS_THRESHOLD)) {
+            mLayers[i]->isLowFps()) {
             mLowFpsLayerInfo.addLowFpsLayer(i);
         } else if (mLowFpsLayerInfo.mHasLowFpsLayer == true) {
             break;
@@ -1439,18 +1434,9 @@ int ExynosDisplay::checkDynamicReCompMode() {
     }
 
     /*
-     * There will be at least one composition call per one minute (because of time update)
-     * To minimize the analysis overhead, just analyze it once in 5 second
-     */
-    auto timeStampDiff = systemTime(SYSTEM_TIME_MONOTONIC) - mLastModeSwitchTimeStamp;
-
-    /*
-     * previous CompModeSwitch was CLIENT_2_DEVICE: check fps after 5s from mLastModeSwitchTimeStamp
-     * previous CompModeSwitch was DEVICE_2_CLIENT: check immediately
+     * Layer update rates are estimated on every buffer update, so they are
+     * checked on every call instead of once per stable period.
      */
-    if ((mDynamicReCompMode != DEVICE_2_CLIENT) && (timeStampDiff < kLayerFpsStableTimeNs))
-        return 0;
-
     mLastModeSwitchTimeStamp = mLastUpdateTimeStamp;
     float updateFps = 0;
     if ((mUpdateEventCnt != 1) &&
@@ -1469,7 +1455,8 @@ int ExynosDisplay::checkDynamicReCompMode() {
 
     /*
      * FPS estimation.
-     * If FPS is lower than kDynamicRecompFpsThreshold, try to switch the mode to GLES
+     * If FPS is lower than kDynamicRecompFpsThreshold, try to switch the mode to GLES.
+     * Switch back once FPS reaches kDynamicRecompFpsExitThreshold.
      */
     if (updateFps < kDynamicRecompFpsThreshold) {
         auto ret = switchDynamicReCompMode(DEVICE_2_CLIENT);
@@ -1478,7 +1465,7 @@ int ExynosDisplay::checkDynamicReCompMode() {
                          updateFps);
         }
         return ret;
-    } else {
+    } else if (updateFps >= kDynamicRecompFpsExitThreshold) {
         auto ret = switchDynamicReCompMode(CLIENT_2_DEVICE);
         if (ret) {
             DISPLAY_LOGD(eDebugDynamicRecomp, "[DYNAMIC_RECOMP] CLIENT_2_HWC by high FPS((%.2f)",
@@ -1548,6 +1535,7 @@ int ExynosDisplay::handleStaticLayers(ExynosCompositionInfo& compositionInfo)
                 fence_close(mLayers[i]->mAcquireFence, this, FENCE_TYPE_SRC_ACQUIRE, FENCE_IP_ALL);
             mLayers[i]->mAcquireFence = -1;
             mLayers[i]->mReleaseFence = -1;
+            mLayers[i]->mSharedReleaseFence.reset();
         }
 
         if (compositionInfo.mTargetBuffer == NULL) {
@@ -2766,12 +2754,13 @@ int ExynosDisplay::deliverWinConfigData() {
             goto err;
         } else {
             mLastDpuData = mDpuData;
+            /* Only the configs are compared, don't keep the fence open for another frame */
+            mLastDpuData.release_fence.reset();
         }
 
-        for (size_t i = 0; i < mDpuData.configs.size(); i++) {
-            setFenceInfo(mDpuData.configs[i].rel_fence, this, FENCE_TYPE_SRC_RELEASE, FENCE_IP_DPP,
-                         HwcFenceDirection::FROM);
-        }
+        if (mDpuData.release_fence)
+            setFenceInfo(mDpuData.release_fence->get(), this, FENCE_TYPE_SRC_RELEASE,
+                         FENCE_IP_DPP, HwcFenceDirection::FROM);
         setFenceInfo(mDpuData.retire_fence, this, FENCE_TYPE_RETIRE, FENCE_IP_DPP,
                      HwcFenceDirection::FROM);
     }
@@ -2791,8 +2780,12 @@ err:
  */
 int ExynosDisplay::setReleaseFences() {
 
-    int release_fd = -1;
     String8 errString;
+    /* Layers on buffer windows keep a reference, it is dup'ed when handed out */
+    const std::shared_ptr<SharedFence> &windowRelease = mDpuData.release_fence;
+
+    for (size_t i = 0; i < mLayers.size(); i++)
+        mLayers[i]->mSharedReleaseFence.reset();
 
     /*
      * Close release fence for client target buffer
@@ -2802,8 +2795,6 @@ int ExynosDisplay::setReleaseFences() {
         (mClientCompositionInfo.mWindowIndex >= 0) &&
         (mClientCompositionInfo.mWindowIndex < (int32_t)mDpuData.configs.size())) {
 
-        exynos_win_config_data &config = mDpuData.configs[mClientCompositionInfo.mWindowIndex];
-
         for (int i = mClientCompositionInfo.mFirstIndex; i <= mClientCompositionInfo.mLastIndex; i++) {
             if (mLayers[i]->mExynosCompositionType != HWC2_COMPOSITION_CLIENT) {
                 if(mLayers[i]->mOverlayPriority < ePriorityHigh) {
@@ -2813,16 +2804,10 @@ int ExynosDisplay::setReleaseFences() {
                     continue;
                 }
             }
-            if (mType == HWC_DISPLAY_VIRTUAL)
-                mLayers[i]->mReleaseFence = -1;
-            else
-                mLayers[i]->mReleaseFence =
-                    hwcCheckFenceDebug(this, FENCE_TYPE_SRC_RELEASE, FENCE_IP_DPP,
-                            hwc_dup(config.rel_fence, this,
-                                FENCE_TYPE_SRC_RELEASE, FENCE_IP_DPP));
+            mLayers[i]->mReleaseFence = -1;
+            if (mType != HWC_DISPLAY_VIRTUAL)
+                mLayers[i]->mSharedReleaseFence = windowRelease;
         }
-        config.rel_fence = fence_close(config.rel_fence, this,
-                   FENCE_TYPE_SRC_RELEASE, FENCE_IP_FB);
     }
 
     // DPU doesn't close acq_fence, HWC should close it.
@@ -2854,7 +2839,6 @@ int ExynosDisplay::setReleaseFences() {
                     __func__, i, mLayers[i]->mWindowIndex);
             goto err;
         }
-        exynos_win_config_data &config = mDpuData.configs[mLayers[i]->mWindowIndex];
         if (mLayers[i]->mOtfMPP != NULL) {
             mLayers[i]->mOtfMPP->setHWStateFence(-1);
         }
@@ -2862,9 +2846,8 @@ int ExynosDisplay::setReleaseFences() {
             if (mLayers[i]->mM2mMPP->mUseM2MSrcFence)
                 mLayers[i]->mReleaseFence = mLayers[i]->mM2mMPP->getSrcReleaseFence(0);
             else {
-                mLayers[i]->mReleaseFence = hwcCheckFenceDebug(this, FENCE_TYPE_SRC_RELEASE, FENCE_IP_DPP,
-                    hwc_dup(config.rel_fence, this,
-                        FENCE_TYPE_SRC_RELEASE, FENCE_IP_LAYER));
+                mLayers[i]->mReleaseFence = -1;
+                mLayers[i]->mSharedReleaseFence = windowRelease;
             }
 
             mLayers[i]->mM2mMPP->resetSrcReleaseFence();
@@ -2872,12 +2855,10 @@ int ExynosDisplay::setReleaseFences() {
             mLayers[i]->mM2mMPP->setDstAcquireFence(-1);
 #else
             DISPLAY_LOGD(eDebugFence, "m2m : win_index(%d), releaseFencefd(%d)",
-                    mLayers[i]->mWindowIndex, config.rel_fence);
-            if (config.rel_fence > 0) {
-                release_fd = config.rel_fence;
+                    mLayers[i]->mWindowIndex, windowRelease ? windowRelease->get() : -1);
+            if (windowRelease) {
+                int release_fd = windowRelease->dup(FENCE_TYPE_DST_ACQUIRE, FENCE_IP_DPP);
                 if (release_fd >= 0) {
-                    setFenceInfo(release_fd, this, FENCE_TYPE_DST_ACQUIRE, FENCE_IP_DPP,
-                                 HwcFenceDirection::UPDATE, true);
                     mLayers[i]->mM2mMPP->setDstAcquireFence(release_fd);
                 } else {
                     DISPLAY_LOGE("fail to dup, ret(%d, %s)", errno, strerror(errno));
@@ -2893,21 +2874,10 @@ int ExynosDisplay::setReleaseFences() {
 #ifdef DISABLE_FENCE
             mLayers[i]->mReleaseFence = -1;
 #else
-            DISPLAY_LOGD(eDebugFence, "other : win_index(%d), releaseFencefd(%d)",
-                    mLayers[i]->mWindowIndex, config.rel_fence);
-            if (config.rel_fence > 0) {
-                release_fd = hwcCheckFenceDebug(this, FENCE_TYPE_SRC_RELEASE, FENCE_IP_DPP, config.rel_fence);
-                if (release_fd >= 0)
-                    mLayers[i]->mReleaseFence = release_fd;
-                else {
-                    DISPLAY_LOGE("fail to dup, ret(%d, %s)", errno, strerror(errno));
-                    mLayers[i]->mReleaseFence = -1;
-                }
-            } else {
-                mLayers[i]->mReleaseFence = -1;
-            }
-            DISPLAY_LOGD(eDebugFence, "Direct overlay layer[%zu].releaseFencefd(%d)",
-                i, mLayers[i]->mReleaseFence);
+            DISPLAY_LOGD(eDebugFence, "Direct overlay : win_index(%d), releaseFencefd(%d)",
+                    mLayers[i]->mWindowIndex, windowRelease ? windowRelease->get() : -1);
+            mLayers[i]->mReleaseFence = -1;
+            mLayers[i]->mSharedReleaseFence = windowRelease;
 #endif
         }
     }
@@ -2925,7 +2895,6 @@ int ExynosDisplay::setReleaseFences() {
                     __func__, mExynosCompositionInfo.mWindowIndex);
             goto err;
         }
-        exynos_win_config_data &config = mDpuData.configs[mExynosCompositionInfo.mWindowIndex];
         for (int i = mExynosCompositionInfo.mFirstIndex; i <= mExynosCompositionInfo.mLastIndex; i++) {
             /* break when only framebuffer target is assigned on ExynosCompositor */
             if (i == -1)
@@ -2940,9 +2909,8 @@ int ExynosDisplay::setReleaseFences() {
                 mLayers[i]->mReleaseFence =
                     mExynosCompositionInfo.mM2mMPP->getSrcReleaseFence(i-mExynosCompositionInfo.mFirstIndex);
             else {
-                mLayers[i]->mReleaseFence =
-                    hwc_dup(config.rel_fence,
-                            this, FENCE_TYPE_SRC_RELEASE, FENCE_IP_LAYER);
+                mLayers[i]->mReleaseFence = -1;
+                mLayers[i]->mSharedReleaseFence = windowRelease;
             }
 
             DISPLAY_LOGD(eDebugFence, "exynos composition layer[%d].releaseFencefd(%d)",
@@ -2953,10 +2921,9 @@ int ExynosDisplay::setReleaseFences() {
 #ifdef DISABLE_FENCE
             mExynosCompositionInfo.mM2mMPP->setDstAcquireFence(-1);
 #else
-            if (config.rel_fence > 0) {
-                setFenceInfo(config.rel_fence, this, FENCE_TYPE_DST_ACQUIRE, FENCE_IP_DPP,
-                             HwcFenceDirection::UPDATE, true);
-                mExynosCompositionInfo.mM2mMPP->setDstAcquireFence(config.rel_fence);
+            if (windowRelease) {
+                mExynosCompositionInfo.mM2mMPP->setDstAcquireFence(
+                        windowRelease->dup(FENCE_TYPE_DST_ACQUIRE, FENCE_IP_DPP));
             } else {
                 mExynosCompositionInfo.mM2mMPP->setDstAcquireFence(-1);
             }
@@ -3026,6 +2993,7 @@ int32_t ExynosDisplay::createLayer(hwc2_layer_t* outLayer) {
 
     /* TODO : Sort sequence should be added to somewhere */
     mLayers.add((ExynosLayer*)layer);
+    mLayerIndex.insert(layer);
 
     /* TODO : Set z-order to max, check outLayer address? */
     layer->setLayerZOrder(1000);
@@ -3344,8 +3312,23 @@ int32_t ExynosDisplay::getReleaseFences(
     if (outLayers != NULL && outFences != NULL) {
         // second pass call
         for (size_t i = 0; i < mLayers.size(); i++) {
-            if (mLayers[i]->mReleaseFence >= 0) {
+            if (mLayers[i]->hasReleaseFence()) {
                 if (deviceLayerNum < *outNumElements) {
+                    // a shared release fence is dup'ed only when it is handed out
+                    if (mLayers[i]->mReleaseFence < 0) {
+                        mLayers[i]->mReleaseFence =
+                                mLayers[i]->mSharedReleaseFence->dup(FENCE_TYPE_SRC_RELEASE,
+                                                                     FENCE_IP_LAYER);
+                        if (mLayers[i]->mReleaseFence < 0) {
+                            DISPLAY_LOGE("%s: [%zu] layer fails to dup release fence(%d)",
+                                         __func__, i, mLayers[i]->mSharedReleaseFence->get());
+                            mLayers[i]->mSharedReleaseFence.reset();
+                            continue;
+                        }
+                        setFenceInfo(mLayers[i]->mReleaseFence, this, FENCE_TYPE_SRC_RELEASE,
+                                     FENCE_IP_LAYER, HwcFenceDirection::TO);
+                    }
+                    mLayers[i]->mSharedReleaseFence.reset();
                     // transfer fence ownership to the caller
                     setFenceName(mLayers[i]->mReleaseFence, FENCE_LAYER_RELEASE_DPP);
                     outLayers[deviceLayerNum] = (hwc2_layer_t)mLayers[i];
@@ -3365,7 +3348,7 @@ int32_t ExynosDisplay::getReleaseFences(
     } else {
         // first pass call
         for (size_t i = 0; i < mLayers.size(); i++) {
-            if (mLayers[i]->mReleaseFence >= 0) {
+            if (mLayers[i]->hasReleaseFence()) {
                 deviceLayerNum++;
             }
         }
@@ -3721,6 +3704,7 @@ int32_t ExynosDisplay::presentDisplay(int32_t* outRetireFence) {
         *outRetireFence = -1;
         for (size_t i=0; i < mLayers.size(); i++) {
             mLayers[i]->mReleaseFence = -1;
+            mLayers[i]->mSharedReleaseFence.reset();
         }
         if (mRenderingState == RENDERING_STATE_NONE) {
             ALOGD("\tThis is the first frame after power on");
@@ -3830,6 +3814,7 @@ int32_t ExynosDisplay::presentDisplay(int32_t* outRetireFence) {
 
         if (mLayers[i]->mExynosCompositionType == HWC2_COMPOSITION_CLIENT) {
             mLayers[i]->mReleaseFence = -1;
+            mLayers[i]->mSharedReleaseFence.reset();
             mLayers[i]->mAcquireFence =
                 fence_close(mLayers[i]->mAcquireFence, this,
                         FENCE_TYPE_SRC_ACQUIRE, FENCE_IP_LAYER);
@@ -3883,6 +3868,19 @@ int32_t ExynosDisplay::presentDisplay(int32_t* outRetireFence) {
 
     handleWindowUpdate();
 
+    /*
+     * A one-shot readback requested for this frame takes precedence over the ring.
+     * Armed only once the frame is going to be committed, so the frame completes it
+     * in presentPostProcessing.
+     */
+    if (!mDpuData.enable_readback && mDisplayControl.readbackSupport) {
+        if (buffer_handle_t buffer = mReadbackRing.arm()) {
+            mDpuData.enable_readback = true;
+            setReadbackBufferInternal(buffer, -1, true);
+            mReadbackFromRing = true;
+        }
+    }
+
     setDisplayWinConfigData();
 
     if ((ret = deliverWinConfigData()) != NO_ERROR) {
@@ -3890,6 +3888,7 @@ int32_t ExynosDisplay::presentDisplay(int32_t* outRetireFence) {
         if (mDpuData.retire_fence > 0)
             fence_close(mDpuData.retire_fence, this, FENCE_TYPE_RETIRE, FENCE_IP_DPP);
         mDpuData.retire_fence = -1;
+        mDpuData.release_fence.reset();
     }
 
     setReleaseFences();
@@ -4019,6 +4018,12 @@ not_validated:
 
 int32_t ExynosDisplay::presentPostProcessing()
 {
+    if (mReadbackFromRing) {
+        /* The ring owns the acquire fence, it is not returned by getReadbackBufferFence */
+        mReadbackRing.complete(mDpuData.readback_info.acq_fence);
+        mDpuData.readback_info.acq_fence = -1;
+        mReadbackFromRing = false;
+    }
     setReadbackBufferInternal(NULL, -1, false);
     if (mDpuData.enable_readback)
         mDevice->signalReadbackDone();
@@ -4126,6 +4131,8 @@ int32_t ExynosDisplay::setClientTarget(
     if (handle) {
         mClientCompositionInfo.mCompressionInfo = getCompressionInfo(handle);
         mExynosCompositionInfo.mCompressionInfo = getCompressionInfo(handle);
+        if (!mExynosCompositionInfo.mHasCompositionLayer)
+            mDisplayInterface->preimportBuffer(nullptr, handle);
     }
 
     return 0;
@@ -4938,6 +4945,8 @@ int32_t ExynosDisplay::validateDisplay(
         if (mDevice->isDynamicRecompositionThreadAlive() == false &&
             mDevice->mDRLoopStatus == false)
             mDevice->dynamicRecompositionThreadCreate();
+        if (mDynamicReCompMode != DEVICE_2_CLIENT)
+            mDevice->armDynamicRecompositionTimer(this);
     }
 
     if ((ret = mResourceManager->assignResource(this)) != NO_ERROR) {
@@ -4988,6 +4997,7 @@ int32_t ExynosDisplay::validateDisplay(
         mClientCompositionInfo.mSkipStaticInitFlag = false;
         mExynosCompositionInfo.mSkipStaticInitFlag = false;
         mResourceManager->resetAssignedResources(this, true);
+        mResourceManager->invalidateAssignment(this);
         mClientCompositionInfo.initializeInfos(this);
         mExynosCompositionInfo.initializeInfos(this);
         for (uint32_t i = 0; i < mLayers.size(); i++) {
@@ -5136,6 +5146,17 @@ void ExynosDisplay::dumpLocked(String8& result) {
     mClientCompositionInfo.dump(result);
     mExynosCompositionInfo.dump(result);
 
+    if (mWindowUpdateStats.frames) {
+        const WindowUpdateStats &stats = mWindowUpdateStats;
+        result.appendFormat("Window update: frames %" PRIu64 ", partial %" PRIu64
+                            ", updated %.1f%%, damaged %.1f%% of full frame pixels\n",
+                            stats.frames, stats.partialFrames,
+                            100.0 * stats.updatedPixels / stats.fullPixels,
+                            100.0 * stats.damagePixels / stats.fullPixels);
+    }
+    if (mDisplayInterface) mDisplayInterface->dump(result);
+    mReadbackRing.dump(result);
+
     result.appendFormat("PanelGammaSource (%d)\n\n", GetCurrentPanelGammaSource());
 
     {
@@ -5755,7 +5776,99 @@ bool ExynosDisplay::windowUpdateExceptions()
     return false;
 }
 
+static uint64_t rectArea(const hwc_rect_t &rect)
+{
+    if ((rect.right <= rect.left) || (rect.bottom <= rect.top))
+        return 0;
+    return (uint64_t)WIDTH(rect) * HEIGHT(rect);
+}
+
+static bool isRectOverlapped(const hwc_rect_t &r1, const hwc_rect_t &r2)
+{
+    return (r1.left < r2.right) && (r2.left < r1.right) &&
+            (r1.top < r2.bottom) && (r2.top < r1.bottom);
+}
+
+void ExynosDisplay::DamageRegion::add(hwc_rect_t rect)
+{
+    for (;;) {
+        /* Absorb every rect it touches so that the rects stay disjoint */
+        bool merged = false;
+        for (size_t i = 0; i < count; i++) {
+            if (isRectOverlapped(rects[i], rect)) {
+                rect = expand(rects[i], rect);
+                rects[i] = rects[--count];
+                merged = true;
+                break;
+            }
+        }
+        if (merged)
+            continue;
+
+        if (count < kMaxRects)
+            break;
+
+        /* Out of slots: merge with the rect that adds the fewest pixels */
+        size_t best = 0;
+        uint64_t bestCost = UINT64_MAX;
+        for (size_t i = 0; i < count; i++) {
+            uint64_t cost = rectArea(expand(rects[i], rect)) - rectArea(rects[i]);
+            if (cost < bestCost) {
+                bestCost = cost;
+                best = i;
+            }
+        }
+        rect = expand(rects[best], rect);
+        rects[best] = rects[--count];
+    }
+    rects[count++] = rect;
+}
+
+hwc_rect_t ExynosDisplay::DamageRegion::bounds() const
+{
+    hwc_rect_t box = {INT_MAX, INT_MAX, 0, 0};
+    for (size_t i = 0; i < count; i++)
+        box = expand(box, rects[i]);
+    return box;
+}
+
+uint64_t ExynosDisplay::DamageRegion::area(const hwc_rect_t &bounds) const
+{
+    uint64_t pixels = 0;
+    for (size_t i = 0; i < count; i++) {
+        hwc_rect_t clipped = {max(rects[i].left, bounds.left), max(rects[i].top, bounds.top),
+                              min(rects[i].right, bounds.right),
+                              min(rects[i].bottom, bounds.bottom)};
+        pixels += rectArea(clipped);
+    }
+    return pixels;
+}
+
 int ExynosDisplay::handleWindowUpdate()
+{
+    DamageRegion region;
+    int ret = computeWindowUpdate(region);
+
+    if (exynosHWCControl.windowUpdate != 1)
+        return ret;
+
+    const hwc_rect_t bounds = {0, 0, (int)mXres, (int)mYres};
+    uint64_t fullPixels = rectArea(bounds);
+    uint64_t updatedPixels = fullPixels;
+    if (mDpuData.enable_win_update)
+        updatedPixels = (uint64_t)mDpuData.win_update_region.w * mDpuData.win_update_region.h;
+
+    mWindowUpdateStats.frames++;
+    if (updatedPixels < fullPixels)
+        mWindowUpdateStats.partialFrames++;
+    mWindowUpdateStats.fullPixels += fullPixels;
+    mWindowUpdateStats.updatedPixels += updatedPixels;
+    mWindowUpdateStats.damagePixels += region.complete ? region.area(bounds) : updatedPixels;
+
+    return ret;
+}
+
+int ExynosDisplay::computeWindowUpdate(DamageRegion &region)
 {
     int ret = NO_ERROR;
     // TODO will be implemented
@@ -5788,18 +5901,16 @@ int ExynosDisplay::handleWindowUpdate()
     if (windowUpdateExceptions())
         return 0;
 
-    hwc_rect mergedRect = {(int)mXres, (int)mYres, 0, 0};
     hwc_rect damageRect = {(int)mXres, (int)mYres, 0, 0};
 
     for (size_t i = 0; i < mLayers.size(); i++) {
         if (mLayers[i]->mExynosCompositionType == HWC2_COMPOSITION_DISPLAY_DECORATION) {
             continue;
         }
-        excp = getLayerRegion(mLayers[i], &damageRect, eDamageRegionByDamage);
+        excp = getLayerRegion(mLayers[i], &damageRect, eDamageRegionByDamage, &region);
         if (excp == eDamageRegionPartial) {
             DISPLAY_LOGD(eDebugWindowUpdate, "layer(%zu) partial : %d, %d, %d, %d", i,
                     damageRect.left, damageRect.top, damageRect.right, damageRect.bottom);
-            mergedRect = expand(mergedRect, damageRect);
         }
         else if (excp == eDamageRegionSkip) {
             int32_t windowIndex = mLayers[i]->mWindowIndex;
@@ -5812,11 +5923,11 @@ int ExynosDisplay::handleWindowUpdate()
                 damageRect.bottom = mLayers[i]->mDisplayFrame.bottom;
                 DISPLAY_LOGD(eDebugWindowUpdate, "Skip layer (origin) : %d, %d, %d, %d",
                         damageRect.left, damageRect.top, damageRect.right, damageRect.bottom);
-                mergedRect = expand(mergedRect, damageRect);
+                region.add(damageRect);
                 hwc_rect prevDst = {mLastDpuData.configs[i].dst.x, mLastDpuData.configs[i].dst.y,
                     mLastDpuData.configs[i].dst.x + (int)mLastDpuData.configs[i].dst.w,
                     mLastDpuData.configs[i].dst.y + (int)mLastDpuData.configs[i].dst.h};
-                mergedRect = expand(mergedRect, prevDst);
+                region.add(prevDst);
             } else {
                 DISPLAY_LOGD(eDebugWindowUpdate, "layer(%zu) skip", i);
                 continue;
@@ -5829,7 +5940,7 @@ int ExynosDisplay::handleWindowUpdate()
             damageRect.bottom = mLayers[i]->mDisplayFrame.bottom;
             DISPLAY_LOGD(eDebugWindowUpdate, "Full layer update : %d, %d, %d, %d", mLayers[i]->mDisplayFrame.left,
                     mLayers[i]->mDisplayFrame.top, mLayers[i]->mDisplayFrame.right, mLayers[i]->mDisplayFrame.bottom);
-            mergedRect = expand(mergedRect, damageRect);
+            region.add(damageRect);
         }
         else {
             DISPLAY_LOGD(eDebugWindowUpdate, "Partial canceled, Skip reason (layer %zu) : %d", i, excp);
@@ -5837,12 +5948,21 @@ int ExynosDisplay::handleWindowUpdate()
         }
     }
 
-    if (mergedRect.left == (int32_t)mXres && mergedRect.right == 0 &&
-        mergedRect.top == (int32_t)mYres && mergedRect.bottom == 0) {
+    if (region.count == 0) {
         DISPLAY_LOGD(eDebugWindowUpdate, "Partial canceled, All layer skiped" );
         return 0;
     }
 
+    region.complete = true;
+
+    /*
+     * The CRTC partial_region property is a single drm_clip_rect, so the DPU
+     * can only be given one window: the bounding box of the damage. The
+     * disjoint rects only measure how many pixels that box updates for
+     * nothing, see mWindowUpdateStats.
+     */
+    hwc_rect mergedRect = region.bounds();
+
     DISPLAY_LOGD(eDebugWindowUpdate, "Partial(origin) : %d, %d, %d, %d",
             mergedRect.left, mergedRect.top, mergedRect.right, mergedRect.bottom);
 
@@ -5873,7 +5993,8 @@ int ExynosDisplay::handleWindowUpdate()
     return 0;
 }
 
-unsigned int ExynosDisplay::getLayerRegion(ExynosLayer *layer, hwc_rect *rect_area, uint32_t regionType) {
+unsigned int ExynosDisplay::getLayerRegion(ExynosLayer *layer, hwc_rect *rect_area,
+                                           uint32_t regionType, DamageRegion *region) {
 
     android::Vector <hwc_rect_t> hwcRects;
     size_t numRects = 0;
@@ -5894,19 +6015,19 @@ unsigned int ExynosDisplay::getLayerRegion(ExynosLayer *layer, hwc_rect *rect_ar
 
     switch (regionType) {
     case eDamageRegionByDamage:
+        /* Validate every rect first so that an invalid one leaves the region untouched */
         for (size_t j = 0; j < hwcRects.size(); j++) {
-            hwc_rect_t rect;
-
             if ((hwcRects[j].left < 0) || (hwcRects[j].top < 0) ||
                     (hwcRects[j].right < 0) || (hwcRects[j].bottom < 0) ||
                     (hwcRects[j].left >= hwcRects[j].right) || (hwcRects[j].top >= hwcRects[j].bottom) ||
                     (hwcRects[j].right - hwcRects[j].left > WIDTH(layer->mSourceCrop)) ||
                     (hwcRects[j].bottom - hwcRects[j].top > HEIGHT(layer->mSourceCrop))) {
-                rect_area->left = INT_MAX;
-                rect_area->top = INT_MAX;
-                rect_area->right = rect_area->bottom = 0;
                 return eDamageRegionFull;
             }
+        }
+
+        for (size_t j = 0; j < hwcRects.size(); j++) {
+            hwc_rect_t rect;
 
             rect.left = layer->mDisplayFrame.left + hwcRects[j].left - layer->mSourceCrop.left;
             rect.top = layer->mDisplayFrame.top + hwcRects[j].top - layer->mSourceCrop.top;
@@ -5919,6 +6040,8 @@ unsigned int ExynosDisplay::getLayerRegion(ExynosLayer *layer, hwc_rect *rect_ar
             adjustRect(rect, INT_MAX, INT_MAX);
             /* Get sums of rects */
             *rect_area = expand(*rect_area, rect);
+            if (region != nullptr)
+                region->add(rect);
         }
         return eDamageRegionPartial;
         break;
@@ -6033,6 +6156,7 @@ void ExynosDisplay::closeFences()
                     FENCE_TYPE_SRC_RELEASE, FENCE_IP_LAYER);
             mLayers[i]->mReleaseFence = -1;
         }
+        mLayers[i]->mSharedReleaseFence.reset();
         if ((mLayers[i]->mExynosCompositionType == HWC2_COMPOSITION_DEVICE) &&
             (mLayers[i]->mM2mMPP != NULL)) {
             mLayers[i]->mM2mMPP->closeFences();
@@ -6062,6 +6186,7 @@ void ExynosDisplay::closeFences()
     if (mDpuData.retire_fence > 0)
         fence_close(mDpuData.retire_fence, this, FENCE_TYPE_RETIRE, FENCE_IP_DPP);
     mDpuData.retire_fence = -1;
+    mDpuData.release_fence.reset();
 
     mLastRetireFence = fence_close(mLastRetireFence, this,  FENCE_TYPE_RETIRE, FENCE_IP_DPP);
 
@@ -6289,6 +6414,18 @@ int32_t ExynosDisplay::setReadbackBufferAcqFence(int32_t acqFence) {
     return NO_ERROR;
 }
 
+int32_t ExynosDisplay::setReadbackRing(const std::vector<buffer_handle_t>& buffers)
+{
+    Mutex::Autolock lock(mDisplayMutex);
+
+    if (!buffers.empty() && !mDisplayControl.readbackSupport) {
+        DISPLAY_LOGE("readback is not supported but setReadbackRing is called");
+        return HWC2_ERROR_UNSUPPORTED;
+    }
+    mReadbackRing.setBuffers(buffers);
+    return NO_ERROR;
+}
+
 void ExynosDisplay::initDisplayInterface(uint32_t __unused interfaceType)
 {
     mDisplayInterface = std::make_unique<ExynosDisplayInterface>();
@@ -6734,6 +6871,10 @@ int32_t ExynosDisplay::SysfsBasedRRIHandler::disable() {
 void ExynosDisplay::SysfsBasedRRIHandler::updateRefreshRateLocked(int refreshRate) {
     ATRACE_CALL();
     ATRACE_INT("Refresh rate indicator event", refreshRate);
+    if (refreshRate != mLastRefreshRate) {
+        /* The panel refresh rate changed, which vsync prediction can't see */
+        mDisplay->mDisplayInterface->onVsyncTimingChanged();
+    }
     // Ignore refresh rate increase that is caused by refresh rate indicator update but there's
     // no update for the other layers
     if (mCanIgnoreIncreaseUpdate && refreshRate > mLastRefreshRate && mLastRefreshRate > 0 &&
@@ -24,11 +24,15 @@
 #include <utils/KeyedVector.h>
 #include <utils/Vector.h>
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <set>
+#include <unordered_set>
 
 #include "DeconHeader.h"
+#include "DisplayReadbackRing.h"
+#include "ExynosDisplayConfig.h"
 #include "ExynosDisplayInterface.h"
 #include "ExynosHWC.h"
 #include "ExynosHWCDebug.h"
@@ -46,6 +50,12 @@
 
 #define LOW_FPS_THRESHOLD     5
 
+constexpr float kDynamicRecompFpsThreshold = 1.0 / 5.0; // 1 frame update per 5 second
+/* Leaving DEVICE_2_CLIENT needs twice the threshold so that the mode doesn't flap */
+constexpr float kDynamicRecompFpsExitThreshold = kDynamicRecompFpsThreshold * 2;
+/* Without an update for this long, the update rate is under kDynamicRecompFpsThreshold */
+constexpr nsecs_t kDynamicRecompIdleTimeNs = s2ns(5) + ms2ns(100);
+
 using ::aidl::android::hardware::drm::HdcpLevels;
 using ::android::hardware::graphics::composer::RefreshRateChangeListener;
 using ::android::hardware::graphics::composer::V2_4::VsyncPeriodNanos;
@@ -252,6 +262,8 @@ struct exynos_win_config_data
 struct exynos_dpu_data
 {
     int retire_fence = -1;
+    /* Release fence of every buffer window, shared instead of dup'ed per window */
+    std::shared_ptr<SharedFence> release_fence;
     std::vector<exynos_win_config_data> configs;
     std::vector<exynos_win_config_data> rcdConfigs;
 
@@ -267,6 +279,7 @@ struct exynos_dpu_data
 
     void reset() {
         retire_fence = -1;
+        release_fence.reset();
         for (auto& config : configs) config.reset();
         for (auto& config : rcdConfigs) config.reset();
 
@@ -372,66 +385,12 @@ struct ResolutionInfo {
     int      nPanelType[3];
 };
 
-typedef struct FrameIntervalPowerHint {
-    int frameIntervalNs = 0;
-    int averageRefreshPeriodNs = 0;
-} FrameIntervalPowerHint_t;
-
-typedef struct NotifyExpectedPresentConfig {
-    int HeadsUpNs = 0;
-    int TimeoutNs = 0;
-} NotifyExpectedPresentConfig_t;
-
-typedef struct VrrConfig {
-    bool isFullySupported = false;
-    int vsyncPeriodNs = 0;
-    int minFrameIntervalNs = 0;
-    std::optional<std::vector<FrameIntervalPowerHint_t>> frameIntervalPowerHint;
-    std::optional<NotifyExpectedPresentConfig_t> notifyExpectedPresentConfig;
-} VrrConfig_t;
-
 typedef struct XrrSettings {
     android::hardware::graphics::composer::XrrVersionInfo_t versionInfo;
     NotifyExpectedPresentConfig_t notifyExpectedPresentConfig;
     std::function<void(int)> configChangeCallback;
 } XrrSettings_t;
 
-typedef struct displayConfigs {
-    std::string toString() const {
-        std::ostringstream os;
-        os << "vsyncPeriod = " << vsyncPeriod;
-        os << ", w = " << width;
-        os << ", h = " << height;
-        os << ", Xdpi = " << Xdpi;
-        os << ", Ydpi = " << Ydpi;
-        os << ", groupId = " << groupId;
-        os << (isNsMode ? ", NS " : ", HS ");
-        os << ", refreshRate = " << refreshRate;
-        return os.str();
-    }
-
-    // HWC2_ATTRIBUTE_VSYNC_PERIOD
-    VsyncPeriodNanos vsyncPeriod;
-    // HWC2_ATTRIBUTE_WIDTH
-    uint32_t width;
-    // case HWC2_ATTRIBUTE_HEIGHT
-    uint32_t height;
-    // HWC2_ATTRIBUTE_DPI_X
-    uint32_t Xdpi;
-    // HWC2_ATTRIBUTE_DPI_Y
-    uint32_t Ydpi;
-    // HWC2_ATTRIBUTE_CONFIG_GROUP
-    uint32_t groupId;
-
-    std::optional<VrrConfig_t> vrrConfig;
-
-    /* internal use */
-    bool isNsMode = false;
-    bool isOperationRateToBts;
-    bool isBoost2xBts;
-    int32_t refreshRate;
-} displayConfigs_t;
-
 struct DisplayControl {
     /** Composition crop en/disable **/
     bool enableCompositionCrop;
@@ -502,6 +461,8 @@ class ExynosDisplay {
          */
         ExynosSortedLayer mLayers;
         std::vector<ExynosLayer*> mIgnoreLayers;
+        /* Every layer of mLayers and mIgnoreLayers, for checkLayer() */
+        std::unordered_set<ExynosLayer*> mLayerIndex;
 
         ExynosResourceManager *mResourceManager;
 
@@ -563,6 +524,8 @@ class ExynosDisplay {
         uint64_t mLastUpdateTimeStamp;
         uint64_t mUpdateEventCnt;
         uint64_t mUpdateCallCnt;
+        /* When the display counts as idle for dynamic recomposition, 0 if not armed */
+        nsecs_t mDRIdleDeadline = 0;
 
         /* default DMA for the display */
         decon_idma_type mDefaultDMA;
@@ -612,6 +575,10 @@ class ExynosDisplay {
 
         std::unique_ptr<DisplayTe2Manager> mDisplayTe2Manager;
 
+        /* Continuous readback, armed when no one-shot readback is requested */
+        DisplayReadbackRing mReadbackRing{this};
+        bool mReadbackFromRing = false;
+
         std::shared_ptr<
                 aidl::com::google::hardware::pixel::display::IDisplayProximitySensorCallback>
                 mProximitySensorStateChangeCallback;
@@ -1265,6 +1232,14 @@ class ExynosDisplay {
         int32_t getReadbackBufferFence(int32_t* outFence);
         /* This function is called by ExynosDisplayInterface class to set acquire fence*/
         int32_t setReadbackBufferAcqFence(int32_t acqFence);
+        /* Continuous readback into a ring of buffers, an empty list stops it */
+        int32_t setReadbackRing(const std::vector<buffer_handle_t>& buffers);
+        bool acquireReadbackFrame(ReadbackRing::Frame& outFrame) {
+            return mReadbackRing.acquire(outFrame);
+        }
+        int32_t releaseReadbackFrame(buffer_handle_t buffer, int32_t releaseFence) {
+            return mReadbackRing.release(buffer, releaseFence);
+        }
 
         int32_t uncacheLayerBuffers(ExynosLayer* layer, const std::vector<buffer_handle_t>& buffers,
                                     std::vector<buffer_handle_t>& outClearableBuffers);
@@ -1281,10 +1256,33 @@ class ExynosDisplay {
         void dumpConfig(String8 &result, const exynos_win_config_data &c);
         void printConfig(exynos_win_config_data &c);
 
+        /* Damage of a frame as disjoint rectangles, merged down to kMaxRects */
+        struct DamageRegion {
+            static constexpr size_t kMaxRects = 4;
+            std::array<hwc_rect_t, kMaxRects> rects;
+            size_t count = 0;
+            /* Set once every layer's damage has been added */
+            bool complete = false;
+
+            void add(hwc_rect_t rect);
+            hwc_rect_t bounds() const;
+            uint64_t area(const hwc_rect_t &bounds) const;
+        };
+
+        /* Window update results, updated on present and read by dumpsys */
+        struct WindowUpdateStats {
+            uint64_t frames = 0;
+            uint64_t partialFrames = 0;
+            uint64_t fullPixels = 0;
+            uint64_t updatedPixels = 0;
+            uint64_t damagePixels = 0;
+        } mWindowUpdateStats GUARDED_BY(mDisplayMutex);
+
         unsigned int getLayerRegion(ExynosLayer *layer,
-                hwc_rect *rect_area, uint32_t regionType);
+                hwc_rect *rect_area, uint32_t regionType, DamageRegion *region = nullptr);
 
-        int handleWindowUpdate();
+        int handleWindowUpdate() REQUIRES(mDisplayMutex);
+        int computeWindowUpdate(DamageRegion &region);
         bool windowUpdateExceptions();
 
         /* For debugging */
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _EXYNOSDISPLAYCONFIG_H
+#define _EXYNOSDISPLAYCONFIG_H
+
+#include <stdint.h>
+
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+ * Display configuration types shared with libvrr. They are kept apart from
+ * ExynosDisplay.h so that code depending only on them builds on the host.
+ */
+
+typedef struct FrameIntervalPowerHint {
+    int frameIntervalNs = 0;
+    int averageRefreshPeriodNs = 0;
+} FrameIntervalPowerHint_t;
+
+typedef struct NotifyExpectedPresentConfig {
+    int HeadsUpNs = 0;
+    int TimeoutNs = 0;
+} NotifyExpectedPresentConfig_t;
+
+typedef struct VrrConfig {
+    bool isFullySupported = false;
+    int vsyncPeriodNs = 0;
+    int minFrameIntervalNs = 0;
+    std::optional<std::vector<FrameIntervalPowerHint_t>> frameIntervalPowerHint;
+    std::optional<NotifyExpectedPresentConfig_t> notifyExpectedPresentConfig;
+} VrrConfig_t;
+
+typedef struct displayConfigs {
+    std::string toString() const {
+        std::ostringstream os;
+        os << "vsyncPeriod = " << vsyncPeriod;
+        os << ", w = " << width;
+        os << ", h = " << height;
+        os << ", Xdpi = " << Xdpi;
+        os << ", Ydpi = " << Ydpi;
+        os << ", groupId = " << groupId;
+        os << (isNsMode ? ", NS " : ", HS ");
+        os << ", refreshRate = " << refreshRate;
+        return os.str();
+    }
+
+    // HWC2_ATTRIBUTE_VSYNC_PERIOD
+    uint32_t vsyncPeriod;
+    // HWC2_ATTRIBUTE_WIDTH
+    uint32_t width;
+    // case HWC2_ATTRIBUTE_HEIGHT
+    uint32_t height;
+    // HWC2_ATTRIBUTE_DPI_X
+    uint32_t Xdpi;
+    // HWC2_ATTRIBUTE_DPI_Y
+    uint32_t Ydpi;
+    // HWC2_ATTRIBUTE_CONFIG_GROUP
+    uint32_t groupId;
+
+    std::optional<VrrConfig_t> vrrConfig;
+
+    /* internal use */
+    bool isNsMode = false;
+    bool isOperationRateToBts;
+    bool isBoost2xBts;
+    int32_t refreshRate;
+} displayConfigs_t;
+
+#endif
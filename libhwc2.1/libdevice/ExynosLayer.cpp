@@ -47,7 +47,6 @@ ExynosLayer::ExynosLayer(ExynosDisplay* display)
         mValidateExynosCompositionType(HWC2_COMPOSITION_INVALID),
         mOverlayInfo(0x0),
         mSupportedMPPFlag(0x0),
-        mFps(0),
         mOverlayPriority(ePriorityLow),
         mGeometryChanged(0x0),
         mWindowIndex(0),
@@ -55,11 +54,7 @@ ExynosLayer::ExynosLayer(ExynosDisplay* display)
         mAcquireFence(-1),
         mPrevAcquireFence(-1),
         mReleaseFence(-1),
-        mFrameCount(0),
-        mLastFrameCount(0),
-        mLastFpsTime(0),
-        mNextLastFrameCount(0),
-        mNextLastFpsTime(0),
+        mFpsTracker(LOW_FPS_THRESHOLD),
         mLastLayerBuffer(NULL),
         mLayerBuffer(NULL),
         mLastUpdateTime(0),
@@ -110,53 +105,19 @@ ExynosLayer::~ExynosLayer() {
  * @return float
  */
 float ExynosLayer::checkFps(bool increaseCount) {
-    uint32_t frameDiff;
-    mFrameCount += increaseCount ? 1 : 0;
-
-    nsecs_t now = systemTime();
-    if (mLastFpsTime == 0) { // Initialize values
-        mLastFpsTime = now;
-        mNextLastFpsTime = now;
-        // TODO(b/268474771): set the initial FPS to the correct peak refresh rate
-        mFps = 120;
-        return mFps;
-    }
-
-    nsecs_t diff = now - mNextLastFpsTime;
-    // Update mLastFrameCount for every 5s, to ensure that FPS calculation is only based on
-    // frames in the past at most 10s.
-    if (diff >= kLayerFpsStableTimeNs) {
-        mLastFrameCount = mNextLastFrameCount;
-        mNextLastFrameCount = mFrameCount;
-
-        mLastFpsTime = mNextLastFpsTime;
-        mNextLastFpsTime = now;
-    }
-
-    bool wasLowFps = (mFps < LOW_FPS_THRESHOLD) ? true : false;
-
-    if (mFrameCount >= mLastFrameCount)
-        frameDiff = (mFrameCount - mLastFrameCount);
-    else
-        frameDiff = (mFrameCount + (UINT_MAX - mLastFrameCount));
-
-    diff = now - mLastFpsTime;
-    mFps = (frameDiff * float(s2ns(1))) / diff;
-
-    bool nowLowFps = (mFps < LOW_FPS_THRESHOLD) ? true : false;
+    LayerFpsTracker::Estimate estimate = mFpsTracker.update(increaseCount);
 
-    if ((mDisplay->mDisplayControl.handleLowFpsLayers) &&
-        (wasLowFps != nowLowFps))
+    if ((mDisplay->mDisplayControl.handleLowFpsLayers) && estimate.lowFpsChanged)
         setGeometryChanged(GEOMETRY_LAYER_FPS_CHANGED);
 
-    return mFps;
+    return estimate.fps;
 }
 
 /**
  * @return float
  */
 float ExynosLayer::getFps() {
-    return mFps;
+    return mFpsTracker.getFps();
 }
 
 int32_t ExynosLayer::doPreProcess()
@@ -419,16 +380,23 @@ int32_t ExynosLayer::setLayerBuffer(buffer_handle_t buffer, int32_t acquireFence
             setGeometryChanged(GEOMETRY_LAYER_FRONT_BUFFER_USAGE_CHANGED);
     }
 
+    bool newBuffer;
     {
         Mutex::Autolock lock(mDisplay->mDRMutex);
         mLayerBuffer = buffer;
-        checkFps(mLastLayerBuffer != mLayerBuffer);
-        if (mLayerBuffer != mLastLayerBuffer) {
+        newBuffer = (mLayerBuffer != mLastLayerBuffer);
+        checkFps(newBuffer);
+        if (newBuffer) {
             mLastUpdateTime = systemTime(CLOCK_MONOTONIC);
             if (mRequestedCompositionType != HWC2_COMPOSITION_REFRESH_RATE_INDICATOR)
                 mDisplay->mBufferUpdates++;
         }
     }
+    /* a layer that was scanned out directly is likely to be scanned out again,
+     * and the buffer of the last frame is already imported */
+    if ((buffer != NULL) && newBuffer &&
+        (mValidateCompositionType == HWC2_COMPOSITION_DEVICE) && (mM2mMPP == NULL))
+        mDisplay->mDisplayInterface->preimportBuffer(this, buffer);
     mPrevAcquireFence =
             fence_close(mPrevAcquireFence, mDisplay, FENCE_TYPE_SRC_ACQUIRE, FENCE_IP_UNDEFINED);
     mAcquireFence = fence_close(mAcquireFence, mDisplay, FENCE_TYPE_SRC_ACQUIRE, FENCE_IP_UNDEFINED);
@@ -440,6 +408,7 @@ int32_t ExynosLayer::setLayerBuffer(buffer_handle_t buffer, int32_t acquireFence
     if (mReleaseFence >= 0)
         HWC_LOGE(NULL, "Layer's release fence is not initialized");
     mReleaseFence = -1;
+    mSharedReleaseFence.reset();
 #ifdef DISABLE_FENCE
     if (mAcquireFence >= 0)
         fence_close(mAcquireFence);
@@ -1062,7 +1031,7 @@ void ExynosLayer::dump(String8& result)
                 .add("colorTr", mLayerColorTransform.enable)
                 .add("blend", mBlending, true)
                 .add("planeAlpha", mPlaneAlpha)
-                .add("fps", mFps);
+                .add("fps", getFps());
         result.append(tb.build().c_str());
     }
 
@@ -1204,8 +1173,8 @@ void ExynosLayer::printLayer()
                         getFormatStr(format, mCompressionInfo.type).c_str());
     result.appendFormat("\tblend: 0x%4x, planeAlpha: %3.1f, zOrder: %d, color[0x%2x, 0x%2x, 0x%2x, 0x%2x]\n",
             mBlending, mPlaneAlpha, mZOrder, mColor.r, mColor.g, mColor.b, mColor.a);
-    result.appendFormat("\tfps: %.2f, priority: %d, windowIndex: %d\n", mFps, mOverlayPriority,
-                        mWindowIndex);
+    result.appendFormat("\tfps: %.2f, priority: %d, windowIndex: %d\n", getFps(),
+                        mOverlayPriority, mWindowIndex);
     result.appendFormat("\tsourceCrop[%7.1f,%7.1f,%7.1f,%7.1f], dispFrame[%5d,%5d,%5d,%5d]\n",
             mSourceCrop.left, mSourceCrop.top, mSourceCrop.right, mSourceCrop.bottom,
             mDisplayFrame.left, mDisplayFrame.top, mDisplayFrame.right, mDisplayFrame.bottom);
@@ -29,6 +29,7 @@
 #include "ExynosDisplay.h"
 #include "ExynosHWC.h"
 #include "ExynosHWCHelper.h"
+#include "LayerFpsTracker.h"
 #include "VendorGraphicBuffer.h"
 #include "VendorVideoAPI.h"
 
@@ -41,8 +42,6 @@ using namespace android;
 using namespace vendor::graphics;
 using ::aidl::android::hardware::graphics::composer3::Composition;
 
-constexpr nsecs_t kLayerFpsStableTimeNs = s2ns(5);
-
 class ExynosMPP;
 
 enum overlay_priority {
@@ -143,11 +142,6 @@ class ExynosLayer : public ExynosMPPSource {
         /* Key is logical type of MPP */
         std::unordered_map<uint32_t, uint64_t> mCheckMPPFlag;
 
-        /**
-         * Update rate for using client composition.
-         */
-        float mFps;
-
         /**
          * Assign priority, when priority changing is needded by order infomation in mGeometryChanged
          */
@@ -176,14 +170,18 @@ class ExynosLayer : public ExynosMPPSource {
 
         /**
          * Release fence
+         * mSharedReleaseFence is used instead when the layer shares the window
+         * release fence with other layers; it is dup'ed in getReleaseFences().
          */
         int32_t mReleaseFence;
+        std::shared_ptr<SharedFence> mSharedReleaseFence;
 
-        uint32_t mFrameCount;
-        uint32_t mLastFrameCount;
-        nsecs_t mLastFpsTime;
-        uint32_t mNextLastFrameCount;
-        nsecs_t mNextLastFpsTime;
+        bool hasReleaseFence() const { return (mReleaseFence >= 0) || mSharedReleaseFence; }
+
+        /**
+         * Update rate for using client composition.
+         */
+        LayerFpsTracker mFpsTracker;
 
         /**
          * Previous buffer's handle
@@ -287,6 +285,7 @@ class ExynosLayer : public ExynosMPPSource {
         float checkFps(bool increaseCount);
 
         float getFps();
+        bool isLowFps() const { return mFpsTracker.isLowFps(); };
 
         int32_t doPreProcess();
 
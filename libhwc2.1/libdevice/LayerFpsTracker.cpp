@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LayerFpsTracker.h"
+
+#include <algorithm>
+
+LayerFpsTracker::Estimate LayerFpsTracker::update(bool newFrame) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    /* Read under the lock so that a frame never goes back in time */
+    nsecs_t now = mClock();
+
+    if (mLastFrameTime == 0) { // Initialize values
+        mLastFrameTime = now;
+        // TODO(b/268474771): set the initial FPS to the correct peak refresh rate
+        mFrameIntervalEwma = kLayerInitialFrameIntervalNs;
+        mFps = 120;
+        return {mFps, mIsLowFps, false};
+    }
+
+    if (newFrame) {
+        nsecs_t interval = std::min(now - mLastFrameTime, kLayerFpsStableTimeNs);
+        mFrameIntervalEwma += (interval - mFrameIntervalEwma) / kLayerFpsEwmaWeight;
+        mLastFrameTime = now;
+    }
+
+    /* A layer that stopped updating is as slow as the time since its last frame */
+    nsecs_t interval = std::max(mFrameIntervalEwma, now - mLastFrameTime);
+    mFps = float(s2ns(1)) / std::max(interval, nsecs_t(1));
+
+    /* Leaving low fps needs twice the threshold so that the state doesn't flap */
+    bool wasLowFps = mIsLowFps;
+    if (mFps < mLowFpsThreshold)
+        mIsLowFps = true;
+    else if (mFps >= mLowFpsThreshold * 2)
+        mIsLowFps = false;
+
+    return {mFps, mIsLowFps, wasLowFps != mIsLowFps};
+}
+
+float LayerFpsTracker::getFps() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mFps;
+}
+
+bool LayerFpsTracker::isLowFps() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mIsLowFps;
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _LAYER_FPS_TRACKER_H_
+#define _LAYER_FPS_TRACKER_H_
+
+#include <utils/Timers.h>
+
+#include <functional>
+#include <mutex>
+
+constexpr nsecs_t kLayerFpsStableTimeNs = s2ns(5);
+/* Weight of a new frame interval in the update rate estimate is 1/kLayerFpsEwmaWeight */
+constexpr nsecs_t kLayerFpsEwmaWeight = 4;
+/* Update rate of a layer before its first frame interval is known */
+constexpr nsecs_t kLayerInitialFrameIntervalNs = s2ns(1) / 120;
+
+/*
+ * Update rate of a layer from an exponentially weighted frame interval.
+ * setLayerBuffer() reports new frames while the dynamic recomposition thread
+ * re-evaluates the rate of layers that stopped updating, so the estimate has
+ * its own lock and each update returns a consistent snapshot of it.
+ */
+class LayerFpsTracker {
+public:
+    using Clock = std::function<nsecs_t()>;
+
+    struct Estimate {
+        float fps;
+        bool isLowFps;
+        /* isLowFps differs from the previous estimate */
+        bool lowFpsChanged;
+    };
+
+    /* The layer is low fps below lowFpsThreshold, and leaves it at twice that */
+    explicit LayerFpsTracker(float lowFpsThreshold,
+                             Clock clock = [] { return systemTime(SYSTEM_TIME_MONOTONIC); })
+          : mLowFpsThreshold(lowFpsThreshold), mClock(std::move(clock)) {}
+
+    /* Updates the estimate, with a new frame if newFrame is set */
+    Estimate update(bool newFrame);
+
+    float getFps() const;
+    bool isLowFps() const;
+
+private:
+    const float mLowFpsThreshold;
+    const Clock mClock;
+
+    mutable std::mutex mMutex;
+    nsecs_t mFrameIntervalEwma = 0;
+    /* Time of the last frame, 0 until the first update */
+    nsecs_t mLastFrameTime = 0;
+    float mFps = 0;
+    bool mIsLowFps = false;
+};
+
+#endif
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ReadbackRing.h"
+
+#include <hardware/hwcomposer2.h>
+#include <inttypes.h>
+#include <log/log.h>
+#include <utils/Errors.h>
+
+using android::NO_ERROR;
+
+void ReadbackRing::setBuffers(const std::vector<buffer_handle_t>& buffers) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mReplacing = true;
+    if (!mWritingDone.wait_for(lock, kCompleteTimeout, [this] { return mWritingSlot < 0; })) {
+        ALOGE("%s: armed readback frame was not completed", __func__);
+    }
+    mReplacing = false;
+
+    for (auto& slot : mSlots) {
+        if ((slot.state == SlotState::FILLED) && (slot.fence >= 0)) waitFence(slot.fence);
+        closeFenceLocked(slot);
+    }
+    mSlots.clear();
+    mFilled.clear();
+    mWritingSlot = -1;
+    mStats = {};
+
+    for (auto buffer : buffers) {
+        if (buffer == nullptr) continue;
+        mSlots.emplace_back();
+        mSlots.back().buffer = buffer;
+    }
+}
+
+bool ReadbackRing::isActive() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return !mSlots.empty();
+}
+
+buffer_handle_t ReadbackRing::arm() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mSlots.empty() || mReplacing || mWritingSlot >= 0) return nullptr;
+
+    /* A free buffer the consumer has finished reading */
+    for (size_t i = 0; i < mSlots.size(); i++) {
+        auto& slot = mSlots[i];
+        if (slot.state != SlotState::FREE) continue;
+        if ((slot.fence >= 0) && !isFenceSignaled(slot.fence)) continue;
+        startWritingLocked(i);
+        return slot.buffer;
+    }
+
+    /* The consumer is behind, overwrite the oldest frame it has not acquired */
+    if (!mFilled.empty()) {
+        size_t index = mFilled.front();
+        mFilled.pop_front();
+        mStats.dropped++;
+        startWritingLocked(index);
+        return mSlots[index].buffer;
+    }
+
+    /* Every buffer is held by the consumer */
+    mStats.skipped++;
+    return nullptr;
+}
+
+void ReadbackRing::complete(int32_t acqFence) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mWritingSlot < 0) {
+        /* The ring was reset while the frame was presented */
+        if (acqFence >= 0) closeAcquireFence(acqFence);
+        return;
+    }
+
+    auto& slot = mSlots[mWritingSlot];
+    if (acqFence < 0) {
+        /* The frame was skipped or the commit failed */
+        slot.state = SlotState::FREE;
+    } else {
+        slot.state = SlotState::FILLED;
+        slot.fence = acqFence;
+        slot.sequence = ++mSequence;
+        mFilled.push_back(mWritingSlot);
+        mStats.captured++;
+    }
+    mWritingSlot = -1;
+    mWritingDone.notify_all();
+}
+
+bool ReadbackRing::acquire(Frame& outFrame) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFilled.empty()) return false;
+
+    auto& slot = mSlots[mFilled.front()];
+    mFilled.pop_front();
+    slot.state = SlotState::ACQUIRED;
+    outFrame.buffer = slot.buffer;
+    outFrame.fence = slot.fence;
+    outFrame.sequence = slot.sequence;
+    /* Fence will be closed by the consumer */
+    slot.fence = -1;
+    return true;
+}
+
+int32_t ReadbackRing::release(buffer_handle_t buffer, int32_t releaseFence) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto& slot : mSlots) {
+        if ((slot.buffer == buffer) && (slot.state == SlotState::ACQUIRED)) {
+            slot.state = SlotState::FREE;
+            slot.fence = releaseFence;
+            if (releaseFence >= 0) onReleaseFence(releaseFence);
+            return NO_ERROR;
+        }
+    }
+
+    ALOGE("%s: buffer(%p) is not acquired from the readback ring", __func__, buffer);
+    if (releaseFence >= 0) {
+        onReleaseFence(releaseFence);
+        closeReleaseFence(releaseFence);
+    }
+    return HWC2_ERROR_BAD_PARAMETER;
+}
+
+void ReadbackRing::dump(String8& result) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mSlots.empty()) return;
+
+    size_t acquired = 0;
+    for (const auto& slot : mSlots) {
+        if (slot.state == SlotState::ACQUIRED) acquired++;
+    }
+    result.appendFormat("Readback ring: buffers %zu, filled %zu, acquired %zu, captured %" PRIu64
+                        ", dropped %" PRIu64 ", skipped %" PRIu64 "\n",
+                        mSlots.size(), mFilled.size(), acquired, mStats.captured, mStats.dropped,
+                        mStats.skipped);
+}
+
+void ReadbackRing::closeFenceLocked(Slot& slot) {
+    if (slot.fence < 0) return;
+    if (slot.state == SlotState::FILLED) {
+        closeAcquireFence(slot.fence);
+    } else {
+        closeReleaseFence(slot.fence);
+    }
+    slot.fence = -1;
+}
+
+void ReadbackRing::startWritingLocked(size_t index) {
+    auto& slot = mSlots[index];
+    closeFenceLocked(slot);
+    slot.state = SlotState::WRITING;
+    mWritingSlot = index;
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _READBACK_RING_H_
+#define _READBACK_RING_H_
+
+#include <cutils/native_handle.h>
+#include <utils/String8.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+using android::String8;
+
+/*
+ * Rotates a fixed set of readback buffers through successive frames for
+ * continuous capture. The present path never waits for the consumer: when no
+ * buffer is free, the oldest captured frame the consumer has not acquired yet
+ * is overwritten.
+ *
+ * How fences are polled and closed is left to the subclass, so that the ring
+ * can be driven by a fake writeback in tests.
+ */
+class ReadbackRing {
+public:
+    struct Frame {
+        buffer_handle_t buffer = nullptr;
+        /* Signals when the device has filled buffer, owned by the consumer */
+        int32_t fence = -1;
+        /* Increases by one per captured frame, gaps are dropped frames */
+        uint64_t sequence = 0;
+    };
+
+    virtual ~ReadbackRing() = default;
+
+    /*
+     * Replaces the buffers of the ring, an empty list stops capturing.
+     * Frames still being written are waited for, including the armed frame
+     * whose fence complete() has not delivered yet, so the caller can free
+     * the previous buffers on return. Subclasses call it with an empty list
+     * on destruction.
+     */
+    void setBuffers(const std::vector<buffer_handle_t>& buffers);
+    bool isActive();
+
+    /* Producer side, called by presentDisplay */
+    buffer_handle_t arm();
+    void complete(int32_t acqFence);
+
+    /* Consumer side, frames are acquired oldest first */
+    bool acquire(Frame& outFrame);
+    int32_t release(buffer_handle_t buffer, int32_t releaseFence);
+
+    void dump(String8& result);
+
+protected:
+    /* Returns true once fence has signaled, without waiting */
+    virtual bool isFenceSignaled(int32_t fence) = 0;
+    /* Waits for a writeback fence before its buffer is given back */
+    virtual void waitFence(int32_t fence) = 0;
+    /* Takes the release fence of a consumer */
+    virtual void onReleaseFence(int32_t fence) = 0;
+    virtual void closeAcquireFence(int32_t fence) = 0;
+    virtual void closeReleaseFence(int32_t fence) = 0;
+
+private:
+    enum class SlotState {
+        FREE,
+        WRITING,
+        FILLED,
+        ACQUIRED,
+    };
+    struct Slot {
+        buffer_handle_t buffer = nullptr;
+        SlotState state = SlotState::FREE;
+        /* Release fence of the consumer while FREE, acquire fence while FILLED */
+        int32_t fence = -1;
+        uint64_t sequence = 0;
+    };
+    struct Stats {
+        uint64_t captured = 0;
+        uint64_t dropped = 0;
+        uint64_t skipped = 0;
+    };
+
+    /* Bounds the wait for complete() of an armed frame that is never presented */
+    static constexpr std::chrono::milliseconds kCompleteTimeout{1000};
+
+    void closeFenceLocked(Slot& slot);
+    void startWritingLocked(size_t index);
+
+    std::mutex mMutex;
+    std::vector<Slot> mSlots;
+    /* Indices of FILLED slots, oldest first */
+    std::deque<size_t> mFilled;
+    int32_t mWritingSlot = -1;
+    /* Signaled by complete() */
+    std::condition_variable mWritingDone;
+    /* No frame is armed while setBuffers() waits for the one being written */
+    bool mReplacing = false;
+    uint64_t mSequence = 0;
+    Stats mStats;
+};
+
+#endif // _READBACK_RING_H_
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+#include "LayerFpsTracker.h"
+
+namespace {
+
+constexpr float kLowFpsThreshold = 5;
+
+/* The tracker only sees the time the test sets */
+class FakeClock {
+public:
+    LayerFpsTracker::Clock get() {
+        return [this] { return mNow.load(); };
+    }
+    void advance(nsecs_t duration) { mNow += duration; }
+
+private:
+    std::atomic<nsecs_t> mNow = s2ns(100);
+};
+
+/* Reports frames at fps for duration, returns the last estimate */
+LayerFpsTracker::Estimate presentFrames(LayerFpsTracker& tracker, FakeClock& clock, int fps,
+                                        nsecs_t duration) {
+    LayerFpsTracker::Estimate estimate = {};
+    for (nsecs_t elapsed = 0; elapsed < duration; elapsed += s2ns(1) / fps) {
+        clock.advance(s2ns(1) / fps);
+        estimate = tracker.update(true);
+    }
+    return estimate;
+}
+
+} // namespace
+
+TEST(LayerFpsTrackerTest, StartsAtPeakRate) {
+    FakeClock clock;
+    LayerFpsTracker tracker(kLowFpsThreshold, clock.get());
+
+    auto estimate = tracker.update(true);
+    EXPECT_FLOAT_EQ(estimate.fps, 120);
+    EXPECT_FALSE(estimate.isLowFps);
+    EXPECT_FALSE(estimate.lowFpsChanged);
+    EXPECT_FLOAT_EQ(tracker.getFps(), 120);
+}
+
+TEST(LayerFpsTrackerTest, ConvergesToFrameRate) {
+    FakeClock clock;
+    LayerFpsTracker tracker(kLowFpsThreshold, clock.get());
+    tracker.update(true);
+
+    auto estimate = presentFrames(tracker, clock, 30, s2ns(1));
+    EXPECT_NEAR(estimate.fps, 30, 0.5);
+    estimate = presentFrames(tracker, clock, 60, s2ns(1));
+    EXPECT_NEAR(estimate.fps, 60, 0.5);
+    EXPECT_FALSE(estimate.isLowFps);
+}
+
+TEST(LayerFpsTrackerTest, StoppedLayerSlowsDownWithoutFrames) {
+    FakeClock clock;
+    LayerFpsTracker tracker(kLowFpsThreshold, clock.get());
+    tracker.update(true);
+    presentFrames(tracker, clock, 60, s2ns(1));
+
+    /* Re-evaluated by the idle check, the rate follows the time since the last frame */
+    clock.advance(ms2ns(100));
+    auto estimate = tracker.update(false);
+    EXPECT_FLOAT_EQ(estimate.fps, 10);
+    EXPECT_FALSE(estimate.isLowFps);
+
+    clock.advance(ms2ns(150));
+    estimate = tracker.update(false);
+    EXPECT_FLOAT_EQ(estimate.fps, 4);
+    EXPECT_TRUE(estimate.isLowFps);
+    EXPECT_TRUE(estimate.lowFpsChanged);
+
+    clock.advance(ms2ns(250));
+    estimate = tracker.update(false);
+    EXPECT_TRUE(estimate.isLowFps);
+    EXPECT_FALSE(estimate.lowFpsChanged);
+    EXPECT_TRUE(tracker.isLowFps());
+}
+
+TEST(LayerFpsTrackerTest, LeavesLowFpsAtTwiceTheThreshold) {
+    FakeClock clock;
+    LayerFpsTracker tracker(kLowFpsThreshold, clock.get());
+    tracker.update(true);
+    auto estimate = presentFrames(tracker, clock, 2, s2ns(10));
+    ASSERT_TRUE(estimate.isLowFps);
+
+    /* Between the threshold and twice it, the layer stays low fps */
+    estimate = presentFrames(tracker, clock, 7, s2ns(5));
+    EXPECT_NEAR(estimate.fps, 7, 0.5);
+    EXPECT_TRUE(estimate.isLowFps);
+
+    estimate = presentFrames(tracker, clock, 30, s2ns(1));
+    EXPECT_FALSE(estimate.isLowFps);
+    EXPECT_FALSE(tracker.isLowFps());
+}
+
+TEST(LayerFpsTrackerTest, LongIntervalsAreCapped) {
+    FakeClock clock;
+    LayerFpsTracker tracker(kLowFpsThreshold, clock.get());
+    tracker.update(true);
+
+    /* A minute without frames weighs no more than kLayerFpsStableTimeNs */
+    clock.advance(s2ns(60));
+    tracker.update(true);
+    auto estimate = presentFrames(tracker, clock, 60, s2ns(1));
+    EXPECT_NEAR(estimate.fps, 60, 0.5);
+}
+
+TEST(LayerFpsTrackerTest, ConcurrentUpdatesStayConsistent) {
+    FakeClock clock;
+    LayerFpsTracker tracker(kLowFpsThreshold, clock.get());
+    tracker.update(true);
+
+    /* setLayerBuffer and the dynamic recomposition thread */
+    std::thread frames([&] {
+        for (int i = 0; i < 10000; i++) {
+            clock.advance(s2ns(1) / 60);
+            tracker.update(true);
+        }
+    });
+    for (int i = 0; i < 10000; i++) {
+        auto estimate = tracker.update(false);
+        EXPECT_GT(estimate.fps, 0);
+        EXPECT_LT(estimate.fps, 121);
+        EXPECT_EQ(estimate.isLowFps, estimate.fps < kLowFpsThreshold);
+    }
+    frames.join();
+
+    EXPECT_NEAR(tracker.update(false).fps, 60, 0.5);
+}
@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <hardware/hwcomposer2.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "ReadbackRing.h"
+
+namespace {
+
+/* Fences are plain numbers that the test signals, the ring never sees a real fd */
+class FakeReadbackRing : public ReadbackRing {
+public:
+    ~FakeReadbackRing() override { setBuffers({}); }
+
+    int32_t newFence() { return mNextFence++; }
+    void signal(int32_t fence) { mSignaled.insert(fence); }
+
+    /* Every fence handed to the ring must be closed by it exactly once */
+    std::map<int32_t, int> mClosed;
+    std::vector<int32_t> mWaited;
+
+protected:
+    bool isFenceSignaled(int32_t fence) override { return mSignaled.count(fence) != 0; }
+    void waitFence(int32_t fence) override { mWaited.push_back(fence); }
+    void onReleaseFence(int32_t) override {}
+    void closeAcquireFence(int32_t fence) override { mClosed[fence]++; }
+    void closeReleaseFence(int32_t fence) override { mClosed[fence]++; }
+
+private:
+    int32_t mNextFence = 100;
+    std::set<int32_t> mSignaled;
+};
+
+/* Stands in for presentDisplay and the writeback connector */
+class FakeWriteback {
+public:
+    explicit FakeWriteback(FakeReadbackRing& ring) : mRing(ring) {}
+
+    /* Presents a frame, returns the buffer it was captured into or nullptr */
+    buffer_handle_t present() {
+        buffer_handle_t buffer = mRing.arm();
+        if (buffer != nullptr) mRing.complete(mRing.newFence());
+        return buffer;
+    }
+
+    /* A frame that was armed but not committed */
+    void presentSkipped() {
+        if (mRing.arm() != nullptr) mRing.complete(-1);
+    }
+
+private:
+    FakeReadbackRing& mRing;
+};
+
+std::vector<buffer_handle_t> makeBuffers(std::vector<native_handle_t>& handles) {
+    std::vector<buffer_handle_t> buffers;
+    for (auto& handle : handles) buffers.push_back(&handle);
+    return buffers;
+}
+
+std::string dump(ReadbackRing& ring) {
+    String8 result;
+    ring.dump(result);
+    return result.c_str();
+}
+
+} // namespace
+
+TEST(ReadbackRingTest, DeliversFramesInCaptureOrder) {
+    std::vector<native_handle_t> handles(3);
+    FakeReadbackRing ring;
+    FakeWriteback writeback(ring);
+    ring.setBuffers(makeBuffers(handles));
+
+    std::vector<buffer_handle_t> captured;
+    for (int i = 0; i < 3; i++) captured.push_back(writeback.present());
+
+    ReadbackRing::Frame frame;
+    for (uint64_t sequence = 1; sequence <= 3; sequence++) {
+        ASSERT_TRUE(ring.acquire(frame));
+        EXPECT_EQ(frame.sequence, sequence);
+        EXPECT_EQ(frame.buffer, captured[sequence - 1]);
+        EXPECT_GE(frame.fence, 0);
+        ring.release(frame.buffer, -1);
+    }
+    EXPECT_FALSE(ring.acquire(frame));
+}
+
+TEST(ReadbackRingTest, OverwritesOldestFrameWhenConsumerFallsBehind) {
+    std::vector<native_handle_t> handles(2);
+    FakeReadbackRing ring;
+    FakeWriteback writeback(ring);
+    ring.setBuffers(makeBuffers(handles));
+
+    for (int i = 0; i < 5; i++) EXPECT_NE(writeback.present(), nullptr);
+
+    /* Only the two latest frames are left, the gaps in the sequence are the drops */
+    ReadbackRing::Frame frame;
+    ASSERT_TRUE(ring.acquire(frame));
+    EXPECT_EQ(frame.sequence, 4);
+    ASSERT_TRUE(ring.acquire(frame));
+    EXPECT_EQ(frame.sequence, 5);
+    EXPECT_FALSE(ring.acquire(frame));
+    EXPECT_NE(dump(ring).find("captured 5, dropped 3, skipped 0"), std::string::npos) << dump(ring);
+}
+
+TEST(ReadbackRingTest, NeverWaitsForTheConsumer) {
+    std::vector<native_handle_t> handles(2);
+    FakeReadbackRing ring;
+    FakeWriteback writeback(ring);
+    ring.setBuffers(makeBuffers(handles));
+
+    writeback.present();
+    writeback.present();
+    ReadbackRing::Frame first, second;
+    ASSERT_TRUE(ring.acquire(first));
+    ASSERT_TRUE(ring.acquire(second));
+
+    /* Every buffer is held by the consumer */
+    EXPECT_EQ(writeback.present(), nullptr);
+
+    /* A released buffer is reused only once the consumer is done reading it */
+    int32_t releaseFence = ring.newFence();
+    EXPECT_EQ(ring.release(first.buffer, releaseFence), HWC2_ERROR_NONE);
+    EXPECT_EQ(writeback.present(), nullptr);
+    ring.signal(releaseFence);
+    EXPECT_EQ(writeback.present(), first.buffer);
+    EXPECT_NE(dump(ring).find("skipped 2"), std::string::npos) << dump(ring);
+
+    /* A buffer that was not acquired cannot be released */
+    EXPECT_EQ(ring.release(first.buffer, -1), HWC2_ERROR_BAD_PARAMETER);
+}
+
+TEST(ReadbackRingTest, SkippedFrameFreesItsBuffer) {
+    std::vector<native_handle_t> handles(1);
+    FakeReadbackRing ring;
+    FakeWriteback writeback(ring);
+    ring.setBuffers(makeBuffers(handles));
+
+    writeback.presentSkipped();
+    ReadbackRing::Frame frame;
+    EXPECT_FALSE(ring.acquire(frame));
+    EXPECT_NE(writeback.present(), nullptr);
+    ASSERT_TRUE(ring.acquire(frame));
+    EXPECT_EQ(frame.sequence, 1);
+}
+
+TEST(ReadbackRingTest, ClosesEveryFenceOnce) {
+    std::vector<native_handle_t> handles(3);
+    FakeReadbackRing ring;
+    FakeWriteback writeback(ring);
+    ring.setBuffers(makeBuffers(handles));
+
+    /* One frame read and released, one overwritten, two still captured */
+    writeback.present();
+    ReadbackRing::Frame frame;
+    ASSERT_TRUE(ring.acquire(frame));
+    const int32_t acquiredFence = frame.fence;
+    const int32_t releaseFence = ring.newFence();
+    ring.signal(releaseFence);
+    ring.release(frame.buffer, releaseFence);
+    for (int i = 0; i < 4; i++) writeback.present();
+
+    /* The acquire fence of an acquired frame belongs to the consumer */
+    ring.setBuffers({});
+    EXPECT_EQ(ring.mClosed.count(acquiredFence), 0);
+    ring.mClosed[acquiredFence]++;
+    const int32_t endFence = ring.newFence();
+    for (int32_t fence = 100; fence < endFence; fence++) {
+        EXPECT_EQ(ring.mClosed[fence], 1) << "fence " << fence;
+    }
+    /* The frames still captured were waited for before their buffers were given back */
+    EXPECT_EQ(ring.mWaited.size(), 3);
+    EXPECT_FALSE(ring.isActive());
+}
+
+TEST(ReadbackRingTest, ClearingWaitsForTheArmedFrame) {
+    std::vector<native_handle_t> handles(2);
+    FakeReadbackRing ring;
+    ring.setBuffers(makeBuffers(handles));
+
+    /* presentDisplay armed the frame, its writeback fence comes with complete() */
+    ASSERT_NE(ring.arm(), nullptr);
+    std::atomic<bool> cleared = false;
+    std::thread consumer([&ring, &cleared]() {
+        ring.setBuffers({});
+        cleared = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(cleared);
+    /* Nothing more is armed while the ring is being cleared */
+    EXPECT_EQ(ring.arm(), nullptr);
+
+    const int32_t fence = ring.newFence();
+    ring.complete(fence);
+    consumer.join();
+    EXPECT_TRUE(cleared);
+    ASSERT_EQ(ring.mWaited.size(), 1);
+    EXPECT_EQ(ring.mWaited[0], fence);
+    EXPECT_EQ(ring.mClosed[fence], 1);
+    EXPECT_FALSE(ring.isActive());
+}
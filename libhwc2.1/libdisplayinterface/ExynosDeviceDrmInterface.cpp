@@ -368,6 +368,7 @@ void ExynosDeviceDrmInterface::ExynosDrmEventHandler::handleIdleEnterEvent(char
         /* sending vsyncIdle callback */
         if (vrefresh != idleTeVrefresh) {
             mExynosDevice->onVsyncIdle(primaryDisplay->getId());
+            primaryDisplay->mDisplayInterface->onVsyncTimingChanged();
         }
 
         primaryDisplay->handleDisplayIdleEnter(idleTeVrefresh);
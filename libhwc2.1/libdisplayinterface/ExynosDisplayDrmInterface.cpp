@@ -23,6 +23,7 @@
 #include <drm.h>
 #include <drm/drm_fourcc.h>
 #include <sys/types.h>
+#include <unistd.h>
 #include <xf86drm.h>
 
 #include <algorithm>
@@ -64,6 +65,8 @@ using namespace vendor::graphics;
 extern struct exynos_hwc_control exynosHWCControl;
 static const int32_t kUmPerInch = 25400;
 
+DrmCommittedState ExynosDisplayDrmInterface::sCommittedState;
+
 int writeIntToKernelFile(const char* path, const int value) {
     std::ofstream ofs(path);
 
@@ -77,22 +80,119 @@ int writeIntToKernelFile(const char* path, const int value) {
     return 0;
 }
 
+void ExynosDisplayDrmInterface::initCommittedState() {
+    std::vector<uint32_t> trackedObjects;
+    std::vector<uint32_t> volatileProperties;
+    for (const auto &plane : mDrmDevice->planes()) {
+        trackedObjects.push_back(plane->id());
+        volatileProperties.push_back(plane->in_fence_fd_property().id());
+    }
+    for (const auto &crtc : mDrmDevice->crtcs()) {
+        trackedObjects.push_back(crtc->id());
+        volatileProperties.push_back(crtc->out_fence_ptr_property().id());
+        volatileProperties.push_back(crtc->cgc_lut_fd_property().id());
+        volatileProperties.push_back(crtc->partial_region_property().id());
+        volatileProperties.push_back(crtc->expected_present_time_property().id());
+    }
+    sCommittedState.Init(trackedObjects, volatileProperties);
+}
+
+void ExynosDisplayDrmInterface::dumpCommittedState(String8 &result) {
+    std::string state;
+    sCommittedState.Dump(state);
+    result.append(state.c_str());
+}
+
+int32_t DrmPropertyBlobCache::get(const void *data, size_t length, uint32_t &blobId) {
+    std::string_view payload(static_cast<const char *>(data), length);
+    auto indexIter = mIndex.find(payload);
+    if (indexIter != mIndex.end()) {
+        auto blobIter = indexIter->second;
+        mBlobs.splice(mBlobs.begin(), mBlobs, blobIter);
+        blobIter->refCount++;
+        blobId = blobIter->id;
+        mHits++;
+        return NO_ERROR;
+    }
+
+    uint32_t id = 0;
+    int ret = mDrmDevice->CreatePropertyBlob(data, length, &id);
+    if (ret || (id == 0)) {
+        ALOGE("%s: failed to create blob id=%d, ret=%d", __func__, id, ret);
+        return ret ? ret : -EINVAL;
+    }
+    mMisses++;
+
+    mBlobs.push_front(Blob{std::string(payload), id, 1});
+    mIndex.emplace(mBlobs.front().payload, mBlobs.begin());
+    blobId = id;
+    evictUnused();
+    return NO_ERROR;
+}
+
+void DrmPropertyBlobCache::put(uint32_t blobId) {
+    for (auto &blob : mBlobs) {
+        if (blob.id == blobId) {
+            if (blob.refCount > 0) blob.refCount--;
+            return;
+        }
+    }
+    ALOGW("%s: blob %d is not cached", __func__, blobId);
+}
+
+void DrmPropertyBlobCache::clear() {
+    for (auto &blob : mBlobs) {
+        mDrmDevice->DestroyPropertyBlob(blob.id);
+    }
+    mIndex.clear();
+    mBlobs.clear();
+}
+
+void DrmPropertyBlobCache::evictUnused() {
+    auto blobIter = mBlobs.end();
+    while ((mBlobs.size() > kMaxBlobs) && (blobIter != mBlobs.begin())) {
+        --blobIter;
+        if (blobIter->refCount) continue;
+        /* the kernel keeps the blob alive while a committed state uses it */
+        mDrmDevice->DestroyPropertyBlob(blobIter->id);
+        mIndex.erase(blobIter->payload);
+        blobIter = mBlobs.erase(blobIter);
+        mEvictions++;
+    }
+}
+
+void DrmPropertyBlobCache::dump(String8 &result) {
+    result.appendFormat("Property blob cache: cached %zu, hits %" PRIu64 ", misses %" PRIu64
+                        ", evictions %" PRIu64 "\n",
+                        mBlobs.size(), mHits, mMisses, mEvictions);
+}
+
 FramebufferManager::~FramebufferManager()
 {
     {
         Mutex::Autolock lock(mMutex);
         mRmFBThreadRunning = false;
+        mPreimportThreadRunning = false;
     }
     mFlipDone.signal();
+    mPreimportRequested.signal();
     mRmFBThread.join();
+    mPreimportThread.join();
+
+    Mutex::Autolock lock(mMutex);
+    dropPreimportsLocked(nullptr, nullptr);
 }
 
 void FramebufferManager::init(int drmFd)
 {
     mDrmFd = drmFd;
+    mCache.init(drmFd);
     mRmFBThreadRunning = true;
     mRmFBThread = std::thread(&FramebufferManager::removeFBsThreadRoutine, this);
     pthread_setname_np(mRmFBThread.native_handle(), "RemoveFBsThread");
+    mPreimportThreadRunning = true;
+    mPreimportThread = std::thread(&FramebufferManager::preimportThreadRoutine, this);
+    pthread_setname_np(mPreimportThread.native_handle(), "PreimportFBThread");
 }
 
 uint32_t FramebufferManager::getBufHandleFromFd(int fd)
@@ -136,30 +236,58 @@ bool FramebufferManager::validateLayerInfo(uint32_t state, uint32_t drmFormat,
     return true;
 }
 
-void FramebufferManager::checkShrink() {
+void FramebufferManager::cleanup(const ExynosLayer *layer) {
+    ATRACE_CALL();
+
     Mutex::Autolock lock(mMutex);
+    mCache.evictLayer(layer);
 
-    mCacheShrinkPending = mCachedLayerBuffers.size() > MAX_CACHED_LAYERS;
-    mCacheSecureShrinkPending = mCachedSecureLayerBuffers.size() > MAX_CACHED_SECURE_LAYERS;
+    dropPreimportsLocked(layer, nullptr);
+    if (mPreimporting && mPreimportLayer == layer) {
+        mPreimportCanceled = true;
+    }
 }
 
-void FramebufferManager::cleanup(const ExynosLayer *layer) {
-    ATRACE_CALL();
+uint32_t FramebufferManager::findCachedFbId(const ExynosLayer *layer, const Framebuffer::Key &key,
+                                            const Framebuffer::Layout &layout,
+                                            const bool isPreimport) {
+    Mutex::Autolock lock(mMutex);
+    if (!isPreimport) {
+        /* import it here rather than waiting for the queued request */
+        dropPreimportsLocked(nullptr, &key);
+        while (mPreimporting && mPreimportKey == key) {
+            mPreimportDone.wait(mMutex);
+        }
+    }
 
+    uint32_t fbId = mCache.find(layer, key, layout, !isPreimport);
+    if (fbId == 0 && isPreimport) {
+        mPreimporting = true;
+        mPreimportKey = key;
+        mPreimportLayer = layer;
+    }
+    return fbId;
+}
+
+void FramebufferManager::cacheFbId(const ExynosLayer *layer, const Framebuffer::Key &key,
+                                   const Framebuffer::Layout &layout, uint32_t fbId,
+                                   const bool isPreimport) {
     Mutex::Autolock lock(mMutex);
-    auto clean = [&](std::map<const ExynosLayer *, FBList> &layerBuffs) {
-        if (auto it = layerBuffs.find(layer); it != layerBuffs.end()) {
-            mCleanBuffers.splice(mCleanBuffers.end(), std::move(it->second));
-            layerBuffs.erase(it);
+    if (isPreimport) {
+        /* the buffer was released or imported by getBuffer meanwhile */
+        if (mPreimportCanceled || mCache.contains(key)) {
+            mCache.discard(layer, key, layout, fbId);
+            return;
         }
-    };
-    clean(mCachedLayerBuffers);
-    clean(mCachedSecureLayerBuffers);
+        mPreimports++;
+    }
+
+    mCache.insert(layer, key, layout, fbId);
 }
 
 void FramebufferManager::removeFBsThreadRoutine()
 {
-    FBList cleanupBuffers;
+    FramebufferCache::FBList cleanupBuffers;
     while (true) {
         {
             Mutex::Autolock lock(mMutex);
@@ -167,14 +295,140 @@ void FramebufferManager::removeFBsThreadRoutine()
                 break;
             }
             mFlipDone.wait(mMutex);
-            cleanupBuffers.splice(cleanupBuffers.end(), mCleanBuffers);
+            mCache.takeCleanBuffers(cleanupBuffers);
         }
         ATRACE_NAME("cleanup framebuffers");
         cleanupBuffers.clear();
     }
 }
 
+void FramebufferManager::preimportBuffer(const ExynosLayer *layer, buffer_handle_t buffer) {
+    if (buffer == nullptr) {
+        return;
+    }
+
+    {
+        /* a known handle needs no gralloc metadata while its fbId is cached or on its way */
+        Mutex::Autolock lock(mMutex);
+        auto handleIter = mPreimportHandles.find(buffer);
+        if (handleIter != mPreimportHandles.end() && isImportedLocked(handleIter->second)) {
+            return;
+        }
+    }
+
+    VendorGraphicBufferMeta gmeta(buffer);
+    if (getDrmMode(gmeta.producer_usage) == SECURE_DRM) {
+        return;
+    }
+
+    /* describe the buffer the way it is configured when the DPP reads it directly */
+    PreimportRequest request;
+    auto &config = request.config;
+    config.state = config.WIN_STATE_BUFFER;
+    config.layer = layer;
+    config.format = gmeta.format;
+    config.buffer_id = gmeta.unique_id;
+    config.src.f_w = gmeta.stride;
+    config.src.f_h = gmeta.vstride;
+    config.compressionInfo = getCompressionInfo(buffer);
+    if (config.compressionInfo.type == COMP_TYPE_AFBC) {
+        config.comp_src = DPP_COMP_SRC_GPU;
+    }
+
+    int drmFormat = halFormatToDrmFormat(config.format, config.compressionInfo.type);
+    if (drmFormat == DRM_FORMAT_UNDEFINED) {
+        return;
+    }
+    request.key = Framebuffer::Key::of(
+            Framebuffer::BufferDesc{config.buffer_id, drmFormat, false});
+
+    {
+        Mutex::Autolock lock(mMutex);
+        if (mPreimportHandles.size() >= MAX_CACHED_BUFFERS) {
+            mPreimportHandles.clear();
+        }
+        mPreimportHandles[buffer] = request.key;
+        if (!mPreimportThreadRunning || mPreimportQueue.size() >= MAX_PREIMPORT_REQUESTS ||
+            isImportedLocked(request.key)) {
+            return;
+        }
+
+        /* the worker must not depend on the client keeping the buffer alive */
+        const int fds[] = {gmeta.fd, gmeta.fd1, gmeta.fd2};
+        for (size_t i = 0; i < std::size(fds); i++) {
+            config.fd_idma[i] = (fds[i] >= 0) ? dup(fds[i]) : -1;
+        }
+        mPreimportQueue.push_back(request);
+    }
+    mPreimportRequested.signal();
+}
+
+bool FramebufferManager::isImportedLocked(const Framebuffer::Key &key) {
+    if (mCache.contains(key) || (mPreimporting && mPreimportKey == key)) {
+        return true;
+    }
+    for (const auto &queued : mPreimportQueue) {
+        if (queued.key == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void FramebufferManager::dropPreimportsLocked(const ExynosLayer *layer,
+                                              const Framebuffer::Key *key) {
+    for (auto it = mPreimportQueue.begin(); it != mPreimportQueue.end();) {
+        if ((layer && it->config.layer != layer) || (key && !(it->key == *key))) {
+            ++it;
+            continue;
+        }
+        for (int fd : it->config.fd_idma) {
+            if (fd >= 0) close(fd);
+        }
+        it = mPreimportQueue.erase(it);
+    }
+}
+
+void FramebufferManager::preimportThreadRoutine() {
+    while (true) {
+        PreimportRequest request;
+        {
+            Mutex::Autolock lock(mMutex);
+            while (mPreimportThreadRunning && mPreimportQueue.empty()) {
+                mPreimportRequested.wait(mMutex);
+            }
+            if (!mPreimportThreadRunning) {
+                break;
+            }
+            request = mPreimportQueue.front();
+            mPreimportQueue.pop_front();
+        }
+
+        uint32_t fbId = 0;
+        {
+            ATRACE_NAME("preimport framebuffer");
+            getBuffer(request.config, fbId, true);
+        }
+        for (int fd : request.config.fd_idma) {
+            if (fd >= 0) close(fd);
+        }
+
+        {
+            Mutex::Autolock lock(mMutex);
+            mPreimporting = false;
+            mPreimportCanceled = false;
+            mPreimportLayer = nullptr;
+        }
+        mPreimportDone.broadcast();
+    }
+}
+
 int32_t FramebufferManager::getBuffer(const exynos_win_config_data &config, uint32_t &fbId) {
+    return getBuffer(config, fbId, false);
+}
+
+int32_t FramebufferManager::getBuffer(const exynos_win_config_data &config, uint32_t &fbId,
+                                      const bool isPreimport) {
     ATRACE_CALL();
     int ret = NO_ERROR;
     int drmFormat = DRM_FORMAT_UNDEFINED;
@@ -186,6 +440,8 @@ int32_t FramebufferManager::getBuffer(const exynos_win_config_data &config, uint
     DrmArray<uint32_t> offsets = {0};
     DrmArray<uint64_t> modifiers = {0};
     DrmArray<uint32_t> handles = {0};
+    Framebuffer::Key fbKey{};
+    Framebuffer::Layout fbLayout{};
 
     if (config.protection) modifiers[0] |= DRM_FORMAT_MOD_PROTECTION;
 
@@ -216,14 +472,6 @@ int32_t FramebufferManager::getBuffer(const exynos_win_config_data &config, uint
             return -EINVAL;
         }
 
-        fbId = findCachedFbId(config.layer, isSecureBuffer,
-                              [bufferDesc = Framebuffer::BufferDesc{config.buffer_id, drmFormat,
-                                                                    config.protection}](
-                                      auto& buffer) { return buffer->bufferDesc == bufferDesc; });
-        if (fbId != 0) {
-            return NO_ERROR;
-        }
-
         if (config.compressionInfo.type == COMP_TYPE_AFBC) {
             uint64_t compressed_modifier = config.compressionInfo.modifier;
             switch (config.comp_src) {
@@ -241,6 +489,14 @@ int32_t FramebufferManager::getBuffer(const exynos_win_config_data &config, uint
             modifiers[0] |= DRM_FORMAT_MOD_SAMSUNG_SBWC(config.compressionInfo.modifier);
         }
 
+        fbKey = Framebuffer::Key::of(
+                Framebuffer::BufferDesc{config.buffer_id, drmFormat, config.protection});
+        fbLayout = Framebuffer::Layout{bufWidth, bufHeight, modifiers[0]};
+        fbId = findCachedFbId(config.layer, fbKey, fbLayout, isPreimport);
+        if (fbId != 0) {
+            return NO_ERROR;
+        }
+
         for (uint32_t bufferIndex = 0; bufferIndex < bufferNum; bufferIndex++) {
             pitches[bufferIndex] = config.src.f_w * bpp;
             modifiers[bufferIndex] = modifiers[0];
@@ -269,9 +525,10 @@ int32_t FramebufferManager::getBuffer(const exynos_win_config_data &config, uint
         handles[0] = 0xff000000;
         bpp = getBytePerPixelOfPrimaryPlane(HAL_PIXEL_FORMAT_BGRA_8888);
         pitches[0] = config.dst.w * bpp;
-        fbId = findCachedFbId(config.layer, isSecureBuffer,
-                              [colorDesc = Framebuffer::SolidColorDesc{bufWidth, bufHeight}](
-                                      auto& buffer) { return buffer->colorDesc == colorDesc; });
+        fbKey = Framebuffer::Key::of(Framebuffer::SolidColorDesc{bufWidth, bufHeight},
+                                     isSecureBuffer);
+        fbLayout = Framebuffer::Layout{bufWidth, bufHeight, modifiers[0]};
+        fbId = findCachedFbId(config.layer, fbKey, fbLayout, isPreimport);
         if (fbId != 0) {
             return NO_ERROR;
         }
@@ -300,29 +557,7 @@ int32_t FramebufferManager::getBuffer(const exynos_win_config_data &config, uint
     }
 
     if (config.layer || config.buffer_id) {
-        Mutex::Autolock lock(mMutex);
-        auto& cachedBuffers = (!isSecureBuffer) ? mCachedLayerBuffers[config.layer]
-                                                : mCachedSecureLayerBuffers[config.layer];
-        auto maxCachedBufferSize = (!isSecureBuffer) ? MAX_CACHED_BUFFERS_PER_LAYER
-                                                     : MAX_CACHED_SECURE_BUFFERS_PER_LAYER;
-        markInuseLayerLocked(config.layer, isSecureBuffer);
-
-        if (cachedBuffers.size() > maxCachedBufferSize) {
-            ALOGW("FBManager: cached buffers size %zu exceeds limitation(%zu) while adding fbId %d",
-                  cachedBuffers.size(), maxCachedBufferSize, fbId);
-            mCleanBuffers.splice(mCleanBuffers.end(), cachedBuffers);
-        }
-
-        if (config.state == config.WIN_STATE_COLOR) {
-            cachedBuffers.emplace_front(
-                    new Framebuffer(mDrmFd, fbId,
-                                    Framebuffer::SolidColorDesc{bufWidth, bufHeight}));
-        } else {
-            cachedBuffers.emplace_front(
-                    new Framebuffer(mDrmFd, fbId,
-                                    Framebuffer::BufferDesc{config.buffer_id, drmFormat,
-                                                            config.protection}));
-        }
+        cacheFbId(config.layer, fbKey, fbLayout, fbId, isPreimport);
     } else {
         ALOGW("FBManager: possible leakage fbId %d was created", fbId);
     }
@@ -334,12 +569,11 @@ void FramebufferManager::flip(const bool hasSecureBuffer) {
     bool needCleanup = false;
     {
         Mutex::Autolock lock(mMutex);
-        destroyUnusedLayersLocked();
         if (!hasSecureBuffer) {
-            destroyAllSecureBuffersLocked();
+            mCache.evictSecure();
         }
 
-        needCleanup = mCleanBuffers.size() > 0;
+        needCleanup = mCache.hasCleanBuffers();
     }
 
     if (needCleanup) {
@@ -350,9 +584,18 @@ void FramebufferManager::flip(const bool hasSecureBuffer) {
 void FramebufferManager::releaseAll()
 {
     Mutex::Autolock lock(mMutex);
-    mCachedLayerBuffers.clear();
-    mCachedSecureLayerBuffers.clear();
-    mCleanBuffers.clear();
+    dropPreimportsLocked(nullptr, nullptr);
+    mPreimportCanceled = mPreimporting;
+    mPreimportHandles.clear();
+    mCache.clear();
+}
+
+void FramebufferManager::dump(String8 &result) {
+    Mutex::Autolock lock(mMutex);
+    result.appendFormat("Framebuffer cache: cached %zu (secure %zu), hits %" PRIu64
+                        ", misses %" PRIu64 ", evictions %" PRIu64 ", preimports %" PRIu64 "\n",
+                        mCache.size(), mCache.secureSize(), mCache.stats().hits,
+                        mCache.stats().misses, mCache.stats().evictions, mPreimports);
 }
 
 void FramebufferManager::freeBufHandle(uint32_t handle) {
@@ -369,67 +612,12 @@ void FramebufferManager::freeBufHandle(uint32_t handle) {
     }
 }
 
-void FramebufferManager::markInuseLayerLocked(const ExynosLayer* layer, const bool isSecureBuffer) {
-    if (!isSecureBuffer && mCacheShrinkPending) {
-        mCachedLayersInuse.insert(layer);
-    }
-
-    if (isSecureBuffer && mCacheSecureShrinkPending) {
-        mCachedSecureLayersInuse.insert(layer);
-    }
-}
-
-void FramebufferManager::destroyUnusedLayersLocked() {
-    auto destroyUnusedLayers =
-            [&](const bool &cacheShrinkPending, std::set<const ExynosLayer *> &cachedLayersInuse,
-                std::map<const ExynosLayer *, FBList> &cachedLayerBuffers) -> bool {
-        if (!cacheShrinkPending || cachedLayersInuse.size() == cachedLayerBuffers.size()) {
-            cachedLayersInuse.clear();
-            return false;
-        }
-
-        for (auto layer = cachedLayerBuffers.begin(); layer != cachedLayerBuffers.end();) {
-            if (cachedLayersInuse.find(layer->first) == cachedLayersInuse.end()) {
-                mCleanBuffers.splice(mCleanBuffers.end(), std::move(layer->second));
-                layer = cachedLayerBuffers.erase(layer);
-            } else {
-                ++layer;
-            }
-        }
-        cachedLayersInuse.clear();
-        return true;
-    };
-
-    auto cachedLayerSize = mCachedLayerBuffers.size();
-    if (destroyUnusedLayers(mCacheShrinkPending, mCachedLayersInuse, mCachedLayerBuffers)) {
-        ALOGW("FBManager: shrink cached layers from %zu to %zu", cachedLayerSize,
-              mCachedLayerBuffers.size());
-    }
-
-    cachedLayerSize = mCachedSecureLayerBuffers.size();
-    if (destroyUnusedLayers(mCacheSecureShrinkPending, mCachedSecureLayersInuse,
-                            mCachedSecureLayerBuffers)) {
-        ALOGW("FBManager: shrink cached secure layers from %zu to %zu", cachedLayerSize,
-              mCachedSecureLayerBuffers.size());
-    }
-}
-
-void FramebufferManager::destroyAllSecureBuffersLocked() {
-    for (auto& [layer, bufferList] : mCachedSecureLayerBuffers) {
-        if (bufferList.size()) {
-            mCleanBuffers.splice(mCleanBuffers.end(), bufferList, bufferList.begin(),
-                                 bufferList.end());
-        }
-    }
-    mCachedSecureLayerBuffers.clear();
-}
-
 void FramebufferManager::destroyAllSecureBuffers() {
     bool needCleanup = false;
     {
         Mutex::Autolock lock(mMutex);
-        destroyAllSecureBuffersLocked();
-        needCleanup = mCleanBuffers.size() > 0;
+        mCache.evictSecure();
+        needCleanup = mCache.hasCleanBuffers();
     }
     if (needCleanup) {
         mFlipDone.signal();
@@ -438,36 +626,24 @@ void FramebufferManager::destroyAllSecureBuffers() {
 
 int32_t FramebufferManager::uncacheLayerBuffers(const ExynosLayer* layer,
                                                 const std::vector<buffer_handle_t>& buffers) {
-    std::set<Framebuffer::BufferDesc> removedBufferDescs;
-    for (auto buffer : buffers) {
-        VendorGraphicBufferMeta gmeta(buffer);
-        removedBufferDescs.insert(
-                Framebuffer::BufferDesc{.bufferId = gmeta.unique_id,
-                                        .drmFormat =
-                                                halFormatToDrmFormat(gmeta.format,
-                                                                     getCompressionType(buffer)),
-                                        .isSecure =
-                                                (getDrmMode(gmeta.producer_usage) == SECURE_DRM)});
-    }
     bool needCleanup = false;
     {
         Mutex::Autolock lock(mMutex);
-        auto destroyCachedBuffersLocked =
-                [&](std::map<const ExynosLayer*, FBList>& cachedLayerBuffers) REQUIRES(mMutex) {
-                    if (auto layerIter = cachedLayerBuffers.find(layer);
-                        layerIter != cachedLayerBuffers.end()) {
-                        auto& fbList = layerIter->second;
-                        for (auto it = fbList.begin(); it != fbList.end();) {
-                            auto bufferIter = it++;
-                            if (removedBufferDescs.count((*bufferIter)->bufferDesc)) {
-                                mCleanBuffers.splice(mCleanBuffers.end(), fbList, bufferIter);
-                                needCleanup = true;
-                            }
-                        }
-                    }
-                };
-        destroyCachedBuffersLocked(mCachedLayerBuffers);
-        destroyCachedBuffersLocked(mCachedSecureLayerBuffers);
+        for (auto buffer : buffers) {
+            mPreimportHandles.erase(buffer);
+            VendorGraphicBufferMeta gmeta(buffer);
+            auto key = Framebuffer::Key::of(Framebuffer::BufferDesc{
+                    .bufferId = gmeta.unique_id,
+                    .drmFormat = halFormatToDrmFormat(gmeta.format, getCompressionType(buffer)),
+                    .isSecure = (getDrmMode(gmeta.producer_usage) == SECURE_DRM)});
+            dropPreimportsLocked(nullptr, &key);
+            if (mPreimporting && mPreimportKey == key) {
+                mPreimportCanceled = true;
+            }
+            if (mCache.evict(layer, key)) {
+                needCleanup = true;
+            }
+        }
     }
     if (needCleanup) {
         mFlipDone.signal();
@@ -475,6 +651,11 @@ int32_t FramebufferManager::uncacheLayerBuffers(const ExynosLayer* layer,
     return NO_ERROR;
 }
 
+void ExynosDisplayDrmInterface::preimportBuffer(const ExynosLayer *layer,
+                                                buffer_handle_t buffer) {
+    mFBManager.preimportBuffer(layer, buffer);
+}
+
 int32_t ExynosDisplayDrmInterface::uncacheLayerBuffers(
         const ExynosLayer* layer, const std::vector<buffer_handle_t>& buffers) {
     return mFBManager.uncacheLayerBuffers(layer, buffers);
@@ -530,8 +711,6 @@ ExynosDisplayDrmInterface::~ExynosDisplayDrmInterface()
         mDrmDevice->DestroyPropertyBlob(mDesiredModeState.blob_id);
     if (mDesiredModeState.old_blob_id)
         mDrmDevice->DestroyPropertyBlob(mDesiredModeState.old_blob_id);
-    if (mPartialRegionState.blob_id)
-        mDrmDevice->DestroyPropertyBlob(mPartialRegionState.blob_id);
 }
 
 void ExynosDisplayDrmInterface::init(ExynosDisplay *exynosDisplay)
@@ -728,6 +907,12 @@ int32_t ExynosDisplayDrmInterface::initDrmDevice(DrmDevice *drmDevice)
     }
 
     mFBManager.init(mDrmDevice->fd());
+    mBlobCache.init(mDrmDevice);
+    if (mDrmDevice->planes().size() > kMaxPlaneMaskBits) {
+        HWC_LOGE(mExynosDisplay, "%s:: %zu planes, only %zu can be tracked", __func__,
+                 mDrmDevice->planes().size(), kMaxPlaneMaskBits);
+    }
+    initCommittedState();
 
     int drmDisplayId = getDrmDisplayId(mExynosDisplay->mType, mExynosDisplay->mIndex);
     if (drmDisplayId < 0) {
@@ -995,6 +1180,9 @@ int32_t ExynosDisplayDrmInterface::setPowerMode(int32_t mode)
         dpms_value = DRM_MODE_DPMS_ON;
     }
 
+    /* the kernel may reset plane and crtc state across power transitions */
+    sCommittedState.Invalidate();
+
     const DrmProperty &prop = mDrmConnector->dpms_property();
     if ((ret = drmModeConnectorSetProperty(mDrmDevice->fd(), mDrmConnector->id(), prop.id(),
             dpms_value)) != NO_ERROR) {
@@ -1857,17 +2045,15 @@ int32_t ExynosDisplayDrmInterface::setupCommitFromDisplayConfig(
         if (plane->block_property().id()) {
             if (mBlockState != config.block_area) {
                 uint32_t blobId = 0;
-                ret = mDrmDevice->CreatePropertyBlob(&config.block_area, sizeof(config.block_area),
-                                                     &blobId);
-                if (ret || (blobId == 0)) {
-                    HWC_LOGE(mExynosDisplay, "Failed to create blocking region blob id=%d, ret=%d",
-                             blobId, ret);
+                ret = mBlobCache.get(&config.block_area, sizeof(config.block_area), blobId);
+                if (ret) {
+                    HWC_LOGE(mExynosDisplay, "Failed to get blocking region blob ret=%d", ret);
                     return ret;
                 }
 
                 mBlockState.mRegion = config.block_area;
                 if (mBlockState.mBlobId) {
-                    drmReq.addOldBlob(mBlockState.mBlobId);
+                    mBlobCache.put(mBlockState.mBlobId);
                 }
                 mBlockState.mBlobId = blobId;
             }
@@ -1901,11 +2087,9 @@ int32_t ExynosDisplayDrmInterface::setupPartialRegion(DrmModeAtomicReq &drmReq)
          mPartialRegionState.isUpdated(partial_rect))
     {
         uint32_t blob_id = 0;
-        ret = mDrmDevice->CreatePropertyBlob(&partial_rect,
-                sizeof(partial_rect),&blob_id);
-        if (ret || (blob_id == 0)) {
-            HWC_LOGE(mExynosDisplay, "Failed to create partial region "
-                    "blob id=%d, ret=%d", blob_id, ret);
+        ret = mBlobCache.get(&partial_rect, sizeof(partial_rect), blob_id);
+        if (ret) {
+            HWC_LOGE(mExynosDisplay, "Failed to get partial region blob ret=%d", ret);
             return ret;
         }
 
@@ -1924,7 +2108,7 @@ int32_t ExynosDisplayDrmInterface::setupPartialRegion(DrmModeAtomicReq &drmReq)
         mPartialRegionState.partial_rect = partial_rect;
 
         if (mPartialRegionState.blob_id)
-            drmReq.addOldBlob(mPartialRegionState.blob_id);
+            mBlobCache.put(mPartialRegionState.blob_id);
         mPartialRegionState.blob_id = blob_id;
     }
     if ((ret = drmReq.atomicAddProperty(mDrmCrtc->id(),
@@ -1990,7 +2174,6 @@ int32_t ExynosDisplayDrmInterface::deliverWinConfigData()
 {
     int ret = NO_ERROR;
     DrmModeAtomicReq drmReq(this);
-    std::unordered_map<uint32_t, uint32_t> planeEnableInfo;
     android::String8 result;
     bool hasSecureBuffer = false;
 
@@ -2005,8 +2188,6 @@ int32_t ExynosDisplayDrmInterface::deliverWinConfigData()
         }
     });
 
-    mFBManager.checkShrink();
-
     bool needModesetForReadback = false;
     if (mExynosDisplay->mDpuData.enable_readback) {
         if ((ret = setupWritebackCommit(drmReq)) < 0) {
@@ -2014,7 +2195,8 @@ int32_t ExynosDisplayDrmInterface::deliverWinConfigData()
                     __func__, ret);
             return ret;
         }
-        needModesetForReadback = true;
+        /* Only attaching the writeback connector needs a modeset, not a buffer switch */
+        needModesetForReadback = !mReadbackInfo.mWritebackAttached;
     } else {
         if (mReadbackInfo.mNeedClearReadbackCommit) {
             if ((ret = clearWritebackCommit(drmReq)) < 0) {
@@ -2044,16 +2226,14 @@ int32_t ExynosDisplayDrmInterface::deliverWinConfigData()
     if ((ret = setupPartialRegion(drmReq)) != NO_ERROR)
         return ret;
 
-    uint64_t out_fences[mDrmDevice->crtcs().size()];
+    uint64_t outFence = 0;
     if ((ret = drmReq.atomicAddProperty(mDrmCrtc->id(),
                     mDrmCrtc->out_fence_ptr_property(),
-                    (uint64_t)&out_fences[mDrmCrtc->pipe()], true)) < 0) {
+                    (uint64_t)&outFence, true)) < 0) {
         return ret;
     }
 
-    for (auto &plane : mDrmDevice->planes()) {
-        planeEnableInfo[plane->id()] = 0;
-    }
+    mPlaneEnableMask = 0;
 
     uint64_t dqeEnable = 1;
     if (mExynosDisplay->mDpuData.enable_readback &&
@@ -2099,7 +2279,7 @@ int32_t ExynosDisplayDrmInterface::deliverWinConfigData()
             }
             hasSecureBuffer |= config.protection;
             /* Set this plane is enabled */
-            planeEnableInfo[plane->id()] = 1;
+            mPlaneEnableMask |= 1ULL << channelId;
         }
     }
 
@@ -2115,38 +2295,51 @@ int32_t ExynosDisplayDrmInterface::deliverWinConfigData()
                 if ((ret = setupCommitFromDisplayConfig(drmReq, config, i, plane, fbId)) < 0) {
                     HWC_LOGE(mExynosDisplay, "setupCommitFromDisplayConfig failed, config[%zu]", i);
                 }
-                planeEnableInfo[plane->id()] = 1;
+                mPlaneEnableMask |= 1ULL << channelId;
             }
         }
     }
 
-    /* Disable unused plane */
-    for (auto &plane : mDrmDevice->planes()) {
-        if (planeEnableInfo[plane->id()] == 0) {
-            /* Don't disable planes that are reserved to other display */
-            ExynosMPP* exynosMPP = mExynosMPPsForPlane[plane->id()];
-            if ((exynosMPP != NULL) && (mExynosDisplay != NULL) &&
-                (exynosMPP->mAssignedState & MPP_ASSIGN_STATE_RESERVED) &&
-                (exynosMPP->mReservedDisplay != (int32_t)mExynosDisplay->mDisplayId))
-                continue;
-
-            if ((exynosMPP == NULL) && (mExynosDisplay->mType == HWC_DISPLAY_PRIMARY) &&
-                (plane->id() != static_cast<ExynosPrimaryDisplay *>(mExynosDisplay)->mRcdId))
-                continue;
-
-            /* If this plane is not supported by the CRTC binded with ExynosDisplay,
-             * it should be disabled by this ExynosDisplay */
-            if (!plane->GetCrtcSupported(*mDrmCrtc))
-                continue;
+    /* Disable planes that were enabled before but are unused in this frame */
+    if (mCommittedPlaneMaskInvalid.exchange(false)) mCommittedPlaneMask = kAllPlanesMask;
+    uint64_t skippedPlaneMask = 0;
+    const size_t planeNum = std::min(mDrmDevice->planes().size(), kMaxPlaneMaskBits);
+    uint64_t disableMask = mCommittedPlaneMask & ~mPlaneEnableMask;
+    if (planeNum < kMaxPlaneMaskBits)
+        disableMask &= (1ULL << planeNum) - 1;
+    while (disableMask) {
+        const size_t planeIndex = __builtin_ctzll(disableMask);
+        disableMask &= disableMask - 1;
 
-            if ((ret = drmReq.atomicAddProperty(plane->id(),
-                    plane->crtc_property(), 0)) < 0)
-                return ret;
+        auto &plane = mDrmDevice->planes()[planeIndex];
+        /* Don't disable planes that are reserved to other display */
+        ExynosMPP* exynosMPP = mExynosMPPsForPlane[plane->id()];
+        if ((exynosMPP != NULL) && (mExynosDisplay != NULL) &&
+            (exynosMPP->mAssignedState & MPP_ASSIGN_STATE_RESERVED) &&
+            (exynosMPP->mReservedDisplay != (int32_t)mExynosDisplay->mDisplayId)) {
+            /* Keep it a candidate until the reservation no longer hides it */
+            skippedPlaneMask |= 1ULL << planeIndex;
+            continue;
+        }
 
-            if ((ret = drmReq.atomicAddProperty(plane->id(),
-                    plane->fb_property(), 0)) < 0)
-                return ret;
+        if ((exynosMPP == NULL) && (mExynosDisplay->mType == HWC_DISPLAY_PRIMARY) &&
+            (plane->id() != static_cast<ExynosPrimaryDisplay *>(mExynosDisplay)->mRcdId)) {
+            skippedPlaneMask |= 1ULL << planeIndex;
+            continue;
         }
+
+        /* If this plane is not supported by the CRTC binded with ExynosDisplay,
+         * it should be disabled by this ExynosDisplay */
+        if (!plane->GetCrtcSupported(*mDrmCrtc))
+            continue;
+
+        if ((ret = drmReq.atomicAddProperty(plane->id(),
+                plane->crtc_property(), 0)) < 0)
+            return ret;
+
+        if ((ret = drmReq.atomicAddProperty(plane->id(),
+                plane->fb_property(), 0)) < 0)
+            return ret;
     }
 
     if (ATRACE_ENABLED()) {
@@ -2255,23 +2448,30 @@ int32_t ExynosDisplayDrmInterface::deliverWinConfigData()
         mExynosDisplay->applyExpectedPresentTime();
     }
 
+    drmReq.setDeltaCommit(true);
     if ((ret = drmReq.commit(flags, true)) < 0) {
         HWC_LOGE(mExynosDisplay, "%s:: Failed to commit pset ret=%d in deliverWinConfigData()\n",
                 __func__, ret);
+        mCommittedPlaneMask = kAllPlanesMask;
+        mReadbackInfo.mWritebackAttached = false;
         return ret;
     }
+    mCommittedPlaneMask = mPlaneEnableMask | skippedPlaneMask;
+    if (mExynosDisplay->mDpuData.enable_readback) mReadbackInfo.mWritebackAttached = true;
 
-    mExynosDisplay->mDpuData.retire_fence = (int)out_fences[mDrmCrtc->pipe()];
+    mExynosDisplay->mDpuData.retire_fence = (int)outFence;
     /*
-     * [HACK] dup retire_fence for each layer's release fence
+     * Every buffer window is released by the retire fence, so all of them
+     * share one dup of it instead of getting one each.
      * Do not use hwc_dup because hwc_dup increase usage count of fence treacer
      * Usage count of this fence is incresed by ExynosDisplay::deliverWinConfigData()
      */
     for (auto &display_config : mExynosDisplay->mDpuData.configs) {
         if ((display_config.state == display_config.WIN_STATE_BUFFER) ||
             (display_config.state == display_config.WIN_STATE_CURSOR)) {
-            display_config.rel_fence =
-                dup((int)out_fences[mDrmCrtc->pipe()]);
+            mExynosDisplay->mDpuData.release_fence =
+                    std::make_shared<SharedFence>(dup((int)outFence), mExynosDisplay);
+            break;
         }
     }
 
@@ -2377,6 +2577,8 @@ int32_t ExynosDisplayDrmInterface::clearDisplay(bool needModeClear)
     int ret = NO_ERROR;
     DrmModeAtomicReq drmReq(this);
 
+    /* walk every plane again in the next frame */
+    mCommittedPlaneMask = kAllPlanesMask;
     ret = clearDisplayPlanes(drmReq);
     if (ret != NO_ERROR) {
         HWC_LOGE(mExynosDisplay, "%s: Failed to clear planes", __func__);
@@ -2591,10 +2793,22 @@ int ExynosDisplayDrmInterface::DrmModeAtomicReq::commit(uint32_t flags, bool log
      * During kernel is in TUI, all atomic commits should be returned with error EPERM(-1).
      * To avoid handling atomic commit as fail, it needs to check TUI status.
      */
-    int ret = drmModeAtomicCommit(mDrmDisplayInterface->mDrmDevice->fd(),
-            mPset, flags, mDrmDisplayInterface->mDrmDevice);
+    auto atomicCommit = [&](uint32_t) {
+        return drmModeAtomicCommit(mDrmDisplayInterface->mDrmDevice->fd(), mPset, flags,
+                                   mDrmDisplayInterface->mDrmDevice);
+    };
+    int ret;
+    if (flags & DRM_MODE_ATOMIC_TEST_ONLY) {
+        ret = atomicCommit(0);
+    } else {
+        /* unchanged properties are dropped from mPset in place */
+        ret = ExynosDisplayDrmInterface::sCommittedState
+                      .Commit(mPset->items, mPset->cursor, mDeltaCommit,
+                              flags & DRM_MODE_ATOMIC_ALLOW_MODESET, atomicCommit);
+    }
     if (loggingForDebug)
         dumpAtomicCommitInfo(result, true);
+
     if ((ret == -EPERM) && mDrmDisplayInterface->mDrmDevice->event_listener()->IsDrmInTUI()) {
         ALOGV("skip atomic commit error handling as kernel is in TUI");
         ret = NO_ERROR;
@@ -2741,6 +2955,7 @@ int32_t ExynosDisplayDrmInterface::clearWritebackCommit(DrmModeAtomicReq &drmReq
         return ret;
 
     mReadbackInfo.mNeedClearReadbackCommit = false;
+    mReadbackInfo.mWritebackAttached = false;
     return NO_ERROR;
 }
 
@@ -3082,6 +3297,8 @@ void ExynosDisplayDrmInterface::handleDrmPropertyUpdate(uint32_t connector_id, u
         return;
     }
     mDrmDevice->UpdateConnectorProperty(*mDrmConnector, *prop);
+    /* Connector properties the kernel updates can follow a panel refresh rate change */
+    onVsyncTimingChanged();
     if ((*prop)->id() == mDrmConnector->content_protection().id()) {
         auto [ret, content_protection_value] = mDrmConnector->content_protection().value();
         if (ret < 0) {
@@ -3160,6 +3377,8 @@ int32_t ExynosDisplayDrmInterface::swapCrtcs(ExynosDisplay* anotherDisplay) {
 
     anotherDisplayIntf->mDrmCrtc = mDrmCrtc;
     mDrmCrtc = anotherCrtc;
+    mCommittedPlaneMask = kAllPlanesMask;
+    anotherDisplayIntf->mCommittedPlaneMask = kAllPlanesMask;
 
     clearOldCrtcBlobs();
     anotherDisplayIntf->clearOldCrtcBlobs();
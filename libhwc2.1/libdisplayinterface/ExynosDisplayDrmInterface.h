@@ -22,13 +22,20 @@
 #include <utils/Mutex.h>
 #include <xf86drmMode.h>
 
+#include <atomic>
+#include <deque>
 #include <list>
+#include <string>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "ExynosDisplay.h"
 #include "ExynosDisplayInterface.h"
 #include "ExynosHWC.h"
 #include "ExynosMPP.h"
+#include "FramebufferCache.h"
+#include "drmcommittedstate.h"
 #include "drmconnector.h"
 #include "drmcrtc.h"
 #include "histogram/histogram.h"
@@ -85,8 +92,6 @@ class FramebufferManager {
         // layer. Those fbIds will be cleaned up once the layer was destroyed.
         int32_t getBuffer(const exynos_win_config_data &config, uint32_t &fbId);
 
-        void checkShrink();
-
         void cleanup(const ExynosLayer *layer);
         void destroyAllSecureBuffers();
         int32_t uncacheLayerBuffers(const ExynosLayer* layer,
@@ -102,52 +107,22 @@ class FramebufferManager {
         // off
         void releaseAll();
 
-    private:
-        // this struct should contain elements that can be used to identify framebuffer more easily
-        struct Framebuffer {
-            struct BufferDesc {
-                uint64_t bufferId;
-                int drmFormat;
-                bool isSecure;
-                bool operator==(const Framebuffer::BufferDesc &rhs) const {
-                    return (bufferId == rhs.bufferId && drmFormat == rhs.drmFormat &&
-                            isSecure == rhs.isSecure);
-                }
-                bool operator<(const Framebuffer::BufferDesc& rhs) const {
-                    if (bufferId != rhs.bufferId) {
-                        return bufferId < rhs.bufferId;
-                    }
-                    if (drmFormat != rhs.drmFormat) {
-                        return drmFormat < rhs.drmFormat;
-                    }
-                    return isSecure < rhs.isSecure;
-                }
-            };
-            struct SolidColorDesc {
-                uint32_t width;
-                uint32_t height;
-                bool operator==(const Framebuffer::SolidColorDesc &rhs) const {
-                    return (width == rhs.width && height == rhs.height);
-                }
-            };
+        // queue an import of a buffer that is expected to be scanned out directly, so the
+        // fbId is already cached when the buffer reaches getBuffer. Secure buffers are not
+        // pre-imported.
+        void preimportBuffer(const ExynosLayer *layer, buffer_handle_t buffer);
 
-            explicit Framebuffer(int fd, uint32_t fb, BufferDesc desc)
-                  : drmFd(fd), fbId(fb), bufferDesc(desc){};
-            explicit Framebuffer(int fd, uint32_t fb, SolidColorDesc desc)
-                  : drmFd(fd), fbId(fb), colorDesc(desc){};
-            ~Framebuffer() { drmModeRmFB(drmFd, fbId); };
-            int drmFd;
-            uint32_t fbId;
-            union {
-                BufferDesc bufferDesc;
-                SolidColorDesc colorDesc;
-            };
-        };
-        using FBList = std::list<std::unique_ptr<Framebuffer>>;
+        void dump(String8 &result);
 
-        template <class UnaryPredicate>
-        uint32_t findCachedFbId(const ExynosLayer* layer, const bool isSecureBuffer,
-                                UnaryPredicate predicate);
+    private:
+        using Framebuffer = FramebufferCache;
+
+        int32_t getBuffer(const exynos_win_config_data &config, uint32_t &fbId,
+                          const bool isPreimport);
+        uint32_t findCachedFbId(const ExynosLayer *layer, const Framebuffer::Key &key,
+                                const Framebuffer::Layout &layout, const bool isPreimport);
+        void cacheFbId(const ExynosLayer *layer, const Framebuffer::Key &key,
+                       const Framebuffer::Layout &layout, uint32_t fbId, const bool isPreimport);
         int addFB2WithModifiers(uint32_t state, uint32_t width, uint32_t height, uint32_t drmFormat,
                                 const DrmArray<uint32_t> &handles,
                                 const DrmArray<uint32_t> &pitches,
@@ -160,56 +135,91 @@ class FramebufferManager {
         uint32_t getBufHandleFromFd(int fd);
         void freeBufHandle(uint32_t handle);
         void removeFBsThreadRoutine();
-
-        void markInuseLayerLocked(const ExynosLayer* layer, const bool isSecureBuffer)
+        void preimportThreadRoutine();
+        void dropPreimportsLocked(const ExynosLayer *layer, const Framebuffer::Key *key)
                 REQUIRES(mMutex);
-        void destroyUnusedLayersLocked() REQUIRES(mMutex);
-        void destroyAllSecureBuffersLocked() REQUIRES(mMutex);
+        // cached, being pre-imported or queued for it
+        bool isImportedLocked(const Framebuffer::Key &key) REQUIRES(mMutex);
 
         int mDrmFd = -1;
 
-        // mCachedLayerBuffers map keep the relationship between Layer and FBList.
-        // mCachedSecureLayerBuffers map keep the relationship between secure
-        // Layer and FBList. The map entry will be deleted once the layer is destroyed.
-        std::map<const ExynosLayer *, FBList> mCachedLayerBuffers;
-        std::map<const ExynosLayer*, FBList> mCachedSecureLayerBuffers;
-
-        // mCleanBuffers list keeps fbIds of destroyed layers. Those fbIds will
-        // be destroyed in mRmFBThread thread.
-        FBList mCleanBuffers;
-
-        // mCacheShrinkPending is set when we want to clean up unused layers
-        // in mCachedLayerBuffers. When the flag is set, mCachedLayersInuse will
-        // keep in-use layers in this frame update. Those unused layers will be
-        // freed at the end of the update. mCacheSecureShrinkPending is same to
-        // mCacheShrinkPending but for mCachedSecureLayerBuffers.
-        // TODO: have a better way to maintain inuse layers
-        bool mCacheShrinkPending = false;
-        bool mCacheSecureShrinkPending = false;
-        std::set<const ExynosLayer *> mCachedLayersInuse;
-        std::set<const ExynosLayer*> mCachedSecureLayersInuse;
+        static constexpr size_t MAX_CACHED_BUFFERS = 128;
+        static constexpr size_t MAX_CACHED_SECURE_BUFFERS = 3;
+
+        // mCache keeps the cached framebuffers in LRU order, its clean list
+        // keeps the fbIds of destroyed layers. Those fbIds will be destroyed in
+        // mRmFBThread thread.
+        FramebufferCache mCache{MAX_CACHED_BUFFERS, MAX_CACHED_SECURE_BUFFERS, drmModeRmFB};
+
+        struct PreimportRequest {
+            Framebuffer::Key key;
+            exynos_win_config_data config;
+        };
+        uint64_t mPreimports = 0;
 
         std::thread mRmFBThread;
         bool mRmFBThreadRunning = false;
         Condition mFlipDone;
         Mutex mMutex;
 
-        static constexpr size_t MAX_CACHED_LAYERS = 16;
-        static constexpr size_t MAX_CACHED_SECURE_LAYERS = 1;
-        static constexpr size_t MAX_CACHED_BUFFERS_PER_LAYER = 32;
-        static constexpr size_t MAX_CACHED_SECURE_BUFFERS_PER_LAYER = 3;
+        // mPreimportQueue keeps buffers waiting to be imported by
+        // mPreimportThread, their fds are duplicated and owned by the queue.
+        // mPreimportKey is the key being imported while mPreimporting is set,
+        // getBuffer waits on mPreimportDone instead of importing it twice.
+        // mPreimportCanceled drops the in-flight import if its layer or buffer
+        // was released meanwhile.
+        std::thread mPreimportThread;
+        Condition mPreimportRequested;
+        Condition mPreimportDone;
+        std::deque<PreimportRequest> mPreimportQueue;
+        Framebuffer::Key mPreimportKey{};
+        const ExynosLayer *mPreimportLayer = nullptr;
+        bool mPreimportThreadRunning = false;
+        bool mPreimporting = false;
+        bool mPreimportCanceled = false;
+        // keys of the handles seen by preimportBuffer, so that a handle coming back skips the
+        // gralloc metadata lookups. A stale entry only costs a missed pre-import.
+        std::unordered_map<buffer_handle_t, Framebuffer::Key> mPreimportHandles;
+
+        static constexpr size_t MAX_PREIMPORT_REQUESTS = 8;
 };
 
-template <class UnaryPredicate>
-uint32_t FramebufferManager::findCachedFbId(const ExynosLayer* layer, const bool isSecureBuffer,
-                                            UnaryPredicate predicate) {
-    Mutex::Autolock lock(mMutex);
-    markInuseLayerLocked(layer, isSecureBuffer);
-    const auto& cachedBuffers =
-            (!isSecureBuffer) ? mCachedLayerBuffers[layer] : mCachedSecureLayerBuffers[layer];
-    const auto it = std::find_if(cachedBuffers.begin(), cachedBuffers.end(), predicate);
-    return (it != cachedBuffers.end()) ? (*it)->fbId : 0;
-}
+// Property blobs of one display keyed by their payload. A payload that comes
+// back, like a partial update region alternating between a few rects, reuses
+// its blob instead of creating a new one every frame. Blobs referenced by the
+// display state are kept, the others are destroyed in LRU order once more
+// than kMaxBlobs are cached. It is only used from the display's commit path.
+class DrmPropertyBlobCache {
+    public:
+        ~DrmPropertyBlobCache() { clear(); }
+        void init(DrmDevice *drmDevice) { mDrmDevice = drmDevice; }
+
+        // blobId holds data and is referenced until put() is called for it
+        int32_t get(const void *data, size_t length, uint32_t &blobId);
+        void put(uint32_t blobId);
+        void clear();
+        void dump(String8 &result);
+
+    private:
+        static constexpr size_t kMaxBlobs = 16;
+        struct Blob {
+            std::string payload;
+            uint32_t id;
+            uint32_t refCount;
+        };
+        using BlobList = std::list<Blob>;
+        void evictUnused();
+
+        DrmDevice *mDrmDevice = nullptr;
+        // most recently used first
+        BlobList mBlobs;
+        // keys view the payload of the Blob they point to
+        std::unordered_map<std::string_view, BlobList::iterator> mIndex;
+
+        uint64_t mHits = 0;
+        uint64_t mMisses = 0;
+        uint64_t mEvictions = 0;
+};
 
 class ExynosDisplayDrmInterface :
     public ExynosDisplayInterface,
@@ -239,6 +249,8 @@ class ExynosDisplayDrmInterface :
                     mSavedPset = NULL;
                 }
 
+                // commit only the properties changed since the last commit
+                void setDeltaCommit(bool enable) { mDeltaCommit = enable; };
                 void setError(int err) { mError = err; };
                 int getError() { return mError; };
                 int32_t atomicAddProperty(const uint32_t id,
@@ -271,6 +283,7 @@ class ExynosDisplayDrmInterface :
                 drmModeAtomicReqPtr mPset;
                 drmModeAtomicReqPtr mSavedPset;
                 int mError = 0;
+                bool mDeltaCommit = false;
                 ExynosDisplayDrmInterface *mDrmDisplayInterface = NULL;
                 /* Destroy old blobs after commit */
                 std::vector<uint32_t> mOldBlobs;
@@ -342,6 +355,11 @@ class ExynosDisplayDrmInterface :
                 uint32_t* outNumConfigs,
                 hwc2_config_t* outConfigs);
         virtual void dumpDisplayConfigs();
+        virtual void dump(String8 &result) {
+            mFBManager.dump(result);
+            dumpCommittedState(result);
+            mBlobCache.dump(result);
+        };
         virtual bool supportDataspace(int32_t dataspace);
         virtual int32_t getColorModes(uint32_t* outNumModes, int32_t* outModes);
         virtual int32_t setColorMode(int32_t mode);
@@ -465,9 +483,16 @@ class ExynosDisplayDrmInterface :
         // After swapCrtcs has been successfully done, this function will return the display, whose
         // crtc/decon this display is currently using.
         virtual ExynosDisplay* borrowedCrtcFrom() override;
+        // The next deliverWinConfigData() walks every plane again instead of
+        // only the planes it committed last time.
+        virtual void invalidateCommittedPlaneMask() override {
+            mCommittedPlaneMaskInvalid = true;
+        }
+        virtual void onVsyncTimingChanged() override { mDrmVSyncWorker.ResetPredictor(); }
 
         virtual int32_t uncacheLayerBuffers(const ExynosLayer* __unused layer,
                                             const std::vector<buffer_handle_t>& buffers) override;
+        virtual void preimportBuffer(const ExynosLayer* layer, buffer_handle_t buffer) override;
 
     protected:
         enum class HalMipiSyncType : uint32_t {
@@ -606,6 +631,8 @@ class ExynosDisplayDrmInterface :
                     HAL_PIXEL_FORMAT_RGBA_8888;
                 uint32_t mReadbackFormat = HAL_PIXEL_FORMAT_IMPLEMENTATION_DEFINED;
                 bool mNeedClearReadbackCommit = false;
+                /* The writeback connector is routed to the crtc by a committed frame */
+                bool mWritebackAttached = false;
             private:
                 DrmDevice *mDrmDevice = NULL;
                 DrmConnector *mWritebackConnector = NULL;
@@ -622,8 +649,24 @@ class ExynosDisplayDrmInterface :
         ModeState mDesiredModeState;
         PartialRegionState mPartialRegionState;
         BlockingRegionState mBlockState;
+        DrmPropertyBlobCache mBlobCache;
         /* Mapping plane id to ExynosMPP, key is plane id */
         std::unordered_map<uint32_t, ExynosMPP*> mExynosMPPsForPlane;
+        /*
+         * Bit masks indexed like mDrmDevice->planes(). mPlaneEnableMask has the
+         * planes enabled by the commit being built in deliverWinConfigData(),
+         * mCommittedPlaneMask the planes this display may have enabled in the
+         * kernel. Only planes in the latter but not in the former get disabled.
+         * All bits are set when the kernel state is unknown. Planes skipped by
+         * the disable pass stay in mCommittedPlaneMask so that they are
+         * disabled once the skip condition goes away.
+         */
+        uint64_t mPlaneEnableMask = 0;
+        uint64_t mCommittedPlaneMask = kAllPlanesMask;
+        /* Set by invalidateCommittedPlaneMask() from the resource manager */
+        std::atomic<bool> mCommittedPlaneMaskInvalid = false;
+        static constexpr uint64_t kAllPlanesMask = ~0ULL;
+        static constexpr size_t kMaxPlaneMaskBits = 64;
 
         ExynosDisplay* mBorrowedCrtcFrom = nullptr;
 
@@ -636,12 +679,16 @@ class ExynosDisplayDrmInterface :
 
         DrmReadbackInfo mReadbackInfo;
         FramebufferManager mFBManager;
+        static DrmCommittedState sCommittedState;
         std::array<uint8_t, MONITOR_DESCRIPTOR_DATA_LENGTH> mMonitorDescription;
         nsecs_t mLastDumpDrmAtomicMessageTime;
         bool mIsResolutionSwitchInProgress = false;
 
     private:
         int32_t getDisplayFakeEdid(uint8_t &outPort, uint32_t &outDataSize, uint8_t *outData);
+        // tracks the plane and crtc properties of the drm device, once per display
+        void initCommittedState();
+        void dumpCommittedState(String8 &result);
 
         String8 mDisplayTraceName;
         DrmMode mDozeDrmMode;
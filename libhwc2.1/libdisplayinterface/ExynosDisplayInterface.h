@@ -44,6 +44,7 @@ class ExynosDisplayInterface {
                 uint32_t* outNumConfigs,
                 hwc2_config_t* outConfigs);
         virtual void dumpDisplayConfigs() {};
+        virtual void dump(String8 & __unused result) {};
         virtual bool supportDataspace(int32_t __unused dataspace) { return true; };
         virtual int32_t getColorModes(uint32_t* outNumModes, int32_t* outModes);
         virtual int32_t setColorMode(int32_t __unused mode) {return NO_ERROR;};
@@ -104,11 +105,16 @@ class ExynosDisplayInterface {
         virtual int32_t swapCrtcs(ExynosDisplay* anotherDisplay) { return HWC2_ERROR_UNSUPPORTED; }
         virtual ExynosDisplay* borrowedCrtcFrom() { return nullptr; }
         virtual void clearOldCrtcBlobs() {}
+        virtual void invalidateCommittedPlaneMask() {}
+        /* The panel changed its refresh rate by itself, e.g. on panel idle */
+        virtual void onVsyncTimingChanged() {}
 
         virtual int32_t uncacheLayerBuffers(const ExynosLayer* layer,
                                             const std::vector<buffer_handle_t>& buffers) {
             return NO_ERROR;
         }
+        virtual void preimportBuffer(const ExynosLayer* __unused layer,
+                                     buffer_handle_t __unused buffer) {}
 
     public:
         uint32_t mType = INTERFACE_TYPE_NONE;
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FramebufferCache.h"
+
+#include <functional>
+#include <iterator>
+
+static size_t hashCombine(size_t hash, size_t value) {
+    return hash ^ (value + 0x9e3779b9 + (hash << 6) + (hash >> 2));
+}
+
+size_t FramebufferCache::KeyHash::operator()(const Key &key) const {
+    size_t hash = std::hash<bool>()(key.isColor);
+    hash = hashCombine(hash, std::hash<bool>()(key.isSecure));
+    if (key.isColor) {
+        hash = hashCombine(hash, std::hash<uint32_t>()(key.colorDesc.width));
+        return hashCombine(hash, std::hash<uint32_t>()(key.colorDesc.height));
+    }
+    /* bufferDesc.isSecure is covered by key.isSecure */
+    hash = hashCombine(hash, std::hash<uint64_t>()(key.bufferDesc.bufferId));
+    return hashCombine(hash, std::hash<int>()(key.bufferDesc.drmFormat));
+}
+
+uint32_t FramebufferCache::find(const ExynosLayer *layer, const Key &key, const Layout &layout,
+                                bool forFrame) {
+    auto indexIter = mIndex.find(key);
+    if (indexIter != mIndex.end() && (*indexIter->second)->layout == layout) {
+        auto bufferIter = indexIter->second;
+        if (forFrame) {
+            auto &buffers = buffersFor(key.isSecure);
+            buffers.splice(buffers.begin(), buffers, bufferIter);
+            (*bufferIter)->layer = layer;
+            mStats.hits++;
+        }
+        return (*bufferIter)->fbId;
+    }
+
+    if (forFrame) {
+        mStats.misses++;
+    }
+    return 0;
+}
+
+void FramebufferCache::insert(const ExynosLayer *layer, const Key &key, const Layout &layout,
+                              uint32_t fbId) {
+    auto &buffers = buffersFor(key.isSecure);
+    if (auto indexIter = mIndex.find(key); indexIter != mIndex.end()) {
+        evict(buffers, indexIter->second);
+    }
+
+    buffers.emplace_front(new Framebuffer(mDrmFd, fbId, key, layout, layer, mRemoveFb));
+    mIndex[key] = buffers.begin();
+
+    const size_t maxBuffers = key.isSecure ? mMaxSecureBuffers : mMaxBuffers;
+    while (buffers.size() > maxBuffers) {
+        evict(buffers, std::prev(buffers.end()));
+        mStats.evictions++;
+    }
+}
+
+void FramebufferCache::discard(const ExynosLayer *layer, const Key &key, const Layout &layout,
+                               uint32_t fbId) {
+    mCleanBuffers.emplace_back(new Framebuffer(mDrmFd, fbId, key, layout, layer, mRemoveFb));
+}
+
+bool FramebufferCache::evict(const ExynosLayer *layer, const Key &key) {
+    auto indexIter = mIndex.find(key);
+    if (indexIter == mIndex.end() || (*indexIter->second)->layer != layer) {
+        return false;
+    }
+    evict(buffersFor(key.isSecure), indexIter->second);
+    return true;
+}
+
+void FramebufferCache::evictLayer(const ExynosLayer *layer) {
+    for (auto *buffers : {&mBuffers, &mSecureBuffers}) {
+        for (auto it = buffers->begin(); it != buffers->end();) {
+            auto bufferIter = it++;
+            if ((*bufferIter)->layer == layer) {
+                evict(*buffers, bufferIter);
+            }
+        }
+    }
+}
+
+void FramebufferCache::evictSecure() {
+    for (auto &buffer : mSecureBuffers) {
+        mIndex.erase(buffer->key);
+    }
+    mCleanBuffers.splice(mCleanBuffers.end(), mSecureBuffers);
+}
+
+void FramebufferCache::clear() {
+    mIndex.clear();
+    mBuffers.clear();
+    mSecureBuffers.clear();
+    mCleanBuffers.clear();
+}
+
+void FramebufferCache::evict(FBList &list, FBList::iterator it) {
+    mIndex.erase((*it)->key);
+    mCleanBuffers.splice(mCleanBuffers.end(), list, it);
+}
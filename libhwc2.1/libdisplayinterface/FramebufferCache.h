@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FRAMEBUFFERCACHE_H
+#define _FRAMEBUFFERCACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+class ExynosLayer;
+
+// FramebufferCache keeps the fbIds created for buffers and solid colors so
+// that they can be reused. The normal and secure framebuffers are kept in
+// LRU order, the most recently used one at the front, and are evicted from
+// the back once a list grows over its budget. Evicted framebuffers wait in a
+// clean list until the caller knows they are off the screen. It has no lock
+// of its own, FramebufferManager uses it under its mutex.
+class FramebufferCache {
+    public:
+        struct BufferDesc {
+            uint64_t bufferId;
+            int drmFormat;
+            bool isSecure;
+            bool operator==(const BufferDesc &rhs) const {
+                return (bufferId == rhs.bufferId && drmFormat == rhs.drmFormat &&
+                        isSecure == rhs.isSecure);
+            }
+        };
+        struct SolidColorDesc {
+            uint32_t width;
+            uint32_t height;
+            bool operator==(const SolidColorDesc &rhs) const {
+                return (width == rhs.width && height == rhs.height);
+            }
+        };
+        // cache key of a framebuffer, either a buffer or a solid color one
+        struct Key {
+            bool isColor;
+            bool isSecure;
+            BufferDesc bufferDesc;
+            SolidColorDesc colorDesc;
+            static Key of(const BufferDesc &desc) { return Key{false, desc.isSecure, desc, {}}; }
+            static Key of(const SolidColorDesc &desc, bool isSecure) {
+                return Key{true, isSecure, {}, desc};
+            }
+            bool operator==(const Key &rhs) const {
+                return isColor == rhs.isColor && isSecure == rhs.isSecure &&
+                        (isColor ? colorDesc == rhs.colorDesc : bufferDesc == rhs.bufferDesc);
+            }
+        };
+        // hashes the fields operator== compares, nothing else
+        struct KeyHash {
+            size_t operator()(const Key &key) const;
+        };
+
+        // how the fbId was created, a cached fbId is only reused if it still matches
+        struct Layout {
+            uint32_t width;
+            uint32_t height;
+            uint64_t modifier;
+            bool operator==(const Layout &rhs) const {
+                return width == rhs.width && height == rhs.height && modifier == rhs.modifier;
+            }
+        };
+
+        // drmModeRmFB, or a stub in tests
+        using RemoveFb = int (*)(int drmFd, uint32_t fbId);
+
+        struct Framebuffer {
+            Framebuffer(int fd, uint32_t fb, const Key &k, const Layout &lo,
+                        const ExynosLayer *l, RemoveFb rm)
+                  : drmFd(fd), fbId(fb), key(k), layout(lo), layer(l), removeFb(rm) {}
+            ~Framebuffer() { removeFb(drmFd, fbId); }
+            int drmFd;
+            uint32_t fbId;
+            Key key;
+            Layout layout;
+            // the layer which used this framebuffer most recently
+            const ExynosLayer *layer;
+            RemoveFb removeFb;
+        };
+        using FBList = std::list<std::unique_ptr<Framebuffer>>;
+
+        struct Stats {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint64_t evictions = 0;
+        };
+
+        FramebufferCache(size_t maxBuffers, size_t maxSecureBuffers, RemoveFb removeFb)
+              : mMaxBuffers(maxBuffers), mMaxSecureBuffers(maxSecureBuffers),
+                mRemoveFb(removeFb) {}
+        void init(int drmFd) { mDrmFd = drmFd; }
+
+        // fbId cached for key if it was created with the same layout, 0 otherwise.
+        // A lookup for a frame makes the framebuffer the most recently used one
+        // and layer its user, and counts as a hit or a miss.
+        uint32_t find(const ExynosLayer *layer, const Key &key, const Layout &layout,
+                      bool forFrame);
+        bool contains(const Key &key) const { return mIndex.count(key) != 0; }
+
+        // caches fbId for key in place of any previous one, evicting the least
+        // recently used framebuffers over the budget
+        void insert(const ExynosLayer *layer, const Key &key, const Layout &layout,
+                    uint32_t fbId);
+        // fbId won't be cached, it goes to the clean list
+        void discard(const ExynosLayer *layer, const Key &key, const Layout &layout,
+                     uint32_t fbId);
+
+        // evicts key if layer was its last user, returns whether it did
+        bool evict(const ExynosLayer *layer, const Key &key);
+        // evicts every framebuffer last used by layer
+        void evictLayer(const ExynosLayer *layer);
+        void evictSecure();
+        // destroys everything, including the clean list
+        void clear();
+
+        bool hasCleanBuffers() const { return !mCleanBuffers.empty(); }
+        void takeCleanBuffers(FBList &buffers) {
+            buffers.splice(buffers.end(), mCleanBuffers);
+        }
+
+        size_t size() const { return mBuffers.size(); }
+        size_t secureSize() const { return mSecureBuffers.size(); }
+        const Stats &stats() const { return mStats; }
+
+    private:
+        FBList &buffersFor(bool isSecure) { return isSecure ? mSecureBuffers : mBuffers; }
+        void evict(FBList &list, FBList::iterator it);
+
+        const size_t mMaxBuffers;
+        const size_t mMaxSecureBuffers;
+        const RemoveFb mRemoveFb;
+        int mDrmFd = -1;
+
+        FBList mBuffers;
+        FBList mSecureBuffers;
+        // position of each cached key in one of the lists
+        std::unordered_map<Key, FBList::iterator, KeyHash> mIndex;
+        FBList mCleanBuffers;
+        Stats mStats;
+};
+
+#endif
@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <utility>
+#include <vector>
+
+#include "FramebufferCache.h"
+
+/* Only its address is used by the cache */
+class ExynosLayer {};
+
+namespace {
+
+constexpr int kDrmFd = 42;
+constexpr size_t kMaxBuffers = 4;
+constexpr size_t kMaxSecureBuffers = 2;
+
+/* fbIds handed to the stubbed drmModeRmFB, with the fd they were removed from */
+std::vector<std::pair<int, uint32_t>> gRemovedFbs;
+
+int removeFb(int drmFd, uint32_t fbId) {
+    gRemovedFbs.emplace_back(drmFd, fbId);
+    return 0;
+}
+
+using Key = FramebufferCache::Key;
+using Layout = FramebufferCache::Layout;
+
+Key bufferKey(uint64_t bufferId, bool isSecure = false) {
+    return Key::of(FramebufferCache::BufferDesc{bufferId, 1, isSecure});
+}
+
+const Layout kLayout{1080, 2400, 0};
+
+class FramebufferCacheTest : public testing::Test {
+protected:
+    void SetUp() override {
+        gRemovedFbs.clear();
+        mCache.init(kDrmFd);
+    }
+
+    /* Like FramebufferManager::getBuffer, with a stubbed AddFB handing out new fbIds */
+    uint32_t getBuffer(const ExynosLayer *layer, const Key &key, const Layout &layout = kLayout) {
+        uint32_t fbId = mCache.find(layer, key, layout, true);
+        if (fbId == 0) {
+            fbId = ++mLastFbId;
+            mAddedFbs++;
+            mCache.insert(layer, key, layout, fbId);
+        }
+        return fbId;
+    }
+
+    /* Destroys the clean list, like FramebufferManager does once a frame is flipped */
+    std::vector<uint32_t> flip() {
+        {
+            FramebufferCache::FBList cleanBuffers;
+            mCache.takeCleanBuffers(cleanBuffers);
+            EXPECT_TRUE(gRemovedFbs.empty());
+        }
+        std::vector<uint32_t> removed;
+        for (const auto &[fd, fbId] : gRemovedFbs) {
+            EXPECT_EQ(fd, kDrmFd);
+            removed.push_back(fbId);
+        }
+        gRemovedFbs.clear();
+        return removed;
+    }
+
+    FramebufferCache mCache{kMaxBuffers, kMaxSecureBuffers, removeFb};
+    uint32_t mLastFbId = 0;
+    int mAddedFbs = 0;
+    ExynosLayer mLayer;
+    ExynosLayer mOtherLayer;
+};
+
+} // namespace
+
+TEST_F(FramebufferCacheTest, ReusesCachedFbId) {
+    uint32_t fbId = getBuffer(&mLayer, bufferKey(1));
+    EXPECT_EQ(getBuffer(&mLayer, bufferKey(1)), fbId);
+    EXPECT_EQ(mAddedFbs, 1);
+    EXPECT_EQ(mCache.stats().hits, 1u);
+    EXPECT_EQ(mCache.stats().misses, 1u);
+
+    /* a preimport lookup neither counts nor touches the LRU order */
+    EXPECT_EQ(mCache.find(&mOtherLayer, bufferKey(1), kLayout, false), fbId);
+    EXPECT_EQ(mCache.find(&mOtherLayer, bufferKey(2), kLayout, false), 0u);
+    EXPECT_EQ(mCache.stats().hits, 1u);
+    EXPECT_EQ(mCache.stats().misses, 1u);
+}
+
+TEST_F(FramebufferCacheTest, LayoutChangeReimports) {
+    uint32_t fbId = getBuffer(&mLayer, bufferKey(1));
+    uint32_t newFbId = getBuffer(&mLayer, bufferKey(1), Layout{1080, 2400, 1});
+    EXPECT_NE(newFbId, fbId);
+    EXPECT_EQ(mCache.size(), 1u);
+    EXPECT_EQ(flip(), std::vector<uint32_t>{fbId});
+}
+
+TEST_F(FramebufferCacheTest, EvictsLeastRecentlyUsed) {
+    for (uint64_t id = 1; id <= kMaxBuffers; id++) {
+        getBuffer(&mLayer, bufferKey(id));
+    }
+    /* buffer 1 becomes the most recently used, 2 the least */
+    getBuffer(&mLayer, bufferKey(1));
+    uint32_t newFbId = getBuffer(&mLayer, bufferKey(kMaxBuffers + 1));
+
+    EXPECT_EQ(mCache.size(), kMaxBuffers);
+    EXPECT_EQ(mCache.stats().evictions, 1u);
+    EXPECT_FALSE(mCache.contains(bufferKey(2)));
+    EXPECT_TRUE(mCache.contains(bufferKey(1)));
+    EXPECT_EQ(flip(), std::vector<uint32_t>{2});
+
+    EXPECT_EQ(getBuffer(&mLayer, bufferKey(kMaxBuffers + 1)), newFbId);
+    EXPECT_NE(getBuffer(&mLayer, bufferKey(2)), 2u);
+}
+
+TEST_F(FramebufferCacheTest, SecureBuffersHaveTheirOwnBudget) {
+    for (uint64_t id = 1; id <= kMaxBuffers; id++) {
+        getBuffer(&mLayer, bufferKey(id));
+    }
+    for (uint64_t id = 1; id <= kMaxSecureBuffers + 1; id++) {
+        getBuffer(&mLayer, bufferKey(id, true));
+    }
+    EXPECT_EQ(mCache.size(), kMaxBuffers);
+    EXPECT_EQ(mCache.secureSize(), kMaxSecureBuffers);
+    EXPECT_FALSE(mCache.contains(bufferKey(1, true)));
+    EXPECT_TRUE(mCache.contains(bufferKey(1)));
+
+    mCache.evictSecure();
+    EXPECT_EQ(mCache.secureSize(), 0u);
+    EXPECT_EQ(mCache.size(), kMaxBuffers);
+    EXPECT_EQ(flip().size(), kMaxSecureBuffers + 1);
+}
+
+TEST_F(FramebufferCacheTest, EvictsOnlyForLastUser) {
+    uint32_t fbId = getBuffer(&mLayer, bufferKey(1));
+    getBuffer(&mOtherLayer, bufferKey(1));
+
+    EXPECT_FALSE(mCache.evict(&mLayer, bufferKey(1)));
+    EXPECT_FALSE(mCache.hasCleanBuffers());
+    EXPECT_FALSE(mCache.evict(&mOtherLayer, bufferKey(2)));
+
+    EXPECT_TRUE(mCache.evict(&mOtherLayer, bufferKey(1)));
+    EXPECT_FALSE(mCache.contains(bufferKey(1)));
+    EXPECT_EQ(flip(), std::vector<uint32_t>{fbId});
+}
+
+TEST_F(FramebufferCacheTest, EvictsLayer) {
+    getBuffer(&mLayer, bufferKey(1));
+    getBuffer(&mLayer, bufferKey(2, true));
+    uint32_t otherFbId = getBuffer(&mOtherLayer, bufferKey(3));
+
+    mCache.evictLayer(&mLayer);
+    EXPECT_EQ(mCache.size(), 1u);
+    EXPECT_EQ(mCache.secureSize(), 0u);
+    EXPECT_EQ(flip().size(), 2u);
+    EXPECT_EQ(getBuffer(&mOtherLayer, bufferKey(3)), otherFbId);
+}
+
+TEST_F(FramebufferCacheTest, DiscardedAndClearedBuffersAreRemoved) {
+    mCache.discard(&mLayer, bufferKey(1), kLayout, 100);
+    EXPECT_FALSE(mCache.contains(bufferKey(1)));
+    EXPECT_EQ(flip(), std::vector<uint32_t>{100});
+
+    getBuffer(&mLayer, bufferKey(1));
+    getBuffer(&mLayer, bufferKey(2, true));
+    mCache.clear();
+    EXPECT_EQ(gRemovedFbs.size(), 2u);
+    EXPECT_EQ(mCache.size() + mCache.secureSize(), 0u);
+}
+
+TEST_F(FramebufferCacheTest, ColorKeysIgnoreBufferFields) {
+    Key key = Key::of(FramebufferCache::SolidColorDesc{64, 32}, false);
+    Key other = key;
+    other.bufferDesc = FramebufferCache::BufferDesc{7, 8, true};
+    ASSERT_TRUE(key == other);
+    EXPECT_EQ(FramebufferCache::KeyHash()(key), FramebufferCache::KeyHash()(other));
+
+    uint32_t fbId = getBuffer(&mLayer, key);
+    EXPECT_EQ(getBuffer(&mLayer, other), fbId);
+    EXPECT_FALSE(mCache.contains(Key::of(FramebufferCache::SolidColorDesc{64, 32}, true)));
+}
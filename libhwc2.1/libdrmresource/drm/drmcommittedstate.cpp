@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "drmcommittedstate.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+namespace android {
+
+void DrmCommittedState::Init(const std::vector<uint32_t> &tracked_objects,
+                             const std::vector<uint32_t> &volatile_properties) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  tracked_objects_.insert(tracked_objects.begin(), tracked_objects.end());
+  volatile_properties_.insert(volatile_properties.begin(),
+                              volatile_properties.end());
+}
+
+void DrmCommittedState::Invalidate() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  InvalidateLocked();
+}
+
+void DrmCommittedState::InvalidateLocked() {
+  for (auto &[key, entry] : values_)
+    entry.committed = false;
+}
+
+void DrmCommittedState::Dump(std::string &result) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t tracking = 0;
+  for (const auto &[key, entry] : values_)
+    tracking += entry.committed;
+
+  char line[128];
+  snprintf(line, sizeof(line),
+           "Atomic commit: committed %" PRIu64 " properties, skipped %" PRIu64
+           " unchanged, tracking %zu\n",
+           committed_count_, stripped_count_, tracking);
+  result += line;
+}
+
+}  // namespace android
@@ -26,6 +26,7 @@
 #include <inttypes.h>
 #include <linux/netlink.h>
 #include <log/log.h>
+#include <string.h>
 #include <sys/socket.h>
 #include <utils/String8.h>
 #include <xf86drm.h>
@@ -46,8 +47,16 @@ int DrmEventListener::Init() {
   struct epoll_event ev;
   char buffer[1024];
 
-  /* Open User Event File Descriptor */
-  uevent_fd_.Set(socket(PF_NETLINK, SOCK_DGRAM, NETLINK_KOBJECT_UEVENT));
+  /* Set EPoll*/
+  epoll_fd_.Set(epoll_create1(EPOLL_CLOEXEC));
+  if (epoll_fd_.get() < 0) {
+    ALOGE("Failed to create epoll: %s", strerror(errno));
+    return epoll_fd_.get();
+  }
+
+  /* Open User Event File Descriptor, non-blocking so that it can be drained */
+  uevent_fd_.Set(socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                        NETLINK_KOBJECT_UEVENT));
   if (uevent_fd_.get() < 0) {
     ALOGE("Failed to open uevent socket: %s", strerror(errno));
     return uevent_fd_.get();
@@ -79,13 +88,6 @@ int DrmEventListener::Init() {
       ALOGE("Failed to add tui fd into epoll: %s", strerror(errno));
   }
 
-  /* Set EPoll*/
-  epoll_fd_.Set(epoll_create(maxFds));
-  if (epoll_fd_.get() < 0) {
-    ALOGE("Failed to create epoll: %s", strerror(errno));
-    return epoll_fd_.get();
-  }
-
   ev.events = EPOLLIN;
   ev.data.fd = uevent_fd_.get();
   if (epoll_ctl(epoll_fd_.get(), EPOLL_CTL_ADD, uevent_fd_.get(), &ev) < 0) {
@@ -271,8 +273,27 @@ void DrmEventListener::FlipHandler(int /* fd */, unsigned int /* sequence */,
   delete handler;
 }
 
+void DrmEventListener::DispatchUEventBatch(uint64_t timestamp) {
+  for (const auto &action : uevent_batch_.actions) {
+    switch (action.kind) {
+      case UEventAction::kPanelIdle:
+        if (panel_idle_handler_)
+          panel_idle_handler_->handleIdleEnterEvent(action.panel_idle.c_str());
+        break;
+      case UEventAction::kPropertyUpdate:
+        if (drm_prop_update_handler_)
+          drm_prop_update_handler_->handleDrmPropertyUpdate(action.connector_id,
+                                                            action.property_id);
+        break;
+      case UEventAction::kHotplug:
+        if (hotplug_handler_)
+          hotplug_handler_->handleEvent(timestamp);
+        break;
+    }
+  }
+}
+
 void DrmEventListener::UEventHandler() {
-  char buffer[1024];
   int ret;
 
   struct timespec ts;
@@ -283,50 +304,12 @@ void DrmEventListener::UEventHandler() {
   else
     ALOGE("Failed to get monotonic clock on hotplug %d", ret);
 
-  ret = read(uevent_fd_.get(), &buffer, sizeof(buffer));
-  if (ret == 0) {
-    return;
-  } else if (ret < 0) {
-    ALOGE("Got error reading uevent %d", ret);
-    return;
-  }
-
-  bool drm_event = false, hotplug_event = false;
-  bool have_connector_id = false, have_property_id = false;
-  unsigned connector_id = 0;
-  unsigned updated_property_id = 0;
-  for (int i = 0; i < ret;) {
-    char *event = buffer + i;
-
-    if (!strcmp(event, "DEVTYPE=drm_minor")) {
-      drm_event = true;
-    } else if (!strncmp(event, "PANEL_IDLE_ENTER=", strlen("PANEL_IDLE_ENTER="))) {
-      panel_idle_handler_->handleIdleEnterEvent(event);
-    } else if (!strcmp(event, "HOTPLUG=1")) {
-      hotplug_event = true;
-    } else if (sscanf(event, "CONNECTOR=%u", &connector_id) == 1) {
-      have_connector_id = true;
-    } else if (sscanf(event, "PROPERTY=%u", &updated_property_id) == 1) {
-      have_property_id = true;
-    }
-
-    i += strlen(event) + 1;
-  }
+  uevent_batch_.clear();
+  ret = DrainUEvents(uevent_fd_.get(), kMaxUEventsPerWakeup, uevent_batch_);
+  if (ret < 0)
+    ALOGE("Got error reading uevent %s", strerror(-ret));
 
-  // Property updates also have HOTPLUG=1 string, so must be handled
-  // first. Actual hotplug events don't have property id.
-  if (have_connector_id && have_property_id) {
-    if (drm_prop_update_handler_)
-      drm_prop_update_handler_->handleDrmPropertyUpdate(connector_id, updated_property_id);
-    return;
-  }
-
-  if (drm_event && hotplug_event) {
-    if (!hotplug_handler_)
-      return;
-
-    hotplug_handler_->handleEvent(timestamp);
-  }
+  DispatchUEventBatch(timestamp);
 }
 
 void DrmEventListener::DRMEventHandler() {
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ueventparser.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <charconv>
+
+namespace android {
+
+namespace {
+
+template <typename T>
+bool ParseUnsigned(std::string_view value, T &out) {
+  auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), out);
+  return ec == std::errc() && ptr == value.data() + value.size();
+}
+
+}  // namespace
+
+void ParseUEvent(const char *buffer, size_t len, UEvent &event) {
+  struct KeyHandler {
+    std::string_view key;
+    void (*parse)(std::string_view token, std::string_view value, UEvent &event);
+  };
+  /* Keys of interest, everything else in the uevent is skipped */
+  static constexpr KeyHandler kKeyHandlers[] = {
+      {"DEVTYPE",
+       [](std::string_view, std::string_view value, UEvent &event) {
+         event.drm_minor = (value == "drm_minor");
+       }},
+      {"HOTPLUG",
+       [](std::string_view, std::string_view value, UEvent &event) {
+         event.hotplug = (value == "1");
+       }},
+      {"CONNECTOR",
+       [](std::string_view, std::string_view value, UEvent &event) {
+         event.have_connector_id = ParseUnsigned(value, event.connector_id);
+       }},
+      {"PROPERTY",
+       [](std::string_view, std::string_view value, UEvent &event) {
+         event.have_property_id = ParseUnsigned(value, event.property_id);
+       }},
+      {"PANEL_IDLE_ENTER",
+       [](std::string_view token, std::string_view, UEvent &event) {
+         event.panel_idle = token;
+       }},
+  };
+
+  event = UEvent();
+  /* The uevent is a list of NUL separated "KEY=value" tokens */
+  const char *pos = buffer;
+  const char *end = buffer + len;
+  while (pos < end) {
+    const char *token_end = static_cast<const char *>(memchr(pos, '\0', end - pos));
+    if (token_end == nullptr)
+      token_end = end;
+
+    std::string_view token(pos, token_end - pos);
+    size_t separator = token.find('=');
+    if (separator != std::string_view::npos) {
+      std::string_view key = token.substr(0, separator);
+      for (const auto &handler : kKeyHandlers) {
+        if (handler.key == key) {
+          handler.parse(token, token.substr(separator + 1), event);
+          break;
+        }
+      }
+    }
+    pos = token_end + 1;
+  }
+}
+
+void UEventBatch::add(const UEvent &event) {
+  if (!event.panel_idle.empty())
+    actions.push_back({UEventAction::kPanelIdle, 0, 0, std::string(event.panel_idle)});
+
+  // Property updates also have HOTPLUG=1 string, so must be handled
+  // first. Actual hotplug events don't have property id.
+  if (event.have_connector_id && event.have_property_id) {
+    addLast({UEventAction::kPropertyUpdate, event.connector_id, event.property_id, {}});
+    return;
+  }
+
+  if (event.drm_minor && event.hotplug)
+    addLast({UEventAction::kHotplug, 0, 0, {}});
+}
+
+void UEventBatch::addLast(UEventAction action) {
+  auto earlier = std::find(actions.begin(), actions.end(), action);
+  if (earlier != actions.end())
+    actions.erase(earlier);
+  actions.push_back(std::move(action));
+}
+
+int DrainUEvents(int fd, uint32_t max_events, UEventBatch &batch) {
+  char buffer[kUEventBufferSize];
+  UEvent event;
+  uint32_t n = 0;
+  for (; n < max_events; n++) {
+    ssize_t len = recv(fd, buffer, sizeof(buffer), 0);
+    if (len == 0)
+      break;
+    if (len < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        break;
+      return -errno;
+    }
+
+    ParseUEvent(buffer, len, event);
+    batch.add(event);
+  }
+  return n;
+}
+
+}  // namespace android
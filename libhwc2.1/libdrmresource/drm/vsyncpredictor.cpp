@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "hwc-vsync-predictor"
+
+#include "vsyncpredictor.h"
+
+#include <inttypes.h>
+#include <log/log.h>
+
+#include <cmath>
+#include <cstdlib>
+
+namespace android {
+
+void VsyncPredictor::reset(int64_t nominalPeriodNs) {
+    mNominalPeriodNs = nominalPeriodNs;
+    mPeriodNs = nominalPeriodNs;
+    clearSamples();
+}
+
+void VsyncPredictor::clearSamples() {
+    mHead = 0;
+    mCount = 0;
+    mConsecutiveOutliers = 0;
+    mUnitSteps = 0;
+    mPeriodNs = mNominalPeriodNs;
+    mSlopeNs = mNominalPeriodNs;
+    mInterceptNs = 0;
+    mErrorNs = 0;
+}
+
+bool VsyncPredictor::addTimestamp(int64_t timestampNs) {
+    if (mNominalPeriodNs <= 0) {
+        return false;
+    }
+
+    /* check against the last observed vsync, so rejected ones are not skipped over */
+    const int64_t lastObservedNs = mLastObservedNs;
+    mLastObservedNs = timestampNs;
+
+    int64_t ordinal = 0;
+    if (mCount > 0) {
+        const Sample &last = mSamples[(mHead + mCount - 1) % kHistorySize];
+        const int64_t deltaNs = timestampNs - lastObservedNs;
+        if (deltaNs <= 0) {
+            return false;
+        }
+
+        const int64_t periods = (deltaNs + mPeriodNs / 2) / mPeriodNs;
+        const int64_t errorNs = deltaNs - periods * mPeriodNs;
+        if (timestampNs - last.timestampNs > kMaxSampleGapNs) {
+            clearSamples();
+        } else if ((periods == 0) || (std::llabs(errorNs) * 100 > mPeriodNs * kOutlierPercent)) {
+            if (++mConsecutiveOutliers < kMaxConsecutiveOutliers) {
+                ALOGV("%s: reject %" PRId64 " (delta %" PRId64 ", period %" PRId64 ")", __func__,
+                      timestampNs, deltaNs, mPeriodNs);
+                return false;
+            }
+            /* the timing really changed, learn it again */
+            clearSamples();
+        } else {
+            ordinal = last.ordinal +
+                    (timestampNs - last.timestampNs + mPeriodNs / 2) / mPeriodNs;
+            /* a nominal period that is a fraction of the real one never sees single steps */
+            mUnitSteps = (periods == 1) ? mUnitSteps + 1 : 0;
+        }
+    }
+
+    mConsecutiveOutliers = 0;
+    if (mCount == 0) {
+        mBaseNs = timestampNs;
+    }
+    if (mCount == kHistorySize) {
+        mHead = (mHead + 1) % kHistorySize;
+        mCount--;
+    }
+    mSamples[(mHead + mCount) % kHistorySize] = {ordinal, timestampNs};
+    mCount++;
+    fit();
+
+    return true;
+}
+
+void VsyncPredictor::fit() {
+    if (mCount < 2) {
+        mInterceptNs = mSamples[mHead].timestampNs - mBaseNs -
+                static_cast<double>(mSamples[mHead].ordinal) * mSlopeNs;
+        return;
+    }
+
+    double meanX = 0, meanY = 0;
+    for (size_t i = 0; i < mCount; i++) {
+        const Sample &sample = mSamples[(mHead + i) % kHistorySize];
+        meanX += sample.ordinal;
+        meanY += sample.timestampNs - mBaseNs;
+    }
+    meanX /= mCount;
+    meanY /= mCount;
+
+    double covXY = 0, varX = 0;
+    for (size_t i = 0; i < mCount; i++) {
+        const Sample &sample = mSamples[(mHead + i) % kHistorySize];
+        const double dx = sample.ordinal - meanX;
+        covXY += dx * (sample.timestampNs - mBaseNs - meanY);
+        varX += dx * dx;
+    }
+    if (varX == 0) {
+        return;
+    }
+
+    const double slope = covXY / varX;
+    /* keep the nominal period if the fit is off, the outlier check will catch it */
+    if (std::abs(slope - mNominalPeriodNs) * 100 > mNominalPeriodNs * kOutlierPercent) {
+        return;
+    }
+    mSlopeNs = slope;
+    mInterceptNs = meanY - slope * meanX;
+    mPeriodNs = static_cast<int64_t>(std::llround(slope));
+
+    double squaredError = 0;
+    for (size_t i = 0; i < mCount; i++) {
+        const Sample &sample = mSamples[(mHead + i) % kHistorySize];
+        const double error =
+                sample.timestampNs - mBaseNs - (mInterceptNs + sample.ordinal * mSlopeNs);
+        squaredError += error * error;
+    }
+    mErrorNs = std::sqrt(squaredError / mCount);
+}
+
+bool VsyncPredictor::isConfident() const {
+    return (mCount >= kMinConfidentSamples) && (mUnitSteps + 1 >= kMinConfidentSamples) &&
+            (mErrorNs <= kMaxConfidentErrorNs);
+}
+
+int64_t VsyncPredictor::nextVsync(int64_t nowNs) const {
+    const double sinceFirstNs = static_cast<double>(nowNs - mBaseNs) - mInterceptNs;
+    int64_t ordinal = static_cast<int64_t>(std::floor(sinceFirstNs / mSlopeNs)) + 1;
+    int64_t vsyncNs = mBaseNs + static_cast<int64_t>(std::llround(mInterceptNs + ordinal * mSlopeNs));
+    if (vsyncNs <= nowNs) {
+        vsyncNs = mBaseNs + static_cast<int64_t>(std::llround(mInterceptNs + ++ordinal * mSlopeNs));
+    }
+    return vsyncNs;
+}
+
+}  // namespace android
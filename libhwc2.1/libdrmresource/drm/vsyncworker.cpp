@@ -56,6 +56,7 @@ int VSyncWorker::Init(DrmDevice *drm, int display, const String8 &displayTraceNa
     mDisplayTraceName = displayTraceName;
     mHwVsyncPeriodTag.appendFormat("HWVsyncPeriod for %s", displayTraceName.c_str());
     mHwVsyncEnabledTag.appendFormat("HWCVsync for %s", displayTraceName.c_str());
+    mVsyncPredictedTag.appendFormat("PredictedVsync for %s", displayTraceName.c_str());
 
     return InitWorker();
 }
@@ -70,6 +71,8 @@ void VSyncWorker::VSyncControl(bool enabled) {
     Lock();
     mEnabled = enabled;
     mLastTimestampNs = -1;
+    /* check the model against hardware first after vsync was off */
+    mNextResyncNs = 0;
     Unlock();
 
     ATRACE_INT(mHwVsyncEnabledTag.c_str(), static_cast<int32_t>(enabled));
@@ -77,6 +80,12 @@ void VSyncWorker::VSyncControl(bool enabled) {
     Signal();
 }
 
+void VSyncWorker::ResetPredictor() {
+    /* mPredictor belongs to the worker thread, it is reset on the next vsync */
+    mPredictorResetPending = true;
+    mNextResyncNs = 0;
+}
+
 /*
  * Returns the timestamp of the next vsync in phase with mLastTimestampNs.
  * For example:
@@ -146,6 +155,49 @@ int VSyncWorker::SyntheticWaitVBlank(int64_t &timestampNs) {
     return 0;
 }
 
+void VSyncWorker::UpdatePredictor(DrmConnector *conn) {
+    /*
+     * Predict at the vblank interval, not at the TE interval which is a
+     * fraction of it with TE_FREQ_X2/X4. VRR modes have no fixed vblank
+     * interval to predict, so they always wait for hardware vsync.
+     */
+    int64_t periodNs = kDefaultVsyncPeriodNanoSecond;
+    if (conn && conn->active_mode().is_vrr_mode())
+        periodNs = 0;
+    else if (conn && conn->active_mode().v_period() != 0.0f)
+        periodNs = static_cast<int64_t>(conn->active_mode().v_period());
+
+    /* the model is only valid for the mode and panel timing it was learned on */
+    if (mPredictorResetPending.exchange(false) || (periodNs != mPredictor.nominalPeriod())) {
+        mPredictor.reset(periodNs);
+        mNextResyncNs = 0;
+    }
+}
+
+int VSyncWorker::PredictedWaitVBlank(int64_t &timestampNs) {
+    struct timespec now;
+    if (clock_gettime(CLOCK_MONOTONIC, &now)) {
+        ALOGE("clock_gettime failed %d", errno);
+        return -EPERM;
+    }
+
+    int64_t currentTimeNs = now.tv_sec * nsecsPerSec + now.tv_nsec;
+    int64_t expectTimeNs = mPredictor.nextVsync(currentTimeNs);
+
+    struct timespec vsync;
+    vsync.tv_sec = expectTimeNs / nsecsPerSec;
+    vsync.tv_nsec = expectTimeNs % nsecsPerSec;
+
+    int err;
+    do {
+        err = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &vsync, nullptr);
+    } while (err == EINTR);
+    if (err) return -1;
+
+    timestampNs = expectTimeNs;
+    return 0;
+}
+
 void VSyncWorker::Routine() {
     int ret;
 
@@ -167,24 +219,18 @@ void VSyncWorker::Routine() {
         ALOGE("Failed to get crtc for display");
         return;
     }
-    uint32_t highCrtc = (crtc->pipe() << DRM_VBLANK_HIGH_CRTC_SHIFT);
-
-    drmVBlank vblank;
-    memset(&vblank, 0, sizeof(vblank));
-    vblank.request.type =
-        (drmVBlankSeqType)(DRM_VBLANK_RELATIVE | (highCrtc & DRM_VBLANK_HIGH_CRTC_MASK));
-    vblank.request.sequence = 1;
+    UpdatePredictor(mDrmDevice->GetConnectorForDisplay(display));
 
     int64_t timestampNs;
-    ret = drmWaitVBlank(mDrmDevice->fd(), &vblank);
-    if (ret) {
-        if (SyntheticWaitVBlank(timestampNs)) {
-            // postpone the callback until we get a real value from the hardware
+    if (mPredictor.isConfident() && (mLastTimestampNs >= 0) &&
+        (mLastTimestampNs < mNextResyncNs)) {
+        ATRACE_INT(mVsyncPredictedTag.c_str(), 1);
+        if (PredictedWaitVBlank(timestampNs))
             return;
-        }
     } else {
-        timestampNs = (int64_t)vblank.reply.tval_sec * nsecsPerSec +
-                (int64_t)vblank.reply.tval_usec * 1000;
+        ATRACE_INT(mVsyncPredictedTag.c_str(), 0);
+        if (WaitHwVBlank(crtc, timestampNs))
+            return;
     }
 
     /*
@@ -226,4 +272,31 @@ void VSyncWorker::Routine() {
 
     mLastTimestampNs = timestampNs;
 }
+
+int VSyncWorker::WaitHwVBlank(DrmCrtc *crtc, int64_t &timestampNs) {
+    uint32_t highCrtc = (crtc->pipe() << DRM_VBLANK_HIGH_CRTC_SHIFT);
+
+    drmVBlank vblank;
+    memset(&vblank, 0, sizeof(vblank));
+    vblank.request.type =
+        (drmVBlankSeqType)(DRM_VBLANK_RELATIVE | (highCrtc & DRM_VBLANK_HIGH_CRTC_MASK));
+    vblank.request.sequence = 1;
+
+    int ret = drmWaitVBlank(mDrmDevice->fd(), &vblank);
+    if (ret) {
+        // postpone the callback until we get a real value from the hardware
+        return SyntheticWaitVBlank(timestampNs);
+    }
+
+    timestampNs = (int64_t)vblank.reply.tval_sec * nsecsPerSec +
+            (int64_t)vblank.reply.tval_usec * 1000;
+
+    /* predict from the next vsync only after this sample fits the model */
+    if (mPredictor.addTimestamp(timestampNs))
+        mNextResyncNs = timestampNs + kResyncIntervalNs;
+    else
+        mNextResyncNs = 0;
+
+    return 0;
+}
 }  // namespace android
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_DRM_COMMITTED_STATE_H_
+#define ANDROID_DRM_COMMITTED_STATE_H_
+
+#include <stdint.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace android {
+
+/*
+ * DrmCommittedState keeps the last committed value of plane and crtc
+ * properties. It is shared by all displays of the drm device, since planes
+ * can move between crtcs, and lets frame commits skip properties that would
+ * not change the kernel state. Stripping a request, committing it and
+ * recording the result happen under one lock, so that commits of different
+ * displays never interleave with the state they were checked against.
+ */
+class DrmCommittedState {
+ public:
+  /* Properties of tracked_objects are skipped when unchanged, but for
+   * volatile_properties that carry fds, pointers or per-frame data. */
+  void Init(const std::vector<uint32_t> &tracked_objects,
+            const std::vector<uint32_t> &volatile_properties);
+
+  /*
+   * Commits count items, {object_id, property_id, value} such as the items of
+   * a drmModeAtomicReq, with commit_fn(count) and returns its result. With
+   * strip set, the tracked items that are unchanged or overridden by a later
+   * item of the same property are removed in place first, keeping the order
+   * of the others. Only a successful commit without modeset is recorded,
+   * anything else makes the next commit carry every property.
+   * Test-only commits don't change the kernel state and don't need this.
+   */
+  template <typename Item, typename CommitFn>
+  int Commit(Item *items, uint32_t &count, bool strip, bool modeset,
+             CommitFn &&commit_fn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (strip)
+      count = Strip(items, count);
+    int ret = commit_fn(count);
+    if (ret == 0 && !modeset)
+      Record(items, count);
+    else
+      InvalidateLocked();
+    return ret;
+  }
+
+  /* The next commit carries every property, e.g. across power changes */
+  void Invalidate();
+  void Dump(std::string &result);
+
+ private:
+  struct Entry {
+    uint64_t value = 0;
+    bool committed = false;
+    /* Last strip pass that saw the property */
+    uint64_t pass = 0;
+  };
+
+  static uint64_t Key(uint32_t object_id, uint32_t property_id) {
+    return (static_cast<uint64_t>(object_id) << 32) | property_id;
+  }
+  bool IsTracked(uint32_t object_id, uint32_t property_id) const {
+    return tracked_objects_.count(object_id) &&
+           !volatile_properties_.count(property_id);
+  }
+  void InvalidateLocked();
+
+  /*
+   * Walks the items backwards, so the last write of a property is the one
+   * compared and the earlier ones are dropped, as the kernel would ignore
+   * them. Dropped items are marked with object id 0, which no drm object has,
+   * then squeezed out. Entries are only allocated the first time a property
+   * is seen, steady state frames don't allocate.
+   */
+  template <typename Item>
+  uint32_t Strip(Item *items, uint32_t count) {
+    pass_++;
+    for (uint32_t i = count; i-- > 0;) {
+      Item &item = items[i];
+      if (!IsTracked(item.object_id, item.property_id))
+        continue;
+      Entry &entry = values_[Key(item.object_id, item.property_id)];
+      bool overridden = entry.pass == pass_;
+      entry.pass = pass_;
+      if (overridden || (entry.committed && entry.value == item.value))
+        item.object_id = 0;
+    }
+
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < count; i++) {
+      if (items[i].object_id == 0)
+        continue;
+      if (kept != i)
+        items[kept] = items[i];
+      kept++;
+    }
+    stripped_count_ += count - kept;
+    return kept;
+  }
+
+  template <typename Item>
+  void Record(const Item *items, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+      const Item &item = items[i];
+      if (!IsTracked(item.object_id, item.property_id))
+        continue;
+      Entry &entry = values_[Key(item.object_id, item.property_id)];
+      entry.value = item.value;
+      entry.committed = true;
+    }
+    committed_count_ += count;
+  }
+
+  std::mutex mutex_;
+  /* planes and crtcs, connector properties are always committed */
+  std::unordered_set<uint32_t> tracked_objects_;
+  std::unordered_set<uint32_t> volatile_properties_;
+  std::unordered_map<uint64_t, Entry> values_;
+  uint64_t pass_ = 0;
+
+  uint64_t committed_count_ = 0;
+  uint64_t stripped_count_ = 0;
+};
+
+}  // namespace android
+
+#endif  // ANDROID_DRM_COMMITTED_STATE_H_
@@ -22,6 +22,7 @@
 #include <map>
 
 #include "autofd.h"
+#include "ueventparser.h"
 #include "worker.h"
 
 namespace android {
@@ -102,7 +103,10 @@ class DrmPropertyUpdateHandler {
 
 class DrmEventListener : public Worker {
   static constexpr const char kTUIStatusPath[] = "/sys/devices/platform/exynos-drm/tui_status";
-  static const uint32_t maxFds = 4;
+  /* uevent, drm, tui and the registered sysfs nodes can all be ready at once */
+  static const uint32_t maxFds = 16;
+  /* Bound the uevents drained per wakeup so the other fds are not starved */
+  static const uint32_t kMaxUEventsPerWakeup = 32;
 
  public:
   DrmEventListener(DrmDevice *drm);
@@ -140,6 +144,8 @@ class DrmEventListener : public Worker {
   virtual void Routine();
 
  private:
+  void DispatchUEventBatch(uint64_t timestamp);
+
   void UEventHandler();
   void DRMEventHandler();
   void TUIEventHandler();
@@ -159,6 +165,7 @@ class DrmEventListener : public Worker {
   std::shared_ptr<DrmPropertyUpdateHandler> drm_prop_update_handler_;
   std::mutex mutex_;
   std::map<int, std::shared_ptr<DrmSysfsEventHandler>> sysfs_handlers_;
+  UEventBatch uevent_batch_;
 };
 
 }  // namespace android
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_UEVENT_PARSER_H_
+#define ANDROID_UEVENT_PARSER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace android {
+
+/* The keys of one uevent the DRM event listener cares about */
+struct UEvent {
+  bool drm_minor = false;
+  bool hotplug = false;
+  bool have_connector_id = false;
+  bool have_property_id = false;
+  unsigned connector_id = 0;
+  unsigned property_id = 0;
+  /* Whole "PANEL_IDLE_ENTER=..." token, points into the parsed buffer */
+  std::string_view panel_idle;
+};
+
+/* What the listener does for one uevent */
+struct UEventAction {
+  enum Kind { kPanelIdle, kPropertyUpdate, kHotplug };
+
+  Kind kind;
+  unsigned connector_id = 0;
+  unsigned property_id = 0;
+  /* Whole "PANEL_IDLE_ENTER=..." token */
+  std::string panel_idle;
+
+  bool operator==(const UEventAction &other) const {
+    return kind == other.kind && connector_id == other.connector_id &&
+           property_id == other.property_id && panel_idle == other.panel_idle;
+  }
+};
+
+/*
+ * uevents drained in one wakeup, dispatched together in the order they
+ * arrived. A hotplug or a property update that comes again is only kept at
+ * its last position: the hotplug handler rescans every connector and the
+ * property update handler reads the latest value, so the earlier ones would
+ * not see anything more. Panel idle events are all delivered.
+ *
+ * The listener tells its events apart by their keys rather than by
+ * SUBSYSTEM and ACTION, which are "drm" and "change" for hotplugs and
+ * property updates alike, so the actions are keyed by kind.
+ */
+struct UEventBatch {
+  std::vector<UEventAction> actions;
+
+  void add(const UEvent &event);
+  void clear() { actions.clear(); }
+
+ private:
+  void addLast(UEventAction action);
+};
+
+/* UEVENT_BUFFER_SIZE of the kernel */
+constexpr size_t kUEventBufferSize = 2048;
+
+/*
+ * Reads up to max_events uevents from the non-blocking socket fd into batch.
+ * Returns the number of uevents read, or -errno if reading failed; the
+ * uevents read before the failure are still in batch.
+ */
+int DrainUEvents(int fd, uint32_t max_events, UEventBatch &batch);
+
+/* Parses a uevent, a list of NUL separated "KEY=value" tokens of len bytes */
+void ParseUEvent(const char *buffer, size_t len, UEvent &event);
+
+}  // namespace android
+
+#endif  // ANDROID_UEVENT_PARSER_H_
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_VSYNC_PREDICTOR_H_
+#define ANDROID_VSYNC_PREDICTOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <array>
+
+namespace android {
+
+/*
+ * VsyncPredictor fits vsync period and phase from hardware vsync timestamps
+ * with a least squares line over the recent samples. Timestamps that are not
+ * close to a whole number of periods after the previous one are rejected,
+ * and the model starts over after a few rejections in a row, after a long gap
+ * or when the nominal period changes. It is only confident after consecutive
+ * samples one period apart, so a nominal period shorter than the real vsync
+ * interval never yields predictions. A nominal period of 0 disables it.
+ */
+class VsyncPredictor {
+    public:
+        // start over with a new nominal period, e.g. after a mode change
+        void reset(int64_t nominalPeriodNs);
+        int64_t nominalPeriod() const { return mNominalPeriodNs; }
+
+        // returns false if the timestamp was rejected as an outlier
+        bool addTimestamp(int64_t timestampNs);
+
+        // enough consistent samples to stand in for hardware vsync
+        bool isConfident() const;
+        int64_t period() const { return mPeriodNs; }
+        // first predicted vsync later than nowNs
+        int64_t nextVsync(int64_t nowNs) const;
+
+    private:
+        struct Sample {
+            int64_t ordinal;
+            int64_t timestampNs;
+        };
+
+        void clearSamples();
+        void fit();
+
+        static constexpr size_t kHistorySize = 20;
+        static constexpr size_t kMinConfidentSamples = 6;
+        static constexpr int64_t kOutlierPercent = 20;
+        static constexpr int kMaxConsecutiveOutliers = 3;
+        static constexpr int64_t kMaxConfidentErrorNs = 500000;
+        static constexpr int64_t kMaxSampleGapNs = 2000000000;
+
+        int64_t mNominalPeriodNs = 0;
+        int64_t mPeriodNs = 0;
+        // vsync with ordinal n is predicted at mBaseNs + mInterceptNs + n * mSlopeNs
+        int64_t mBaseNs = 0;
+        int64_t mLastObservedNs = 0;
+        double mInterceptNs = 0;
+        double mSlopeNs = 0;
+        double mErrorNs = 0;
+
+        std::array<Sample, kHistorySize> mSamples;
+        size_t mHead = 0;
+        size_t mCount = 0;
+        int mConsecutiveOutliers = 0;
+        // latest samples in a row that were exactly one period apart
+        size_t mUnitSteps = 0;
+};
+
+}  // namespace android
+
+#endif
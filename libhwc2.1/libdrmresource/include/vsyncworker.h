@@ -22,9 +22,11 @@
 #include <stdint.h>
 #include <utils/String8.h>
 
+#include <atomic>
 #include <map>
 
 #include "drmdevice.h"
+#include "vsyncpredictor.h"
 #include "worker.h"
 
 namespace android {
@@ -44,6 +46,9 @@ class VSyncWorker : public Worker {
         void RegisterCallback(std::shared_ptr<VsyncCallback> callback);
 
         void VSyncControl(bool enabled);
+        // The panel timing changed without a mode change, such as a refresh
+        // rate drop on panel idle, so the model is relearned from hardware.
+        void ResetPredictor();
 
     protected:
         void Routine() override;
@@ -51,6 +56,9 @@ class VSyncWorker : public Worker {
     private:
         int GetPhasedVSync(uint32_t vsyncPeriodNs, int64_t& expectTimeNs);
         int SyntheticWaitVBlank(int64_t& timestamp);
+        int WaitHwVBlank(DrmCrtc* crtc, int64_t& timestampNs);
+        int PredictedWaitVBlank(int64_t& timestampNs);
+        void UpdatePredictor(DrmConnector* conn);
 
         DrmDevice* mDrmDevice;
 
@@ -62,8 +70,17 @@ class VSyncWorker : public Worker {
         int mDisplay;
         std::atomic_bool mEnabled;
         int64_t mLastTimestampNs;
+
+        // Once mPredictor is confident, vsync is generated from the model and
+        // the kernel vblank interrupt is left to turn off. A hardware vsync is
+        // still waited for at mNextResyncNs to keep the model in sync.
+        VsyncPredictor mPredictor;
+        std::atomic<int64_t> mNextResyncNs = 0;
+        std::atomic_bool mPredictorResetPending = false;
+        static constexpr int64_t kResyncIntervalNs = 1000000000;
         String8 mHwVsyncPeriodTag;
         String8 mHwVsyncEnabledTag;
+        String8 mVsyncPredictedTag;
         String8 mDisplayTraceName;
 };
 }  // namespace android
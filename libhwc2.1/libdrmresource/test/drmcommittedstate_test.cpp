@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <map>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "drmcommittedstate.h"
+
+namespace android {
+
+namespace {
+
+/* Same layout as the items of a drmModeAtomicReq */
+struct Item {
+    uint32_t object_id;
+    uint32_t property_id;
+    uint64_t value;
+};
+
+constexpr uint32_t kPlane0 = 10;
+constexpr uint32_t kPlane1 = 11;
+constexpr uint32_t kCrtc = 20;
+constexpr uint32_t kConnector = 30;
+
+constexpr uint32_t kFbId = 1;
+constexpr uint32_t kCrtcX = 2;
+constexpr uint32_t kInFenceFd = 3;
+constexpr uint32_t kActive = 4;
+constexpr uint32_t kOutFencePtr = 5;
+constexpr uint32_t kCrtcId = 6;
+
+/* Applies the items it gets in order, like the kernel does with an atomic request */
+class FakePropertySink {
+public:
+    int commit(const Item *items, uint32_t count) {
+        mSent.assign(items, items + count);
+        if (mError)
+            return mError;
+        for (uint32_t i = 0; i < count; i++)
+            mState[{items[i].object_id, items[i].property_id}] = items[i].value;
+        return 0;
+    }
+
+    std::map<std::pair<uint32_t, uint32_t>, uint64_t> mState;
+    std::vector<Item> mSent;
+    int mError = 0;
+};
+
+class DrmCommittedStateTest : public testing::Test {
+protected:
+    void SetUp() override {
+        mState.Init({kPlane0, kPlane1, kCrtc}, {kInFenceFd, kOutFencePtr});
+    }
+
+    int commit(std::vector<Item> items, bool strip = true, bool modeset = false) {
+        uint32_t count = items.size();
+        return mState.Commit(items.data(), count, strip, modeset, [&](uint32_t n) {
+            return mSink.commit(items.data(), n);
+        });
+    }
+
+    std::vector<std::pair<uint32_t, uint32_t>> sent() const {
+        std::vector<std::pair<uint32_t, uint32_t>> properties;
+        for (const auto &item : mSink.mSent)
+            properties.emplace_back(item.object_id, item.property_id);
+        return properties;
+    }
+
+    static std::vector<Item> frame(uint64_t fb0, uint64_t fb1) {
+        return {{kPlane0, kFbId, fb0},     {kPlane0, kCrtcX, 0},
+                {kPlane0, kInFenceFd, 7},  {kPlane1, kFbId, fb1},
+                {kPlane1, kCrtcX, 100},    {kPlane1, kInFenceFd, 8},
+                {kCrtc, kActive, 1},       {kCrtc, kOutFencePtr, 0x1000},
+                {kConnector, kCrtcId, kCrtc}};
+    }
+
+    DrmCommittedState mState;
+    FakePropertySink mSink;
+};
+
+using Properties = std::vector<std::pair<uint32_t, uint32_t>>;
+
+/* Changed, volatile and connector properties */
+const Properties kMinimalFrame = {{kPlane0, kFbId},     {kPlane0, kInFenceFd},
+                                  {kPlane1, kInFenceFd}, {kCrtc, kOutFencePtr},
+                                  {kConnector, kCrtcId}};
+
+} // namespace
+
+TEST_F(DrmCommittedStateTest, FirstCommitCarriesEverything) {
+    ASSERT_EQ(commit(frame(1, 2)), 0);
+    EXPECT_EQ(mSink.mSent.size(), frame(1, 2).size());
+}
+
+TEST_F(DrmCommittedStateTest, SendsOnlyChangedProperties) {
+    ASSERT_EQ(commit(frame(1, 2)), 0);
+    ASSERT_EQ(commit(frame(3, 2)), 0);
+    EXPECT_EQ(sent(), kMinimalFrame);
+    EXPECT_EQ(mSink.mSent[0].value, 3u);
+
+    /* The kernel ends up as after a full commit */
+    FakePropertySink reference;
+    auto full = frame(3, 2);
+    reference.commit(full.data(), full.size());
+    EXPECT_EQ(mSink.mState, reference.mState);
+}
+
+TEST_F(DrmCommittedStateTest, NonStrippedCommitsAreRecorded) {
+    ASSERT_EQ(commit(frame(1, 2), false), 0);
+    EXPECT_EQ(mSink.mSent.size(), frame(1, 2).size());
+    ASSERT_EQ(commit(frame(3, 2)), 0);
+    EXPECT_EQ(sent(), kMinimalFrame);
+}
+
+TEST_F(DrmCommittedStateTest, LastWriteWins) {
+    ASSERT_EQ(commit(frame(1, 2)), 0);
+
+    /* Overridden by the committed value, nothing changes */
+    auto items = frame(1, 2);
+    items.insert(items.begin(), {kPlane1, kFbId, 5});
+    ASSERT_EQ(commit(items), 0);
+    EXPECT_EQ((sent()), (Properties{{kPlane0, kInFenceFd}, {kPlane1, kInFenceFd},
+                                    {kCrtc, kOutFencePtr}, {kConnector, kCrtcId}}));
+    EXPECT_EQ((mSink.mState[{kPlane1, kFbId}]), 2u);
+
+    /* The committed value overridden by a new one, only the last one is sent */
+    items = frame(1, 2);
+    items.push_back({kPlane1, kFbId, 6});
+    ASSERT_EQ(commit(items), 0);
+    EXPECT_EQ((sent()), (Properties{{kPlane0, kInFenceFd}, {kPlane1, kInFenceFd},
+                                    {kCrtc, kOutFencePtr}, {kConnector, kCrtcId},
+                                    {kPlane1, kFbId}}));
+    EXPECT_EQ(mSink.mSent.back().value, 6u);
+    EXPECT_EQ((mSink.mState[{kPlane1, kFbId}]), 6u);
+
+    /* And it is what the next frame is compared with */
+    ASSERT_EQ(commit(frame(1, 2)), 0);
+    EXPECT_EQ((mSink.mState[{kPlane1, kFbId}]), 2u);
+}
+
+TEST_F(DrmCommittedStateTest, FailedCommitFallsBackToFullCommit) {
+    ASSERT_EQ(commit(frame(1, 2)), 0);
+    mSink.mError = -EINVAL;
+    EXPECT_EQ(commit(frame(3, 4)), -EINVAL);
+
+    mSink.mError = 0;
+    ASSERT_EQ(commit(frame(3, 4)), 0);
+    EXPECT_EQ(mSink.mSent.size(), frame(3, 4).size());
+    ASSERT_EQ(commit(frame(3, 4)), 0);
+    EXPECT_EQ(mSink.mSent.size(), 4u);
+}
+
+TEST_F(DrmCommittedStateTest, ModesetFallsBackToFullCommit) {
+    ASSERT_EQ(commit(frame(1, 2)), 0);
+    ASSERT_EQ(commit(frame(1, 2), false, true), 0);
+
+    ASSERT_EQ(commit(frame(1, 2)), 0);
+    EXPECT_EQ(mSink.mSent.size(), frame(1, 2).size());
+}
+
+TEST_F(DrmCommittedStateTest, InvalidateFallsBackToFullCommit) {
+    ASSERT_EQ(commit(frame(1, 2)), 0);
+    /* e.g. a power mode change */
+    mState.Invalidate();
+
+    /* A property missing from the first commit after it isn't known either */
+    auto items = frame(1, 2);
+    items.erase(items.begin());
+    ASSERT_EQ(commit(items), 0);
+    EXPECT_EQ(mSink.mSent.size(), items.size());
+    ASSERT_EQ(commit(frame(1, 2)), 0);
+    EXPECT_EQ(sent(), kMinimalFrame);
+}
+
+TEST_F(DrmCommittedStateTest, MatchesFullCommits) {
+    std::mt19937 random(42);
+    FakePropertySink reference;
+    for (int i = 0; i < 1000; i++) {
+        auto items = frame(random() % 3, random() % 3);
+        if (random() % 4 == 0)
+            items.push_back({kPlane0, kCrtcX, random() % 2});
+        if (random() % 50 == 0)
+            mState.Invalidate();
+        ASSERT_EQ(commit(items), 0);
+        reference.commit(items.data(), items.size());
+        ASSERT_EQ(mSink.mState, reference.mState) << "frame " << i;
+    }
+}
+
+TEST_F(DrmCommittedStateTest, CommitsDontInterleave) {
+    std::atomic<int> committing = 0;
+    std::atomic<bool> overlapped = false;
+    auto display = [&](uint32_t plane) {
+        for (int i = 0; i < 1000; i++) {
+            std::vector<Item> items = {{plane, kFbId, uint64_t(i % 2)}};
+            uint32_t count = items.size();
+            mState.Commit(items.data(), count, true, false, [&](uint32_t) {
+                if (committing++)
+                    overlapped = true;
+                std::this_thread::yield();
+                committing--;
+                return 0;
+            });
+        }
+    };
+    std::thread other(display, kPlane1);
+    display(kPlane0);
+    other.join();
+    EXPECT_FALSE(overlapped);
+}
+
+} // namespace android
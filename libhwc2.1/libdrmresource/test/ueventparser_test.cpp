@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ueventparser.h"
+
+namespace android {
+
+namespace {
+
+using namespace std::string_literals;
+
+const std::string kHotplug =
+        "change@/devices/platform/exynos-drm/drm/card0\0"
+        "ACTION=change\0"
+        "DEVPATH=/devices/platform/exynos-drm/drm/card0\0"
+        "SUBSYSTEM=drm\0"
+        "HOTPLUG=1\0"
+        "DEVNAME=dri/card0\0"
+        "DEVTYPE=drm_minor\0"
+        "SEQNUM=4242\0"s;
+
+/* property updates carry HOTPLUG=1 too */
+std::string propertyUpdate(const std::string &connector, const std::string &property) {
+    return "change@/devices/platform/exynos-drm/drm/card0\0"
+           "ACTION=change\0"
+           "HOTPLUG=1\0"
+           "CONNECTOR="s +
+            connector + "\0PROPERTY="s + property + "\0DEVTYPE=drm_minor\0"s;
+}
+
+UEvent parse(const std::string &uevent) {
+    UEvent event;
+    ParseUEvent(uevent.data(), uevent.size(), event);
+    return event;
+}
+
+} // namespace
+
+TEST(UEventParserTest, ParsesHotplug) {
+    UEvent event = parse(kHotplug);
+    EXPECT_TRUE(event.drm_minor);
+    EXPECT_TRUE(event.hotplug);
+    EXPECT_FALSE(event.have_connector_id);
+    EXPECT_FALSE(event.have_property_id);
+    EXPECT_TRUE(event.panel_idle.empty());
+}
+
+TEST(UEventParserTest, ParsesPropertyUpdate) {
+    UEvent event = parse(propertyUpdate("32", "4294967295"));
+    ASSERT_TRUE(event.have_connector_id);
+    ASSERT_TRUE(event.have_property_id);
+    EXPECT_EQ(event.connector_id, 32u);
+    EXPECT_EQ(event.property_id, 4294967295u);
+}
+
+TEST(UEventParserTest, KeepsWholePanelIdleToken) {
+    const std::string uevent = "change@/devices/platform/exynos-drm/primary-panel\0"
+                               "PANEL_IDLE_ENTER=primary\0"s;
+    UEvent event = parse(uevent);
+    EXPECT_EQ(event.panel_idle, "PANEL_IDLE_ENTER=primary");
+    /* it points into the buffer that was parsed */
+    EXPECT_GE(event.panel_idle.data(), uevent.data());
+    EXPECT_LT(event.panel_idle.data(), uevent.data() + uevent.size());
+    EXPECT_FALSE(event.hotplug);
+}
+
+TEST(UEventParserTest, RejectsMalformedValues) {
+    for (const auto &[connector, property] :
+         {std::pair{"12x", "7"}, {"", "7"}, {"-1", "7"}, {"99999999999", "7"}, {"12", " 7"}}) {
+        UEvent event = parse(propertyUpdate(connector, property));
+        EXPECT_FALSE(event.have_connector_id && event.have_property_id)
+                << "CONNECTOR=" << connector << " PROPERTY=" << property;
+    }
+
+    EXPECT_FALSE(parse("HOTPLUG=0\0DEVTYPE=drm_minor\0"s).hotplug);
+    EXPECT_FALSE(parse("HOTPLUG=1\0DEVTYPE=drm_minor_x\0"s).drm_minor);
+    /* only whole keys match */
+    EXPECT_FALSE(parse("XHOTPLUG=1\0HOTPLUGX=1\0HOTPLUG\0"s).hotplug);
+}
+
+TEST(UEventParserTest, StopsAtLength) {
+    /* the last token may not be NUL terminated, and nothing past len is read */
+    const std::string uevent = "DEVTYPE=drm_minor\0HOTPLUG=1"s;
+    UEvent event;
+    ParseUEvent(uevent.data(), uevent.size(), event);
+    EXPECT_TRUE(event.hotplug);
+    ParseUEvent(uevent.data(), uevent.size() - 1, event);
+    EXPECT_TRUE(event.drm_minor);
+    EXPECT_FALSE(event.hotplug);
+    ParseUEvent(uevent.data(), 0, event);
+    EXPECT_FALSE(event.drm_minor);
+}
+
+TEST(UEventParserTest, ResetsBetweenEvents) {
+    UEvent event;
+    ParseUEvent(kHotplug.data(), kHotplug.size(), event);
+    const std::string other = propertyUpdate("1", "2");
+    ParseUEvent(other.data(), other.size(), event);
+    const std::string idle = "PANEL_IDLE_ENTER=primary\0"s;
+    ParseUEvent(idle.data(), idle.size(), event);
+    EXPECT_FALSE(event.hotplug);
+    EXPECT_FALSE(event.drm_minor);
+    EXPECT_FALSE(event.have_connector_id);
+    EXPECT_FALSE(event.have_property_id);
+}
+
+TEST(UEventParserTest, BatchKeepsArrivalOrder) {
+    UEventBatch batch;
+    for (const auto &uevent :
+         {kHotplug, propertyUpdate("32", "7"), "PANEL_IDLE_ENTER=primary\0"s, kHotplug,
+          propertyUpdate("33", "7"), propertyUpdate("32", "7"), "PANEL_IDLE_ENTER=secondary\0"s}) {
+        batch.add(parse(uevent));
+    }
+    /* property updates are not hotplugs even though they carry HOTPLUG=1, and repeated
+     * ones only stay at their last position */
+    EXPECT_EQ(batch.actions,
+              (std::vector<UEventAction>{{UEventAction::kPanelIdle, 0, 0,
+                                          "PANEL_IDLE_ENTER=primary"},
+                                         {UEventAction::kHotplug},
+                                         {UEventAction::kPropertyUpdate, 33, 7},
+                                         {UEventAction::kPropertyUpdate, 32, 7},
+                                         {UEventAction::kPanelIdle, 0, 0,
+                                          "PANEL_IDLE_ENTER=secondary"}}));
+
+    batch.clear();
+    batch.add(parse(propertyUpdate("32", "7")));
+    EXPECT_EQ(batch.actions, (std::vector<UEventAction>{{UEventAction::kPropertyUpdate, 32, 7}}));
+}
+
+namespace {
+
+/* uevents of a brightness change racing with a hotplug, as the listener receives them */
+std::vector<std::string> capturedStream() {
+    std::vector<std::string> stream;
+    for (int i = 0; i < 12; i++) {
+        stream.push_back(propertyUpdate("32", std::to_string(40 + i % 3)));
+        if (i % 4 == 0)
+            stream.push_back("change@/devices/platform/exynos-drm/primary-panel\0"
+                             "ACTION=change\0SUBSYSTEM=drm\0PANEL_IDLE_ENTER=primary\0"s);
+    }
+    stream.push_back(kHotplug);
+    stream.push_back(propertyUpdate("33", "40"));
+    stream.push_back(kHotplug);
+    return stream;
+}
+
+/* Datagrams keep the uevent boundaries, like the netlink socket */
+class UEventSocket {
+public:
+    UEventSocket() {
+        EXPECT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, mFds), 0);
+        EXPECT_EQ(fcntl(mFds[0], F_SETFL, O_NONBLOCK), 0);
+    }
+    ~UEventSocket() {
+        close(mFds[0]);
+        if (mFds[1] >= 0)
+            close(mFds[1]);
+    }
+
+    void send(const std::vector<std::string> &stream) {
+        for (const auto &uevent : stream)
+            ASSERT_EQ(write(mFds[1], uevent.data(), uevent.size()), ssize_t(uevent.size()));
+    }
+    void closeSender() {
+        close(mFds[1]);
+        mFds[1] = -1;
+    }
+    int fd() const { return mFds[0]; }
+
+private:
+    int mFds[2] = {-1, -1};
+};
+
+} // namespace
+
+TEST(UEventParserTest, ReplaysCapturedStream) {
+    const auto stream = capturedStream();
+    ASSERT_EQ(stream.size(), 18u);
+    UEventSocket socket;
+    socket.send(stream);
+
+    /* Drained in bounded batches, each one in arrival order */
+    UEventBatch batch;
+    ASSERT_EQ(DrainUEvents(socket.fd(), 10, batch), 10);
+    UEventBatch expected;
+    for (size_t i = 0; i < 10; i++)
+        expected.add(parse(stream[i]));
+    EXPECT_EQ(batch.actions, expected.actions);
+    /* 8 brightness updates of 3 properties and 2 idle events */
+    EXPECT_EQ(batch.actions.size(), 5u);
+
+    batch.clear();
+    expected.clear();
+    ASSERT_EQ(DrainUEvents(socket.fd(), 32, batch), 8);
+    for (size_t i = 10; i < stream.size(); i++)
+        expected.add(parse(stream[i]));
+    EXPECT_EQ(batch.actions, expected.actions);
+    EXPECT_EQ(batch.actions.back(), UEventAction{UEventAction::kHotplug});
+
+    /* Nothing left, then the sender went away */
+    batch.clear();
+    EXPECT_EQ(DrainUEvents(socket.fd(), 32, batch), 0);
+    socket.closeSender();
+    EXPECT_EQ(DrainUEvents(socket.fd(), 32, batch), 0);
+    EXPECT_TRUE(batch.actions.empty());
+
+    EXPECT_EQ(DrainUEvents(-1, 32, batch), -EBADF);
+}
+
+TEST(UEventParserTest, ReplayThroughput) {
+    const auto stream = capturedStream();
+    UEventSocket socket;
+    UEventBatch batch;
+    constexpr int kRounds = 5000;
+
+    size_t drained = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < kRounds; round++) {
+        socket.send(stream);
+        batch.clear();
+        drained += DrainUEvents(socket.fd(), 32, batch);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(drained, stream.size() * kRounds);
+    double rate = drained / elapsed.count();
+    RecordProperty("uevents_per_second", std::to_string(int64_t(rate)));
+    std::cout << "replayed " << drained << " uevents at " << int64_t(rate) << " per second, "
+              << "including the sends\n";
+}
+
+} // namespace android
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <vector>
+
+#include "vsyncpredictor.h"
+
+namespace android {
+
+namespace {
+
+constexpr int64_t k60HzNs = 16666667;
+constexpr int64_t k120HzNs = 8333333;
+constexpr int64_t kStartNs = 1000000000;
+
+/* hardware vsync timestamps of one period with a repeatable +-jitterNs noise */
+std::vector<int64_t> makeVsyncs(int64_t startNs, int64_t periodNs, size_t count,
+                                int64_t jitterNs, uint32_t seed = 1) {
+    std::vector<int64_t> vsyncs;
+    for (size_t i = 0; i < count; i++) {
+        seed = seed * 1103515245 + 12345;
+        const int64_t noiseNs =
+                jitterNs ? static_cast<int64_t>((seed >> 8) % (2 * jitterNs + 1)) - jitterNs : 0;
+        vsyncs.push_back(startNs + static_cast<int64_t>(i) * periodNs + noiseNs);
+    }
+    return vsyncs;
+}
+
+void feed(VsyncPredictor& predictor, const std::vector<int64_t>& vsyncs) {
+    for (int64_t vsyncNs : vsyncs) predictor.addTimestamp(vsyncNs);
+}
+
+} // namespace
+
+TEST(VsyncPredictorTest, LearnsJitteredPeriod) {
+    VsyncPredictor predictor;
+    predictor.reset(k60HzNs);
+
+    /* the panel runs 0.1% slow and every timestamp has up to 100us of noise */
+    const int64_t realPeriodNs = k60HzNs + k60HzNs / 1000;
+    const auto vsyncs = makeVsyncs(kStartNs, realPeriodNs, 20, 100000);
+    feed(predictor, vsyncs);
+
+    ASSERT_TRUE(predictor.isConfident());
+    EXPECT_NEAR(predictor.period(), realPeriodNs, 20000);
+
+    /* the next vsync lands close to where the panel actually fires it */
+    const int64_t nowNs = vsyncs.back() + realPeriodNs / 2;
+    EXPECT_NEAR(predictor.nextVsync(nowNs), kStartNs + 20 * realPeriodNs, 200000);
+}
+
+TEST(VsyncPredictorTest, NotConfidentWithFewSamples) {
+    VsyncPredictor predictor;
+    predictor.reset(k60HzNs);
+
+    feed(predictor, makeVsyncs(kStartNs, k60HzNs, 3, 0));
+    EXPECT_FALSE(predictor.isConfident());
+}
+
+TEST(VsyncPredictorTest, RejectsSingleOutlier) {
+    VsyncPredictor predictor;
+    predictor.reset(k60HzNs);
+
+    auto vsyncs = makeVsyncs(kStartNs, k60HzNs, 12, 50000);
+    feed(predictor, vsyncs);
+    ASSERT_TRUE(predictor.isConfident());
+
+    /* a spurious timestamp half way between two vsyncs, the vsync after it is
+     * measured from the spurious one and rejected as well */
+    EXPECT_FALSE(predictor.addTimestamp(vsyncs.back() + k60HzNs / 2));
+    EXPECT_FALSE(predictor.addTimestamp(vsyncs.back() + k60HzNs));
+    EXPECT_TRUE(predictor.addTimestamp(vsyncs.back() + 2 * k60HzNs));
+    EXPECT_TRUE(predictor.isConfident());
+    EXPECT_NEAR(predictor.period(), k60HzNs, 20000);
+}
+
+TEST(VsyncPredictorTest, MissedVsyncsKeepPhase) {
+    VsyncPredictor predictor;
+    predictor.reset(k60HzNs);
+
+    auto vsyncs = makeVsyncs(kStartNs, k60HzNs, 10, 0);
+    /* two vsyncs were not observed */
+    vsyncs.push_back(kStartNs + 12 * k60HzNs);
+    for (int i = 13; i < 20; i++) vsyncs.push_back(kStartNs + i * k60HzNs);
+    feed(predictor, vsyncs);
+
+    ASSERT_TRUE(predictor.isConfident());
+    EXPECT_NEAR(predictor.nextVsync(kStartNs + 19 * k60HzNs + 1), kStartNs + 20 * k60HzNs,
+                1000);
+}
+
+TEST(VsyncPredictorTest, RelearnsAfterRateChange) {
+    VsyncPredictor predictor;
+    predictor.reset(k60HzNs);
+
+    auto vsyncs = makeVsyncs(kStartNs, k60HzNs, 20, 100000);
+    feed(predictor, vsyncs);
+    ASSERT_TRUE(predictor.isConfident());
+
+    /* the panel switched to 120Hz without a mode change reaching the worker */
+    const int64_t switchNs = vsyncs.back() + k120HzNs;
+    const auto fastVsyncs = makeVsyncs(switchNs, k120HzNs, 40, 100000, 7);
+    for (int64_t vsyncNs : fastVsyncs) {
+        predictor.addTimestamp(vsyncNs);
+        /* while confident it must not predict the old rate */
+        if (predictor.isConfident()) {
+            EXPECT_NEAR(predictor.period(), k60HzNs, k60HzNs / 5);
+        }
+    }
+    EXPECT_FALSE(predictor.isConfident());
+
+    /* once the worker resets the nominal period the new rate is learned */
+    predictor.reset(k120HzNs);
+    feed(predictor, makeVsyncs(fastVsyncs.back() + k120HzNs, k120HzNs, 20, 100000, 9));
+    ASSERT_TRUE(predictor.isConfident());
+    EXPECT_NEAR(predictor.period(), k120HzNs, 20000);
+}
+
+TEST(VsyncPredictorTest, NominalFractionOfRealPeriod) {
+    /* with TE_FREQ_X2 the TE period is half the vblank interval */
+    VsyncPredictor predictor;
+    predictor.reset(k60HzNs / 2);
+
+    feed(predictor, makeVsyncs(kStartNs, k60HzNs, 40, 100000));
+    EXPECT_FALSE(predictor.isConfident());
+
+    /* same for TE_FREQ_X4 */
+    predictor.reset(k60HzNs / 4);
+    feed(predictor, makeVsyncs(kStartNs + 40 * k60HzNs, k60HzNs, 40, 100000));
+    EXPECT_FALSE(predictor.isConfident());
+}
+
+TEST(VsyncPredictorTest, DisabledWithoutNominalPeriod) {
+    VsyncPredictor predictor;
+    predictor.reset(0);
+
+    for (int64_t vsyncNs : makeVsyncs(kStartNs, k60HzNs, 20, 0)) {
+        EXPECT_FALSE(predictor.addTimestamp(vsyncNs));
+    }
+    EXPECT_FALSE(predictor.isConfident());
+}
+
+TEST(VsyncPredictorTest, LongGapStartsOver) {
+    VsyncPredictor predictor;
+    predictor.reset(k60HzNs);
+
+    auto vsyncs = makeVsyncs(kStartNs, k60HzNs, 20, 0);
+    feed(predictor, vsyncs);
+    ASSERT_TRUE(predictor.isConfident());
+
+    /* display was idle for 3 seconds */
+    EXPECT_TRUE(predictor.addTimestamp(vsyncs.back() + 3000000000));
+    EXPECT_FALSE(predictor.isConfident());
+}
+
+} // namespace android
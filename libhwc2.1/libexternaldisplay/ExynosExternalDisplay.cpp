@@ -83,6 +83,8 @@ int ExynosExternalDisplay::openExternalDisplay()
     mPlugState = true;
 
     if (mLayers.size() != 0) {
+        for (size_t i = 0; i < mLayers.size(); i++)
+            mLayerIndex.erase(mLayers[i]);
         mLayers.clear();
     }
 
@@ -118,6 +120,7 @@ void ExynosExternalDisplay::closeExternalDisplay()
         ExynosLayer *layer = mLayers[i];
         layer->mAcquireFence = fence_close(layer->mAcquireFence, this, FENCE_TYPE_SRC_ACQUIRE, FENCE_IP_LAYER);
         layer->mReleaseFence = -1;
+        layer->mSharedReleaseFence.reset();
         layer->mLayerBuffer = NULL;
     }
 
@@ -347,6 +350,7 @@ int32_t ExynosExternalDisplay::presentDisplay(
         *outRetireFence = -1;
         for (size_t i=0; i < mLayers.size(); i++) {
             mLayers[i]->mReleaseFence = -1;
+            mLayers[i]->mSharedReleaseFence.reset();
         }
         if (mRenderingState == RENDERING_STATE_NONE) {
             ALOGD("\tThis is the first frame after power on");
@@ -379,6 +383,7 @@ int32_t ExynosExternalDisplay::presentDisplay(
             layer->mAcquireFence = fence_close(layer->mAcquireFence, this,
                     FENCE_TYPE_SRC_ACQUIRE, FENCE_IP_LAYER);
             layer->mReleaseFence = -1;
+            layer->mSharedReleaseFence.reset();
         }
         mClientCompositionInfo.mAcquireFence =
             fence_close(mClientCompositionInfo.mAcquireFence, this,
@@ -31,6 +31,7 @@
 #include "ExynosHWCDebug.h"
 #include "ExynosLayer.h"
 #include "ExynosResourceRestriction.h"
+#include "FormatDescIndex.h"
 #include "VendorVideoAPI.h"
 #include "exynos_sync.h"
 
@@ -132,24 +133,30 @@ unsigned int isNarrowRgb(int format, android_dataspace data_space)
     }
 }
 
-const format_description_t* halFormatToExynosFormat(int inHalFormat, uint32_t inCompressType) {
-    for (unsigned int i = 0; i < FORMAT_MAX_CNT; i++) {
-        const int descHalFormat = exynos_format_desc[i].halFormat;
+/* exynos_format_desc is looked up several times per layer on every validate */
+static const FormatDescIndex<format_description_t>& getFormatDescIndex() {
+    static const FormatDescIndex<format_description_t> index(exynos_format_desc, FORMAT_MAX_CNT);
+    return index;
+}
 
-        if ((inHalFormat == descHalFormat) &&
-            exynos_format_desc[i].isCompressionSupported(inCompressType)) {
-            return &exynos_format_desc[i];
-        }
-    }
-    return nullptr;
+/* First descriptor of the HAL format regardless of compression */
+static const format_description_t* findHalFormatDesc(int halFormat) {
+    return getFormatDescIndex().halFormatDesc(halFormat);
+}
+
+static const format_description_t* findDpuFormatDesc(int dpuFormat) {
+    return getFormatDescIndex().dpuFormatDesc(dpuFormat);
+}
+
+const format_description_t* halFormatToExynosFormat(int inHalFormat, uint32_t inCompressType) {
+    return getFormatDescIndex().halFormatDesc(inHalFormat, inCompressType);
 }
 
 uint8_t formatToBpp(int format)
 {
-    for (unsigned int i = 0; i < FORMAT_MAX_CNT; i++){
-        if (exynos_format_desc[i].halFormat == format)
-            return exynos_format_desc[i].bpp;
-    }
+    auto desc = findHalFormatDesc(format);
+    if (desc != nullptr)
+        return desc->bpp;
 
     ALOGW("unrecognized pixel format %u", format);
     return 0;
@@ -157,25 +164,18 @@ uint8_t formatToBpp(int format)
 
 uint8_t DpuFormatToBpp(decon_pixel_format format)
 {
-    for (unsigned int i = 0; i < FORMAT_MAX_CNT; i++){
-        if (exynos_format_desc[i].s3cFormat == format)
-            return exynos_format_desc[i].bpp;
-    }
+    auto desc = findDpuFormatDesc(format);
+    if (desc != nullptr)
+        return desc->bpp;
+
     ALOGW("unrecognized decon format %u", format);
     return 0;
 }
 
 bool isFormatRgb(int format)
 {
-    for (unsigned int i = 0; i < FORMAT_MAX_CNT; i++){
-        if (exynos_format_desc[i].halFormat == format) {
-            if (exynos_format_desc[i].type & RGB)
-                return true;
-            else
-                return false;
-        }
-    }
-    return false;
+    auto desc = findHalFormatDesc(format);
+    return (desc != nullptr) && (desc->type & RGB);
 }
 
 bool isFormatYUV(int format)
@@ -187,106 +187,48 @@ bool isFormatYUV(int format)
 
 bool isFormatSBWC(int format)
 {
-    for (unsigned int i = 0; i < FORMAT_MAX_CNT; i++){
-        if (exynos_format_desc[i].halFormat == format) {
-            if (exynos_format_desc[i].type & COMP_TYPE_SBWC)
-                return true;
-            else
-                return false;
-        }
-    }
-    return false;
+    auto desc = findHalFormatDesc(format);
+    return (desc != nullptr) && (desc->type & COMP_TYPE_SBWC);
 }
 
 bool isFormatYUV420(int format)
 {
-    for (unsigned int i = 0; i < FORMAT_MAX_CNT; i++){
-        if (exynos_format_desc[i].halFormat == format) {
-            if (exynos_format_desc[i].type & YUV420)
-                return true;
-            else
-                return false;
-        }
-    }
-    return false;
+    auto desc = findHalFormatDesc(format);
+    return (desc != nullptr) && (desc->type & YUV420);
 }
 
 bool isFormatYUV8_2(int format)
 {
-    for (unsigned int i = 0; i < FORMAT_MAX_CNT; i++){
-        if (exynos_format_desc[i].halFormat == format) {
-            if ((exynos_format_desc[i].type & YUV420) &&
-                (exynos_format_desc[i].type & BIT8_2))
-                return true;
-            else
-                return false;
-        }
-    }
-    return false;
+    auto desc = findHalFormatDesc(format);
+    return (desc != nullptr) && (desc->type & YUV420) && (desc->type & BIT8_2);
 }
 
 bool isFormat10BitYUV420(int format)
 {
-    for (unsigned int i = 0; i < FORMAT_MAX_CNT; i++){
-        if (exynos_format_desc[i].halFormat == format) {
-            if ((exynos_format_desc[i].type & YUV420) &&
-                (exynos_format_desc[i].type & BIT10))
-                return true;
-            else
-                return false;
-        }
-    }
-    return false;
+    auto desc = findHalFormatDesc(format);
+    return (desc != nullptr) && (desc->type & YUV420) && (desc->type & BIT10);
 }
 
 bool isFormatYUV422(int format)
 {
-    for (unsigned int i = 0; i < FORMAT_MAX_CNT; i++){
-        if (exynos_format_desc[i].halFormat == format) {
-            if (exynos_format_desc[i].type & YUV422)
-                return true;
-            else
-                return false;
-        }
-    }
-    return false;
+    auto desc = findHalFormatDesc(format);
+    return (desc != nullptr) && (desc->type & YUV422);
 }
 
 bool isFormatP010(int format)
 {
-    for (unsigned int i = 0; i < FORMAT_MAX_CNT; i++){
-        if (exynos_format_desc[i].halFormat == format) {
-            if (exynos_format_desc[i].type & P010)
-                return true;
-            else
-                return false;
-        }
-    }
-    return false;
+    auto desc = findHalFormatDesc(format);
+    return (desc != nullptr) && (desc->type & P010);
 }
 
 bool isFormat10Bit(int format) {
-    for (unsigned int i = 0; i < FORMAT_MAX_CNT; i++) {
-        if (exynos_format_desc[i].halFormat == format) {
-            if ((exynos_format_desc[i].type & BIT_MASK) == BIT10)
-                return true;
-            else
-                return false;
-        }
-    }
-    return false;
+    auto desc = findHalFormatDesc(format);
+    return (desc != nullptr) && ((desc->type & BIT_MASK) == BIT10);
 }
 
 bool isFormat8Bit(int format) {
-    for (unsigned int i = 0; i < FORMAT_MAX_CNT; i++) {
-        if (exynos_format_desc[i].halFormat == format) {
-            if ((exynos_format_desc[i].type & BIT_MASK) == BIT8)
-                return true;
-            else
-                return false;
-        }
-    }
-    return false;
+    auto desc = findHalFormatDesc(format);
+    return (desc != nullptr) && ((desc->type & BIT_MASK) == BIT8);
 }
 
 bool isFormatYCrCb(int format)
@@ -296,26 +238,17 @@ bool isFormatYCrCb(int format)
 
 bool isFormatLossy(int format)
 {
-    for (unsigned int i = 0; i < FORMAT_MAX_CNT; i++) {
-        if (exynos_format_desc[i].halFormat == format) {
-            uint32_t sbwcType = exynos_format_desc[i].type & FORMAT_SBWC_MASK;
-            if (sbwcType && sbwcType != SBWC_LOSSLESS)
-                return true;
-            else
-                return false;
-        }
-    }
-    return false;
+    auto desc = findHalFormatDesc(format);
+    if (desc == nullptr) return false;
+
+    uint32_t sbwcType = desc->type & FORMAT_SBWC_MASK;
+    return sbwcType && sbwcType != SBWC_LOSSLESS;
 }
 
 bool formatHasAlphaChannel(int format)
 {
-    for (unsigned int i = 0; i < FORMAT_MAX_CNT; i++) {
-        if (exynos_format_desc[i].halFormat == format) {
-            return exynos_format_desc[i].hasAlpha;
-        }
-    }
-    return false;
+    auto desc = findHalFormatDesc(format);
+    return (desc != nullptr) && desc->hasAlpha;
 }
 
 bool isAFBCCompressed(const buffer_handle_t handle) {
@@ -427,11 +360,8 @@ enum decon_pixel_format halFormatToDpuFormat(int format, uint32_t compressType)
 }
 
 uint32_t DpuFormatToHalFormat(int format, uint32_t /*compressType*/) {
-    for (unsigned int i = 0; i < FORMAT_MAX_CNT; i++){
-        if (exynos_format_desc[i].s3cFormat == static_cast<decon_pixel_format>(format))
-            return exynos_format_desc[i].halFormat;
-    }
-    return HAL_PIXEL_FORMAT_EXYNOS_UNDEFINED;
+    auto desc = findDpuFormatDesc(format);
+    return (desc != nullptr) ? desc->halFormat : HAL_PIXEL_FORMAT_EXYNOS_UNDEFINED;
 }
 
 int halFormatToDrmFormat(int format, uint32_t compressType)
@@ -446,21 +376,18 @@ int32_t drmFormatToHalFormats(int format, std::vector<uint32_t> *halFormats)
         return -EINVAL;
 
     halFormats->clear();
-    for (unsigned int i = 0; i < FORMAT_MAX_CNT; i++){
-        if (exynos_format_desc[i].drmFormat == format) {
-            halFormats->push_back(exynos_format_desc[i].halFormat);
-        }
+    auto descs = getFormatDescIndex().drmFormatDescs(format);
+    if (descs != nullptr) {
+        for (auto i : *descs)
+            halFormats->push_back(getFormatDescIndex()[i].halFormat);
     }
     return NO_ERROR;
 }
 
 int drmFormatToHalFormat(int format)
 {
-    for (unsigned int i = 0; i < FORMAT_MAX_CNT; i++){
-        if (exynos_format_desc[i].drmFormat == format)
-            return exynos_format_desc[i].halFormat;
-    }
-    return HAL_PIXEL_FORMAT_EXYNOS_UNDEFINED;
+    auto desc = getFormatDescIndex().drmFormatDesc(format);
+    return (desc != nullptr) ? desc->halFormat : HAL_PIXEL_FORMAT_EXYNOS_UNDEFINED;
 }
 
 android_dataspace colorModeToDataspace(android_color_mode_t mode)
@@ -25,6 +25,7 @@
 
 #include <fstream>
 #include <list>
+#include <memory>
 #include <optional>
 #include <sstream>
 #include <string>
@@ -496,6 +497,30 @@ int hwc_dup(int fd, ExynosDisplay *display, HwcFdebugFenceType type, HwcFdebugIp
             bool pendingAllowed = false);
 int hwc_print_stack();
 
+/*
+ * Release fence referenced by several layers at once.
+ * The fd is closed when the last reference goes away; owners that must hand
+ * out their own fd call dup().
+ */
+class SharedFence {
+    public:
+        SharedFence(int fd, ExynosDisplay *display) : mFd(fd), mDisplay(display) {}
+        ~SharedFence() {
+            fence_close(mFd, mDisplay, FENCE_TYPE_SRC_RELEASE, FENCE_IP_DPP);
+        }
+        SharedFence(const SharedFence &) = delete;
+        SharedFence &operator=(const SharedFence &) = delete;
+
+        int get() const { return mFd; }
+        int dup(HwcFdebugFenceType type, HwcFdebugIpType ip) const {
+            return hwc_dup(mFd, mDisplay, type, ip);
+        }
+
+    private:
+        const int mFd;
+        ExynosDisplay *const mDisplay;
+};
+
 inline hwc_rect expand(const hwc_rect &r1, const hwc_rect &r2)
 {
     hwc_rect i;
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _FORMAT_DESC_INDEX_H
+#define _FORMAT_DESC_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Index of a format description table by HAL, DPU and DRM format, so that
+ * lookups don't scan the table. Each list keeps table order, so the first
+ * entry is the one a linear scan would have returned, and a format listed
+ * more than once resolves the same way.
+ */
+template <typename Desc>
+class FormatDescIndex {
+public:
+    FormatDescIndex(const Desc* table, size_t count) : mTable(table) {
+        for (uint32_t i = 0; i < count; i++) {
+            mHalFormats[table[i].halFormat].push_back(i);
+            mDpuFormats.emplace(static_cast<int>(table[i].s3cFormat), i);
+            mDrmFormats[table[i].drmFormat].push_back(i);
+        }
+    }
+
+    /* Descriptions of the HAL format in table order, nullptr if there is none */
+    const std::vector<uint32_t>* halFormatDescs(int halFormat) const {
+        auto it = mHalFormats.find(halFormat);
+        return (it != mHalFormats.end()) ? &it->second : nullptr;
+    }
+
+    /* First description of the HAL format regardless of compression */
+    const Desc* halFormatDesc(int halFormat) const {
+        auto descs = halFormatDescs(halFormat);
+        return (descs != nullptr) ? &mTable[descs->front()] : nullptr;
+    }
+
+    /* First description of the HAL format that supports compressType */
+    const Desc* halFormatDesc(int halFormat, uint32_t compressType) const {
+        auto descs = halFormatDescs(halFormat);
+        if (descs == nullptr) return nullptr;
+
+        for (auto i : *descs) {
+            if (mTable[i].isCompressionSupported(compressType)) return &mTable[i];
+        }
+        return nullptr;
+    }
+
+    const Desc* dpuFormatDesc(int dpuFormat) const {
+        auto it = mDpuFormats.find(dpuFormat);
+        return (it != mDpuFormats.end()) ? &mTable[it->second] : nullptr;
+    }
+
+    /* Descriptions of the DRM format in table order, nullptr if there is none */
+    const std::vector<uint32_t>* drmFormatDescs(int drmFormat) const {
+        auto it = mDrmFormats.find(drmFormat);
+        return (it != mDrmFormats.end()) ? &it->second : nullptr;
+    }
+
+    const Desc* drmFormatDesc(int drmFormat) const {
+        auto descs = drmFormatDescs(drmFormat);
+        return (descs != nullptr) ? &mTable[descs->front()] : nullptr;
+    }
+
+    const Desc& operator[](uint32_t i) const { return mTable[i]; }
+
+private:
+    const Desc* mTable;
+    std::unordered_map<int, std::vector<uint32_t>> mHalFormats;
+    std::unordered_map<int, uint32_t> mDpuFormats;
+    std::unordered_map<int, std::vector<uint32_t>> mDrmFormats;
+};
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "FormatDescIndex.h"
+#include "linear_format_lookup.h"
+
+namespace {
+
+/* exynos_format_desc has 55 entries */
+constexpr size_t kTableSize = 55;
+
+/* The HAL formats of a validate, looked up in turn like the layers of a frame */
+std::vector<int> layerFormats(const std::vector<TestFormatDesc>& table) {
+    std::vector<int> formats;
+    for (size_t i = 0; i < table.size(); i += 5) formats.push_back(table[i].halFormat);
+    /* and one that is not in the table */
+    formats.push_back(0);
+    return formats;
+}
+
+void BM_LinearHalFormatLookup(benchmark::State& state) {
+    const auto table = makeFormatTable(kTableSize, 1);
+    const auto formats = layerFormats(table);
+    size_t n = 0;
+    for (auto _ : state) {
+        int format = formats[n++ % formats.size()];
+        benchmark::DoNotOptimize(linearHalFormatDesc(table, format, kCompAfbc));
+    }
+}
+BENCHMARK(BM_LinearHalFormatLookup);
+
+void BM_IndexedHalFormatLookup(benchmark::State& state) {
+    const auto table = makeFormatTable(kTableSize, 1);
+    const auto formats = layerFormats(table);
+    FormatDescIndex<TestFormatDesc> index(table.data(), table.size());
+    size_t n = 0;
+    for (auto _ : state) {
+        int format = formats[n++ % formats.size()];
+        benchmark::DoNotOptimize(index.halFormatDesc(format, kCompAfbc));
+    }
+}
+BENCHMARK(BM_IndexedHalFormatLookup);
+
+void BM_LinearDrmToHalFormats(benchmark::State& state) {
+    const auto table = makeFormatTable(kTableSize, 1);
+    size_t n = 0;
+    for (auto _ : state) {
+        int format = table[n++ % table.size()].drmFormat;
+        benchmark::DoNotOptimize(linearDrmToHalFormats(table, format));
+    }
+}
+BENCHMARK(BM_LinearDrmToHalFormats);
+
+void BM_IndexedDrmToHalFormats(benchmark::State& state) {
+    const auto table = makeFormatTable(kTableSize, 1);
+    FormatDescIndex<TestFormatDesc> index(table.data(), table.size());
+    size_t n = 0;
+    for (auto _ : state) {
+        int format = table[n++ % table.size()].drmFormat;
+        std::vector<int> halFormats;
+        if (auto descs = index.drmFormatDescs(format)) {
+            for (auto i : *descs) halFormats.push_back(index[i].halFormat);
+        }
+        benchmark::DoNotOptimize(halFormats);
+    }
+}
+BENCHMARK(BM_IndexedDrmToHalFormats);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "FormatDescIndex.h"
+#include "linear_format_lookup.h"
+
+namespace {
+
+const uint32_t kCompressTypes[] = {kCompNone, kCompAfbc, kCompSbwc, kCompNone | kCompAfbc};
+
+/* Checks every helper lookup of the index against the linear scan over all keys */
+void expectMatchesLinearScan(const std::vector<TestFormatDesc>& table) {
+    FormatDescIndex<TestFormatDesc> index(table.data(), table.size());
+
+    for (int halFormat = 0; halFormat <= int(table.size()); halFormat++) {
+        EXPECT_EQ(index.halFormatDesc(halFormat), linearHalFormatDesc(table, halFormat))
+                << "hal format " << halFormat;
+        for (uint32_t compressType : kCompressTypes) {
+            EXPECT_EQ(index.halFormatDesc(halFormat, compressType),
+                      linearHalFormatDesc(table, halFormat, compressType))
+                    << "hal format " << halFormat << ", compression " << compressType;
+        }
+    }
+
+    for (int dpuFormat = 0; dpuFormat <= kDpuFormatMax; dpuFormat++) {
+        EXPECT_EQ(index.dpuFormatDesc(dpuFormat), linearDpuFormatDesc(table, dpuFormat))
+                << "dpu format " << dpuFormat;
+    }
+
+    for (int drmFormat = 0; drmFormat < 100 + int(table.size()); drmFormat++) {
+        std::vector<int> halFormats;
+        if (auto descs = index.drmFormatDescs(drmFormat)) {
+            for (auto i : *descs) halFormats.push_back(index[i].halFormat);
+        }
+        auto expected = linearDrmToHalFormats(table, drmFormat);
+        EXPECT_EQ(halFormats, expected) << "drm format " << drmFormat;
+
+        const TestFormatDesc* desc = index.drmFormatDesc(drmFormat);
+        ASSERT_EQ(desc != nullptr, !expected.empty());
+        if (desc != nullptr) {
+            EXPECT_EQ(desc->halFormat, expected.front());
+        }
+    }
+}
+
+} // namespace
+
+TEST(FormatDescIndexTest, DuplicatesResolveToFirstEntry) {
+    const std::vector<TestFormatDesc> table = {
+            {1, 10, 100, kCompNone},
+            {1, 11, 100, kCompAfbc},
+            /* same HAL format and compression again, never returned */
+            {1, 12, 101, kCompNone | kCompAfbc},
+            {2, kDpuFormatMax, 101, kCompNone},
+            {3, kDpuFormatMax, 100, kCompSbwc},
+            {2, 10, 102, kCompAfbc},
+    };
+    FormatDescIndex<TestFormatDesc> index(table.data(), table.size());
+
+    EXPECT_EQ(index.halFormatDesc(1), &table[0]);
+    EXPECT_EQ(index.halFormatDesc(1, kCompNone), &table[0]);
+    EXPECT_EQ(index.halFormatDesc(1, kCompAfbc), &table[1]);
+    EXPECT_EQ(index.halFormatDesc(1, kCompSbwc), nullptr);
+    EXPECT_EQ(index.halFormatDesc(2, kCompAfbc), &table[5]);
+    EXPECT_EQ(index.halFormatDesc(4), nullptr);
+
+    EXPECT_EQ(index.dpuFormatDesc(10), &table[0]);
+    EXPECT_EQ(index.dpuFormatDesc(kDpuFormatMax), &table[3]);
+    EXPECT_EQ(index.dpuFormatDesc(13), nullptr);
+
+    EXPECT_EQ(index.drmFormatDesc(100), &table[0]);
+    EXPECT_EQ(index.drmFormatDesc(101), &table[2]);
+    ASSERT_NE(index.drmFormatDescs(100), nullptr);
+    EXPECT_EQ(*index.drmFormatDescs(100), (std::vector<uint32_t>{0, 1, 4}));
+    EXPECT_EQ(index.drmFormatDescs(103), nullptr);
+
+    expectMatchesLinearScan(table);
+}
+
+TEST(FormatDescIndexTest, MatchesLinearScan) {
+    for (unsigned seed = 0; seed < 20; seed++) {
+        SCOPED_TRACE(seed);
+        expectMatchesLinearScan(makeFormatTable(55, seed));
+    }
+}
+
+TEST(FormatDescIndexTest, EmptyTable) {
+    FormatDescIndex<TestFormatDesc> index(nullptr, 0);
+    EXPECT_EQ(index.halFormatDesc(1), nullptr);
+    EXPECT_EQ(index.halFormatDesc(1, kCompNone), nullptr);
+    EXPECT_EQ(index.dpuFormatDesc(1), nullptr);
+    EXPECT_EQ(index.drmFormatDescs(1), nullptr);
+    EXPECT_EQ(index.drmFormatDesc(1), nullptr);
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _LINEAR_FORMAT_LOOKUP_H
+#define _LINEAR_FORMAT_LOOKUP_H
+
+#include <stdint.h>
+
+#include <random>
+#include <vector>
+
+/* The fields of format_description_t the lookups use */
+struct TestFormatDesc {
+    inline bool isCompressionSupported(uint32_t inType) const { return (type & inType) != 0; }
+    int halFormat;
+    int s3cFormat;
+    int drmFormat;
+    uint32_t type;
+};
+
+constexpr uint32_t kCompNone = 1 << 0;
+constexpr uint32_t kCompAfbc = 1 << 1;
+constexpr uint32_t kCompSbwc = 1 << 2;
+constexpr int kDpuFormatMax = 99;
+
+/*
+ * A table shaped like exynos_format_desc: HAL formats listed once per
+ * compression, several formats without DPU format sharing the MAX value,
+ * and DRM formats shared by several HAL formats.
+ */
+inline std::vector<TestFormatDesc> makeFormatTable(size_t count, unsigned seed) {
+    std::mt19937 random(seed);
+    std::vector<TestFormatDesc> table;
+    for (size_t i = 0; i < count; i++) {
+        int halFormat = 1 + random() % (count / 2);
+        int s3cFormat = (random() % 3 == 0) ? kDpuFormatMax : int(random() % count);
+        int drmFormat = 100 + random() % (count / 3);
+        uint32_t type = 1 << (random() % 3);
+        if (random() % 4 == 0) type |= kCompAfbc;
+        table.push_back({halFormat, s3cFormat, drmFormat, type});
+    }
+    return table;
+}
+
+/* The scans the helpers of ExynosHWCHelper.cpp did before they were indexed */
+inline const TestFormatDesc* linearHalFormatDesc(const std::vector<TestFormatDesc>& table,
+                                                 int halFormat, uint32_t compressType) {
+    for (const auto& desc : table) {
+        if ((desc.halFormat == halFormat) && desc.isCompressionSupported(compressType))
+            return &desc;
+    }
+    return nullptr;
+}
+
+inline const TestFormatDesc* linearHalFormatDesc(const std::vector<TestFormatDesc>& table,
+                                                 int halFormat) {
+    for (const auto& desc : table) {
+        if (desc.halFormat == halFormat) return &desc;
+    }
+    return nullptr;
+}
+
+inline const TestFormatDesc* linearDpuFormatDesc(const std::vector<TestFormatDesc>& table,
+                                                 int dpuFormat) {
+    for (const auto& desc : table) {
+        if (desc.s3cFormat == dpuFormat) return &desc;
+    }
+    return nullptr;
+}
+
+inline std::vector<int> linearDrmToHalFormats(const std::vector<TestFormatDesc>& table,
+                                              int drmFormat) {
+    std::vector<int> halFormats;
+    for (const auto& desc : table) {
+        if (desc.drmFormat == drmFormat) halFormats.push_back(desc.halFormat);
+    }
+    return halFormats;
+}
+
+#endif
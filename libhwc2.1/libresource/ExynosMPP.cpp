@@ -214,6 +214,8 @@ ExynosMPP::ExynosMPP(ExynosResourceManager* resourceManager,
             mAttr = feature.attr;
     }
 
+    mPPCTable = PPCTable(ppc_table_map, mPhysicalType);
+
     if (mPhysicalType == MPP_MSC) {
         mClockKhz = MSC_CLOCK;
         /* To do
@@ -2041,10 +2043,80 @@ int32_t ExynosMPP::setupRestriction() {
         }
     }
 
+    invalidateSupportCache();
+
     return NO_ERROR;
 }
 
+static inline uint64_t packSupportCacheWord(uint32_t low, uint32_t high)
+{
+    return (static_cast<uint64_t>(high) << 32) | low;
+}
+
+ExynosMPP::SupportCacheKey ExynosMPP::makeSupportCacheKey(const ExynosDisplay &display,
+                                                          const struct exynos_image &src,
+                                                          const struct exynos_image &dst) const
+{
+    SupportCacheKey key;
+    size_t i = 0;
+
+    for (const exynos_image *img : {&src, &dst}) {
+        key[i++] = packSupportCacheWord(img->fullWidth, img->fullHeight);
+        key[i++] = packSupportCacheWord(img->x, img->y);
+        key[i++] = packSupportCacheWord(img->w, img->h);
+        key[i++] = packSupportCacheWord(img->format, img->layerFlags);
+        key[i++] = img->usageFlags;
+        key[i++] = packSupportCacheWord(img->dataSpace, img->blending);
+        key[i++] = packSupportCacheWord(img->transform, img->compressionInfo.type);
+        key[i++] = img->compressionInfo.modifier;
+        key[i++] = packSupportCacheWord(img->metaType,
+                                        (img->needColorTransform ? 0x1 : 0x0) |
+                                                (img->needPreblending ? 0x2 : 0x0));
+    }
+    key[i++] = packSupportCacheWord(display.mDisplayId, display.mType);
+    key[i++] = packSupportCacheWord(display.getBtsRefreshRate(), display.mYres);
+    key[i++] = packSupportCacheWord((mResourceManager && mResourceManager->hasHdrLayer) ? 1 : 0,
+                                    (mResourceManager && mResourceManager->hasDrmLayer) ? 1 : 0);
+
+    return key;
+}
+
+void ExynosMPP::invalidateSupportCache()
+{
+    Mutex::Autolock lock(mSupportCacheMutex);
+    mSupportCache.clear();
+}
+
 int64_t ExynosMPP::isSupported(ExynosDisplay &display, struct exynos_image &src, struct exynos_image &dst)
+{
+    SupportCacheKey key = makeSupportCacheKey(display, src, dst);
+
+    /* FNV-1a over the packed key */
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (uint64_t word : key) {
+        hash ^= word;
+        hash *= 0x100000001b3ULL;
+    }
+
+    {
+        Mutex::Autolock lock(mSupportCacheMutex);
+        auto it = mSupportCache.find(hash);
+        if ((it != mSupportCache.end()) && (it->second.key == key))
+            return it->second.result;
+    }
+
+    int64_t result = checkSupported(display, src, dst);
+
+    Mutex::Autolock lock(mSupportCacheMutex);
+    if (mSupportCache.size() >= kMaxSupportCacheSize)
+        mSupportCache.clear();
+    mSupportCache[hash] = {key, result};
+
+    return result;
+}
+
+int64_t ExynosMPP::checkSupported(ExynosDisplay &display, struct exynos_image &src,
+                                  struct exynos_image &dst)
 {
     uint32_t maxSrcWidth = getSrcMaxWidth(src);
     uint32_t maxSrcHeight = getSrcMaxHeight(src);
@@ -2423,22 +2495,22 @@ void ExynosMPP::getPPCIndex(const struct exynos_image &src,
     scaleIndex = 0;
 
     /* Compare SBWC, AFBC and 10bitYUV420 first! because can be overlapped with other format */
-    if (isFormatSBWC(criteria.format) && hasPPC(mPhysicalType, PPC_FORMAT_SBWC, PPC_ROT_NO))
+    if (isFormatSBWC(criteria.format) && mPPCTable.has(PPC_FORMAT_SBWC, PPC_ROT_NO))
         formatIndex = PPC_FORMAT_SBWC;
     else if (src.compressionInfo.type == COMP_TYPE_AFBC) {
-        if ((isFormatRgb(criteria.format)) && hasPPC(mPhysicalType, PPC_FORMAT_AFBC_RGB, PPC_ROT_NO))
+        if ((isFormatRgb(criteria.format)) && mPPCTable.has(PPC_FORMAT_AFBC_RGB, PPC_ROT_NO))
             formatIndex = PPC_FORMAT_AFBC_RGB;
-        else if ((isFormatYUV(criteria.format)) && hasPPC(mPhysicalType, PPC_FORMAT_AFBC_YUV, PPC_ROT_NO))
+        else if ((isFormatYUV(criteria.format)) && mPPCTable.has(PPC_FORMAT_AFBC_YUV, PPC_ROT_NO))
             formatIndex = PPC_FORMAT_AFBC_YUV;
         else {
             formatIndex = PPC_FORMAT_RGB32;
             MPP_LOGW("%s:: AFBC PPC is not existed. Use default PPC", __func__);
         }
-    } else if (isFormatP010(criteria.format) && hasPPC(mPhysicalType, PPC_FORMAT_P010, PPC_ROT_NO))
+    } else if (isFormatP010(criteria.format) && mPPCTable.has(PPC_FORMAT_P010, PPC_ROT_NO))
         formatIndex = PPC_FORMAT_P010;
-    else if (isFormatYUV420(criteria.format) && hasPPC(mPhysicalType, PPC_FORMAT_YUV420, PPC_ROT_NO))
+    else if (isFormatYUV420(criteria.format) && mPPCTable.has(PPC_FORMAT_YUV420, PPC_ROT_NO))
         formatIndex = PPC_FORMAT_YUV420;
-    else if (isFormatYUV422(criteria.format) && hasPPC(mPhysicalType, PPC_FORMAT_YUV422, PPC_ROT_NO))
+    else if (isFormatYUV422(criteria.format) && mPPCTable.has(PPC_FORMAT_YUV422, PPC_ROT_NO))
         formatIndex = PPC_FORMAT_YUV422;
     else
         formatIndex = PPC_FORMAT_RGB32;
@@ -2449,32 +2521,9 @@ void ExynosMPP::getPPCIndex(const struct exynos_image &src,
     else
         rotIndex = PPC_ROT_NO;
 
-    uint32_t srcResolution = src.w * src.h;
-    uint32_t dstResolution = dst.w * dst.h;
-
-    if (mPhysicalType == MPP_G2D) {
-        if (srcResolution == dstResolution) {
-            scaleIndex = PPC_SCALE_NO;
-        } else if (dstResolution > srcResolution) {
-            /* scale up case */
-            if (dstResolution >= (srcResolution * 4))
-                scaleIndex = PPC_SCALE_UP_4_;
-            else
-                scaleIndex = PPC_SCALE_UP_1_4;
-        } else {
-            /* scale down case */
-            if ((dstResolution * 16) <= srcResolution)
-                scaleIndex = PPC_SCALE_DOWN_16_;
-            else if (((dstResolution * 9) <= srcResolution) &&
-                    (srcResolution < (dstResolution * 16)))
-                scaleIndex = PPC_SCALE_DOWN_9_16;
-            else if (((dstResolution * 4) <= srcResolution) &&
-                    (srcResolution < (dstResolution * 9)))
-                scaleIndex = PPC_SCALE_DOWN_4_9;
-            else
-                scaleIndex = PPC_SCALE_DOWN_1_4;
-        }
-    } else scaleIndex = 0; /* MSC doesn't refer scale Index */
+    if (mPhysicalType == MPP_G2D)
+        scaleIndex = getPPCScaleIndex(src.w * src.h, dst.w * dst.h);
+    else scaleIndex = 0; /* MSC doesn't refer scale Index */
 }
 
 float ExynosMPP::getPPC(const struct exynos_image &src,
@@ -2495,8 +2544,8 @@ float ExynosMPP::getPPC(const struct exynos_image &src,
     }
 
     if (mPhysicalType == MPP_G2D || mPhysicalType == MPP_MSC) {
-        if (hasPPC(mPhysicalType, formatIndex, rotIndex)) {
-            PPC = ppc_table_map.at(PPC_IDX(mPhysicalType, formatIndex, rotIndex)).ppcList[scaleIndex];
+        if (const auto *entry = mPPCTable.find(formatIndex, rotIndex)) {
+            PPC = entry->ppcList[scaleIndex];
         }
     }
 
@@ -2955,6 +3004,7 @@ void ExynosMPP::updateAttr()
         mAttr = iter->second;
         MPP_LOGD(eDebugAttrSetting, "After mAttr(0x%" PRIx64 ")", mAttr);
     }
+    invalidateSupportCache();
 }
 
 void ExynosMPP::updatePreassignedDisplay(uint32_t fromDisplayBit, uint32_t toDisplayBit)
@@ -2970,4 +3020,6 @@ void ExynosMPP::updatePreassignedDisplay(uint32_t fromDisplayBit, uint32_t toDis
 
     if (mPreAssignDisplayInfo == fromDisplayBit)
         mPreAssignDisplayInfo = toDisplayBit;
+
+    invalidateSupportCache();
 }
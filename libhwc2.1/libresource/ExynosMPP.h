@@ -28,12 +28,15 @@
 #include <utils/StrongPointer.h>
 #include <utils/List.h>
 #include <utils/Vector.h>
+#include <array>
 #include <map>
 #include <hardware/exynos/acryl.h>
 #include <map>
+#include <unordered_map>
 #include "ExynosHWCModule.h"
 #include "ExynosHWCHelper.h"
 #include "ExynosMPPType.h"
+#include "PPCTable.h"
 
 class ExynosDisplay;
 class ExynosMPP;
@@ -244,40 +247,6 @@ typedef struct exynos_mpp_img_info {
     ExynosDisplay *assignedDisplay;
 } exynos_mpp_img_info_t;
 
-typedef enum {
-    PPC_SCALE_NO = 0,   /* no scale */
-    PPC_SCALE_DOWN_1_4, /* x1/1.xx ~ x1/4 */
-    PPC_SCALE_DOWN_4_9, /* x1/4 ~ x1/9 */
-    PPC_SCALE_DOWN_9_16, /* x1/9 ~ x1/16 */
-    PPC_SCALE_DOWN_16_,  /* x1/16 ~ */
-    PPC_SCALE_UP_1_4,   /* x1.xx ~ x4 */
-    PPC_SCALE_UP_4_,    /* x4 ~ */
-    PPC_SCALE_MAX
-} scaling_index_t;
-
-typedef enum {
-    PPC_FORMAT_YUV420   =   0,
-    PPC_FORMAT_YUV422,
-    PPC_FORMAT_RGB32,
-    PPC_FORMAT_SBWC,
-    PPC_FORMAT_P010,
-    PPC_FORMAT_AFBC_RGB,
-    PPC_FORMAT_AFBC_YUV,
-    PPC_FORMAT_FORMAT_MAX
-} format_index_t;
-
-typedef enum {
-    PPC_ROT_NO   =   0,
-    PPC_ROT,
-    PPC_ROT_MAX
-} rot_index_t;
-
-typedef struct ppc_list_for_scaling {
-    float ppcList[PPC_SCALE_MAX];
-} ppc_list_for_scaling_t;
-
-typedef std::map<uint32_t, ppc_list_for_scaling> ppc_table;
-
 typedef struct dstMetaInfo {
     uint16_t minLuminance = 0;
     uint16_t maxLuminance = 0;
@@ -363,10 +332,6 @@ typedef struct restriction_table_element
 } restriction_table_element_t;
 /* */
 
-#define FORMAT_SHIFT   10
-#define ROT_SHIFT   20
-#define PPC_IDX(x,y,z) (x|(y<<FORMAT_SHIFT)|(z<<ROT_SHIFT))
-
 const std::map<uint32_t, int32_t> dataspace_standard_map =
 {
     {HAL_DATASPACE_STANDARD_UNSPECIFIED,
@@ -592,6 +557,8 @@ public:
     int32_t requestHWStateChange(uint32_t state);
     int32_t setHWStateFence(int32_t fence);
     virtual int64_t isSupported(ExynosDisplay &display, struct exynos_image &src, struct exynos_image &dst);
+    /* Drops memoized isSupported() results when restrictions or attributes are changed */
+    void invalidateSupportCache();
 
     bool isDataspaceSupportedByMPP(struct exynos_image &src, struct exynos_image &dst);
     bool isSupportedHDR(struct exynos_image &src, struct exynos_image &dst);
@@ -731,6 +698,9 @@ protected:
             const struct exynos_image *assignCheckDst = NULL);
     float getPPC() { return mPPC; };
 
+    /* ppc_table_map entries of mPhysicalType */
+    PPCTable mPPCTable;
+
     /* format and rotation index are defined by indexImage */
     void getPPCIndex(const struct exynos_image &indexImage,
             const struct exynos_image &refImage,
@@ -754,6 +724,26 @@ protected:
 
     uint32_t mClockKhz = 0;
     float mPPC = 0;
+
+    /*
+     * isSupported() result depends only on the image geometry, formats,
+     * restrictions, attributes and a few display states. The result is
+     * memoized per MPP with the packed inputs as the key.
+     */
+    static constexpr size_t kSupportCacheKeySize = 21;
+    static constexpr size_t kMaxSupportCacheSize = 256;
+    typedef std::array<uint64_t, kSupportCacheKeySize> SupportCacheKey;
+    struct SupportCacheEntry {
+        SupportCacheKey key;
+        int64_t result;
+    };
+    SupportCacheKey makeSupportCacheKey(const ExynosDisplay &display,
+                                        const struct exynos_image &src,
+                                        const struct exynos_image &dst) const;
+    virtual int64_t checkSupported(ExynosDisplay &display, struct exynos_image &src,
+                                   struct exynos_image &dst);
+    Mutex mSupportCacheMutex;
+    std::unordered_map<uint64_t, SupportCacheEntry> mSupportCache;
 };
 
 #endif //_EXYNOSMPP_H
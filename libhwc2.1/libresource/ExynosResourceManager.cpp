@@ -421,16 +421,30 @@ int32_t ExynosResourceManager::assignResource(ExynosDisplay *display)
 
     }
 
-    if ((ret = updateSupportedMPPFlag(display)) != NO_ERROR) {
-        HWC_LOGE(display, "%s:: updateSupportedMPPFlag() error (%d)",
-                __func__, ret);
-        return ret;
-    }
+    uint64_t fingerprint = makeAssignFingerprint(display);
+    DisplayAssignRecord *prevRecord = findAssignRecord(display, fingerprint);
+    if ((prevRecord != nullptr) && (reuseAssignment(display, *prevRecord) == NO_ERROR)) {
+        HDEBUGLOGD(eDebugResourceManager | eDebugSkipResourceAssign,
+                   "%s:: reuse previous assignment, display(%d), fingerprint(0x%" PRIx64 ")",
+                   __func__, display->mDisplayId, fingerprint);
+    } else {
+        DisplayAssignRecord &record = addAssignRecord(display);
+        record.fingerprint = fingerprint;
+        saveAssignInputs(display, record);
 
-    if ((ret = assignResourceInternal(display)) != NO_ERROR) {
-        HWC_LOGE(display, "%s:: assignResourceInternal() error (%d)",
-                __func__, ret);
-        return ret;
+        if ((ret = updateSupportedMPPFlag(display)) != NO_ERROR) {
+            HWC_LOGE(display, "%s:: updateSupportedMPPFlag() error (%d)",
+                    __func__, ret);
+            return ret;
+        }
+
+        if ((ret = assignResourceInternal(display)) != NO_ERROR) {
+            HWC_LOGE(display, "%s:: assignResourceInternal() error (%d)",
+                    __func__, ret);
+            return ret;
+        }
+
+        saveAssignment(display, record);
     }
 
     if ((ret = assignWindow(display)) != NO_ERROR) {
@@ -482,6 +496,324 @@ int32_t ExynosResourceManager::assignResource(ExynosDisplay *display)
     return NO_ERROR;
 }
 
+/*
+ * Geometry changes that can't be covered by comparing layer inputs.
+ * Added or removed layers are covered since layer identity and count are compared.
+ */
+static constexpr uint64_t kAssignReuseBlockingGeometry = GEOMETRY_DISPLAY_CONFIG_CHANGED |
+        GEOMETRY_DISPLAY_RESOLUTION_CHANGED | GEOMETRY_DISPLAY_SINGLEBUF_CHANGED |
+        GEOMETRY_DISPLAY_FORCE_VALIDATE | GEOMETRY_DISPLAY_COLOR_MODE_CHANGED |
+        GEOMETRY_DISPLAY_DYNAMIC_RECOMPOSITION | GEOMETRY_DISPLAY_POWER_ON |
+        GEOMETRY_DISPLAY_POWER_OFF | GEOMETRY_DISPLAY_COLOR_TRANSFORM_CHANGED |
+        GEOMETRY_DISPLAY_DATASPACE_CHANGED | GEOMETRY_DEVICE_DISPLAY_ADDED |
+        GEOMETRY_DEVICE_DISPLAY_REMOVED | GEOMETRY_DEVICE_CONFIG_CHANGED |
+        GEOMETRY_DEVICE_DISP_MODE_CHAGED | GEOMETRY_DEVICE_SCENARIO_CHANGED | GEOMETRY_ERROR_CASE;
+
+static bool isSameAssignImage(const exynos_image &lhs, const exynos_image &rhs)
+{
+    return (lhs.fullWidth == rhs.fullWidth) && (lhs.fullHeight == rhs.fullHeight) &&
+            (lhs.x == rhs.x) && (lhs.y == rhs.y) && (lhs.w == rhs.w) && (lhs.h == rhs.h) &&
+            (lhs.format == rhs.format) && (lhs.usageFlags == rhs.usageFlags) &&
+            (lhs.layerFlags == rhs.layerFlags) &&
+            ((lhs.bufferHandle == NULL) == (rhs.bufferHandle == NULL)) &&
+            (lhs.dataSpace == rhs.dataSpace) && (lhs.blending == rhs.blending) &&
+            (lhs.transform == rhs.transform) &&
+            (lhs.compressionInfo.type == rhs.compressionInfo.type) &&
+            (lhs.compressionInfo.modifier == rhs.compressionInfo.modifier) &&
+            (lhs.planeAlpha == rhs.planeAlpha) && (lhs.zOrder == rhs.zOrder) &&
+            (lhs.hasMetaParcel == rhs.hasMetaParcel) && (lhs.metaType == rhs.metaType) &&
+            (lhs.needColorTransform == rhs.needColorTransform) &&
+            (lhs.needPreblending == rhs.needPreblending);
+}
+
+static bool isSameRect(const hwc_frect_t &lhs, const hwc_frect_t &rhs)
+{
+    return (lhs.left == rhs.left) && (lhs.top == rhs.top) && (lhs.right == rhs.right) &&
+            (lhs.bottom == rhs.bottom);
+}
+
+static bool isSameRect(const hwc_rect_t &lhs, const hwc_rect_t &rhs)
+{
+    return (lhs.left == rhs.left) && (lhs.top == rhs.top) && (lhs.right == rhs.right) &&
+            (lhs.bottom == rhs.bottom);
+}
+
+static inline void addAssignFingerprint(uint64_t &hash, uint64_t value)
+{
+    /* FNV-1a step */
+    hash ^= value;
+    hash *= 0x100000001b3ULL;
+}
+
+static inline uint64_t floatBits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static void addAssignFingerprint(uint64_t &hash, const exynos_image &img)
+{
+    addAssignFingerprint(hash, ((uint64_t)img.x << 32) | img.y);
+    addAssignFingerprint(hash, ((uint64_t)img.w << 32) | img.h);
+    addAssignFingerprint(hash, ((uint64_t)img.format << 32) | img.transform);
+    addAssignFingerprint(hash, ((uint64_t)img.dataSpace << 32) | img.blending);
+    addAssignFingerprint(hash, ((uint64_t)img.zOrder << 32) | floatBits(img.planeAlpha));
+    addAssignFingerprint(hash, img.compressionInfo.type);
+}
+
+void ExynosResourceManager::invalidateAssignment(ExynosDisplay *display)
+{
+    mAssignRecords.erase(display->mDisplayId);
+}
+
+/*
+ * Fingerprint of everything assignResourceInternal() depends on.
+ * It only selects a candidate record, which is fully compared before reuse.
+ */
+uint64_t ExynosResourceManager::makeAssignFingerprint(ExynosDisplay *display)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    addAssignFingerprint(hash, ((uint64_t)display->mColorTransformHint << 32) |
+                         (uint32_t)display->mColorMode);
+    addAssignFingerprint(hash, ((uint64_t)display->mDynamicReCompMode << 32) |
+                         display->mDREnable);
+    addAssignFingerprint(hash, ((uint64_t)exynosHWCControl.forceGpu << 32) | mResourceReserved);
+    addAssignFingerprint(hash, ((uint64_t)(uint32_t)display->mLowFpsLayerInfo.mFirstIndex << 32) |
+                         (uint32_t)display->mLowFpsLayerInfo.mLastIndex);
+    addAssignFingerprint(hash, display->mLayers.size());
+
+    for (uint32_t i = 0; i < display->mLayers.size(); i++) {
+        ExynosLayer *layer = display->mLayers[i];
+        exynos_image src_img;
+        exynos_image dst_img;
+        layer->setSrcExynosImage(&src_img);
+        layer->setDstExynosImage(&dst_img);
+
+        addAssignFingerprint(hash, (uint64_t)(uintptr_t)layer);
+        addAssignFingerprint(hash, ((uint64_t)layer->mCompositionType << 32) |
+                             layer->mOverlayPriority);
+        addAssignFingerprint(hash, floatBits(layer->mPreprocessedInfo.sdrDimRatio));
+        addAssignFingerprint(hash, src_img);
+        addAssignFingerprint(hash, dst_img);
+    }
+
+    return hash;
+}
+
+/*
+ * Returns the most recent record matching the current inputs of the display,
+ * which becomes the most recently used one. All records of the display are
+ * dropped on a geometry change that can't be compared.
+ */
+ExynosResourceManager::DisplayAssignRecord *ExynosResourceManager::findAssignRecord(
+        ExynosDisplay *display, uint64_t fingerprint)
+{
+    auto it = mAssignRecords.find(display->mDisplayId);
+    if (it == mAssignRecords.end())
+        return nullptr;
+
+    std::list<DisplayAssignRecord> &records = it->second;
+
+    if ((display->mGeometryChanged & kAssignReuseBlockingGeometry) ||
+        (mDevice->mGeometryChanged & kAssignReuseBlockingGeometry) ||
+        (mForceReallocState != DST_REALLOC_DONE)) {
+        records.clear();
+        return nullptr;
+    }
+
+    for (auto record = records.begin(); record != records.end(); record++) {
+        if ((record->valid == false) || (record->fingerprint != fingerprint) ||
+            (record->forceGpu != exynosHWCControl.forceGpu) ||
+            (record->resourceReserved != mResourceReserved) ||
+            (record->colorTransformHint != display->mColorTransformHint) ||
+            (record->colorMode != (int32_t)display->mColorMode) ||
+            (record->dynamicReCompMode != (int32_t)display->mDynamicReCompMode) ||
+            (record->dREnable != display->mDREnable) ||
+            (record->hasLowFpsLayer != display->mLowFpsLayerInfo.mHasLowFpsLayer) ||
+            (record->lowFpsFirstIndex != display->mLowFpsLayerInfo.mFirstIndex) ||
+            (record->lowFpsLastIndex != display->mLowFpsLayerInfo.mLastIndex) ||
+            (record->layers.size() != display->mLayers.size()))
+            continue;
+
+        records.splice(records.begin(), records, record);
+        return &records.front();
+    }
+
+    return nullptr;
+}
+
+ExynosResourceManager::DisplayAssignRecord &ExynosResourceManager::addAssignRecord(
+        ExynosDisplay *display)
+{
+    std::list<DisplayAssignRecord> &records = mAssignRecords[display->mDisplayId];
+
+    records.remove_if([](const DisplayAssignRecord &record) { return !record.valid; });
+    while (records.size() >= kMaxAssignRecords)
+        records.pop_back();
+
+    records.emplace_front();
+    return records.front();
+}
+
+/*
+ * Replays the result of a previous full assignment. Every MPP of the previous
+ * result is checked again for its assignable state and capacity, so the full
+ * path is taken whenever another display took the MPP in the meantime.
+ */
+int32_t ExynosResourceManager::reuseAssignment(ExynosDisplay *display,
+                                               DisplayAssignRecord &record)
+{
+    ATRACE_CALL();
+    int32_t ret = NO_ERROR;
+
+    Mutex::Autolock lock(mDstBufMgrThread->mStateMutex);
+
+    resetAssignedResources(display);
+
+    for (uint32_t i = 0; i < display->mLayers.size(); i++) {
+        ExynosLayer *layer = display->mLayers[i];
+        LayerAssignRecord &layerRecord = record.layers[i];
+
+        exynos_image src_img;
+        exynos_image dst_img;
+        layer->setSrcExynosImage(&src_img);
+        layer->setDstExynosImage(&dst_img);
+
+        if ((layerRecord.layer != layer) ||
+            (layerRecord.requestedType != layer->mCompositionType) ||
+            (layerRecord.overlayPriority != layer->mOverlayPriority) ||
+            (layerRecord.sdrDimRatio != layer->mPreprocessedInfo.sdrDimRatio) ||
+            !isSameRect(layerRecord.sourceCrop, layer->mPreprocessedInfo.sourceCrop) ||
+            !isSameRect(layerRecord.displayFrame, layer->mPreprocessedInfo.displayFrame) ||
+            !isSameAssignImage(layerRecord.srcImg, src_img) ||
+            !isSameAssignImage(layerRecord.dstImg, dst_img)) {
+            ret = EXYNOS_ERROR_CHANGED;
+            break;
+        }
+
+        layer->setExynosImage(src_img, dst_img);
+        layer->setExynosMidImage(dst_img);
+        layer->mSupportedMPPFlag = layerRecord.supportedMPPFlag;
+
+        if (layerRecord.validateType == HWC2_COMPOSITION_DEVICE) {
+            exynos_image otf_src_img = src_img;
+            if (layerRecord.m2mMPP != NULL) {
+                if (!isAssignable(layerRecord.m2mMPP, display, src_img, layerRecord.midImg,
+                                  layer)) {
+                    ret = eInsufficientMPP;
+                    break;
+                }
+                otf_src_img = layerRecord.midImg;
+            }
+            if ((layerRecord.otfMPP != NULL) &&
+                !isAssignable(layerRecord.otfMPP, display, otf_src_img, dst_img, layer)) {
+                ret = eInsufficientMPP;
+                break;
+            }
+            if ((layerRecord.otfMPP != NULL) &&
+                ((ret = layerRecord.otfMPP->assignMPP(display, layer)) != NO_ERROR))
+                break;
+            if (layerRecord.m2mMPP != NULL) {
+                if ((ret = layerRecord.m2mMPP->assignMPP(display, layer)) != NO_ERROR)
+                    break;
+                layer->setExynosMidImage(layerRecord.midImg);
+            }
+            display->mWindowNumUsed++;
+        }
+        layer->updateValidateCompositionType(layerRecord.validateType, layerRecord.overlayInfo);
+    }
+
+    if ((ret == NO_ERROR) && (display->mWindowNumUsed > display->mMaxWindowNum))
+        ret = eInsufficientWindow;
+
+    if (ret == NO_ERROR) {
+        if (record.assignedHasLowFpsLayer == false)
+            display->mLowFpsLayerInfo.initializeInfos();
+        display->mClientCompositionInfo.mHasCompositionLayer = record.hasClientComposition;
+        display->mClientCompositionInfo.mFirstIndex = record.clientFirstIndex;
+        display->mClientCompositionInfo.mLastIndex = record.clientLastIndex;
+        ret = assignCompositionTarget(display, COMPOSITION_CLIENT);
+    }
+
+    if (ret != NO_ERROR) {
+        HDEBUGLOGD(eDebugResourceManager, "%s:: previous assignment is not reusable (%d)",
+                   __func__, ret);
+        record.valid = false;
+        resetAssignedResources(display);
+        for (uint32_t i = 0; i < display->mLayers.size(); i++)
+            display->mLayers[i]->resetValidateData();
+        display->initializeValidateInfos();
+    }
+
+    return ret;
+}
+
+void ExynosResourceManager::saveAssignInputs(ExynosDisplay *display, DisplayAssignRecord &record)
+{
+    record.colorTransformHint = display->mColorTransformHint;
+    record.colorMode = (int32_t)display->mColorMode;
+    record.dynamicReCompMode = (int32_t)display->mDynamicReCompMode;
+    record.dREnable = display->mDREnable;
+    record.forceGpu = exynosHWCControl.forceGpu;
+    record.resourceReserved = mResourceReserved;
+    record.hasLowFpsLayer = display->mLowFpsLayerInfo.mHasLowFpsLayer;
+    record.lowFpsFirstIndex = display->mLowFpsLayerInfo.mFirstIndex;
+    record.lowFpsLastIndex = display->mLowFpsLayerInfo.mLastIndex;
+
+    record.layers.resize(display->mLayers.size());
+    for (uint32_t i = 0; i < display->mLayers.size(); i++) {
+        ExynosLayer *layer = display->mLayers[i];
+        LayerAssignRecord &layerRecord = record.layers[i];
+        layerRecord.layer = layer;
+        layerRecord.requestedType = layer->mCompositionType;
+        layerRecord.overlayPriority = layer->mOverlayPriority;
+        layerRecord.sdrDimRatio = layer->mPreprocessedInfo.sdrDimRatio;
+        layerRecord.sourceCrop = layer->mPreprocessedInfo.sourceCrop;
+        layerRecord.displayFrame = layer->mPreprocessedInfo.displayFrame;
+        layer->setSrcExynosImage(&layerRecord.srcImg);
+        layer->setDstExynosImage(&layerRecord.dstImg);
+    }
+}
+
+/*
+ * Only results that don't depend on G2D state are saved.
+ * Exynos composition is prioritized every frame by setResourcePriority().
+ */
+void ExynosResourceManager::saveAssignment(ExynosDisplay *display, DisplayAssignRecord &record)
+{
+    record.valid = false;
+
+    if ((display->mUseDpu == false) || (display->mExynosCompositionInfo.mHasCompositionLayer))
+        return;
+
+    for (uint32_t i = 0; i < display->mLayers.size(); i++) {
+        ExynosLayer *layer = display->mLayers[i];
+        LayerAssignRecord &layerRecord = record.layers[i];
+        int32_t type = layer->getValidateCompositionType();
+
+        if ((type != HWC2_COMPOSITION_DEVICE) && (type != HWC2_COMPOSITION_CLIENT) &&
+            (type != HWC2_COMPOSITION_DISPLAY_DECORATION))
+            return;
+        if ((layer->mM2mMPP != NULL) && (layer->mM2mMPP->mPhysicalType == MPP_G2D))
+            return;
+
+        layerRecord.validateType = type;
+        layerRecord.overlayInfo = layer->mOverlayInfo;
+        layerRecord.supportedMPPFlag = layer->mSupportedMPPFlag;
+        layerRecord.otfMPP = layer->mOtfMPP;
+        layerRecord.m2mMPP = layer->mM2mMPP;
+        layerRecord.midImg = layer->mMidImg;
+    }
+
+    record.assignedHasLowFpsLayer = display->mLowFpsLayerInfo.mHasLowFpsLayer;
+    record.hasClientComposition = display->mClientCompositionInfo.mHasCompositionLayer;
+    record.clientFirstIndex = display->mClientCompositionInfo.mFirstIndex;
+    record.clientLastIndex = display->mClientCompositionInfo.mLastIndex;
+    record.valid = true;
+}
+
 int32_t ExynosResourceManager::setResourcePriority(ExynosDisplay *display)
 {
     int ret = NO_ERROR;
@@ -2362,6 +2694,7 @@ void ExynosResourceManager::enableMPP(uint32_t physicalType, uint32_t physicalIn
             (mOtfMPPs[i]->mPhysicalIndex == physicalIndex) &&
             (mOtfMPPs[i]->mLogicalIndex == logicalIndex)) {
             mOtfMPPs[i]->mEnable = !!(enable);
+            mOtfMPPs[i]->invalidateSupportCache();
             return;
         }
     }
@@ -2371,6 +2704,7 @@ void ExynosResourceManager::enableMPP(uint32_t physicalType, uint32_t physicalIn
             (mM2mMPPs[i]->mPhysicalIndex == physicalIndex) &&
             (mM2mMPPs[i]->mLogicalIndex == logicalIndex)) {
             mM2mMPPs[i]->mEnable = !!(enable);
+            mM2mMPPs[i]->invalidateSupportCache();
             return;
         }
     }
@@ -2405,11 +2739,29 @@ void ExynosResourceManager::setScaleDownRatio(uint32_t physicalType,
     for (uint32_t i = RESTRICTION_RGB; i < RESTRICTION_MAX; i++) {
         findMpp->mDstSizeRestrictions[i].maxDownScale = scaleDownRatio;
     }
+    findMpp->invalidateSupportCache();
 }
 
 int32_t ExynosResourceManager::prepareResources(const int32_t willOnDispId) {
     int ret = NO_ERROR;
     HDEBUGLOGD(eDebugResourceManager, "This is first validate");
+
+    /*
+     * Displays skip planes reserved to other displays when disabling unused
+     * planes, so any reservation change invalidates their committed masks.
+     */
+    auto otfReservations = [this]() {
+        constexpr int32_t kNotReserved = -2;
+        std::vector<int32_t> reservations;
+        reservations.reserve(mOtfMPPs.size());
+        for (auto& mpp : mOtfMPPs)
+            reservations.push_back((mpp->mAssignedState & MPP_ASSIGN_STATE_RESERVED)
+                                           ? mpp->mReservedDisplay
+                                           : kNotReserved);
+        return reservations;
+    };
+    const std::vector<int32_t> prevReservations = otfReservations();
+
     if ((ret = resetResources()) != NO_ERROR) {
         HWC_LOGE(NULL,"%s:: resetResources() error (%d)",
                 __func__, ret);
@@ -2429,6 +2781,13 @@ int32_t ExynosResourceManager::prepareResources(const int32_t willOnDispId) {
         return ret;
     }
 
+    if (otfReservations() != prevReservations) {
+        for (auto display : mDevice->mDisplays) {
+            if ((display != nullptr) && (display->mDisplayInterface != nullptr))
+                display->mDisplayInterface->invalidateCommittedPlaneMask();
+        }
+    }
+
     setDisplaysTDMInfo(mainDisp, minorDisp);
 
     return ret;
@@ -2468,6 +2827,14 @@ int32_t ExynosResourceManager::initResourcesState(ExynosDisplay *display)
     return NO_ERROR;
 }
 
+void ExynosResourceManager::invalidateSupportCaches()
+{
+    for (uint32_t i = 0; i < mOtfMPPs.size(); i++)
+        mOtfMPPs[i]->invalidateSupportCache();
+    for (uint32_t i = 0; i < mM2mMPPs.size(); i++)
+        mM2mMPPs[i]->invalidateSupportCache();
+}
+
 void ExynosResourceManager::makeSizeRestrictions(uint32_t mppId, const restriction_size_t &size,
                                                  restriction_classification_t format) {
     mSizeRestrictions[format][mSizeRestrictionCnt[format]].key.hwType = static_cast<mpp_phycal_type_t>(mppId);
@@ -2482,6 +2849,8 @@ void ExynosResourceManager::makeSizeRestrictions(uint32_t mppId, const restricti
     mSizeRestrictions[format][mSizeRestrictionCnt[format]].key.reserved = 0;
     mSizeRestrictions[format][mSizeRestrictionCnt[format]++].sizeRestriction = size;
 
+    invalidateSupportCaches();
+
     HDEBUGLOGD(eDebugDefault, "MPP : %s, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d",
             getMPPStr(mppId).c_str(),
             size.maxDownScale,
@@ -2505,6 +2874,7 @@ void ExynosResourceManager::makeSizeRestrictions(uint32_t mppId, const restricti
 void ExynosResourceManager::makeFormatRestrictions(restriction_key_t table) {
 
     mFormatRestrictions[mFormatRestrictionCnt] = table;
+    invalidateSupportCaches();
 
     HDEBUGLOGD(eDebugDefault, "MPP : %s, %d, %s, %d",
                getMPPStr(mFormatRestrictions[mFormatRestrictionCnt].hwType).c_str(),
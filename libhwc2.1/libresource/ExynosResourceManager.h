@@ -21,6 +21,7 @@
 #ifndef _EXYNOSRESOURCEMANAGER_H
 #define _EXYNOSRESOURCEMANAGER_H
 
+#include <list>
 #include <unordered_map>
 #include "ExynosDevice.h"
 #include "ExynosDisplay.h"
@@ -32,6 +33,7 @@ using namespace android;
 
 class ExynosDevice;
 class ExynosDisplay;
+class ExynosLayer;
 class ExynosMPP;
 
 #define ASSIGN_RESOURCE_TRY_COUNT   100
@@ -159,6 +161,7 @@ class ExynosResourceManager {
         int32_t prepareResources(const int32_t willOnDispId = -1);
         int32_t finishAssignResourceWork();
         int32_t initResourcesState(ExynosDisplay *display);
+        void invalidateAssignment(ExynosDisplay *display);
 
         uint32_t getOtfMPPSize() {return (uint32_t)mOtfMPPs.size();};
         ExynosMPP* getOtfMPP(uint32_t index) {return mOtfMPPs[index];};
@@ -170,6 +173,7 @@ class ExynosResourceManager {
         void makeSizeRestrictions(uint32_t mppId, const restriction_size_t &size,
                                   restriction_classification_t format);
         void makeFormatRestrictions(restriction_key_t table);
+        void invalidateSupportCaches();
 
         void updateRestrictions();
 
@@ -193,6 +197,58 @@ class ExynosResourceManager {
                                               ExynosMPP* m2mMPP, ExynosMPP* otfMPP);
         void dump(const restriction_classification_t, String8 &result) const;
 
+        /*
+         * Inputs and results of recent full resource assignments of a display.
+         * When the layer stack matches one of them, the result is replayed
+         * instead of searching MPPs for every layer again.
+         */
+        struct LayerAssignRecord {
+            ExynosLayer *layer = nullptr;
+            int32_t requestedType = HWC2_COMPOSITION_INVALID;
+            uint32_t overlayPriority = 0;
+            hwc_frect_t sourceCrop;
+            hwc_rect_t displayFrame;
+            float sdrDimRatio = 1.0f;
+            exynos_image srcImg;
+            exynos_image dstImg;
+
+            int32_t validateType = HWC2_COMPOSITION_INVALID;
+            uint32_t overlayInfo = 0;
+            uint32_t supportedMPPFlag = 0;
+            ExynosMPP *otfMPP = nullptr;
+            ExynosMPP *m2mMPP = nullptr;
+            exynos_image midImg;
+        };
+        struct DisplayAssignRecord {
+            bool valid = false;
+            uint64_t fingerprint = 0;
+            int32_t colorTransformHint = 0;
+            int32_t colorMode = 0;
+            int32_t dynamicReCompMode = 0;
+            bool dREnable = false;
+            uint32_t forceGpu = 0;
+            uint32_t resourceReserved = 0;
+            /* low fps layer range before and after the assignment */
+            bool hasLowFpsLayer = false;
+            int32_t lowFpsFirstIndex = -1;
+            int32_t lowFpsLastIndex = -1;
+            bool assignedHasLowFpsLayer = false;
+            bool hasClientComposition = false;
+            int32_t clientFirstIndex = -1;
+            int32_t clientLastIndex = -1;
+            std::vector<LayerAssignRecord> layers;
+        };
+        /* Most recently used first */
+        static constexpr size_t kMaxAssignRecords = 4;
+        std::map<uint32_t, std::list<DisplayAssignRecord>> mAssignRecords;
+
+        uint64_t makeAssignFingerprint(ExynosDisplay *display);
+        DisplayAssignRecord *findAssignRecord(ExynosDisplay *display, uint64_t fingerprint);
+        DisplayAssignRecord &addAssignRecord(ExynosDisplay *display);
+        int32_t reuseAssignment(ExynosDisplay *display, DisplayAssignRecord &record);
+        void saveAssignInputs(ExynosDisplay *display, DisplayAssignRecord &record);
+        void saveAssignment(ExynosDisplay *display, DisplayAssignRecord &record);
+
         sp<DstBufMgrThread> mDstBufMgrThread;
 
     protected:
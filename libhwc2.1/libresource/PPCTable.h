@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PPCTABLE_H
+#define _PPCTABLE_H
+
+#include <array>
+#include <cstdint>
+#include <map>
+
+typedef enum {
+    PPC_SCALE_NO = 0,   /* no scale */
+    PPC_SCALE_DOWN_1_4, /* x1/1.xx ~ x1/4 */
+    PPC_SCALE_DOWN_4_9, /* x1/4 ~ x1/9 */
+    PPC_SCALE_DOWN_9_16, /* x1/9 ~ x1/16 */
+    PPC_SCALE_DOWN_16_,  /* x1/16 ~ */
+    PPC_SCALE_UP_1_4,   /* x1.xx ~ x4 */
+    PPC_SCALE_UP_4_,    /* x4 ~ */
+    PPC_SCALE_MAX
+} scaling_index_t;
+
+typedef enum {
+    PPC_FORMAT_YUV420   =   0,
+    PPC_FORMAT_YUV422,
+    PPC_FORMAT_RGB32,
+    PPC_FORMAT_SBWC,
+    PPC_FORMAT_P010,
+    PPC_FORMAT_AFBC_RGB,
+    PPC_FORMAT_AFBC_YUV,
+    PPC_FORMAT_FORMAT_MAX
+} format_index_t;
+
+typedef enum {
+    PPC_ROT_NO   =   0,
+    PPC_ROT,
+    PPC_ROT_MAX
+} rot_index_t;
+
+typedef struct ppc_list_for_scaling {
+    float ppcList[PPC_SCALE_MAX];
+} ppc_list_for_scaling_t;
+
+typedef std::map<uint32_t, ppc_list_for_scaling> ppc_table;
+
+/* Defined after ExynosHWCHelper.h is included, its format_type also has a FORMAT_SHIFT */
+#define FORMAT_SHIFT   10
+#define ROT_SHIFT   20
+#define PPC_IDX(x,y,z) (x|(y<<FORMAT_SHIFT)|(z<<ROT_SHIFT))
+
+/*
+ * The ppc_table entries of one physical type, resolved once into a
+ * [format][rotation] array so that capacity checks don't search the map.
+ */
+class PPCTable {
+public:
+    PPCTable() = default;
+    PPCTable(const ppc_table &table, uint32_t physicalType) {
+        for (uint32_t formatIndex = 0; formatIndex < PPC_FORMAT_FORMAT_MAX; formatIndex++) {
+            for (uint32_t rotIndex = 0; rotIndex < PPC_ROT_MAX; rotIndex++) {
+                auto it = table.find(PPC_IDX(physicalType, formatIndex, rotIndex));
+                mEntries[formatIndex][rotIndex] = (it != table.end()) ? &it->second : nullptr;
+            }
+        }
+    }
+
+    /* Returns nullptr if the table has no entry for the format and rotation */
+    const ppc_list_for_scaling_t *find(uint32_t formatIndex, uint32_t rotIndex) const {
+        if ((formatIndex >= PPC_FORMAT_FORMAT_MAX) || (rotIndex >= PPC_ROT_MAX))
+            return nullptr;
+        return mEntries[formatIndex][rotIndex];
+    }
+    bool has(uint32_t formatIndex, uint32_t rotIndex) const {
+        return find(formatIndex, rotIndex) != nullptr;
+    }
+
+private:
+    std::array<std::array<const ppc_list_for_scaling_t *, PPC_ROT_MAX>, PPC_FORMAT_FORMAT_MAX>
+            mEntries = {};
+};
+
+/* Scale index of a G2D operation from its source and destination resolution */
+inline uint32_t getPPCScaleIndex(uint32_t srcResolution, uint32_t dstResolution)
+{
+    if (srcResolution == dstResolution)
+        return PPC_SCALE_NO;
+
+    if (dstResolution > srcResolution) {
+        /* scale up case */
+        if (dstResolution >= (srcResolution * 4))
+            return PPC_SCALE_UP_4_;
+        return PPC_SCALE_UP_1_4;
+    }
+
+    /* scale down case */
+    if ((dstResolution * 16) <= srcResolution)
+        return PPC_SCALE_DOWN_16_;
+    if ((dstResolution * 9) <= srcResolution)
+        return PPC_SCALE_DOWN_9_16;
+    if ((dstResolution * 4) <= srcResolution)
+        return PPC_SCALE_DOWN_4_9;
+    return PPC_SCALE_DOWN_1_4;
+}
+
+#endif
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "PPCTable.h"
+
+namespace {
+
+/* Physical types only matter as keys, so these need not match mpp_phycal_type_t */
+constexpr uint32_t kMsc = 14;
+constexpr uint32_t kG2d = 15;
+constexpr uint32_t kDpp = 3;
+
+/* Shaped like the SoC tables: G2D has most formats, MSC only a few */
+const ppc_table kPPCTable = {
+        {PPC_IDX(kG2d, PPC_FORMAT_YUV420, PPC_ROT_NO), {{3.8, 3.8, 3.8, 3.8, 3.8, 1.0, 1.0}}},
+        {PPC_IDX(kG2d, PPC_FORMAT_YUV420, PPC_ROT), {{3.6, 3.6, 3.6, 3.6, 3.6, 1.0, 1.0}}},
+        {PPC_IDX(kG2d, PPC_FORMAT_YUV422, PPC_ROT_NO), {{3.8, 3.8, 3.8, 3.8, 3.8, 1.0, 1.0}}},
+        {PPC_IDX(kG2d, PPC_FORMAT_RGB32, PPC_ROT_NO), {{3.8, 3.8, 3.8, 3.8, 3.8, 1.0, 1.0}}},
+        {PPC_IDX(kG2d, PPC_FORMAT_RGB32, PPC_ROT), {{2.0, 2.0, 2.0, 2.0, 2.0, 1.0, 1.0}}},
+        {PPC_IDX(kG2d, PPC_FORMAT_SBWC, PPC_ROT_NO), {{2.8, 2.8, 2.8, 2.8, 2.8, 1.0, 1.0}}},
+        {PPC_IDX(kG2d, PPC_FORMAT_AFBC_RGB, PPC_ROT), {{3.0, 3.0, 3.0, 3.0, 3.0, 1.0, 1.0}}},
+        {PPC_IDX(kMsc, PPC_FORMAT_YUV420, PPC_ROT_NO), {{2.2, 0, 0, 0, 0, 0, 0}}},
+        {PPC_IDX(kMsc, PPC_FORMAT_RGB32, PPC_ROT), {{1.2, 0, 0, 0, 0, 0, 0}}},
+        {PPC_IDX(kMsc, PPC_FORMAT_AFBC_YUV, PPC_ROT_NO), {{1.6, 0, 0, 0, 0, 0, 0}}},
+};
+
+} // namespace
+
+TEST(PPCTableTest, MatchesMapLookups) {
+    for (uint32_t physicalType : {kMsc, kG2d, kDpp}) {
+        PPCTable table(kPPCTable, physicalType);
+        for (uint32_t formatIndex = 0; formatIndex < PPC_FORMAT_FORMAT_MAX; formatIndex++) {
+            for (uint32_t rotIndex = 0; rotIndex < PPC_ROT_MAX; rotIndex++) {
+                auto it = kPPCTable.find(PPC_IDX(physicalType, formatIndex, rotIndex));
+                const ppc_list_for_scaling_t *expected =
+                        (it != kPPCTable.end()) ? &it->second : nullptr;
+                EXPECT_EQ(table.find(formatIndex, rotIndex), expected)
+                        << "type " << physicalType << ", format " << formatIndex << ", rot "
+                        << rotIndex;
+                EXPECT_EQ(table.has(formatIndex, rotIndex), expected != nullptr);
+            }
+        }
+    }
+}
+
+TEST(PPCTableTest, ReadsTheEntryOfItsOwnType) {
+    PPCTable g2d(kPPCTable, kG2d);
+    PPCTable msc(kPPCTable, kMsc);
+
+    ASSERT_TRUE(g2d.has(PPC_FORMAT_YUV420, PPC_ROT_NO));
+    EXPECT_FLOAT_EQ(g2d.find(PPC_FORMAT_YUV420, PPC_ROT_NO)->ppcList[PPC_SCALE_UP_4_], 1.0);
+    ASSERT_TRUE(msc.has(PPC_FORMAT_YUV420, PPC_ROT_NO));
+    EXPECT_FLOAT_EQ(msc.find(PPC_FORMAT_YUV420, PPC_ROT_NO)->ppcList[PPC_SCALE_NO], 2.2);
+
+    /* Entries of the other type are not picked up */
+    EXPECT_FALSE(g2d.has(PPC_FORMAT_AFBC_YUV, PPC_ROT_NO));
+    EXPECT_FALSE(msc.has(PPC_FORMAT_YUV422, PPC_ROT_NO));
+}
+
+TEST(PPCTableTest, EmptyAndOutOfRangeHaveNoEntry) {
+    PPCTable empty;
+    PPCTable g2d(kPPCTable, kG2d);
+
+    for (uint32_t formatIndex = 0; formatIndex < PPC_FORMAT_FORMAT_MAX; formatIndex++) {
+        for (uint32_t rotIndex = 0; rotIndex < PPC_ROT_MAX; rotIndex++) {
+            EXPECT_FALSE(empty.has(formatIndex, rotIndex));
+        }
+    }
+    EXPECT_EQ(g2d.find(PPC_FORMAT_FORMAT_MAX, PPC_ROT_NO), nullptr);
+    EXPECT_EQ(g2d.find(PPC_FORMAT_RGB32, PPC_ROT_MAX), nullptr);
+}
+
+TEST(PPCTableTest, ScaleIndexBuckets) {
+    constexpr uint32_t kSrc = 1920 * 1080;
+
+    EXPECT_EQ(getPPCScaleIndex(kSrc, kSrc), PPC_SCALE_NO);
+
+    EXPECT_EQ(getPPCScaleIndex(kSrc, kSrc + 1), PPC_SCALE_UP_1_4);
+    EXPECT_EQ(getPPCScaleIndex(kSrc, kSrc * 4 - 1), PPC_SCALE_UP_1_4);
+    EXPECT_EQ(getPPCScaleIndex(kSrc, kSrc * 4), PPC_SCALE_UP_4_);
+
+    EXPECT_EQ(getPPCScaleIndex(kSrc, kSrc - 1), PPC_SCALE_DOWN_1_4);
+    EXPECT_EQ(getPPCScaleIndex(kSrc, kSrc / 4 + 1), PPC_SCALE_DOWN_1_4);
+    EXPECT_EQ(getPPCScaleIndex(kSrc, kSrc / 4), PPC_SCALE_DOWN_4_9);
+    EXPECT_EQ(getPPCScaleIndex(kSrc, kSrc / 9 + 1), PPC_SCALE_DOWN_4_9);
+    EXPECT_EQ(getPPCScaleIndex(kSrc, kSrc / 9), PPC_SCALE_DOWN_9_16);
+    EXPECT_EQ(getPPCScaleIndex(kSrc, kSrc / 16 + 1), PPC_SCALE_DOWN_9_16);
+    EXPECT_EQ(getPPCScaleIndex(kSrc, kSrc / 16), PPC_SCALE_DOWN_16_);
+    EXPECT_EQ(getPPCScaleIndex(kSrc, 1), PPC_SCALE_DOWN_16_);
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace android::hardware::graphics::composer {
+
+// Source of time for the VRR controller, its refresh rate calculators and statistics. They read the
+// time through getSteadyClockTimeNs() and friends, and time their waits through waitFor(), so
+// installing a virtual clock with setClock() lets a host simulation replay present and vsync
+// traces deterministically, without sleeping.
+class Clock {
+public:
+    virtual ~Clock() = default;
+
+    virtual int64_t getSteadyClockTimeNs() const = 0;
+    virtual int64_t getBootClockTimeNs() const = 0;
+
+    // Blocks until |condition| is notified or |durationNs| of this clock's time elapses.
+    virtual std::cv_status waitFor(std::condition_variable& condition,
+                                   std::unique_lock<std::mutex>& lock, int64_t durationNs) = 0;
+};
+
+class SystemClock : public Clock {
+public:
+    int64_t getSteadyClockTimeNs() const override;
+    int64_t getBootClockTimeNs() const override;
+
+    std::cv_status waitFor(std::condition_variable& condition, std::unique_lock<std::mutex>& lock,
+                           int64_t durationNs) override {
+        return condition.wait_for(lock, std::chrono::nanoseconds(durationNs));
+    }
+};
+
+Clock& getClock();
+
+// Installs |clock| as the time source, nullptr restores the system clock. The clock must outlive
+// every VRR controller that reads it.
+void setClock(Clock* clock);
+
+} // namespace android::hardware::graphics::composer
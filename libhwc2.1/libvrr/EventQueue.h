@@ -16,62 +16,251 @@
 
 #pragma once
 
-#include <queue>
+#include <algorithm>
+#include <map>
+#include <vector>
 
 #include "interface/Event.h"
 
 namespace android::hardware::graphics::composer {
 
+// Indexed binary heap of events ordered by mWhenNs, events due at the same time are popped in the
+// order they were posted. Every event keeps its heap position in a slot, and the slots of each
+// event type are linked together, so an event can be cancelled by handle in O(log n) and the
+// events of a type in O(k log n) without rebuilding the queue.
 struct EventQueue {
 public:
+    using Handle = uint64_t;
+    static constexpr Handle kInvalidHandle = 0;
+
     EventQueue() = default;
 
-    void postEvent(VrrControllerEventType type, TimedEvent& timedEvent) {
+    Handle postEvent(VrrControllerEventType type, TimedEvent& timedEvent) {
         VrrControllerEvent event;
         event.mEventType = type;
         setTimedEventWithAbsoluteTime(timedEvent);
         event.mWhenNs = timedEvent.mWhenNs;
         event.mFunctor = std::move(timedEvent.mFunctor);
-        mPriorityQueue.emplace(event);
+        return postEvent(std::move(event));
     }
 
-    void postEvent(VrrControllerEventType type, int64_t when) {
+    Handle postEvent(VrrControllerEventType type, int64_t when) {
         VrrControllerEvent event;
         event.mEventType = type;
         event.mWhenNs = when;
-        mPriorityQueue.emplace(event);
+        return postEvent(std::move(event));
     }
 
-    void dropEvent() { mPriorityQueue = std::priority_queue<VrrControllerEvent>(); }
+    Handle postEvent(VrrControllerEvent event) {
+        uint32_t slotIndex;
+        if (mFreeSlots.empty()) {
+            slotIndex = mSlots.size();
+            mSlots.emplace_back();
+        } else {
+            slotIndex = mFreeSlots.back();
+            mFreeSlots.pop_back();
+        }
+        Slot& slot = mSlots[slotIndex];
+        slot.mHeapIndex = mHeap.size();
+        slot.mType = event.mEventType;
+        linkType(slotIndex);
+
+        mHeap.push_back({std::move(event), mNextSequence++, slotIndex});
+        siftUp(mHeap.size() - 1);
+        return makeHandle(slotIndex, slot.mGeneration);
+    }
+
+    bool empty() const { return mHeap.empty(); }
+
+    size_t size() const { return mHeap.size(); }
+
+    // The earliest event, the queue should not be empty.
+    const VrrControllerEvent& top() const { return mHeap.front().mEvent; }
 
-    void dropEvent(VrrControllerEventType event_type) {
-        std::priority_queue<VrrControllerEvent> q;
-        while (!mPriorityQueue.empty()) {
-            const auto& it = mPriorityQueue.top();
-            if (it.mEventType != event_type) {
-                q.push(it);
+    VrrControllerEvent pop() {
+        VrrControllerEvent event = std::move(mHeap.front().mEvent);
+        removeAt(0);
+        return event;
+    }
+
+    // Returns false if the event has already been popped or dropped.
+    bool dropEvent(Handle handle) {
+        uint32_t slotIndex = static_cast<uint32_t>(handle);
+        if ((handle == kInvalidHandle) || (slotIndex >= mSlots.size()) ||
+            (mSlots[slotIndex].mGeneration != static_cast<uint32_t>(handle >> 32)) ||
+            (mSlots[slotIndex].mHeapIndex == kNone)) {
+            return false;
+        }
+        removeAt(mSlots[slotIndex].mHeapIndex);
+        return true;
+    }
+
+    void dropEvent() {
+        while (!mHeap.empty()) {
+            removeAt(mHeap.size() - 1);
+        }
+    }
+
+    void dropEvent(VrrControllerEventType eventType) {
+        auto it = mTypes.find(eventType);
+        if (it == mTypes.end()) return;
+        while (it->second.mHead != kNone) {
+            removeAt(mSlots[it->second.mHead].mHeapIndex);
+        }
+    }
+
+    // Drops the events whose type contains every bit of mask, such as all events of
+    // kGeneralEventMask.
+    void dropEventWithMask(VrrControllerEventType mask) {
+        const auto target = static_cast<int>(mask);
+        for (auto& [type, list] : mTypes) {
+            if ((static_cast<int>(type) & target) != target) continue;
+            while (list.mHead != kNone) {
+                removeAt(mSlots[list.mHead].mHeapIndex);
             }
-            mPriorityQueue.pop();
         }
-        mPriorityQueue = std::move(q);
     }
 
-    size_t getNumberOfEvents(VrrControllerEventType eventType) {
-        size_t res = 0;
-        std::priority_queue<VrrControllerEvent> q;
-        while (!mPriorityQueue.empty()) {
-            const auto& it = mPriorityQueue.top();
-            if (it.mEventType == eventType) {
-                ++res;
+    size_t getNumberOfEvents(VrrControllerEventType eventType) const {
+        auto it = mTypes.find(eventType);
+        return (it == mTypes.end()) ? 0 : it->second.mCount;
+    }
+
+    // Visits the events in the order they will be popped.
+    template <typename Visitor>
+    void forEachEvent(Visitor&& visitor) const {
+        std::vector<const Entry*> entries;
+        entries.reserve(mHeap.size());
+        for (const auto& entry : mHeap) {
+            entries.push_back(&entry);
+        }
+        std::sort(entries.begin(), entries.end(),
+                  [](const Entry* lhs, const Entry* rhs) { return isEarlier(*lhs, *rhs); });
+        for (const auto* entry : entries) {
+            visitor(entry->mEvent);
+        }
+    }
+
+private:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    struct Entry {
+        VrrControllerEvent mEvent;
+        uint64_t mSequence;
+        uint32_t mSlot;
+    };
+
+    struct Slot {
+        uint32_t mHeapIndex = kNone;
+        // Increased on every reuse of the slot, so stale handles don't match.
+        uint32_t mGeneration = 1;
+        VrrControllerEventType mType;
+        uint32_t mPrevOfType = kNone;
+        uint32_t mNextOfType = kNone;
+    };
+
+    struct TypeList {
+        uint32_t mHead = kNone;
+        size_t mCount = 0;
+    };
+
+    static Handle makeHandle(uint32_t slotIndex, uint32_t generation) {
+        return (static_cast<Handle>(generation) << 32) | slotIndex;
+    }
+
+    static bool isEarlier(const Entry& lhs, const Entry& rhs) {
+        if (lhs.mEvent.mWhenNs != rhs.mEvent.mWhenNs) {
+            return lhs.mEvent.mWhenNs < rhs.mEvent.mWhenNs;
+        }
+        return lhs.mSequence < rhs.mSequence;
+    }
+
+    void linkType(uint32_t slotIndex) {
+        Slot& slot = mSlots[slotIndex];
+        TypeList& list = mTypes[slot.mType];
+        slot.mPrevOfType = kNone;
+        slot.mNextOfType = list.mHead;
+        if (list.mHead != kNone) {
+            mSlots[list.mHead].mPrevOfType = slotIndex;
+        }
+        list.mHead = slotIndex;
+        ++list.mCount;
+    }
+
+    void unlinkType(uint32_t slotIndex) {
+        Slot& slot = mSlots[slotIndex];
+        TypeList& list = mTypes[slot.mType];
+        if (slot.mPrevOfType != kNone) {
+            mSlots[slot.mPrevOfType].mNextOfType = slot.mNextOfType;
+        } else {
+            list.mHead = slot.mNextOfType;
+        }
+        if (slot.mNextOfType != kNone) {
+            mSlots[slot.mNextOfType].mPrevOfType = slot.mPrevOfType;
+        }
+        --list.mCount;
+    }
+
+    void removeAt(size_t heapIndex) {
+        uint32_t slotIndex = mHeap[heapIndex].mSlot;
+        unlinkType(slotIndex);
+        Slot& slot = mSlots[slotIndex];
+        slot.mHeapIndex = kNone;
+        ++slot.mGeneration;
+        mFreeSlots.push_back(slotIndex);
+
+        size_t last = mHeap.size() - 1;
+        if (heapIndex != last) {
+            moveEntry(last, heapIndex);
+        }
+        mHeap.pop_back();
+        if (heapIndex < mHeap.size()) {
+            siftDown(siftUp(heapIndex));
+        }
+    }
+
+    void moveEntry(size_t from, size_t to) {
+        mHeap[to] = std::move(mHeap[from]);
+        mSlots[mHeap[to].mSlot].mHeapIndex = to;
+    }
+
+    size_t siftUp(size_t index) {
+        if (index == 0) return index;
+        Entry entry = std::move(mHeap[index]);
+        while (index > 0) {
+            size_t parent = (index - 1) / 2;
+            if (!isEarlier(entry, mHeap[parent])) break;
+            moveEntry(parent, index);
+            index = parent;
+        }
+        mHeap[index] = std::move(entry);
+        mSlots[mHeap[index].mSlot].mHeapIndex = index;
+        return index;
+    }
+
+    void siftDown(size_t index) {
+        const size_t size = mHeap.size();
+        if (2 * index + 1 >= size) return;
+        Entry entry = std::move(mHeap[index]);
+        while (true) {
+            size_t child = 2 * index + 1;
+            if (child >= size) break;
+            if ((child + 1 < size) && isEarlier(mHeap[child + 1], mHeap[child])) {
+                ++child;
             }
-            q.push(it);
-            mPriorityQueue.pop();
+            if (!isEarlier(mHeap[child], entry)) break;
+            moveEntry(child, index);
+            index = child;
         }
-        mPriorityQueue = std::move(q);
-        return res;
+        mHeap[index] = std::move(entry);
+        mSlots[mHeap[index].mSlot].mHeapIndex = index;
     }
 
-    std::priority_queue<VrrControllerEvent> mPriorityQueue;
+    std::vector<Entry> mHeap;
+    std::vector<Slot> mSlots;
+    std::vector<uint32_t> mFreeSlots;
+    std::map<VrrControllerEventType, TypeList> mTypes;
+    uint64_t mNextSequence = 0;
 };
 
 } // namespace android::hardware::graphics::composer
@@ -16,7 +16,9 @@
 
 #define ATRACE_TAG (ATRACE_TAG_GRAPHICS | ATRACE_TAG_HAL)
 #include "FileNode.h"
+#include <fcntl.h>
 #include <log/log.h>
+#include <unistd.h>
 #include <utils/Trace.h>
 #include <sstream>
 
@@ -68,7 +70,7 @@ int FileNode::getFileHandler(const std::string& nodeName) {
         return mFds[nodeName];
     }
     std::string fullPath = mNodePath + nodeName;
-    int fd = open(fullPath.c_str(), O_WRONLY, 0);
+    int fd = openNode(fullPath);
     if (fd < 0) {
         ALOGE("Open file node %s failed, fd = %d", fullPath.c_str(), fd);
         return fd;
@@ -77,13 +79,21 @@ int FileNode::getFileHandler(const std::string& nodeName) {
     return fd;
 }
 
+int FileNode::openNode(const std::string& fullPath) {
+    return open(fullPath.c_str(), O_WRONLY, 0);
+}
+
+ssize_t FileNode::writeNode(int fd, const std::string& str) {
+    return write(fd, str.c_str(), str.size());
+}
+
 bool FileNode::writeString(const std::string& nodeName, const std::string& str) {
     int fd = getFileHandler(nodeName);
     if (fd < 0) {
         ALOGE("Write to invalid file node %s%s", mNodePath.c_str(), nodeName.c_str());
         return false;
     }
-    int ret = write(fd, str.c_str(), str.size());
+    int ret = writeNode(fd, str);
     if (ret < 0) {
         ALOGE("Write %s to file node %s%s failed, ret = %d errno = %d", str.c_str(),
               mNodePath.c_str(), nodeName.c_str(), ret, errno);
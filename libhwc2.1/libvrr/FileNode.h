@@ -19,6 +19,7 @@
 #include <utils/Singleton.h>
 
 #include <fstream>
+#include <memory>
 #include <optional>
 #include <sstream>
 #include <unordered_map>
@@ -30,7 +31,7 @@ namespace android::hardware::graphics::composer {
 class FileNode {
 public:
     FileNode(const std::string& nodePath);
-    ~FileNode();
+    virtual ~FileNode();
 
     std::string dump();
 
@@ -58,6 +59,11 @@ public:
 
     int getFileHandler(const std::string& nodeName);
 
+protected:
+    // The file operations, overridden by stand-ins that don't touch the file system.
+    virtual int openNode(const std::string& fullPath);
+    virtual ssize_t writeNode(int fd, const std::string& str);
+
 private:
     std::string mNodePath;
     std::unordered_map<std::string, int> mFds;
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrameInsertionScheduler.h"
+
+#include <android-base/logging.h>
+
+#include <algorithm>
+
+#include "interface/Panel_def.h"
+
+namespace android::hardware::graphics::composer {
+
+FrameInsertionScheduler::FrameInsertionScheduler(EventQueue* eventQueue, int64_t aheadOfTimeNs,
+                                                 InsertionTimeAdjuster insertionTimeAdjuster)
+      : mEventQueue(eventQueue),
+        mAheadOfTimeNs(aheadOfTimeNs),
+        mInsertionTimeAdjuster(std::move(insertionTimeAdjuster)) {
+    mInsertionTimesNs.reserve(kDefaultMaximumNumberOfInsertions);
+}
+
+void FrameInsertionScheduler::onPresent(int64_t presentTimeNs, int64_t presentTimeoutNs) {
+    mBaseTimeNs = presentTimeNs + presentTimeoutNs;
+    if (presentTimeoutNs < mAheadOfTimeNs) {
+        LOG(ERROR) << "VrrController: the first vendor present timeout is negative";
+        return;
+    }
+    mEventQueue->postEvent(VrrControllerEventType::kVendorRenderingTimeoutInit,
+                           getInsertionTimeNs(mBaseTimeNs - mAheadOfTimeNs));
+}
+
+void FrameInsertionScheduler::addInsertion(int64_t intervalNs) {
+    mInsertionTimesNs.push_back(mBaseTimeNs + intervalNs);
+}
+
+bool FrameInsertionScheduler::startInsertions() {
+    if (mInsertionTimesNs.empty()) {
+        return false;
+    }
+    // The first insertion is the one being made.
+    mNextInsertionIndex = 1;
+    return true;
+}
+
+void FrameInsertionScheduler::scheduleNextInsertion() {
+    if (isDone()) {
+        return;
+    }
+    int64_t whenNs = std::max(getSteadyClockTimeNs(),
+                              mInsertionTimesNs[mNextInsertionIndex++] - mAheadOfTimeNs);
+    mEventQueue->postEvent(VrrControllerEventType::kVendorRenderingTimeoutPost,
+                           getInsertionTimeNs(whenNs));
+}
+
+void FrameInsertionScheduler::cancel() {
+    mEventQueue->dropEventWithMask(VrrControllerEventType::kVendorRenderingTimeoutInit);
+    mEventQueue->dropEventWithMask(VrrControllerEventType::kVendorRenderingTimeoutPost);
+    mInsertionTimesNs.clear();
+    mNextInsertionIndex = 0;
+}
+
+bool FrameInsertionScheduler::insertFrame(FileNode& fileNode) {
+    uint32_t command = 0;
+    if (fileNode.getLastWrittenValue(kRefreshControlNodeName, command) != NO_ERROR) {
+        return false;
+    }
+    clearBit(command, kPanelRefreshCtrlFrameInsertionAutoModeOffset);
+    setBitField(command, 1, kPanelRefreshCtrlFrameInsertionFrameCountOffset,
+                kPanelRefreshCtrlFrameInsertionFrameCountMask);
+    fileNode.writeValue(kRefreshControlNodeName, command);
+    return true;
+}
+
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "EventQueue.h"
+#include "FileNode.h"
+
+namespace android::hardware::graphics::composer {
+
+// Schedules the frame insertions of the vendor present timeout. The first insertion is due when
+// the present timeout after a present expires and is posted as kVendorRenderingTimeoutInit. The
+// following ones are then added by the vendor schedule and posted as kVendorRenderingTimeoutPost,
+// one at a time once the previous frame was inserted. Each is posted |aheadOfTimeNs| before it is
+// due, and the next expected present cancels all of them.
+class FrameInsertionScheduler {
+public:
+    // Returns when to post a frame insertion that would be posted at |whenNs|.
+    using InsertionTimeAdjuster = std::function<int64_t(int64_t whenNs)>;
+
+    FrameInsertionScheduler(EventQueue* eventQueue, int64_t aheadOfTimeNs,
+                            InsertionTimeAdjuster insertionTimeAdjuster = nullptr);
+
+    // Schedules the first insertion |presentTimeoutNs| after the present at |presentTimeNs|.
+    void onPresent(int64_t presentTimeNs, int64_t presentTimeoutNs);
+
+    // Adds an insertion of the vendor schedule, |intervalNs| after the first insertion.
+    void addInsertion(int64_t intervalNs);
+
+    // Starts the vendor schedule once the first frame is being inserted. Returns false if there is
+    // no schedule, in which case no frame should be inserted.
+    bool startInsertions();
+
+    // Posts the next insertion of the vendor schedule.
+    void scheduleNextInsertion();
+
+    // Drops the pending insertions.
+    void cancel();
+
+    // Writes the panel command that inserts one frame. Returns false if the refresh control state
+    // is not known.
+    static bool insertFrame(FileNode& fileNode);
+
+    bool isDone() const { return (mNextInsertionIndex == mInsertionTimesNs.size()); }
+
+private:
+    static constexpr size_t kDefaultMaximumNumberOfInsertions = 10;
+
+    int64_t getInsertionTimeNs(int64_t whenNs) const {
+        return mInsertionTimeAdjuster ? mInsertionTimeAdjuster(whenNs) : whenNs;
+    }
+
+    EventQueue* mEventQueue;
+    const int64_t mAheadOfTimeNs;
+    InsertionTimeAdjuster mInsertionTimeAdjuster;
+
+    // When the first insertion of the current present is due.
+    int64_t mBaseTimeNs = 0;
+    std::vector<int64_t> mInsertionTimesNs;
+    size_t mNextInsertionIndex = 0;
+};
+
+} // namespace android::hardware::graphics::composer
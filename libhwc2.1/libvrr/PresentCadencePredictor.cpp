@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG (ATRACE_TAG_GRAPHICS | ATRACE_TAG_HAL)
+
+#include "PresentCadencePredictor.h"
+
+#include <utils/Trace.h>
+
+#include <cstdlib>
+
+namespace android::hardware::graphics::composer {
+
+std::optional<int64_t> PresentCadencePredictor::predictNextPresentTimeNs() const {
+    const auto& history = mPresentTimesNs;
+    if (history.size() <= kNumberOfIntervals) {
+        return std::nullopt;
+    }
+    size_t last = history.size() - 1;
+    int64_t averageIntervalNs = (history[last] - history[0]) / kNumberOfIntervals;
+    if (averageIntervalNs <= 0) {
+        return std::nullopt;
+    }
+    for (size_t i = 1; i <= last; ++i) {
+        int64_t intervalNs = history[i] - history[i - 1];
+        if (std::abs(intervalNs - averageIntervalNs) * 100 >
+            averageIntervalNs * kTolerancePercentage) {
+            return std::nullopt;
+        }
+    }
+    return history[last] + averageIntervalNs;
+}
+
+int64_t PresentCadencePredictor::getFrameInsertionTimeNs(int64_t whenNs) const {
+    auto nextPresentTimeNs = predictNextPresentTimeNs();
+    if (!nextPresentTimeNs.has_value()) {
+        return whenNs;
+    }
+    int64_t latestWhenNs = whenNs + mMaxPostponementNs;
+    if ((nextPresentTimeNs.value() > whenNs) && (nextPresentTimeNs.value() <= latestWhenNs)) {
+        ATRACE_INT("PostponedFrameInsertionNs", mMaxPostponementNs);
+        return latestWhenNs;
+    }
+    return whenNs;
+}
+
+} // namespace android::hardware::graphics::composer
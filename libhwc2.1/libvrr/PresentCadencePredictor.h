@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include "RingBuffer.h"
+
+namespace android::hardware::graphics::composer {
+
+// Predicts the next present from the cadence of the recent ones, and moves a frame insertion that
+// such a present would follow shortly to just after it is due, so that the present cancels the
+// insertion instead.
+class PresentCadencePredictor {
+public:
+    // A frame insertion is postponed by at most |maxPostponementNs|. It must stay strictly below
+    // the margin by which insertions are scheduled ahead of the panel deadline, so that a wrong
+    // prediction still leaves time to write the panel command before the minimum refresh rate is
+    // missed.
+    explicit PresentCadencePredictor(int64_t maxPostponementNs)
+          : mMaxPostponementNs(maxPostponementNs) {}
+
+    void onPresent(int64_t presentTimeNs) { mPresentTimesNs.next() = presentTimeNs; }
+
+    void reset() { mPresentTimesNs.clear(); }
+
+    // Returns when the next present is expected if the recent presents have a regular cadence.
+    std::optional<int64_t> predictNextPresentTimeNs() const;
+
+    // Returns |whenNs|, or |whenNs| plus the maximum postponement if the next present is predicted
+    // within it.
+    int64_t getFrameInsertionTimeNs(int64_t whenNs) const;
+
+private:
+    // The next present is predicted only when each of the latest intervals between presents is
+    // within this percentage of their average.
+    static constexpr size_t kNumberOfIntervals = 4;
+    static constexpr int kTolerancePercentage = 10;
+
+    const int64_t mMaxPostponementNs;
+    RingBuffer<int64_t, kNumberOfIntervals + 1> mPresentTimesNs;
+};
+
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PresentRecordQueue.h"
+
+#include <android-base/logging.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+namespace android::hardware::graphics::composer {
+
+void PresentRecordQueue::setConsumers(
+        std::shared_ptr<RefreshRateCalculator> refreshRateCalculator,
+        std::shared_ptr<RefreshRateCalculator> frameRateReporter,
+        std::shared_ptr<VariableRefreshRateStatistic> statistic, FenceHandler fenceHandler) {
+    mRefreshRateCalculator = std::move(refreshRateCalculator);
+    mFrameRateReporter = std::move(frameRateReporter);
+    mStatistic = std::move(statistic);
+    mFenceHandler = std::move(fenceHandler);
+}
+
+void PresentRecordQueue::push(const PresentRecord& record) {
+    if (mCount == kCapacity) {
+        // The VRR controller thread fell behind.
+        LOG(WARNING) << "VrrController: present record queue is full";
+        drain();
+    }
+    mRecords[(mHead + mCount) % kCapacity] = record;
+    mCount++;
+}
+
+void PresentRecordQueue::drain() {
+    while (mCount > 0) {
+        PresentRecord record = mRecords[mHead];
+        mHead = (mHead + 1) % kCapacity;
+        mCount--;
+        consume(record);
+    }
+}
+
+void PresentRecordQueue::drop() {
+    for (; mCount > 0; mCount--) {
+        int fence = mRecords[mHead].mFence;
+        mHead = (mHead + 1) % kCapacity;
+        if ((fence >= 0) && close(fence)) {
+            LOG(ERROR) << "VrrController: close fence file failed, errno = " << errno;
+        }
+    }
+}
+
+void PresentRecordQueue::consume(const PresentRecord& record) {
+    if (mRefreshRateCalculator) {
+        mRefreshRateCalculator->onPresent(record.mTime, record.mFlag);
+    }
+    if (mFrameRateReporter) {
+        mFrameRateReporter->onPresent(record.mTime, 0);
+    }
+    if (mStatistic) {
+        mStatistic->onPresent(record.mTime, record.mFlag);
+    }
+    if (record.mFence < 0) {
+        return;
+    }
+    if (mFenceHandler) {
+        mFenceHandler(record.mFence);
+    } else if (close(record.mFence)) {
+        LOG(ERROR) << "VrrController: close fence file failed, errno = " << errno;
+    }
+}
+
+} // namespace android::hardware::graphics::composer
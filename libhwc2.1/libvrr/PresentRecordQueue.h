@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <functional>
+#include <memory>
+
+#include "RefreshRateCalculator/RefreshRateCalculator.h"
+#include "Statistics/VariableRefreshRateStatistic.h"
+
+namespace android::hardware::graphics::composer {
+
+// The presents that the calling thread of onPresent hands over to the VRR controller thread, and
+// what that thread does with each of them. Both threads use it with the controller lock held, so
+// it is a plain bounded ring.
+class PresentRecordQueue {
+public:
+    typedef struct PresentRecord {
+        int64_t mTime;
+        int mFlag;
+        // Duplicated present fence, or -1 if the present doesn't need to be tracked.
+        int mFence;
+    } PresentRecord;
+
+    // Takes the ownership of the fence of a drained record.
+    using FenceHandler = std::function<void(int fence)>;
+
+    static constexpr size_t kCapacity = 16;
+
+    PresentRecordQueue() = default;
+    ~PresentRecordQueue() { drop(); }
+
+    PresentRecordQueue(const PresentRecordQueue&) = delete;
+    void operator=(const PresentRecordQueue&) = delete;
+
+    // Any of them may be null.
+    void setConsumers(std::shared_ptr<RefreshRateCalculator> refreshRateCalculator,
+                      std::shared_ptr<RefreshRateCalculator> frameRateReporter,
+                      std::shared_ptr<VariableRefreshRateStatistic> statistic,
+                      FenceHandler fenceHandler);
+
+    // If the queue is full, the queued presents are drained on the calling thread rather than
+    // losing this one.
+    void push(const PresentRecord& record);
+
+    // Feeds the queued presents to the consumers in the order they were pushed.
+    void drain();
+
+    // Drops the queued presents and closes their fences.
+    void drop();
+
+    bool empty() const { return mCount == 0; }
+    size_t size() const { return mCount; }
+
+private:
+    void consume(const PresentRecord& record);
+
+    std::shared_ptr<RefreshRateCalculator> mRefreshRateCalculator;
+    std::shared_ptr<RefreshRateCalculator> mFrameRateReporter;
+    std::shared_ptr<VariableRefreshRateStatistic> mStatistic;
+    FenceHandler mFenceHandler;
+
+    std::array<PresentRecord, kCapacity> mRecords;
+    size_t mHead = 0;
+    size_t mCount = 0;
+};
+
+} // namespace android::hardware::graphics::composer
@@ -46,9 +46,10 @@ public:
             if (mAodRefreshRateState != kAodActiveToIdleTransitionState) {
                 setNewRefreshRate(kActiveRefreshRate);
                 mEventQueue->dropEvent(VrrControllerEventType::kAodRefreshRateCalculatorUpdate);
-                mResetRefreshRateEvent.mWhenNs =
-                        getSteadyClockTimeNs() + kActiveRefreshRateDurationNs;
-                mEventQueue->mPriorityQueue.emplace(mResetRefreshRateEvent);
+                // Count from the present rather than from now, presents are handed over to the
+                // VRR controller thread with some delay.
+                mResetRefreshRateEvent.mWhenNs = presentTimeNs + kActiveRefreshRateDurationNs;
+                mEventQueue->postEvent(mResetRefreshRateEvent);
                 if (mAodRefreshRateState == kAodIdleRefreshRateState) {
                     changeRefreshRateDisplayState();
                 }
@@ -109,7 +110,7 @@ private:
             mAodRefreshRateState = kAodActiveToIdleTransitionState;
             mResetRefreshRateEvent.mWhenNs =
                     getSteadyClockTimeNs() + kActiveToIdleTransitionDurationNs;
-            mEventQueue->mPriorityQueue.emplace(mResetRefreshRateEvent);
+            mEventQueue->postEvent(mResetRefreshRateEvent);
         } else {
             mAodRefreshRateState = kAodIdleRefreshRateState;
         }
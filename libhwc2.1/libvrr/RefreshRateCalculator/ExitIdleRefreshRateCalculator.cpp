@@ -59,7 +59,7 @@ void ExitIdleRefreshRateCalculator::onPresentInternal(int64_t presentTimeNs, int
         setNewRefreshRate(mMaxFrameRate);
 
         mTimeoutEvent.mWhenNs = presentTimeNs + mParams.mMaxValidTimeNs;
-        mEventQueue->mPriorityQueue.emplace(mTimeoutEvent);
+        mEventQueue->postEvent(mTimeoutEvent);
     }
     mLastPresentTimeNs = presentTimeNs;
 }
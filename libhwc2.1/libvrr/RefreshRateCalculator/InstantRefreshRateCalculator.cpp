@@ -61,7 +61,7 @@ void InstantRefreshRateCalculator::onPresentInternal(int64_t presentTimeNs, int
 
     mEventQueue->dropEvent(VrrControllerEventType::kInstantRefreshRateCalculatorUpdate);
     mTimeoutEvent.mWhenNs = presentTimeNs + mMaxValidTimeNs;
-    mEventQueue->mPriorityQueue.emplace(mTimeoutEvent);
+    mEventQueue->postEvent(mTimeoutEvent);
 }
 
 void InstantRefreshRateCalculator::reset() {
@@ -74,7 +74,7 @@ void InstantRefreshRateCalculator::setEnabled(bool isEnabled) {
         mEventQueue->dropEvent(VrrControllerEventType::kInstantRefreshRateCalculatorUpdate);
     } else {
         mTimeoutEvent.mWhenNs = getSteadyClockTimeNs() + mMaxValidTimeNs;
-        mEventQueue->mPriorityQueue.emplace(mTimeoutEvent);
+        mEventQueue->postEvent(mTimeoutEvent);
     }
 }
 
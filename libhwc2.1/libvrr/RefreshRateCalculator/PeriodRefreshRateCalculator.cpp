@@ -18,6 +18,8 @@
 
 #include "PeriodRefreshRateCalculator.h"
 
+#include <algorithm>
+
 #include "../Utils.h"
 
 namespace android::hardware::graphics::composer {
@@ -33,6 +35,8 @@ PeriodRefreshRateCalculator::PeriodRefreshRateCalculator(
     mMeasureEvent.mFunctor = std::move(std::bind(&PeriodRefreshRateCalculator::onMeasure, this));
 
     mConfidenceThresholdTimeNs = mParams.mMeasurePeriodNs * mParams.mConfidencePercentage / 100;
+    // A present is counted when it is at most one second after the previous one.
+    mStatistics.resize(mVsyncRate + 1, 0);
 }
 
 int PeriodRefreshRateCalculator::getRefreshRate() const {
@@ -62,14 +66,17 @@ void PeriodRefreshRateCalculator::onPresentInternal(int64_t presentTimeNs, int f
         if (periodNs <= std::nano::den) {
             int numVsync = std::max(mMinVsyncNum, durationToVsync(periodNs));
             // current frame rate is |mVsyncRate/numVsync|
-            ++mStatistics[Fraction<int>(mVsyncRate, numVsync)];
+            if (static_cast<size_t>(numVsync) >= mStatistics.size()) {
+                mStatistics.resize(numVsync + 1, 0);
+            }
+            ++mStatistics[numVsync];
         }
     }
     mLastPresentTimeNs = presentTimeNs;
 }
 
 void PeriodRefreshRateCalculator::reset() {
-    mStatistics.clear();
+    std::fill(mStatistics.begin(), mStatistics.end(), 0);
     mLastRefreshRate = kDefaultInvalidRefreshRate;
     mLastPresentTimeNs = kDefaultInvalidPresentTimeNs;
 }
@@ -82,8 +89,29 @@ void PeriodRefreshRateCalculator::setEnabled(bool isEnabled) {
         mMeasureEvent.mWhenNs = mLastMeasureTimeNs;
         mMeasureEvent.mFunctor =
                 std::move(std::bind(&PeriodRefreshRateCalculator::onMeasure, this));
-        mEventQueue->mPriorityQueue.emplace(mMeasureEvent);
+        mEventQueue->postEvent(mMeasureEvent);
+    }
+}
+
+void PeriodRefreshRateCalculator::setVrrConfigAttributes(int64_t vsyncPeriodNs,
+                                                         int64_t minFrameIntervalNs) {
+    int oldVsyncRate = mVsyncRate;
+    RefreshRateCalculator::setVrrConfigAttributes(vsyncPeriodNs, minFrameIntervalNs);
+    if (mVsyncRate == oldVsyncRate) return;
+
+    // Move the presents of the current period to the buckets of the new vsync rate.
+    std::vector<int> statistics(mVsyncRate + 1, 0);
+    for (size_t numVsync = 0; numVsync < mStatistics.size(); ++numVsync) {
+        if (mStatistics[numVsync] == 0) continue;
+        int newNumVsync = (numVsync == 0)
+                ? 0
+                : std::max(1, roundDivide(static_cast<int>(numVsync) * mVsyncRate, oldVsyncRate));
+        if (static_cast<size_t>(newNumVsync) >= statistics.size()) {
+            statistics.resize(newNumVsync + 1, 0);
+        }
+        statistics[newNumVsync] += mStatistics[numVsync];
     }
+    mStatistics = std::move(statistics);
 }
 
 int PeriodRefreshRateCalculator::onMeasure() {
@@ -93,7 +121,11 @@ int PeriodRefreshRateCalculator::onMeasure() {
     int maxOccurrence = 0;
     Fraction<int> majorRefreshRate;
 
-    for (const auto& [rate, count] : mStatistics) {
+    // Visit the buckets from the lowest frame rate up, so that ties resolve to the lower rate.
+    for (int numVsync = static_cast<int>(mStatistics.size()) - 1; numVsync >= 0; --numVsync) {
+        int count = mStatistics[numVsync];
+        if (count == 0) continue;
+        Fraction<int> rate(mVsyncRate, numVsync);
         totalPresent += count;
         auto durationNs = freqToDurationNs(rate);
         totalDurationNs += durationNs * count;
@@ -116,7 +148,7 @@ int PeriodRefreshRateCalculator::onMeasure() {
             currentRefreshRate = majorRefreshRate.round();
         }
     }
-    mStatistics.clear();
+    std::fill(mStatistics.begin(), mStatistics.end(), 0);
     currentRefreshRate = std::max(currentRefreshRate, 1);
     currentRefreshRate = std::min(currentRefreshRate, mMaxFrameRate);
     setNewRefreshRate(currentRefreshRate);
@@ -124,7 +156,7 @@ int PeriodRefreshRateCalculator::onMeasure() {
     // Prepare next measurement event.
     mLastMeasureTimeNs += mParams.mMeasurePeriodNs;
     mMeasureEvent.mWhenNs = mLastMeasureTimeNs;
-    mEventQueue->mPriorityQueue.emplace(mMeasureEvent);
+    mEventQueue->postEvent(mMeasureEvent);
     return NO_ERROR;
 }
 
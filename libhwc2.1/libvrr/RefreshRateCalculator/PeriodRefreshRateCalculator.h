@@ -18,7 +18,7 @@
 
 #include <stdint.h>
 #include <chrono>
-#include <map>
+#include <vector>
 
 #include "../EventQueue.h"
 #include "RefreshRateCalculator.h"
@@ -58,6 +58,8 @@ public:
 
     void setEnabled(bool isEnabled) final;
 
+    void setVrrConfigAttributes(int64_t vsyncPeriodNs, int64_t minFrameIntervalNs) final;
+
 private:
     int onMeasure();
 
@@ -67,7 +69,9 @@ private:
     PeriodRefreshRateCalculatorParameters mParams;
     VrrControllerEvent mMeasureEvent;
 
-    std::map<Fraction<int>, int> mStatistics;
+    // Number of presents in the current period, indexed by the number of vsyncs since the previous
+    // present, so the frame rate of a bucket is |mVsyncRate| / index.
+    std::vector<int> mStatistics;
 
     int64_t mLastPresentTimeNs = kDefaultInvalidPresentTimeNs;
     int mLastRefreshRate = kDefaultInvalidRefreshRate;
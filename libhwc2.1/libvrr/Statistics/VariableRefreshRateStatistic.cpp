@@ -42,20 +42,15 @@ VariableRefreshRateStatistic::VariableRefreshRateStatistic(
     mUpdateEvent.mFunctor =
             std::move(std::bind(&VariableRefreshRateStatistic::updateStatistic, this));
     mUpdateEvent.mWhenNs = getSteadyClockTimeNs() + mUpdatePeriodNs;
-    mEventQueue->mPriorityQueue.emplace(mUpdateEvent);
+    mEventQueue->postEvent(mUpdateEvent);
 #endif
-    mStatistics[mDisplayRefreshProfile] = DisplayRefreshRecord();
+    mPowerOffProfile = mDisplayRefreshProfile;
 }
 
 uint64_t VariableRefreshRateStatistic::getPowerOffDurationNs() const {
     if (isPowerModeOffNowLocked()) {
-        const auto& item = mStatistics.find(mDisplayRefreshProfile);
-        if (item == mStatistics.end()) {
-            ALOGE("%s We should have inserted power-off item in constructor.", __func__);
-            return 0;
-        }
         return mPowerOffDurationNs +
-                (getBootClockTimeNs() - item->second.mLastTimeStampInBootClockNs);
+                (getBootClockTimeNs() - mPowerOffRecord.mLastTimeStampInBootClockNs);
     } else {
         return mPowerOffDurationNs;
     }
@@ -68,27 +63,22 @@ uint64_t VariableRefreshRateStatistic::getStartStatisticTimeNs() const {
 DisplayRefreshStatistics VariableRefreshRateStatistic::getStatistics() {
     updateIdleStats();
     std::scoped_lock lock(mMutex);
-    return mStatistics;
+    return getStatisticsLocked();
 }
 
 DisplayRefreshStatistics VariableRefreshRateStatistic::getUpdatedStatistics() {
     updateIdleStats();
     std::scoped_lock lock(mMutex);
-    DisplayRefreshStatistics updatedStatistics;
-    for (auto& it : mStatistics) {
-        if (it.second.mUpdated) {
-            if (it.first.mNumVsync < 0) {
-                it.second.mAccumulatedTimeNs = getPowerOffDurationNs();
-            }
-        }
-        // need all mStatistics to be able to do aggregation and bucketing accurately
-        updatedStatistics[it.first] = it.second;
+    if (mPowerOffRecord.mUpdated && (mPowerOffProfile.mNumVsync < 0)) {
+        mPowerOffRecord.mAccumulatedTimeNs = getPowerOffDurationNs();
     }
+    // need all statistics to be able to do aggregation and bucketing accurately
+    DisplayRefreshStatistics updatedStatistics = getStatisticsLocked();
     if (isPowerModeOffNowLocked()) {
-        mStatistics[mDisplayRefreshProfile].mUpdated = true;
+        mPowerOffRecord.mUpdated = true;
     }
 
-    return std::move(updatedStatistics);
+    return updatedStatistics;
 }
 
 std::string VariableRefreshRateStatistic::dumpStatistics(bool getUpdatedOnly,
@@ -97,12 +87,13 @@ std::string VariableRefreshRateStatistic::dumpStatistics(bool getUpdatedOnly,
     std::string res;
     updateIdleStats();
     std::scoped_lock lock(mMutex);
-    for (auto& it : mStatistics) {
+    if ((mPowerOffProfile.mNumVsync < 0) && (mPowerOffProfile.mRefreshSource & refreshSource) &&
+        ((!getUpdatedOnly) || mPowerOffRecord.mUpdated)) {
+        mPowerOffRecord.mAccumulatedTimeNs = getPowerOffDurationNs();
+    }
+    for (const auto& it : getStatisticsLocked()) {
         if ((!getUpdatedOnly) || (it.second.mUpdated)) {
             if (it.first.mRefreshSource & refreshSource) {
-                if (it.first.mNumVsync < 0) {
-                    it.second.mAccumulatedTimeNs = getPowerOffDurationNs();
-                }
                 res += "[";
                 res += it.first.toString();
                 res += " , ";
@@ -223,7 +214,7 @@ void VariableRefreshRateStatistic::onPowerStateChange(int from, int to) {
         // |HWC_POWER_MODE_OFF| to |mPowerMode| when it is |HWC_POWER_MODE_DOZE_SUSPEND|.
         mDisplayRefreshProfile.mCurrentDisplayConfig.mPowerMode = HWC_POWER_MODE_OFF;
 
-        auto& record = mStatistics[mDisplayRefreshProfile];
+        auto& record = getRecordLocked();
         ++record.mCount;
         record.mLastTimeStampInBootClockNs = getBootClockTimeNs();
         record.mUpdated = true;
@@ -232,13 +223,12 @@ void VariableRefreshRateStatistic::onPowerStateChange(int from, int to) {
     } else {
         if (isPowerModeOff(from)) {
             mPowerOffDurationNs +=
-                    (getBootClockTimeNs() -
-                     mStatistics[mDisplayRefreshProfile].mLastTimeStampInBootClockNs);
+                    (getBootClockTimeNs() - mPowerOffRecord.mLastTimeStampInBootClockNs);
         }
         mDisplayRefreshProfile.mCurrentDisplayConfig.mPowerMode = to;
         if (to == HWC_POWER_MODE_DOZE) {
             mDisplayRefreshProfile.mNumVsync = mTeFrequency;
-            auto& record = mStatistics[mDisplayRefreshProfile];
+            auto& record = getRecordLocked();
             ++record.mCount;
             record.mLastTimeStampInBootClockNs = getBootClockTimeNs();
             record.mUpdated = true;
@@ -288,7 +278,7 @@ void VariableRefreshRateStatistic::onRefreshInternal(int64_t refreshTimeNs, int
     {
         std::scoped_lock lock(mMutex);
 
-        auto& record = mStatistics[mDisplayRefreshProfile];
+        auto& record = getRecordLocked();
         ++record.mCount;
         record.mAccumulatedTimeNs += (mTeIntervalNs * mDisplayRefreshProfile.mNumVsync);
         record.mLastTimeStampInBootClockNs = presentTimeInBootClockNs;
@@ -296,7 +286,7 @@ void VariableRefreshRateStatistic::onRefreshInternal(int64_t refreshTimeNs, int
         if (hasPresentFrameFlag(flag, PresentFrameFlag::kPresentingWhenDoze)) {
             // After presenting a frame in AOD, we revert back to 1 Hz operation.
             mDisplayRefreshProfile.mNumVsync = mTeFrequency;
-            auto& record = mStatistics[mDisplayRefreshProfile];
+            auto& record = getRecordLocked();
             ++record.mCount;
             record.mLastTimeStampInBootClockNs = mLastRefreshTimeInBootClockNs;
             record.mUpdated = true;
@@ -342,6 +332,52 @@ void VariableRefreshRateStatistic::setFixedRefreshRate(uint32_t rate) {
     }
 }
 
+DisplayRefreshRecord& VariableRefreshRateStatistic::getRecordLocked() {
+    if (mDisplayRefreshProfile.isOff()) {
+        return mPowerOffRecord;
+    }
+
+    const auto& status = mDisplayRefreshProfile.mCurrentDisplayConfig;
+    if ((mCurrentStatusIndex >= mStatusRecords.size()) ||
+        !(mStatusRecords[mCurrentStatusIndex].mProfile.mCurrentDisplayConfig == status)) {
+        // The display status changed, which doesn't happen per frame.
+        mCurrentStatusIndex = 0;
+        while ((mCurrentStatusIndex < mStatusRecords.size()) &&
+               !(mStatusRecords[mCurrentStatusIndex].mProfile.mCurrentDisplayConfig == status)) {
+            ++mCurrentStatusIndex;
+        }
+        if (mCurrentStatusIndex == mStatusRecords.size()) {
+            auto& statusRecords = mStatusRecords.emplace_back();
+            statusRecords.mProfile = mDisplayRefreshProfile;
+            statusRecords.mRecords.resize((mTeFrequency + 1) * kNumRefreshSources);
+        }
+    }
+
+    auto& records = mStatusRecords[mCurrentStatusIndex].mRecords;
+    size_t index = std::max(0, mDisplayRefreshProfile.mNumVsync) * kNumRefreshSources +
+            __builtin_ctz(static_cast<unsigned>(mDisplayRefreshProfile.mRefreshSource));
+    if (index >= records.size()) {
+        records.resize((index / kNumRefreshSources + 1) * kNumRefreshSources);
+    }
+    return records[index];
+}
+
+DisplayRefreshStatistics VariableRefreshRateStatistic::getStatisticsLocked() const {
+    DisplayRefreshStatistics statistics;
+    statistics[mPowerOffProfile] = mPowerOffRecord;
+    for (const auto& statusRecords : mStatusRecords) {
+        auto profile = statusRecords.mProfile;
+        for (size_t i = 0; i < statusRecords.mRecords.size(); ++i) {
+            // Every record reached through getRecordLocked() has been updated.
+            if (!statusRecords.mRecords[i].mUpdated) continue;
+            profile.mNumVsync = i / kNumRefreshSources;
+            profile.mRefreshSource = static_cast<RefreshSource>(1 << (i % kNumRefreshSources));
+            statistics[profile] = statusRecords.mRecords[i];
+        }
+    }
+    return statistics;
+}
+
 bool VariableRefreshRateStatistic::isPowerModeOffNowLocked() const {
     return isPowerModeOff(mDisplayRefreshProfile.mCurrentDisplayConfig.mPowerMode);
 }
@@ -369,7 +405,7 @@ void VariableRefreshRateStatistic::updateIdleStats(int64_t endTimeStampInBootClo
 
         std::scoped_lock lock(mMutex);
 
-        auto& record = mStatistics[mDisplayRefreshProfile];
+        auto& record = getRecordLocked();
         record.mAccumulatedTimeNs += durationFromLastPresentNs;
         record.mLastTimeStampInBootClockNs = mLastRefreshTimeInBootClockNs;
         mLastRefreshTimeInBootClockNs = endTimeStampInBootClockNs;
@@ -396,7 +432,7 @@ void VariableRefreshRateStatistic::updateIdleStats(int64_t endTimeStampInBootClo
         {
             std::scoped_lock lock(mMutex);
 
-            auto& record = mStatistics[mDisplayRefreshProfile];
+            auto& record = getRecordLocked();
             record.mCount += count;
             record.mAccumulatedTimeNs += alignedDurationNs;
             mLastRefreshTimeInBootClockNs += alignedDurationNs;
@@ -409,7 +445,7 @@ void VariableRefreshRateStatistic::updateIdleStats(int64_t endTimeStampInBootClo
 #ifdef DEBUG_VRR_STATISTICS
 int VariableRefreshRateStatistic::updateStatistic() {
     updateIdleStats();
-    for (const auto& it : mStatistics) {
+    for (const auto& it : getStatisticsLocked()) {
         const auto& key = it.first;
         const auto& value = it.second;
         ALOGD("%s: power mode = %d, id = %d, birghtness mode = %d, vsync "
@@ -420,7 +456,7 @@ int VariableRefreshRateStatistic::updateStatistic() {
     }
     // Post next update statistics event.
     mUpdateEvent.mWhenNs = getSteadyClockTimeNs() + mUpdatePeriodNs;
-    mEventQueue->mPriorityQueue.emplace(mUpdateEvent);
+    mEventQueue->postEvent(mUpdateEvent);
 
     return NO_ERROR;
 }
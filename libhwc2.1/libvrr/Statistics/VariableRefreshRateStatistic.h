@@ -17,10 +17,12 @@
 #pragma once
 
 #include <hardware/hwcomposer2.h>
+#include <utils/String8.h>
 #include <map>
 #include <sstream>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "../Power/PowerStatsProfile.h"
 #include "../Power/PowerStatsProfileTokenGenerator.h"
@@ -221,6 +223,20 @@ public:
 private:
     static constexpr int64_t kMaxRefreshIntervalNs = std::nano::den;
     static constexpr uint32_t kFrameRateWhenPresentAtLpMode = 30;
+    // One per bit of RefreshSource.
+    static constexpr int kNumRefreshSources = 4;
+
+    // The records of one display status, indexed by mNumVsync * kNumRefreshSources plus the bit
+    // position of the refresh source, so that recording a refresh doesn't search a map.
+    typedef struct DisplayStatusRecords {
+        DisplayRefreshProfile mProfile;
+        std::vector<DisplayRefreshRecord> mRecords;
+    } DisplayStatusRecords;
+
+    // Returns the record of |mDisplayRefreshProfile|.
+    DisplayRefreshRecord& getRecordLocked();
+
+    DisplayRefreshStatistics getStatisticsLocked() const;
 
     bool isPowerModeOffNowLocked() const;
 
@@ -253,7 +269,11 @@ private:
     int64_t mLastDumpsysTime = 0;
     int64_t mLastRefreshTimeInBootClockNs = kDefaultInvalidPresentTimeNs;
 
-    DisplayRefreshStatistics mStatistics;
+    // Every power-off profile shares one record, keyed by the profile of the first power-off.
+    DisplayRefreshProfile mPowerOffProfile;
+    DisplayRefreshRecord mPowerOffRecord;
+    std::vector<DisplayStatusRecords> mStatusRecords;
+    size_t mCurrentStatusIndex = 0;
     DisplayRefreshStatistics mStatisticsSnapshot;
     DisplayRefreshProfile mDisplayRefreshProfile;
 
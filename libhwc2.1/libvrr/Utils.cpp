@@ -17,6 +17,7 @@
 #include "Utils.h"
 
 #include <hardware/hwcomposer2.h>
+#include <atomic>
 #include <chrono>
 #include "android-base/chrono_utils.h"
 
@@ -24,28 +25,47 @@
 
 namespace android::hardware::graphics::composer {
 
-int64_t getSteadyClockTimeMs() {
-    return std::chrono::duration_cast<std::chrono::milliseconds>(
+namespace {
+
+SystemClock gSystemClock;
+std::atomic<Clock*> gClock = &gSystemClock;
+
+} // namespace
+
+int64_t SystemClock::getSteadyClockTimeNs() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
                    std::chrono::steady_clock::now().time_since_epoch())
             .count();
 }
 
-int64_t getSteadyClockTimeNs() {
+int64_t SystemClock::getBootClockTimeNs() const {
     return std::chrono::duration_cast<std::chrono::nanoseconds>(
-                   std::chrono::steady_clock::now().time_since_epoch())
+                   ::android::base::boot_clock::now().time_since_epoch())
             .count();
 }
 
+Clock& getClock() {
+    return *gClock.load(std::memory_order_acquire);
+}
+
+void setClock(Clock* clock) {
+    gClock.store(clock ? clock : &gSystemClock, std::memory_order_release);
+}
+
+int64_t getSteadyClockTimeMs() {
+    return getSteadyClockTimeNs() / kMillisecondToNanoSecond;
+}
+
+int64_t getSteadyClockTimeNs() {
+    return getClock().getSteadyClockTimeNs();
+}
+
 int64_t getBootClockTimeMs() {
-    return std::chrono::duration_cast<std::chrono::milliseconds>(
-                   ::android::base::boot_clock::now().time_since_epoch())
-            .count();
+    return getBootClockTimeNs() / kMillisecondToNanoSecond;
 }
 
 int64_t getBootClockTimeNs() {
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(
-                   ::android::base::boot_clock::now().time_since_epoch())
-            .count();
+    return getClock().getBootClockTimeNs();
 }
 
 bool hasPresentFrameFlag(int flag, PresentFrameFlag target) {
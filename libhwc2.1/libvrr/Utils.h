@@ -19,6 +19,7 @@
 #include <chrono>
 #include <cmath>
 #include <cstdint>
+#include "Clock.h"
 #include "interface/Event.h"
 #include "interface/VariableRefreshRateInterface.h"
 
@@ -107,7 +107,14 @@ auto VariableRefreshRateController::CreateInstance(ExynosDisplay* display,
 
 VariableRefreshRateController::VariableRefreshRateController(ExynosDisplay* display,
                                                              const std::string& panelName)
-      : mDisplay(display), mPanelName(panelName), mPendingVendorRenderingTimeoutTasks(this) {
+      : mDisplay(display),
+        mPanelName(panelName),
+        mPresentCadencePredictor(kMaxFrameInsertionPostponementNs),
+        mFrameInsertionScheduler(&mEventQueue, kDefaultAheadOfTimeNs,
+                                 [this](int64_t whenNs) {
+                                     return mPresentCadencePredictor.getFrameInsertionTimeNs(
+                                             whenNs);
+                                 }) {
     mState = VrrControllerState::kDisable;
     std::string displayFileNodePath = mDisplay->getPanelSysfsPath();
     if (displayFileNodePath.empty()) {
@@ -197,6 +204,14 @@ VariableRefreshRateController::VariableRefreshRateController(ExynosDisplay* disp
                                                            (1 * std::nano::den /*1 second*/));
     mPowerModeListeners.push_back(mVariableRefreshRateStatistic.get());
 
+    // The fence of a drained present replaces the one of the previous present, which is then
+    // checked for its signal time.
+    mPresentRecords.setConsumers(mRefreshRateCalculator, mFrameRateReporter,
+                                 mVariableRefreshRateStatistic, [this](int fence) {
+                                     retireLastPresentFenceLocked();
+                                     mLastPresentFence = fence;
+                                 });
+
     mResidencyWatcher =
             ndk::SharedRefBase::make<DisplayStateResidencyWatcher>(mDisplayContextProvider,
                                                                    mVariableRefreshRateStatistic);
@@ -206,6 +221,7 @@ VariableRefreshRateController::~VariableRefreshRateController() {
     stopThread(true);
 
     const std::lock_guard<std::mutex> lock(mMutex);
+    dropPresentRecordsLocked();
     if (mLastPresentFence.has_value()) {
         if (close(mLastPresentFence.value())) {
             LOG(ERROR) << "VrrController: close fence file failed, errno = " << errno;
@@ -249,9 +265,11 @@ void VariableRefreshRateController::reset() {
     ATRACE_CALL();
 
     const std::lock_guard<std::mutex> lock(mMutex);
-    mEventQueue.mPriorityQueue = std::priority_queue<VrrControllerEvent>();
+    mEventQueue.dropEvent();
     mRecord.clear();
+    mPresentCadencePredictor.reset();
     dropEventLocked();
+    dropPresentRecordsLocked();
     if (mLastPresentFence.has_value()) {
         if (close(mLastPresentFence.value())) {
             LOG(ERROR) << "VrrController: close fence file failed, errno = " << errno;
@@ -270,6 +288,8 @@ void VariableRefreshRateController::setActiveVrrConfiguration(hwc2_config_t conf
             LOG(ERROR) << "VrrController: Set an undefined active configuration";
             return;
         }
+        // Presents made under the old configuration are accounted first.
+        drainPresentRecordsLocked();
         if (mFrameRateReporter) {
             mFrameRateReporter->onPresent(getSteadyClockTimeNs(), 0);
         }
@@ -389,6 +409,8 @@ void VariableRefreshRateController::postSetPowerMode(int32_t powerMode) {
         if (mPowerMode == powerMode) {
             return;
         }
+        // Presents made in the old power mode are accounted first.
+        drainPresentRecordsLocked();
         switch (powerMode) {
             case HWC_POWER_MODE_OFF:
             case HWC_POWER_MODE_DOZE:
@@ -401,7 +423,7 @@ void VariableRefreshRateController::postSetPowerMode(int32_t powerMode) {
                 // We should transition from either HWC_POWER_MODE_OFF, HWC_POWER_MODE_DOZE, or
                 // HWC_POWER_MODE_DOZE_SUSPEND. At this point, there should be no pending events
                 // posted.
-                if (!mEventQueue.mPriorityQueue.empty()) {
+                if (!mEventQueue.empty()) {
                     LOG(WARNING) << "VrrController: there should be no pending event when resume "
                                     "from power mode = "
                                  << mPowerMode << " to power mode = " << powerMode;
@@ -555,6 +577,7 @@ int VariableRefreshRateController::setFixedRefreshRateRange(
             return NO_ERROR;
         }
     }
+    drainPresentRecordsLocked();
     uint32_t command = getCurrentRefreshControlStateLocked();
     mMinimumRefreshRate = minimumRefreshRate;
     mMaximumRefreshRateTimeoutNs = minLockTimeForPeakRefreshRate;
@@ -663,135 +686,127 @@ void VariableRefreshRateController::onPresent(int fence) {
         return;
     }
     ATRACE_CALL();
+    // The calculators, the statistics and the fence checks run on the VRR controller thread, only
+    // the state machine is updated here so that it stays in order with setExpectedPresentTime.
     {
         const std::lock_guard<std::mutex> lock(mMutex);
-        if (!mRecord.mPendingCurrentPresentTime.has_value()) {
-            LOG(WARNING) << "VrrController: VrrController: Present without expected present time "
-                            "information";
-            return;
-        } else {
-            if (mRefreshRateCalculator) {
-                mRefreshRateCalculator->onPresent(mRecord.mPendingCurrentPresentTime.value().mTime,
-                                                  getPresentFrameFlag());
-            }
-            if (mFrameRateReporter) {
-                mFrameRateReporter->onPresent(mRecord.mPendingCurrentPresentTime.value().mTime, 0);
-            }
-            if (mVariableRefreshRateStatistic) {
-                mVariableRefreshRateStatistic
-                        ->onPresent(mRecord.mPendingCurrentPresentTime.value().mTime,
-                                    getPresentFrameFlag());
-            }
-            mRecord.mPresentHistory.next() = mRecord.mPendingCurrentPresentTime.value();
-        }
-        if (mState == VrrControllerState::kDisable) {
+        if (!updateStateOnPresentLocked(fence)) {
             return;
-        } else if (mState == VrrControllerState::kHibernate) {
-            LOG(WARNING) << "VrrController: Present during hibernation without prior notification "
-                            "via notifyExpectedPresent.";
-            mState = VrrControllerState::kRendering;
-            dropEventLocked(VrrControllerEventType::kHibernateTimeout);
         }
+    }
+    mCondition.notify_all();
+}
 
-        if ((mMaximumRefreshRateTimeoutNs > 0) && (mMinimumRefreshRate > 1)) {
-            auto maxFrameRate = durationNsToFreq(mVrrConfigs[mVrrActiveConfig].minFrameIntervalNs);
-            // If the target minimum refresh rate equals the maxFrameRate, there's no need to
-            // promote the refresh rate to maxFrameRate during presentation.
-            // E.g. in low-light conditions, with |maxFrameRate| and |mMinimumRefreshRate| both at
-            // 120, no refresh rate promotion is needed.
-            if (maxFrameRate != mMinimumRefreshRate) {
-                if (mMinimumRefreshRatePresentStates == kAtMinimumRefreshRate) {
-                    if (mPresentTimeoutController != PresentTimeoutControllerType::kHardware) {
-                        LOG(WARNING)
-                                << "VrrController: incorrect type of present timeout controller.";
-                    }
-                    uint32_t command = getCurrentRefreshControlStateLocked();
-                    // Delegate timeout management to hardware.
-                    setBit(command, kPanelRefreshCtrlFrameInsertionAutoModeOffset);
-                    // Configure panel to maintain the minimum refresh rate.
-                    setBitField(command, maxFrameRate, kPanelRefreshCtrlMinimumRefreshRateOffset,
-                                kPanelRefreshCtrlMinimumRefreshRateMask);
-                    if (!mFileNode->writeValue(composer::kRefreshControlNodeName, command)) {
-                        LOG(WARNING)
-                                << "VrrController: write file node error, command = " << command;
-                        return;
-                    }
-                    mMinimumRefreshRatePresentStates = kAtMaximumRefreshRate;
-                    onRefreshRateChangedInternal(maxFrameRate);
-                    mMinimumRefreshRateTimeoutEvent->mIsRelativeTime = false;
-                    mMinimumRefreshRateTimeoutEvent->mWhenNs =
-                            mRecord.mPendingCurrentPresentTime.value().mTime +
-                            mMaximumRefreshRateTimeoutNs;
-                    postEvent(VrrControllerEventType::kMinLockTimeForPeakRefreshRate,
-                              mMinimumRefreshRateTimeoutEvent.value());
-                } else if (mMinimumRefreshRatePresentStates == kTransitionToMinimumRefreshRate) {
-                    dropEventLocked(VrrControllerEventType::kMinLockTimeForPeakRefreshRate);
-                    mMinimumRefreshRateTimeoutEvent->mIsRelativeTime = false;
-                    auto delayNs =
-                            (std::nano::den / mMinimumRefreshRate) + kMillisecondToNanoSecond;
-                    mMinimumRefreshRateTimeoutEvent->mWhenNs =
-                            mRecord.mPendingCurrentPresentTime.value().mTime + delayNs;
-                    postEvent(VrrControllerEventType::kMinLockTimeForPeakRefreshRate,
-                              mMinimumRefreshRateTimeoutEvent.value());
-                } else {
-                    if (mMinimumRefreshRatePresentStates != kAtMaximumRefreshRate) {
-                        LOG(ERROR) << "VrrController: wrong state when setting min refresh rate: "
-                                   << mMinimumRefreshRatePresentStates;
-                    }
+bool VariableRefreshRateController::updateStateOnPresentLocked(int fence) {
+    if (!mRecord.mPendingCurrentPresentTime.has_value()) {
+        LOG(WARNING) << "VrrController: VrrController: Present without expected present time "
+                        "information";
+        return false;
+    }
+    PresentRecordQueue::PresentRecord record =
+            {.mTime = mRecord.mPendingCurrentPresentTime.value().mTime,
+             .mFlag = getPresentFrameFlag(),
+             .mFence = -1};
+    mRecord.mPresentHistory.next() = mRecord.mPendingCurrentPresentTime.value();
+    mPresentCadencePredictor.onPresent(record.mTime);
+    if (mState == VrrControllerState::kDisable) {
+        mPresentRecords.push(record);
+        return true;
+    } else if (mState == VrrControllerState::kHibernate) {
+        LOG(WARNING) << "VrrController: Present during hibernation without prior notification "
+                        "via notifyExpectedPresent.";
+        mState = VrrControllerState::kRendering;
+        dropEventLocked(VrrControllerEventType::kHibernateTimeout);
+    }
+
+    if ((mMaximumRefreshRateTimeoutNs > 0) && (mMinimumRefreshRate > 1)) {
+        mPresentRecords.push(record);
+        auto maxFrameRate = durationNsToFreq(mVrrConfigs[mVrrActiveConfig].minFrameIntervalNs);
+        // If the target minimum refresh rate equals the maxFrameRate, there's no need to
+        // promote the refresh rate to maxFrameRate during presentation.
+        // E.g. in low-light conditions, with |maxFrameRate| and |mMinimumRefreshRate| both at
+        // 120, no refresh rate promotion is needed.
+        if (maxFrameRate != mMinimumRefreshRate) {
+            if (mMinimumRefreshRatePresentStates == kAtMinimumRefreshRate) {
+                if (mPresentTimeoutController != PresentTimeoutControllerType::kHardware) {
+                    LOG(WARNING) << "VrrController: incorrect type of present timeout controller.";
+                }
+                uint32_t command = getCurrentRefreshControlStateLocked();
+                // Delegate timeout management to hardware.
+                setBit(command, kPanelRefreshCtrlFrameInsertionAutoModeOffset);
+                // Configure panel to maintain the minimum refresh rate.
+                setBitField(command, maxFrameRate, kPanelRefreshCtrlMinimumRefreshRateOffset,
+                            kPanelRefreshCtrlMinimumRefreshRateMask);
+                if (!mFileNode->writeValue(composer::kRefreshControlNodeName, command)) {
+                    LOG(WARNING) << "VrrController: write file node error, command = " << command;
+                    return true;
+                }
+                mMinimumRefreshRatePresentStates = kAtMaximumRefreshRate;
+                onRefreshRateChangedInternal(maxFrameRate);
+                mMinimumRefreshRateTimeoutEvent->mIsRelativeTime = false;
+                mMinimumRefreshRateTimeoutEvent->mWhenNs =
+                        mRecord.mPendingCurrentPresentTime.value().mTime +
+                        mMaximumRefreshRateTimeoutNs;
+                postEvent(VrrControllerEventType::kMinLockTimeForPeakRefreshRate,
+                          mMinimumRefreshRateTimeoutEvent.value());
+            } else if (mMinimumRefreshRatePresentStates == kTransitionToMinimumRefreshRate) {
+                dropEventLocked(VrrControllerEventType::kMinLockTimeForPeakRefreshRate);
+                mMinimumRefreshRateTimeoutEvent->mIsRelativeTime = false;
+                auto delayNs = (std::nano::den / mMinimumRefreshRate) + kMillisecondToNanoSecond;
+                mMinimumRefreshRateTimeoutEvent->mWhenNs =
+                        mRecord.mPendingCurrentPresentTime.value().mTime + delayNs;
+                postEvent(VrrControllerEventType::kMinLockTimeForPeakRefreshRate,
+                          mMinimumRefreshRateTimeoutEvent.value());
+            } else {
+                if (mMinimumRefreshRatePresentStates != kAtMaximumRefreshRate) {
+                    LOG(ERROR) << "VrrController: wrong state when setting min refresh rate: "
+                               << mMinimumRefreshRatePresentStates;
                 }
             }
-            return;
         }
+        return true;
     }
 
-    // Prior to pushing the most recent fence update, verify the release timestamps of all preceding
-    // fences.
-    // TODO(b/309873055): delegate the task of executing updateVsyncHistory to the Vrr controller's
-    // loop thread in order to reduce the workload of calling thread.
-    updateVsyncHistory();
-    int dupFence = dup(fence);
-    if (dupFence < 0) {
+    // The VRR controller thread verifies the release timestamp of the preceding fence before
+    // tracking this one.
+    record.mFence = dup(fence);
+    if (record.mFence < 0) {
         LOG(ERROR) << "VrrController: duplicate fence file failed." << errno;
     }
+    mPresentRecords.push(record);
 
-    {
-        const std::lock_guard<std::mutex> lock(mMutex);
-        if (mLastPresentFence.has_value()) {
-            LOG(WARNING) << "VrrController: last present fence remains open.";
-        }
-        mLastPresentFence = dupFence;
-        // Post next rendering timeout.
-        int64_t timeoutNs;
-        if (mVrrConfigs[mVrrActiveConfig].isFullySupported) {
-            timeoutNs = getSteadyClockTimeNs() +
-                    mVrrConfigs[mVrrActiveConfig].notifyExpectedPresentConfig->TimeoutNs;
+    // Post next rendering timeout.
+    int64_t timeoutNs;
+    if (mVrrConfigs[mVrrActiveConfig].isFullySupported) {
+        timeoutNs = getSteadyClockTimeNs() +
+                mVrrConfigs[mVrrActiveConfig].notifyExpectedPresentConfig->TimeoutNs;
+    } else {
+        timeoutNs = kDefaultSystemPresentTimeoutNs;
+    }
+    postEvent(VrrControllerEventType::kSystemRenderingTimeout, getSteadyClockTimeNs() + timeoutNs);
+    if (shouldHandleVendorRenderingTimeout()) {
+        // Post next frame insertion event.
+        int64_t firstTimeOutNs;
+        if (mVendorPresentTimeoutOverride) {
+            firstTimeOutNs = mVendorPresentTimeoutOverride.value().mTimeoutNs;
         } else {
-            timeoutNs = kDefaultSystemPresentTimeoutNs;
+            firstTimeOutNs = mPresentTimeoutEventHandler->getPresentTimeoutNs();
         }
-        postEvent(VrrControllerEventType::kSystemRenderingTimeout,
-                  getSteadyClockTimeNs() + timeoutNs);
-        if (shouldHandleVendorRenderingTimeout()) {
-            // Post next frame insertion event.
-            int64_t firstTimeOutNs;
-            if (mVendorPresentTimeoutOverride) {
-                firstTimeOutNs = mVendorPresentTimeoutOverride.value().mTimeoutNs;
-            } else {
-                firstTimeOutNs = mPresentTimeoutEventHandler->getPresentTimeoutNs();
-            }
-            mPendingVendorRenderingTimeoutTasks.baseTimeNs += firstTimeOutNs;
-            firstTimeOutNs -= kDefaultAheadOfTimeNs;
-            if (firstTimeOutNs >= 0) {
-                auto vendorPresentTimeoutNs =
-                        mRecord.mPendingCurrentPresentTime.value().mTime + firstTimeOutNs;
-                postEvent(VrrControllerEventType::kVendorRenderingTimeoutInit,
-                          vendorPresentTimeoutNs);
-            } else {
-                LOG(ERROR) << "VrrController: the first vendor present timeout is negative";
-            }
+        mFrameInsertionScheduler.onPresent(mRecord.mPendingCurrentPresentTime.value().mTime,
+                                           firstTimeOutNs);
+    }
+    mRecord.mPendingCurrentPresentTime = std::nullopt;
+    return true;
+}
+
+void VariableRefreshRateController::dropPresentRecordsLocked() {
+    mPresentRecords.drop();
+    for (int fence : mPendingPresentFences) {
+        if (close(fence)) {
+            LOG(ERROR) << "VrrController: close fence file failed, errno = " << errno;
         }
-        mRecord.mPendingCurrentPresentTime = std::nullopt;
     }
-    mCondition.notify_all();
+    mPendingPresentFences.clear();
 }
 
 void VariableRefreshRateController::setExpectedPresentTime(int64_t timestampNanos,
@@ -802,7 +817,6 @@ void VariableRefreshRateController::setExpectedPresentTime(int64_t timestampNano
     // Drop the out of date timeout.
     dropEventLocked(VrrControllerEventType::kSystemRenderingTimeout);
     cancelPresentTimeoutHandlingLocked();
-    mPendingVendorRenderingTimeoutTasks.baseTimeNs = timestampNanos;
     mRecord.mPendingCurrentPresentTime = {mVrrActiveConfig, timestampNanos, frameIntervalNs};
 }
 
@@ -815,44 +829,24 @@ void VariableRefreshRateController::onVsync(int64_t timestampNanos,
 }
 
 void VariableRefreshRateController::cancelPresentTimeoutHandlingLocked() {
-    dropEventLocked(VrrControllerEventType::kVendorRenderingTimeoutInit);
-    dropEventLocked(VrrControllerEventType::kVendorRenderingTimeoutPost);
-    mPendingVendorRenderingTimeoutTasks.reset();
+    mFrameInsertionScheduler.cancel();
 }
 
 void VariableRefreshRateController::dropEventLocked() {
-    mEventQueue.mPriorityQueue = std::priority_queue<VrrControllerEvent>();
+    mEventQueue.dropEvent();
 }
 
 void VariableRefreshRateController::dropEventLocked(VrrControllerEventType eventType) {
-    std::priority_queue<VrrControllerEvent> q;
-    auto target = static_cast<int>(eventType);
-    while (!mEventQueue.mPriorityQueue.empty()) {
-        const auto& it = mEventQueue.mPriorityQueue.top();
-        if ((static_cast<int>(it.mEventType) & target) != target) {
-            q.push(it);
-        }
-        mEventQueue.mPriorityQueue.pop();
-    }
-    mEventQueue.mPriorityQueue = std::move(q);
+    mEventQueue.dropEventWithMask(eventType);
 }
 
 std::string VariableRefreshRateController::dumpEventQueueLocked() {
     std::string content;
-    if (mEventQueue.mPriorityQueue.empty()) {
-        return content;
-    }
-
-    std::priority_queue<VrrControllerEvent> q;
-    while (!mEventQueue.mPriorityQueue.empty()) {
-        const auto& it = mEventQueue.mPriorityQueue.top();
+    mEventQueue.forEachEvent([&content](const VrrControllerEvent& event) {
         content += "VrrController: event = ";
-        content += it.toString();
+        content += event.toString();
         content += "\n";
-        q.push(it);
-        mEventQueue.mPriorityQueue.pop();
-    }
-    mEventQueue.mPriorityQueue = std::move(q);
+    });
     return content;
 }
 
@@ -901,11 +895,11 @@ int64_t VariableRefreshRateController::getLastFenceSignalTimeUnlocked(int fd) {
 }
 
 int64_t VariableRefreshRateController::getNextEventTimeLocked() const {
-    if (mEventQueue.mPriorityQueue.empty()) {
+    if (mEventQueue.empty()) {
         LOG(WARNING) << "VrrController: event queue should NOT be empty.";
         return -1;
     }
-    const auto& event = mEventQueue.mPriorityQueue.top();
+    const auto& event = mEventQueue.top();
     return event.mWhenNs;
 }
 
@@ -975,12 +969,7 @@ void VariableRefreshRateController::handlePresentTimeout() {
     if (mDefaultPresentTimeoutController != PresentTimeoutControllerType::kSoftware) {
         LOG(WARNING) << "VrrController: incorrect type of default present timeout controller.";
     }
-    uint32_t command = 0;
-    if (mFileNode->getLastWrittenValue(composer::kRefreshControlNodeName, command) == NO_ERROR) {
-        clearBit(command, kPanelRefreshCtrlFrameInsertionAutoModeOffset);
-        setBitField(command, 1, kPanelRefreshCtrlFrameInsertionFrameCountOffset,
-                    kPanelRefreshCtrlFrameInsertionFrameCountMask);
-        mFileNode->writeValue(composer::kRefreshControlNodeName, command);
+    if (FrameInsertionScheduler::insertFrame(*mFileNode)) {
         if (mPresentTimeoutController != PresentTimeoutControllerType::kSoftware) {
             mPresentTimeoutController = PresentTimeoutControllerType::kSoftware;
         }
@@ -995,7 +984,7 @@ void VariableRefreshRateController::handlePresentTimeout() {
                 ->onNonPresentRefresh(getSteadyClockTimeNs(),
                                       RefreshSource::kRefreshSourceFrameInsertion);
     }
-    mPendingVendorRenderingTimeoutTasks.scheduleNextTask();
+    mFrameInsertionScheduler.scheduleNextInsertion();
 }
 
 void VariableRefreshRateController::onFrameRateChangedForDBI(int refreshRate) {
@@ -1094,34 +1083,35 @@ void VariableRefreshRateController::threadBody() {
     for (;;) {
         bool stateChanged = false;
         uint32_t frameRate = 0;
+        updateVsyncHistory();
         {
             std::unique_lock<std::mutex> lock(mMutex);
             if (mThreadExit) break;
+            drainPresentRecordsLocked();
             if (!mEnabled) mCondition.wait(lock);
             if (!mEnabled) continue;
 
-            if (mEventQueue.mPriorityQueue.empty()) {
+            if (mEventQueue.empty()) {
                 mCondition.wait(lock);
             }
             int64_t whenNs = getNextEventTimeLocked();
             int64_t nowNs = getSteadyClockTimeNs();
             if (whenNs > nowNs) {
                 int64_t delayNs = whenNs - nowNs;
-                auto res = mCondition.wait_for(lock, std::chrono::nanoseconds(delayNs));
+                auto res = getClock().waitFor(mCondition, lock, delayNs);
                 if (res != std::cv_status::timeout) {
                     continue;
                 }
             }
 
-            if (mEventQueue.mPriorityQueue.empty()) {
+            if (mEventQueue.empty()) {
                 continue;
             }
 
-            auto event = mEventQueue.mPriorityQueue.top();
-            if (event.mWhenNs > getSteadyClockTimeNs()) {
+            if (mEventQueue.top().mWhenNs > getSteadyClockTimeNs()) {
                 continue;
             }
-            mEventQueue.mPriorityQueue.pop();
+            auto event = mEventQueue.pop();
             if (static_cast<int>(event.mEventType) &
                 static_cast<int>(VrrControllerEventType::kCallbackEventMask)) {
                 handleCallbackEventLocked(event);
@@ -1139,6 +1129,7 @@ void VariableRefreshRateController::threadBody() {
                     case VrrControllerEventType::kSystemRenderingTimeout: {
                         handleHibernate();
                         mState = VrrControllerState::kHibernate;
+                        retireLastPresentFenceLocked();
                         stateChanged = true;
                         break;
                     }
@@ -1148,43 +1139,25 @@ void VariableRefreshRateController::threadBody() {
                     }
                     case VrrControllerEventType::kVendorRenderingTimeoutInit: {
                         if (mPresentTimeoutEventHandler) {
-                            size_t numberOfIntervals = 0;
                             // Verify whether a present timeout override exists, and if so, execute
                             // it first.
                             if (mVendorPresentTimeoutOverride) {
                                 const auto& params = mVendorPresentTimeoutOverride.value();
                                 int64_t whenFromNowNs = 0;
                                 for (int i = 0; i < params.mSchedule.size(); ++i) {
-                                    numberOfIntervals += params.mSchedule[i].first;
-                                }
-                                if (numberOfIntervals > 0) {
-                                    mPendingVendorRenderingTimeoutTasks.reserveSpace(
-                                            numberOfIntervals);
-                                    for (int i = 0; i < params.mSchedule.size(); ++i) {
-                                        uint32_t intervalNs = params.mSchedule[i].second;
-                                        for (int j = 0; j < params.mSchedule[i].first; ++j) {
-                                            mPendingVendorRenderingTimeoutTasks.addTask(
-                                                    whenFromNowNs);
-                                            whenFromNowNs += intervalNs;
-                                        }
+                                    uint32_t intervalNs = params.mSchedule[i].second;
+                                    for (int j = 0; j < params.mSchedule[i].first; ++j) {
+                                        mFrameInsertionScheduler.addInsertion(whenFromNowNs);
+                                        whenFromNowNs += intervalNs;
                                     }
                                 }
                             } else {
                                 auto handleEvents = mPresentTimeoutEventHandler->getHandleEvents();
-                                if (!handleEvents.empty()) {
-                                    numberOfIntervals = handleEvents.size();
-                                    mPendingVendorRenderingTimeoutTasks.reserveSpace(
-                                            numberOfIntervals);
-                                    for (int i = 0; i < handleEvents.size(); ++i) {
-                                        mPendingVendorRenderingTimeoutTasks.addTask(
-                                                handleEvents[i].mWhenNs);
-                                    }
+                                for (int i = 0; i < handleEvents.size(); ++i) {
+                                    mFrameInsertionScheduler.addInsertion(handleEvents[i].mWhenNs);
                                 }
                             }
-                            if (numberOfIntervals > 0) {
-                                // Start from 1 since we will execute the first task immediately
-                                // below.
-                                mPendingVendorRenderingTimeoutTasks.nextTaskIndex = 1;
+                            if (mFrameInsertionScheduler.startInsertions()) {
                                 handlePresentTimeout();
                             }
                         }
@@ -1219,6 +1192,7 @@ void VariableRefreshRateController::threadBody() {
                     case VrrControllerEventType::kNotifyExpectedPresentConfig: {
                         handleResume();
                         mState = VrrControllerState::kRendering;
+                        retireLastPresentFenceLocked();
                         stateChanged = true;
                         break;
                     }
@@ -1248,7 +1222,7 @@ void VariableRefreshRateController::postEvent(VrrControllerEventType type, int64
     VrrControllerEvent event;
     event.mEventType = type;
     event.mWhenNs = when;
-    mEventQueue.mPriorityQueue.emplace(event);
+    mEventQueue.postEvent(std::move(event));
 }
 
 void VariableRefreshRateController::postEvent(VrrControllerEventType type, TimedEvent& timedEvent) {
@@ -1257,36 +1231,51 @@ void VariableRefreshRateController::postEvent(VrrControllerEventType type, Timed
     event.mWhenNs = timedEvent.mIsRelativeTime ? (getSteadyClockTimeNs() + timedEvent.mWhenNs)
                                                : timedEvent.mWhenNs;
     event.mFunctor = std::move(timedEvent.mFunctor);
-    mEventQueue.mPriorityQueue.emplace(event);
+    mEventQueue.postEvent(std::move(event));
 }
 
-void VariableRefreshRateController::updateVsyncHistory() {
-    int fence = -1;
+void VariableRefreshRateController::retireLastPresentFenceLocked() {
+    if (mLastPresentFence.has_value()) {
+        mPendingPresentFences.push_back(mLastPresentFence.value());
+        mLastPresentFence = std::nullopt;
+    }
+}
 
+void VariableRefreshRateController::updateVsyncHistory() {
     {
         const std::lock_guard<std::mutex> lock(mMutex);
-        if (!mLastPresentFence.has_value()) {
+        if (mPendingPresentFences.empty()) {
             return;
         }
-        fence = mLastPresentFence.value();
-        mLastPresentFence = std::nullopt;
+        // Swap the buffers so that neither side reallocates on every present.
+        mPresentFencesToCheck.swap(mPendingPresentFences);
     }
 
     // Execute the following logic unlocked to enhance performance.
-    int64_t lastSignalTime = getLastFenceSignalTimeUnlocked(fence);
-    if (close(fence)) {
-        LOG(ERROR) << "VrrController: close fence file failed, errno = " << errno;
-        return;
-    } else if (lastSignalTime == SIGNAL_TIME_PENDING || lastSignalTime == SIGNAL_TIME_INVALID) {
+    mPresentFenceSignalTimes.clear();
+    for (int fence : mPresentFencesToCheck) {
+        int64_t lastSignalTime = getLastFenceSignalTimeUnlocked(fence);
+        if (close(fence)) {
+            LOG(ERROR) << "VrrController: close fence file failed, errno = " << errno;
+        } else if ((lastSignalTime != SIGNAL_TIME_PENDING) &&
+                   (lastSignalTime != SIGNAL_TIME_INVALID)) {
+            mPresentFenceSignalTimes.push_back(lastSignalTime);
+        }
+    }
+    mPresentFencesToCheck.clear();
+    if (mPresentFenceSignalTimes.empty()) {
         return;
     }
 
     {
-        // Acquire the mutex again to store the vsync record.
+        // Acquire the mutex again to store the vsync records.
         const std::lock_guard<std::mutex> lock(mMutex);
-        mRecord.mVsyncHistory
-                .next() = {.mType = VariableRefreshRateController::VsyncEvent::Type::kReleaseFence,
-                           .mTime = lastSignalTime};
+        for (int64_t signalTime : mPresentFenceSignalTimes) {
+            mRecord.mVsyncHistory
+                    .next() = {.mType = VariableRefreshRateController::VsyncEvent::Type::
+                                       kReleaseFence,
+                               .mTime = signalTime};
+        }
     }
 }
 
@@ -21,7 +21,6 @@
 #include <list>
 #include <map>
 #include <optional>
-#include <queue>
 #include <thread>
 
 #include "../libdevice/ExynosDisplay.h"
@@ -29,7 +28,10 @@
 #include "EventQueue.h"
 #include "ExternalEventHandlerLoader.h"
 #include "FileNode.h"
+#include "FrameInsertionScheduler.h"
 #include "Power/DisplayStateResidencyWatcher.h"
+#include "PresentCadencePredictor.h"
+#include "PresentRecordQueue.h"
 #include "RefreshRateCalculator/RefreshRateCalculator.h"
 #include "RingBuffer.h"
 #include "Statistics/VariableRefreshRateStatistic.h"
@@ -152,48 +154,16 @@ private:
 
     static constexpr int64_t kDefaultAheadOfTimeNs = 1000000; // 1 ms;
 
+    // A frame insertion postponed for a predicted present is still made half of the margin ahead
+    // of the panel deadline.
+    static constexpr int64_t kMaxFrameInsertionPostponementNs = kDefaultAheadOfTimeNs / 2;
+
     enum class VrrControllerState {
         kDisable = 0,
         kRendering,
         kHibernate,
     };
 
-    typedef struct PendingVendorRenderingTimeoutTasks {
-        PendingVendorRenderingTimeoutTasks(VariableRefreshRateController* controller)
-              : host(controller), taskExecutionTimeNs(kDefaultMaximumNumberOfTasks, 0) {}
-
-        void addTask(int64_t executionIntervalNs) {
-            taskExecutionTimeNs[numberOfTasks++] = baseTimeNs + executionIntervalNs;
-        }
-
-        void scheduleNextTask() {
-            if (!isDone()) {
-                host->postEvent(VrrControllerEventType::kVendorRenderingTimeoutPost,
-                                std::max(getSteadyClockTimeNs(),
-                                         taskExecutionTimeNs[nextTaskIndex++] -
-                                                 kDefaultAheadOfTimeNs));
-            }
-        }
-
-        bool isDone() const { return (numberOfTasks == nextTaskIndex); }
-
-        void reserveSpace(size_t size) {
-            if (size > taskExecutionTimeNs.size()) {
-                taskExecutionTimeNs.resize(size);
-            }
-        }
-
-        void reset() { numberOfTasks = nextTaskIndex = 0; }
-
-        static constexpr size_t kDefaultMaximumNumberOfTasks = 10;
-
-        VariableRefreshRateController* host;
-        int64_t baseTimeNs = 0;
-        int numberOfTasks = 0;
-        int nextTaskIndex = 0;
-        std::vector<int64_t> taskExecutionTimeNs;
-    } PendingVendorRenderingTimeoutTasks;
-
     typedef struct PresentEvent {
         hwc2_config_t config;
         int64_t mTime;
@@ -270,11 +240,20 @@ private:
     virtual void onPresent(int32_t fence) override;
     virtual void setExpectedPresentTime(int64_t timestampNanos, int frameIntervalNs) override;
 
+    // Returns false if the present is not handed over to the VRR controller thread. The record is
+    // queued under the same lock as the state update, so a configuration change cannot drain the
+    // queue in between and account the present under the new configuration.
+    bool updateStateOnPresentLocked(int fence);
+
     // Implement interface VsyncListener.
     virtual void onVsync(int64_t timestamp, int32_t vsyncPeriodNanos) override;
 
     void cancelPresentTimeoutHandlingLocked();
 
+    // Feeds the queued presents to the calculators and statistics.
+    void drainPresentRecordsLocked() { mPresentRecords.drain(); }
+    void dropPresentRecordsLocked();
+
     void dropEventLocked();
     void dropEventLocked(VrrControllerEventType eventType);
 
@@ -342,6 +321,9 @@ private:
     // The core function of the VRR controller thread.
     void threadBody();
 
+    // Hands the last present fence over to updateVsyncHistory.
+    void retireLastPresentFenceLocked();
+
     void updateVsyncHistory();
 
     ExynosDisplay* mDisplay;
@@ -357,6 +339,11 @@ private:
     hwc2_config_t mVrrActiveConfig = -1;
     std::unordered_map<hwc2_config_t, VrrConfig_t> mVrrConfigs;
     std::optional<int> mLastPresentFence;
+    // Fences of earlier presents whose signal time has not been recorded yet.
+    std::vector<int> mPendingPresentFences;
+    // Only accessed by the VRR controller thread.
+    std::vector<int> mPresentFencesToCheck;
+    std::vector<int64_t> mPresentFenceSignalTimes;
     uint32_t mFrameRate = 0;
 
     std::shared_ptr<FileNode> mFileNode;
@@ -404,7 +391,12 @@ private:
 
     std::vector<std::shared_ptr<RefreshRateChangeListener>> mRefreshRateChangeListeners;
 
-    PendingVendorRenderingTimeoutTasks mPendingVendorRenderingTimeoutTasks;
+    PresentCadencePredictor mPresentCadencePredictor;
+    FrameInsertionScheduler mFrameInsertionScheduler;
+
+    // Pushed by the calling thread of onPresent and drained by the VRR controller thread, both
+    // with mMutex held.
+    PresentRecordQueue mPresentRecords;
 
     std::mutex mMutex;
     std::condition_variable mCondition;
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <hardware/hwcomposer2.h>
+
 #include "../../interface/DisplayContextProvider.h"
 #include "../RefreshRateCalculator/VideoFrameRateCalculator.h"
 #include "DisplayConfigurationOwner.h"
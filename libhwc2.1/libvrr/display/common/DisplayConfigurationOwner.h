@@ -16,7 +16,7 @@
 
 #pragma once
 
-#include "../libdevice/ExynosDisplay.h"
+#include "../libdevice/ExynosDisplayConfig.h"
 
 namespace android::hardware::graphics::composer {
 
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "EventQueue.h"
+
+namespace android::hardware::graphics::composer {
+
+namespace {
+
+constexpr int64_t k240HzPeriodNs = 4166666;
+
+// The event traffic of one present at 240Hz: the timeouts of the previous frame are cancelled and
+// posted again, the calculators post their periodic updates, and whatever is due is popped.
+void BM_EventQueue240HzPresent(benchmark::State& state) {
+    EventQueue queue;
+    int64_t nowNs = 0;
+    int frame = 0;
+    for (auto _ : state) {
+        queue.dropEventWithMask(VrrControllerEventType::kSystemRenderingTimeout);
+        queue.dropEventWithMask(VrrControllerEventType::kVendorRenderingTimeoutInit);
+        queue.dropEventWithMask(VrrControllerEventType::kVendorRenderingTimeoutPost);
+        queue.postEvent(VrrControllerEventType::kSystemRenderingTimeout, nowNs + 500000000);
+        queue.postEvent(VrrControllerEventType::kVendorRenderingTimeoutInit, nowNs + 32000000);
+        if (frame % 60 == 0) {
+            queue.postEvent(VrrControllerEventType::kPeriodRefreshRateCalculatorUpdate,
+                            nowNs + 250000000);
+        }
+        if (frame % 240 == 0) {
+            queue.postEvent(VrrControllerEventType::kStaticticUpdate, nowNs + 1000000000);
+        }
+        while (!queue.empty() && (queue.top().mWhenNs <= nowNs)) {
+            benchmark::DoNotOptimize(queue.pop());
+        }
+        nowNs += k240HzPeriodNs;
+        frame++;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EventQueue240HzPresent);
+
+// Cancelling one event by handle among a realistic number of pending events.
+void BM_EventQueueDropByHandle(benchmark::State& state) {
+    EventQueue queue;
+    for (int i = 0; i < 16; i++) {
+        queue.postEvent(VrrControllerEventType::kPeriodRefreshRateCalculatorUpdate,
+                        i * k240HzPeriodNs);
+    }
+    int64_t whenNs = 0;
+    for (auto _ : state) {
+        auto handle = queue.postEvent(VrrControllerEventType::kTestEvent, whenNs++ % 100000000);
+        benchmark::DoNotOptimize(queue.dropEvent(handle));
+    }
+}
+BENCHMARK(BM_EventQueueDropByHandle);
+
+} // namespace
+
+} // namespace android::hardware::graphics::composer
+
+BENCHMARK_MAIN();
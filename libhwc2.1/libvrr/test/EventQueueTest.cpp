@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "EventQueue.h"
+
+namespace android::hardware::graphics::composer {
+
+namespace {
+
+constexpr auto kSystemTimeout = VrrControllerEventType::kSystemRenderingTimeout;
+constexpr auto kVendorInit = VrrControllerEventType::kVendorRenderingTimeoutInit;
+constexpr auto kVendorPost = VrrControllerEventType::kVendorRenderingTimeoutPost;
+constexpr auto kHibernate = VrrControllerEventType::kHibernateTimeout;
+constexpr auto kPeriodUpdate = VrrControllerEventType::kPeriodRefreshRateCalculatorUpdate;
+
+std::vector<int> popAllIds(EventQueue& queue) {
+    std::vector<int> ids;
+    while (!queue.empty()) {
+        auto event = queue.pop();
+        ids.push_back(event.mFunctor ? event.mFunctor() : -1);
+    }
+    return ids;
+}
+
+EventQueue::Handle postWithId(EventQueue& queue, VrrControllerEventType type, int64_t whenNs,
+                              int id) {
+    VrrControllerEvent event;
+    event.mEventType = type;
+    event.mWhenNs = whenNs;
+    event.mFunctor = [id]() { return id; };
+    return queue.postEvent(std::move(event));
+}
+
+} // namespace
+
+TEST(EventQueueTest, PopsInTimeOrder) {
+    EventQueue queue;
+    postWithId(queue, kSystemTimeout, 300, 3);
+    postWithId(queue, kHibernate, 100, 1);
+    postWithId(queue, kVendorInit, 400, 4);
+    postWithId(queue, kPeriodUpdate, 200, 2);
+
+    EXPECT_EQ(queue.size(), 4u);
+    EXPECT_EQ(queue.top().mWhenNs, 100);
+    EXPECT_EQ(popAllIds(queue), (std::vector<int>{1, 2, 3, 4}));
+}
+
+TEST(EventQueueTest, SameTimeIsFifo) {
+    EventQueue queue;
+    for (int id = 0; id < 16; id++) {
+        postWithId(queue, (id % 2) ? kVendorPost : kSystemTimeout, 1000, id);
+    }
+    postWithId(queue, kHibernate, 500, 100);
+
+    std::vector<int> expected = {100};
+    for (int id = 0; id < 16; id++) expected.push_back(id);
+    EXPECT_EQ(popAllIds(queue), expected);
+}
+
+TEST(EventQueueTest, ForEachEventVisitsInPopOrder) {
+    EventQueue queue;
+    postWithId(queue, kSystemTimeout, 20, 2);
+    postWithId(queue, kHibernate, 10, 0);
+    postWithId(queue, kVendorInit, 10, 1);
+
+    std::vector<int> visited;
+    queue.forEachEvent([&visited](const VrrControllerEvent& event) {
+        visited.push_back(event.mFunctor());
+    });
+    EXPECT_EQ(visited, (std::vector<int>{0, 1, 2}));
+    EXPECT_EQ(queue.size(), 3u);
+}
+
+TEST(EventQueueTest, DropByHandle) {
+    EventQueue queue;
+    postWithId(queue, kSystemTimeout, 100, 1);
+    auto handle = postWithId(queue, kSystemTimeout, 200, 2);
+    postWithId(queue, kSystemTimeout, 300, 3);
+
+    EXPECT_TRUE(queue.dropEvent(handle));
+    EXPECT_FALSE(queue.dropEvent(handle));
+    EXPECT_FALSE(queue.dropEvent(EventQueue::kInvalidHandle));
+    EXPECT_EQ(queue.getNumberOfEvents(kSystemTimeout), 2u);
+    EXPECT_EQ(popAllIds(queue), (std::vector<int>{1, 3}));
+}
+
+TEST(EventQueueTest, StaleHandleDoesNotDropReusedSlot) {
+    EventQueue queue;
+    auto stale = postWithId(queue, kHibernate, 100, 1);
+    queue.pop();
+    EXPECT_FALSE(queue.dropEvent(stale));
+
+    /* the new event reuses the slot of the popped one */
+    auto fresh = postWithId(queue, kHibernate, 200, 2);
+    EXPECT_NE(fresh, stale);
+    EXPECT_FALSE(queue.dropEvent(stale));
+    EXPECT_EQ(queue.size(), 1u);
+    EXPECT_TRUE(queue.dropEvent(fresh));
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(EventQueueTest, DropByType) {
+    EventQueue queue;
+    postWithId(queue, kVendorInit, 100, 1);
+    postWithId(queue, kSystemTimeout, 150, 2);
+    postWithId(queue, kVendorInit, 200, 3);
+    postWithId(queue, kVendorPost, 250, 4);
+
+    queue.dropEvent(kVendorInit);
+    EXPECT_EQ(queue.getNumberOfEvents(kVendorInit), 0u);
+    EXPECT_EQ(popAllIds(queue), (std::vector<int>{2, 4}));
+
+    /* dropping a type that was never posted is a no-op */
+    queue.dropEvent(kHibernate);
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(EventQueueTest, DropWithMask) {
+    EventQueue queue;
+    postWithId(queue, kSystemTimeout, 100, 1);
+    postWithId(queue, kPeriodUpdate, 200, 2);
+    postWithId(queue, kVendorPost, 300, 3);
+    postWithId(queue, VrrControllerEventType::kMinLockTimeForPeakRefreshRate, 400, 4);
+
+    /* a single type as mask only drops that type */
+    queue.dropEventWithMask(kVendorPost);
+    EXPECT_EQ(queue.size(), 3u);
+
+    queue.dropEventWithMask(VrrControllerEventType::kGeneralEventMask);
+    EXPECT_EQ(queue.getNumberOfEvents(kSystemTimeout), 0u);
+    EXPECT_EQ(popAllIds(queue), (std::vector<int>{2, 4}));
+}
+
+TEST(EventQueueTest, DropAll) {
+    EventQueue queue;
+    for (int id = 0; id < 10; id++) postWithId(queue, kHibernate, id, id);
+    queue.dropEvent();
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.getNumberOfEvents(kHibernate), 0u);
+}
+
+TEST(EventQueueTest, PerTypeCounts) {
+    EventQueue queue;
+    postWithId(queue, kSystemTimeout, 100, 1);
+    postWithId(queue, kSystemTimeout, 200, 2);
+    auto handle = postWithId(queue, kHibernate, 50, 3);
+    EXPECT_EQ(queue.getNumberOfEvents(kSystemTimeout), 2u);
+    EXPECT_EQ(queue.getNumberOfEvents(kHibernate), 1u);
+    EXPECT_EQ(queue.getNumberOfEvents(kVendorInit), 0u);
+
+    queue.pop();
+    EXPECT_EQ(queue.getNumberOfEvents(kHibernate), 0u);
+    EXPECT_FALSE(queue.dropEvent(handle));
+    queue.pop();
+    EXPECT_EQ(queue.getNumberOfEvents(kSystemTimeout), 1u);
+}
+
+TEST(EventQueueTest, MatchesReferenceModel) {
+    struct Posted {
+        int64_t whenNs;
+        uint64_t sequence;
+        VrrControllerEventType type;
+        EventQueue::Handle handle;
+    };
+    const std::vector<VrrControllerEventType> types = {kSystemTimeout, kVendorInit, kHibernate,
+                                                       kPeriodUpdate};
+    std::mt19937 random(1);
+    EventQueue queue;
+    std::vector<Posted> model;
+    uint64_t sequence = 0;
+    auto earliest = [&model]() {
+        return std::min_element(model.begin(), model.end(), [](const auto& lhs, const auto& rhs) {
+            return (lhs.whenNs != rhs.whenNs) ? (lhs.whenNs < rhs.whenNs)
+                                              : (lhs.sequence < rhs.sequence);
+        });
+    };
+    auto eraseIf = [&model](auto predicate) {
+        model.erase(std::remove_if(model.begin(), model.end(), predicate), model.end());
+    };
+
+    for (int step = 0; step < 20000; step++) {
+        const auto operation = random() % 6;
+        if (operation <= 2) {
+            auto type = types[random() % types.size()];
+            int64_t whenNs = random() % 50;
+            model.push_back({whenNs, sequence++, type, queue.postEvent(type, whenNs)});
+        } else if ((operation == 3) && !model.empty()) {
+            auto expected = earliest();
+            ASSERT_EQ(queue.top().mWhenNs, expected->whenNs);
+            ASSERT_EQ(queue.pop().mEventType, expected->type);
+            ASSERT_FALSE(queue.dropEvent(expected->handle));
+            model.erase(expected);
+        } else if ((operation == 4) && !model.empty()) {
+            size_t index = random() % model.size();
+            ASSERT_TRUE(queue.dropEvent(model[index].handle));
+            model.erase(model.begin() + index);
+        } else if (operation == 5) {
+            if (random() % 10 == 0) {
+                queue.dropEventWithMask(VrrControllerEventType::kGeneralEventMask);
+                eraseIf([](const Posted& posted) {
+                    return static_cast<int>(posted.type) &
+                            static_cast<int>(VrrControllerEventType::kGeneralEventMask);
+                });
+            } else {
+                auto type = types[random() % types.size()];
+                queue.dropEvent(type);
+                eraseIf([type](const Posted& posted) { return posted.type == type; });
+            }
+        }
+        ASSERT_EQ(queue.size(), model.size());
+        for (auto type : types) {
+            ASSERT_EQ(queue.getNumberOfEvents(type),
+                      static_cast<size_t>(std::count_if(model.begin(), model.end(),
+                                                        [type](const Posted& posted) {
+                                                            return posted.type == type;
+                                                        })));
+        }
+    }
+}
+
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <map>
+
+#include "display/common/CommonDisplayContextProvider.h"
+
+namespace android::hardware::graphics::composer {
+
+// Display context of a panel with a 120Hz and a 60Hz configuration with a 240Hz TE, and a 60Hz
+// configuration with a 120Hz TE.
+class FakeDisplayContextProvider : public CommonDisplayContextProvider,
+                                   public DisplayConfigurationsOwner {
+public:
+    static constexpr hwc2_config_t k120HzConfig = 0;
+    static constexpr hwc2_config_t k60HzConfig = 1;
+    static constexpr hwc2_config_t k60HzTe120Config = 2;
+    static constexpr int kTeFrequency = 240;
+
+    explicit FakeDisplayContextProvider(
+            std::shared_ptr<RefreshRateCalculator> videoFrameRateCalculator = nullptr)
+          : CommonDisplayContextProvider(this, std::move(videoFrameRateCalculator)) {
+        addConfig(k120HzConfig, 120);
+        addConfig(k60HzConfig, 60);
+        addConfig(k60HzTe120Config, 60, 120);
+    }
+
+    const displayConfigs_t* getCurrentDisplayConfiguration() const override {
+        return getDisplayConfig(mActiveConfig);
+    }
+
+    BrightnessMode getBrightnessMode() const override { return mBrightnessMode; }
+    int getBrightnessNits() const override { return mBrightnessNits; }
+    const char* getDisplayFileNodePath() const override { return ""; }
+    int getAmbientLightSensorOutput() const override { return 0; }
+    bool isProximityThrottlingEnabled() const override { return false; }
+
+    const std::map<uint32_t, displayConfigs_t>* getDisplayConfigs() const override {
+        return &mConfigs;
+    }
+    const displayConfigs_t* getDisplayConfig(hwc2_config_t id) const override {
+        auto it = mConfigs.find(id);
+        return (it == mConfigs.end()) ? nullptr : &it->second;
+    }
+    int getMaxFrameRate(hwc2_config_t id) const override {
+        auto config = getDisplayConfig(id);
+        return config ? config->refreshRate : 0;
+    }
+    int getTeFrequency(hwc2_config_t id) const override {
+        auto config = getDisplayConfig(id);
+        return config ? durationNsToFreq(config->vsyncPeriod) : 0;
+    }
+    int getWidth(hwc2_config_t id) const override {
+        auto config = getDisplayConfig(id);
+        return config ? config->width : 0;
+    }
+    int getHeight(hwc2_config_t id) const override {
+        auto config = getDisplayConfig(id);
+        return config ? config->height : 0;
+    }
+    bool isHsMode(hwc2_config_t id) const override {
+        auto config = getDisplayConfig(id);
+        return config && !config->isNsMode;
+    }
+
+    void setActiveConfig(hwc2_config_t id) { mActiveConfig = id; }
+    void setBrightnessMode(BrightnessMode mode) { mBrightnessMode = mode; }
+
+private:
+    void addConfig(hwc2_config_t id, int refreshRate, int teFrequency = kTeFrequency) {
+        displayConfigs_t config = {};
+        config.vsyncPeriod = std::nano::den / teFrequency;
+        config.width = 1080;
+        config.height = 2400;
+        config.refreshRate = refreshRate;
+        VrrConfig_t vrrConfig;
+        vrrConfig.isFullySupported = true;
+        vrrConfig.vsyncPeriodNs = std::nano::den / teFrequency;
+        vrrConfig.minFrameIntervalNs = std::nano::den / refreshRate;
+        config.vrrConfig = vrrConfig;
+        mConfigs[id] = config;
+    }
+
+    std::map<uint32_t, displayConfigs_t> mConfigs;
+    hwc2_config_t mActiveConfig = k120HzConfig;
+    BrightnessMode mBrightnessMode = BrightnessMode::kNormalBrightnessMode;
+    int mBrightnessNits = 500;
+};
+
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "FrameInsertionScheduler.h"
+#include "RecordingFileNode.h"
+#include "VirtualClock.h"
+#include "interface/Panel_def.h"
+
+namespace android::hardware::graphics::composer {
+
+namespace {
+
+constexpr int64_t kMsNs = 1000000;
+constexpr int64_t kAheadOfTimeNs = kMsNs;
+constexpr auto kVendorInit = VrrControllerEventType::kVendorRenderingTimeoutInit;
+constexpr auto kVendorPost = VrrControllerEventType::kVendorRenderingTimeoutPost;
+
+} // namespace
+
+TEST(FrameInsertionSchedulerTest, PostsFirstInsertionAheadOfTimeout) {
+    ScopedVirtualClock clock;
+    EventQueue queue;
+    FrameInsertionScheduler scheduler(&queue, kAheadOfTimeNs);
+    const int64_t presentNs = clock.getSteadyClockTimeNs();
+    scheduler.onPresent(presentNs, 33 * kMsNs);
+    ASSERT_EQ(queue.size(), 1);
+    EXPECT_EQ(queue.top().mEventType, kVendorInit);
+    EXPECT_EQ(queue.top().mWhenNs, presentNs + 33 * kMsNs - kAheadOfTimeNs);
+}
+
+TEST(FrameInsertionSchedulerTest, IgnoresTimeoutShorterThanAheadOfTime) {
+    ScopedVirtualClock clock;
+    EventQueue queue;
+    FrameInsertionScheduler scheduler(&queue, kAheadOfTimeNs);
+    scheduler.onPresent(clock.getSteadyClockTimeNs(), kAheadOfTimeNs / 2);
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(FrameInsertionSchedulerTest, PostsScheduleOneInsertionAtATime) {
+    ScopedVirtualClock clock;
+    EventQueue queue;
+    FrameInsertionScheduler scheduler(&queue, kAheadOfTimeNs);
+    const int64_t baseNs = clock.getSteadyClockTimeNs() + 33 * kMsNs;
+    scheduler.onPresent(clock.getSteadyClockTimeNs(), 33 * kMsNs);
+    queue.pop();
+
+    EXPECT_FALSE(scheduler.startInsertions());
+    scheduler.addInsertion(0);
+    scheduler.addInsertion(20 * kMsNs);
+    scheduler.addInsertion(40 * kMsNs);
+    ASSERT_TRUE(scheduler.startInsertions());
+    for (int64_t intervalNs : {20 * kMsNs, 40 * kMsNs}) {
+        EXPECT_FALSE(scheduler.isDone());
+        scheduler.scheduleNextInsertion();
+        ASSERT_EQ(queue.size(), 1);
+        auto event = queue.pop();
+        EXPECT_EQ(event.mEventType, kVendorPost);
+        EXPECT_EQ(event.mWhenNs, baseNs + intervalNs - kAheadOfTimeNs);
+    }
+    EXPECT_TRUE(scheduler.isDone());
+    scheduler.scheduleNextInsertion();
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(FrameInsertionSchedulerTest, LateInsertionIsPostedNow) {
+    ScopedVirtualClock clock;
+    EventQueue queue;
+    FrameInsertionScheduler scheduler(&queue, kAheadOfTimeNs);
+    scheduler.onPresent(clock.getSteadyClockTimeNs(), 33 * kMsNs);
+    queue.pop();
+    scheduler.addInsertion(0);
+    scheduler.addInsertion(10 * kMsNs);
+    ASSERT_TRUE(scheduler.startInsertions());
+    clock.advanceNs(100 * kMsNs);
+    scheduler.scheduleNextInsertion();
+    ASSERT_EQ(queue.size(), 1);
+    EXPECT_EQ(queue.top().mWhenNs, clock.getSteadyClockTimeNs());
+}
+
+TEST(FrameInsertionSchedulerTest, CancelDropsPendingInsertions) {
+    ScopedVirtualClock clock;
+    EventQueue queue;
+    queue.postEvent(VrrControllerEventType::kSystemRenderingTimeout, 0);
+    FrameInsertionScheduler scheduler(&queue, kAheadOfTimeNs);
+    scheduler.onPresent(clock.getSteadyClockTimeNs(), 33 * kMsNs);
+    scheduler.addInsertion(0);
+    scheduler.addInsertion(10 * kMsNs);
+    ASSERT_TRUE(scheduler.startInsertions());
+    scheduler.scheduleNextInsertion();
+    EXPECT_EQ(queue.size(), 3);
+
+    scheduler.cancel();
+    ASSERT_EQ(queue.size(), 1);
+    EXPECT_EQ(queue.top().mEventType, VrrControllerEventType::kSystemRenderingTimeout);
+    EXPECT_TRUE(scheduler.isDone());
+    EXPECT_FALSE(scheduler.startInsertions());
+}
+
+TEST(FrameInsertionSchedulerTest, AdjusterMovesInsertions) {
+    ScopedVirtualClock clock;
+    EventQueue queue;
+    FrameInsertionScheduler scheduler(&queue, kAheadOfTimeNs,
+                                      [](int64_t whenNs) { return whenNs + 5 * kMsNs; });
+    const int64_t presentNs = clock.getSteadyClockTimeNs();
+    scheduler.onPresent(presentNs, 33 * kMsNs);
+    ASSERT_EQ(queue.size(), 1);
+    EXPECT_EQ(queue.pop().mWhenNs, presentNs + 37 * kMsNs);
+
+    scheduler.addInsertion(0);
+    scheduler.addInsertion(10 * kMsNs);
+    ASSERT_TRUE(scheduler.startInsertions());
+    scheduler.scheduleNextInsertion();
+    ASSERT_EQ(queue.size(), 1);
+    EXPECT_EQ(queue.pop().mWhenNs, presentNs + 47 * kMsNs);
+}
+
+TEST(FrameInsertionSchedulerTest, InsertFrameKeepsRefreshControlState) {
+    ScopedVirtualClock clock;
+    RecordingFileNode fileNode;
+    EXPECT_FALSE(FrameInsertionScheduler::insertFrame(fileNode));
+    EXPECT_EQ(fileNode.countWrites(kRefreshControlNodeName), 0);
+
+    uint32_t command = kPanelRefreshCtrlFrameInsertionAutoMode;
+    setBitField(command, 10, kPanelRefreshCtrlMinimumRefreshRateOffset,
+                kPanelRefreshCtrlMinimumRefreshRateMask);
+    fileNode.writeValue(kRefreshControlNodeName, command);
+    EXPECT_TRUE(FrameInsertionScheduler::insertFrame(fileNode));
+
+    uint32_t expected = 0;
+    setBitField(expected, 10, kPanelRefreshCtrlMinimumRefreshRateOffset,
+                kPanelRefreshCtrlMinimumRefreshRateMask);
+    setBitField(expected, 1, kPanelRefreshCtrlFrameInsertionFrameCountOffset,
+                kPanelRefreshCtrlFrameInsertionFrameCountMask);
+    ASSERT_EQ(fileNode.getWrites().size(), 2);
+    EXPECT_EQ(fileNode.getWrites().back().mNodeName, kRefreshControlNodeName);
+    EXPECT_EQ(fileNode.getWrites().back().mValue, std::to_string(expected));
+}
+
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <map>
+
+#include "RefreshRateCalculator/PeriodRefreshRateCalculator.h"
+
+namespace android::hardware::graphics::composer {
+
+// The measurement of PeriodRefreshRateCalculator as it was before its histogram moved to a dense
+// array: the presents of a period are counted in a std::map keyed by frame rate. The caller ends
+// each period with measure(). It serves as the reference for the dense implementation and as the
+// baseline of its benchmark.
+class MapPeriodRefreshRateCalculator : public RefreshRateCalculator {
+public:
+    explicit MapPeriodRefreshRateCalculator(const PeriodRefreshRateCalculatorParameters& params)
+          : mParams(params),
+            mConfidenceThresholdTimeNs(params.mMeasurePeriodNs * params.mConfidencePercentage /
+                                       100) {}
+
+    int getRefreshRate() const override { return mLastRefreshRate; }
+
+    void onPresentInternal(int64_t presentTimeNs, int flag) override {
+        if (hasPresentFrameFlag(flag, PresentFrameFlag::kPresentingWhenDoze)) {
+            return;
+        }
+        if (mLastPresentTimeNs >= 0) {
+            auto periodNs = presentTimeNs - mLastPresentTimeNs;
+            if (periodNs <= std::nano::den) {
+                int numVsync = std::max(mMinVsyncNum, durationToVsync(periodNs));
+                ++mStatistics[Fraction<int>(mVsyncRate, numVsync)];
+            }
+        }
+        mLastPresentTimeNs = presentTimeNs;
+    }
+
+    void reset() override {
+        mStatistics.clear();
+        mLastRefreshRate = kDefaultInvalidRefreshRate;
+        mLastPresentTimeNs = kDefaultInvalidPresentTimeNs;
+    }
+
+    // Ends the current period and returns its refresh rate.
+    int measure() {
+        int currentRefreshRate = kDefaultInvalidRefreshRate;
+        int totalPresent = 0;
+        int64_t totalDurationNs = 0;
+        int maxOccurrence = 0;
+        Fraction<int> majorRefreshRate;
+
+        for (const auto& [rate, count] : mStatistics) {
+            totalPresent += count;
+            totalDurationNs += freqToDurationNs(rate) * count;
+            if (count > maxOccurrence) {
+                maxOccurrence = count;
+                majorRefreshRate = rate;
+            }
+        }
+        if (totalPresent > 0 && (totalDurationNs > mConfidenceThresholdTimeNs)) {
+            if (mParams.mType == PeriodRefreshRateCalculatorType::kAverage) {
+                if (mParams.mMeasurePeriodNs > totalDurationNs * 2) {
+                    totalDurationNs = mParams.mMeasurePeriodNs;
+                    totalPresent++;
+                }
+                auto avgDurationNs =
+                        roundDivide(totalDurationNs, static_cast<int64_t>(totalPresent));
+                currentRefreshRate = durationNsToFreq(avgDurationNs);
+            } else {
+                currentRefreshRate = majorRefreshRate.round();
+            }
+        }
+        mStatistics.clear();
+        currentRefreshRate = std::max(currentRefreshRate, 1);
+        mLastRefreshRate = std::min(currentRefreshRate, mMaxFrameRate);
+        return mLastRefreshRate;
+    }
+
+private:
+    const PeriodRefreshRateCalculatorParameters mParams;
+    const int64_t mConfidenceThresholdTimeNs;
+    std::map<Fraction<int>, int> mStatistics;
+    int64_t mLastPresentTimeNs = kDefaultInvalidPresentTimeNs;
+    int mLastRefreshRate = kDefaultInvalidRefreshRate;
+};
+
+} // namespace android::hardware::graphics::composer
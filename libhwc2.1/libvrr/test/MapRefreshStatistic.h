@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <string>
+
+#include "Statistics/VariableRefreshRateStatistic.h"
+
+namespace android::hardware::graphics::composer {
+
+// The bookkeeping of VariableRefreshRateStatistic as it was before the records moved to dense
+// arrays: every refresh looks its record up in a DisplayRefreshStatistics map. It serves as the
+// reference for the dense implementation and as the baseline of its benchmark, so it also takes
+// the lock where the statistic did.
+class MapRefreshStatistic {
+public:
+    MapRefreshStatistic(CommonDisplayContextProvider* displayContextProvider, int maxFrameRate)
+          : mDisplayContextProvider(displayContextProvider),
+            mTeFrequency(maxFrameRate),
+            mTeIntervalNs(roundDivide(std::nano::den, static_cast<int64_t>(mTeFrequency))) {
+        mStatistics[mDisplayRefreshProfile] = DisplayRefreshRecord();
+    }
+
+    uint64_t getPowerOffDurationNs() const {
+        if (isPowerModeOff(mDisplayRefreshProfile.mCurrentDisplayConfig.mPowerMode)) {
+            const auto& item = mStatistics.find(mDisplayRefreshProfile);
+            return mPowerOffDurationNs +
+                    (getBootClockTimeNs() - item->second.mLastTimeStampInBootClockNs);
+        }
+        return mPowerOffDurationNs;
+    }
+
+    DisplayRefreshStatistics getStatistics() {
+        updateIdleStats();
+        std::scoped_lock lock(mMutex);
+        return mStatistics;
+    }
+
+    DisplayRefreshStatistics getUpdatedStatistics() {
+        updateIdleStats();
+        std::scoped_lock lock(mMutex);
+        for (auto& it : mStatistics) {
+            if (it.second.mUpdated && (it.first.mNumVsync < 0)) {
+                it.second.mAccumulatedTimeNs = getPowerOffDurationNs();
+            }
+        }
+        DisplayRefreshStatistics updatedStatistics = mStatistics;
+        if (isPowerModeOff(mDisplayRefreshProfile.mCurrentDisplayConfig.mPowerMode)) {
+            mStatistics[mDisplayRefreshProfile].mUpdated = true;
+        }
+        return updatedStatistics;
+    }
+
+    std::string dumpStatistics(bool getUpdatedOnly, RefreshSource refreshSource,
+                               const std::string& delimiter = ";") {
+        std::string res;
+        updateIdleStats();
+        std::scoped_lock lock(mMutex);
+        for (auto& it : mStatistics) {
+            if ((getUpdatedOnly && !it.second.mUpdated) ||
+                !(it.first.mRefreshSource & refreshSource)) {
+                continue;
+            }
+            if (it.first.mNumVsync < 0) {
+                it.second.mAccumulatedTimeNs = getPowerOffDurationNs();
+            }
+            res += "[" + it.first.toString() + " , " + it.second.toString() + "]" + delimiter;
+        }
+        return res;
+    }
+
+    void onPowerStateChange(int from, int to) {
+        if (from == to) {
+            return;
+        }
+        updateIdleStats();
+        std::scoped_lock lock(mMutex);
+        if (isPowerModeOff(to)) {
+            mDisplayRefreshProfile.mCurrentDisplayConfig.mPowerMode = HWC_POWER_MODE_OFF;
+            auto& record = mStatistics[mDisplayRefreshProfile];
+            ++record.mCount;
+            record.mLastTimeStampInBootClockNs = getBootClockTimeNs();
+            record.mUpdated = true;
+            mLastRefreshTimeInBootClockNs = kDefaultInvalidPresentTimeNs;
+        } else {
+            if (isPowerModeOff(from)) {
+                mPowerOffDurationNs += (getBootClockTimeNs() -
+                                        mStatistics[mDisplayRefreshProfile]
+                                                .mLastTimeStampInBootClockNs);
+            }
+            mDisplayRefreshProfile.mCurrentDisplayConfig.mPowerMode = to;
+            if (to == HWC_POWER_MODE_DOZE) {
+                mDisplayRefreshProfile.mNumVsync = mTeFrequency;
+                auto& record = mStatistics[mDisplayRefreshProfile];
+                ++record.mCount;
+                record.mLastTimeStampInBootClockNs = getBootClockTimeNs();
+                record.mUpdated = true;
+            }
+        }
+    }
+
+    void onPresent(int64_t presentTimeNs, int flag) {
+        onRefreshInternal(presentTimeNs, flag, RefreshSource::kRefreshSourceActivePresent);
+    }
+
+    void onNonPresentRefresh(int64_t refreshTimeNs, RefreshSource refreshSource) {
+        onRefreshInternal(refreshTimeNs, 0, refreshSource);
+    }
+
+    void setActiveVrrConfiguration(int activeConfigId, int teFrequency) {
+        updateIdleStats();
+        auto& profile = mDisplayRefreshProfile;
+        profile.mCurrentDisplayConfig.mActiveConfigId = activeConfigId;
+        profile.mWidth = mDisplayContextProvider->getWidth(activeConfigId);
+        profile.mHeight = mDisplayContextProvider->getHeight(activeConfigId);
+        profile.mTeFrequency = mDisplayContextProvider->getTeFrequency(activeConfigId);
+        mTeFrequency = teFrequency;
+        mTeIntervalNs = roundDivide(std::nano::den, static_cast<int64_t>(mTeFrequency));
+    }
+
+    void setFixedRefreshRate(uint32_t rate) {
+        if (mMinimumRefreshRate == rate) {
+            return;
+        }
+        updateIdleStats();
+        mMinimumRefreshRate = rate;
+        mMaximumFrameIntervalNs = (mMinimumRefreshRate > 1)
+                ? roundDivide(std::nano::den, static_cast<int64_t>(mMinimumRefreshRate))
+                : kMaxRefreshIntervalNs;
+    }
+
+private:
+    static constexpr int64_t kMaxRefreshIntervalNs = std::nano::den;
+    static constexpr uint32_t kFrameRateWhenPresentAtLpMode = 30;
+
+    void onRefreshInternal(int64_t refreshTimeNs, int flag, RefreshSource refreshSource) {
+        int64_t refreshTimeInBootClockNs = steadyClockTimeToBootClockTimeNs(refreshTimeNs);
+        if (mLastRefreshTimeInBootClockNs == kDefaultInvalidPresentTimeNs) {
+            mLastRefreshTimeInBootClockNs = refreshTimeInBootClockNs;
+            updateCurrentDisplayStatus();
+            return;
+        }
+        updateIdleStats(refreshTimeInBootClockNs);
+        updateCurrentDisplayStatus();
+        const bool presentingWhenDoze =
+                hasPresentFrameFlag(flag, PresentFrameFlag::kPresentingWhenDoze);
+        if (presentingWhenDoze) {
+            mDisplayRefreshProfile.mNumVsync = mTeFrequency / kFrameRateWhenPresentAtLpMode;
+            mLastRefreshTimeInBootClockNs =
+                    refreshTimeInBootClockNs + (std::nano::den / kFrameRateWhenPresentAtLpMode);
+        } else {
+            int numVsync =
+                    roundDivide((refreshTimeInBootClockNs - mLastRefreshTimeInBootClockNs),
+                                mTeIntervalNs);
+            if (numVsync == 0) return;
+            mDisplayRefreshProfile.mNumVsync = std::max(1, std::min(mTeFrequency, numVsync));
+            mLastRefreshTimeInBootClockNs = refreshTimeInBootClockNs;
+            mDisplayRefreshProfile.mRefreshSource = refreshSource;
+        }
+        std::scoped_lock lock(mMutex);
+        auto& record = mStatistics[mDisplayRefreshProfile];
+        ++record.mCount;
+        record.mAccumulatedTimeNs += (mTeIntervalNs * mDisplayRefreshProfile.mNumVsync);
+        record.mLastTimeStampInBootClockNs = refreshTimeInBootClockNs;
+        record.mUpdated = true;
+        if (presentingWhenDoze) {
+            mDisplayRefreshProfile.mNumVsync = mTeFrequency;
+            auto& dozeRecord = mStatistics[mDisplayRefreshProfile];
+            ++dozeRecord.mCount;
+            dozeRecord.mLastTimeStampInBootClockNs = mLastRefreshTimeInBootClockNs;
+            dozeRecord.mUpdated = true;
+        }
+    }
+
+    void updateCurrentDisplayStatus() {
+        auto& status = mDisplayRefreshProfile.mCurrentDisplayConfig;
+        status.mBrightnessMode = mDisplayContextProvider->getBrightnessMode();
+        if (status.mBrightnessMode == BrightnessMode::kInvalidBrightnessMode) {
+            status.mBrightnessMode = BrightnessMode::kNormalBrightnessMode;
+        }
+    }
+
+    void updateIdleStats(int64_t endTimeStampInBootClockNs = -1) {
+        if (mDisplayRefreshProfile.isOff()) return;
+        if (mLastRefreshTimeInBootClockNs == kDefaultInvalidPresentTimeNs) return;
+
+        endTimeStampInBootClockNs =
+                endTimeStampInBootClockNs < 0 ? getBootClockTimeNs() : endTimeStampInBootClockNs;
+        auto durationFromLastPresentNs =
+                std::max<int64_t>(0, endTimeStampInBootClockNs - mLastRefreshTimeInBootClockNs);
+        if (mDisplayRefreshProfile.mCurrentDisplayConfig.mPowerMode == HWC_POWER_MODE_DOZE) {
+            mDisplayRefreshProfile.mNumVsync = mTeFrequency;
+            std::scoped_lock lock(mMutex);
+            auto& record = mStatistics[mDisplayRefreshProfile];
+            record.mAccumulatedTimeNs += durationFromLastPresentNs;
+            record.mLastTimeStampInBootClockNs = mLastRefreshTimeInBootClockNs;
+            mLastRefreshTimeInBootClockNs = endTimeStampInBootClockNs;
+            record.mUpdated = true;
+            return;
+        }
+        if ((mMinimumRefreshRate > 1) &&
+            (!isPresentRefresh(mDisplayRefreshProfile.mRefreshSource))) {
+            return;
+        }
+        mDisplayRefreshProfile.mRefreshSource = RefreshSource::kRefreshSourceIdlePresent;
+        int numVsync = roundDivide(durationFromLastPresentNs, mTeIntervalNs);
+        mDisplayRefreshProfile.mNumVsync =
+                (mMinimumRefreshRate > 1 ? (mTeFrequency / mMinimumRefreshRate) : mTeFrequency);
+        if (numVsync <= mDisplayRefreshProfile.mNumVsync) return;
+
+        auto count = (numVsync - 1) / mDisplayRefreshProfile.mNumVsync;
+        auto alignedDurationNs = mMaximumFrameIntervalNs * count;
+        std::scoped_lock lock(mMutex);
+        auto& record = mStatistics[mDisplayRefreshProfile];
+        record.mCount += count;
+        record.mAccumulatedTimeNs += alignedDurationNs;
+        mLastRefreshTimeInBootClockNs += alignedDurationNs;
+        record.mLastTimeStampInBootClockNs = mLastRefreshTimeInBootClockNs;
+        record.mUpdated = true;
+    }
+
+    CommonDisplayContextProvider* mDisplayContextProvider;
+    int mTeFrequency;
+    int64_t mTeIntervalNs;
+    int64_t mLastRefreshTimeInBootClockNs = kDefaultInvalidPresentTimeNs;
+    DisplayRefreshStatistics mStatistics;
+    DisplayRefreshProfile mDisplayRefreshProfile;
+    uint64_t mPowerOffDurationNs = 0;
+    uint32_t mMinimumRefreshRate = 1;
+    uint64_t mMaximumFrameIntervalNs = kMaxRefreshIntervalNs;
+    std::mutex mMutex;
+};
+
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "MapPeriodRefreshRateCalculator.h"
+#include "RefreshRateCalculator/PeriodRefreshRateCalculator.h"
+#include "VirtualClock.h"
+
+namespace android::hardware::graphics::composer {
+
+namespace {
+
+constexpr int64_t kMsNs = 1000000;
+
+struct VrrConfig {
+    int64_t mVsyncPeriodNs;
+    int64_t mMinFrameIntervalNs;
+};
+
+// Replays random presents through both calculators and returns the refresh rate of each period
+// from the dense calculator and from the map one.
+std::pair<std::vector<int>, std::vector<int>> replay(
+        uint32_t seed, const PeriodRefreshRateCalculatorParameters& params) {
+    const std::vector<VrrConfig> configs = {{4166667, 8333333},
+                                            {4166667, 16666667},
+                                            {8333333, 8333333},
+                                            {8333333, 16666667}};
+    std::mt19937 random(seed);
+    ScopedVirtualClock clock;
+    EventQueue eventQueue;
+    PeriodRefreshRateCalculator dense(&eventQueue, params);
+    MapPeriodRefreshRateCalculator map(params);
+    std::vector<int> denseRates, mapRates;
+    dense.registerRefreshRateChangeCallback(
+            [&denseRates](int refreshRate) { denseRates.push_back(refreshRate); });
+
+    // The histogram is remapped when the vsync rate changes mid-period, so the vsync rate is kept
+    // for the whole replay and only the minimum frame interval changes.
+    const auto& initialConfig = configs[random() % configs.size()];
+    dense.setVrrConfigAttributes(initialConfig.mVsyncPeriodNs, initialConfig.mMinFrameIntervalNs);
+    map.setVrrConfigAttributes(initialConfig.mVsyncPeriodNs, initialConfig.mMinFrameIntervalNs);
+    dense.onPowerStateChange(HWC_POWER_MODE_OFF, HWC_POWER_MODE_NORMAL);
+
+    for (int period = 0; period < 40; period++) {
+        EXPECT_EQ(eventQueue.size(), 1);
+        const int64_t measureTimeNs = eventQueue.top().mWhenNs;
+        // Up to 60 presents, from back to back to a second apart.
+        const int numPresents = random() % 60;
+        for (int i = 0; i < numPresents; i++) {
+            int64_t intervalNs = initialConfig.mVsyncPeriodNs * (1 + random() % 30) +
+                    (random() % kMsNs) - kMsNs / 2;
+            if (random() % 20 == 0) {
+                intervalNs = (random() % 1200) * kMsNs;
+            }
+            int64_t presentTimeNs =
+                    clock.getSteadyClockTimeNs() + std::max<int64_t>(0, intervalNs);
+            if (presentTimeNs >= measureTimeNs) break;
+            clock.setTimeNs(presentTimeNs);
+            int flag = (random() % 50 == 0) ? PresentFrameFlag::kPresentingWhenDoze : 0;
+            dense.onPresent(presentTimeNs, flag);
+            map.onPresent(presentTimeNs, flag);
+        }
+        clock.setTimeNs(measureTimeNs);
+        auto event = eventQueue.pop();
+        event.mFunctor();
+        mapRates.push_back(map.measure());
+
+        if (random() % 10 == 0) {
+            const auto& config = configs[random() % configs.size()];
+            if (config.mVsyncPeriodNs == initialConfig.mVsyncPeriodNs) {
+                dense.setVrrConfigAttributes(config.mVsyncPeriodNs, config.mMinFrameIntervalNs);
+                map.setVrrConfigAttributes(config.mVsyncPeriodNs, config.mMinFrameIntervalNs);
+            }
+        }
+    }
+    return {denseRates, mapRates};
+}
+
+} // namespace
+
+TEST(PeriodRefreshRateCalculatorTest, DenseMatchesMap) {
+    for (auto type : {PeriodRefreshRateCalculatorType::kAverage,
+                      PeriodRefreshRateCalculatorType::kMajor}) {
+        for (int confidencePercentage : {0, 50}) {
+            PeriodRefreshRateCalculatorParameters params;
+            params.mType = type;
+            params.mConfidencePercentage = confidencePercentage;
+            params.mAlwaysCallback = true;
+            for (uint32_t seed = 1; seed <= 50; seed++) {
+                auto [denseRates, mapRates] = replay(seed, params);
+                ASSERT_EQ(denseRates, mapRates)
+                        << "type " << type << ", confidence " << confidencePercentage << ", seed "
+                        << seed;
+            }
+        }
+    }
+}
+
+TEST(PeriodRefreshRateCalculatorTest, MajorRateTieResolvesToLowerRate) {
+    ScopedVirtualClock clock;
+    EventQueue eventQueue;
+    PeriodRefreshRateCalculatorParameters params;
+    params.mType = PeriodRefreshRateCalculatorType::kMajor;
+    params.mConfidencePercentage = 0;
+    PeriodRefreshRateCalculator calculator(&eventQueue, params);
+    calculator.setVrrConfigAttributes(8333333, 8333333);
+    calculator.onPowerStateChange(HWC_POWER_MODE_OFF, HWC_POWER_MODE_NORMAL);
+
+    // As many presents at 120Hz as at 60Hz.
+    int64_t timeNs = clock.getSteadyClockTimeNs();
+    for (int64_t intervalNs : {0, 8333333, 8333333, 16666667, 16666667}) {
+        timeNs += intervalNs;
+        calculator.onPresent(timeNs, 0);
+    }
+    clock.setTimeNs(eventQueue.top().mWhenNs);
+    eventQueue.pop().mFunctor();
+    EXPECT_EQ(calculator.getRefreshRate(), 60);
+}
+
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "PresentCadencePredictor.h"
+
+namespace android::hardware::graphics::composer {
+
+namespace {
+
+constexpr int64_t kMsNs = 1000000;
+constexpr int64_t kMaxPostponementNs = 1 * kMsNs;
+
+} // namespace
+
+TEST(PresentCadencePredictorTest, PredictsAfterFourRegularIntervals) {
+    PresentCadencePredictor predictor(kMaxPostponementNs);
+    for (int64_t timeNs : {0 * kMsNs, 40 * kMsNs, 81 * kMsNs, 120 * kMsNs}) {
+        predictor.onPresent(timeNs);
+        EXPECT_FALSE(predictor.predictNextPresentTimeNs().has_value());
+    }
+    predictor.onPresent(160 * kMsNs);
+    ASSERT_TRUE(predictor.predictNextPresentTimeNs().has_value());
+    EXPECT_EQ(predictor.predictNextPresentTimeNs().value(), 200 * kMsNs);
+
+    predictor.reset();
+    EXPECT_FALSE(predictor.predictNextPresentTimeNs().has_value());
+}
+
+TEST(PresentCadencePredictorTest, DoesNotPredictIrregularPresents) {
+    PresentCadencePredictor predictor(kMaxPostponementNs);
+    // The third interval is more than 10% away from the average.
+    for (int64_t timeNs : {0 * kMsNs, 40 * kMsNs, 80 * kMsNs, 130 * kMsNs, 160 * kMsNs}) {
+        predictor.onPresent(timeNs);
+    }
+    EXPECT_FALSE(predictor.predictNextPresentTimeNs().has_value());
+    EXPECT_EQ(predictor.getFrameInsertionTimeNs(199 * kMsNs), 199 * kMsNs);
+
+    // Only the latest intervals count.
+    for (int64_t timeNs : {200 * kMsNs, 240 * kMsNs, 280 * kMsNs, 320 * kMsNs}) {
+        predictor.onPresent(timeNs);
+    }
+    EXPECT_TRUE(predictor.predictNextPresentTimeNs().has_value());
+}
+
+TEST(PresentCadencePredictorTest, PostponesByAtMostTheMaximum) {
+    PresentCadencePredictor predictor(kMaxPostponementNs);
+    for (int64_t timeNs = 0; timeNs <= 160 * kMsNs; timeNs += 40 * kMsNs) {
+        predictor.onPresent(timeNs);
+    }
+    // The present is predicted at 200ms.
+    EXPECT_EQ(predictor.getFrameInsertionTimeNs(199 * kMsNs), 200 * kMsNs);
+    EXPECT_EQ(predictor.getFrameInsertionTimeNs(199 * kMsNs + kMsNs / 2),
+              200 * kMsNs + kMsNs / 2);
+    // Too far before, or already after, the predicted present.
+    EXPECT_EQ(predictor.getFrameInsertionTimeNs(198 * kMsNs), 198 * kMsNs);
+    EXPECT_EQ(predictor.getFrameInsertionTimeNs(200 * kMsNs), 200 * kMsNs);
+}
+
+} // namespace android::hardware::graphics::composer
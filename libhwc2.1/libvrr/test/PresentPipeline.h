@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "EventQueue.h"
+#include "PresentRecordQueue.h"
+#include "FakeDisplayContextProvider.h"
+#include "RefreshRateCalculator/RefreshRateCalculatorFactory.h"
+#include "Statistics/VariableRefreshRateStatistic.h"
+#include "VirtualClock.h"
+
+namespace android::hardware::graphics::composer {
+
+// The refresh rate calculators and the statistics that the VRR controller feeds from its thread,
+// built the same way the controller builds them. The caller owns the clock: it advances the time
+// with runUntil() and reports presents and display changes at the current time.
+//
+// With a non-negative |presentLatencyNs| the presents go through the PresentRecordQueue of the
+// controller, which hands them over to its thread. The queue is drained when that thread would
+// run: |presentLatencyNs| after a present notified it, before an event is handled and before a
+// configuration or power mode change. Otherwise they are fed to the calculators and the statistics
+// as they come, the way the controller did before it had a queue.
+//
+// Only the present path is shared with the controller: its state machine, its timeouts and its
+// panel commands are not part of the pipeline, see VrrSimulator.h.
+class PresentPipeline {
+public:
+    struct RefreshRateChange {
+        int64_t mTimeNs;
+        int mRefreshRate;
+    };
+
+    static constexpr int kMaxFrameRate = 120;
+    static constexpr int kMaxTeFrequency = 240;
+    static constexpr int64_t kSynchronous = -1;
+
+    // Handles the events that the controller thread handles itself rather than through a functor.
+    using EventHandler = std::function<void(const VrrControllerEvent&)>;
+
+    // The period calculator parameters of the controller.
+    static PeriodRefreshRateCalculatorParameters getDefaultPeriodParameters() {
+        PeriodRefreshRateCalculatorParameters periodParams;
+        periodParams.mConfidencePercentage = 0;
+        return periodParams;
+    }
+
+    explicit PresentPipeline(int64_t presentLatencyNs = kSynchronous,
+                             const PeriodRefreshRateCalculatorParameters& periodParams =
+                                     getDefaultPeriodParameters())
+          : mPresentLatencyNs(presentLatencyNs) {
+        RefreshRateCalculatorFactory factory;
+        std::vector<std::shared_ptr<RefreshRateCalculator>> calculators;
+        calculators.emplace_back(
+                factory.BuildRefreshRateCalculator(&mEventQueue, RefreshRateCalculatorType::kAod));
+        calculators.emplace_back(
+                factory.BuildRefreshRateCalculator(&mEventQueue,
+                                                   RefreshRateCalculatorType::kExitIdle));
+        auto videoFrameRateCalculator =
+                factory.BuildRefreshRateCalculator(&mEventQueue,
+                                                   RefreshRateCalculatorType::kVideoPlayback);
+        calculators.emplace_back(videoFrameRateCalculator);
+        calculators.emplace_back(factory.BuildRefreshRateCalculator(&mEventQueue, periodParams));
+
+        mRefreshRateCalculator = factory.BuildRefreshRateCalculator(std::move(calculators));
+        mRefreshRateCalculator->registerRefreshRateChangeCallback([this](int refreshRate) {
+            mRefreshRateChanges.push_back({getSteadyClockTimeNs(), refreshRate});
+        });
+
+        mDisplayContextProvider =
+                std::make_unique<FakeDisplayContextProvider>(std::move(videoFrameRateCalculator));
+        mStatistic = std::make_shared<VariableRefreshRateStatistic>(mDisplayContextProvider.get(),
+                                                                    &mEventQueue, kMaxFrameRate,
+                                                                    kMaxTeFrequency,
+                                                                    std::nano::den);
+        mPresents.setConsumers(mRefreshRateCalculator, nullptr, mStatistic, nullptr);
+        setActiveConfig(FakeDisplayContextProvider::k120HzConfig);
+    }
+
+    // Runs the controller thread up to |timeNs| and leaves the clock there.
+    void runUntil(VirtualClock& clock, int64_t timeNs) {
+        for (;;) {
+            int64_t wakeupNs = mPendingWakeupNs.value_or(INT64_MAX);
+            if (!mEventQueue.empty()) {
+                wakeupNs = std::min(wakeupNs, mEventQueue.top().mWhenNs);
+            }
+            if (wakeupNs > timeNs) {
+                break;
+            }
+            clock.setTimeNs(std::max(clock.getSteadyClockTimeNs(), wakeupNs));
+            mNumberOfWakeups++;
+            drainPresents();
+            if (!mEventQueue.empty() && (mEventQueue.top().mWhenNs <= wakeupNs)) {
+                auto event = mEventQueue.pop();
+                if (event.mFunctor) {
+                    event.mFunctor();
+                } else if (mEventHandler) {
+                    mEventHandler(event);
+                }
+            }
+        }
+        clock.setTimeNs(std::max(clock.getSteadyClockTimeNs(), timeNs));
+    }
+
+    void setEventHandler(EventHandler eventHandler) { mEventHandler = std::move(eventHandler); }
+
+    void onPresent(int64_t presentTimeNs, int flag) {
+        if (mPresentLatencyNs == kSynchronous) {
+            onPresentInternal(presentTimeNs, flag);
+            return;
+        }
+        mPresents.push({.mTime = presentTimeNs, .mFlag = flag, .mFence = -1});
+        if (!mPendingWakeupNs.has_value()) {
+            mPendingWakeupNs = getSteadyClockTimeNs() + mPresentLatencyNs;
+        }
+    }
+
+    void setActiveConfig(hwc2_config_t config) {
+        drainPresents();
+        mDisplayContextProvider->setActiveConfig(config);
+        const auto& vrrConfig =
+                mDisplayContextProvider->getDisplayConfig(config)->vrrConfig.value();
+        mStatistic->setActiveVrrConfiguration(config, durationNsToFreq(vrrConfig.vsyncPeriodNs));
+        mRefreshRateCalculator->setVrrConfigAttributes(vrrConfig.vsyncPeriodNs,
+                                                       vrrConfig.minFrameIntervalNs);
+    }
+
+    void setPowerMode(int powerMode) {
+        drainPresents();
+        mRefreshRateCalculator->onPowerStateChange(mPowerMode, powerMode);
+        mStatistic->onPowerStateChange(mPowerMode, powerMode);
+        mPowerMode = powerMode;
+    }
+
+    void setBrightnessMode(BrightnessMode mode) {
+        drainPresents();
+        mDisplayContextProvider->setBrightnessMode(mode);
+    }
+
+    // Accounts the queued presents, as the controller does before reading the statistics.
+    void drainPresents() {
+        mPendingWakeupNs = std::nullopt;
+        mPresents.drain();
+    }
+
+    const std::vector<RefreshRateChange>& getRefreshRateChanges() const {
+        return mRefreshRateChanges;
+    }
+    int getRefreshRate() const { return mRefreshRateCalculator->getRefreshRate(); }
+    int getPowerMode() const { return mPowerMode; }
+    size_t getNumberOfWakeups() const { return mNumberOfWakeups; }
+    VariableRefreshRateStatistic& getStatistic() { return *mStatistic; }
+    EventQueue& getEventQueue() { return mEventQueue; }
+
+private:
+    void onPresentInternal(int64_t presentTimeNs, int flag) {
+        mRefreshRateCalculator->onPresent(presentTimeNs, flag);
+        mStatistic->onPresent(presentTimeNs, flag);
+    }
+
+    const int64_t mPresentLatencyNs;
+    std::optional<int64_t> mPendingWakeupNs;
+    EventHandler mEventHandler;
+    EventQueue mEventQueue;
+    std::shared_ptr<RefreshRateCalculator> mRefreshRateCalculator;
+    std::unique_ptr<FakeDisplayContextProvider> mDisplayContextProvider;
+    std::shared_ptr<VariableRefreshRateStatistic> mStatistic;
+    PresentRecordQueue mPresents;
+    std::vector<RefreshRateChange> mRefreshRateChanges;
+    int mPowerMode = HWC_POWER_MODE_OFF;
+    size_t mNumberOfWakeups = 0;
+};
+
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,315 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "PresentPipeline.h"
+
+namespace android::hardware::graphics::composer {
+
+namespace {
+
+constexpr int64_t kMsNs = 1000000;
+
+// Records the presents it is fed, and the frame rate reporter they are fed to.
+class RecordingCalculator : public RefreshRateCalculator {
+public:
+    int getRefreshRate() const override { return kDefaultInvalidRefreshRate; }
+    void onPresentInternal(int64_t presentTimeNs, int flag) override {
+        mPresents.push_back({presentTimeNs, flag});
+    }
+    void reset() override {}
+
+    std::vector<std::pair<int64_t, int>> mPresents;
+};
+
+bool isOpen(int fd) {
+    return fcntl(fd, F_GETFD) != -1;
+}
+
+struct TimelineStep {
+    enum Type { kPresent, kConfig, kPowerMode, kBrightnessMode };
+    int64_t mTimeNs;
+    Type mType;
+    int mValue;
+};
+
+class TimelineBuilder {
+public:
+    explicit TimelineBuilder(uint32_t seed) : mRandom(seed) {}
+
+    // Presents at |frameRate| for |durationNs| with up to |jitterNs| of noise on each of them.
+    TimelineBuilder& present(int frameRate, int64_t durationNs, int64_t jitterNs, int flag = 0) {
+        const int64_t periodNs = std::nano::den / frameRate;
+        const int64_t endNs = mNowNs + durationNs;
+        for (int64_t timeNs = mNowNs + periodNs; timeNs < endNs; timeNs += periodNs) {
+            int64_t noiseNs = jitterNs
+                    ? static_cast<int64_t>(mRandom() % (2 * jitterNs + 1)) - jitterNs
+                    : 0;
+            addStep(std::max(timeNs + noiseNs, mNowNs + 1), TimelineStep::kPresent, flag);
+        }
+        mNowNs = endNs;
+        return *this;
+    }
+    TimelineBuilder& idle(int64_t durationNs) {
+        mNowNs += durationNs;
+        return *this;
+    }
+    TimelineBuilder& config(hwc2_config_t config) {
+        addStep(++mNowNs, TimelineStep::kConfig, config);
+        return *this;
+    }
+    TimelineBuilder& powerMode(int powerMode) {
+        addStep(++mNowNs, TimelineStep::kPowerMode, powerMode);
+        return *this;
+    }
+    TimelineBuilder& brightnessMode(BrightnessMode mode) {
+        addStep(++mNowNs, TimelineStep::kBrightnessMode, static_cast<int>(mode));
+        return *this;
+    }
+
+    int64_t getEndTimeNs() const { return mNowNs; }
+    const std::vector<TimelineStep>& getSteps() const { return mSteps; }
+
+private:
+    void addStep(int64_t timeNs, TimelineStep::Type type, int value) {
+        mSteps.push_back({timeNs, type, value});
+        mNowNs = std::max(mNowNs, timeNs);
+    }
+
+    std::mt19937 mRandom;
+    int64_t mNowNs = VirtualClock::kDefaultStartTimeNs;
+    std::vector<TimelineStep> mSteps;
+};
+
+// Jittered 120Hz and 60Hz content, idle gaps, 30Hz video, doze and configuration changes.
+TimelineBuilder buildRecordedTimeline() {
+    TimelineBuilder timeline(5);
+    timeline.powerMode(HWC_POWER_MODE_NORMAL)
+            .present(120, 2000 * kMsNs, 500000)
+            .idle(1500 * kMsNs)
+            .present(60, 1000 * kMsNs, 1000000)
+            .config(FakeDisplayContextProvider::k60HzConfig)
+            .present(30, 3000 * kMsNs, 300000, PresentFrameFlag::kIsYuv)
+            .present(60, 500 * kMsNs, 0)
+            .idle(700 * kMsNs)
+            .brightnessMode(BrightnessMode::kHighBrightnessMode)
+            .present(60, 800 * kMsNs, 800000)
+            .config(FakeDisplayContextProvider::k120HzConfig)
+            .present(120, 1200 * kMsNs, 2000000)
+            .powerMode(HWC_POWER_MODE_DOZE)
+            .present(1, 5000 * kMsNs, 0, PresentFrameFlag::kPresentingWhenDoze)
+            .powerMode(HWC_POWER_MODE_NORMAL)
+            .present(120, 300 * kMsNs, 500000)
+            .present(120, 200 * kMsNs, 0, PresentFrameFlag::kUpdateRefreshRateIndicatorLayerOnly)
+            .powerMode(HWC_POWER_MODE_OFF)
+            .idle(2000 * kMsNs)
+            .powerMode(HWC_POWER_MODE_NORMAL)
+            .present(90, 1000 * kMsNs, 1000000)
+            .idle(3000 * kMsNs);
+    return timeline;
+}
+
+struct Result {
+    std::vector<int> mRefreshRates;
+    std::vector<int64_t> mRefreshRateChangeTimesNs;
+    std::string mStatistics;
+    std::string mDump;
+    std::vector<int> mRefreshRatesAtSteps;
+};
+
+Result replay(const TimelineBuilder& timeline, int64_t presentLatencyNs) {
+    ScopedVirtualClock clock;
+    PresentPipeline pipeline(presentLatencyNs);
+    Result result;
+    for (const auto& step : timeline.getSteps()) {
+        pipeline.runUntil(clock, step.mTimeNs);
+        switch (step.mType) {
+            case TimelineStep::kPresent:
+                pipeline.onPresent(step.mTimeNs, step.mValue);
+                break;
+            case TimelineStep::kConfig:
+                pipeline.setActiveConfig(step.mValue);
+                result.mRefreshRatesAtSteps.push_back(pipeline.getRefreshRate());
+                break;
+            case TimelineStep::kPowerMode:
+                pipeline.setPowerMode(step.mValue);
+                result.mRefreshRatesAtSteps.push_back(pipeline.getRefreshRate());
+                break;
+            case TimelineStep::kBrightnessMode:
+                pipeline.setBrightnessMode(static_cast<BrightnessMode>(step.mValue));
+                break;
+        }
+    }
+    pipeline.runUntil(clock, timeline.getEndTimeNs());
+    pipeline.drainPresents();
+
+    for (const auto& change : pipeline.getRefreshRateChanges()) {
+        result.mRefreshRates.push_back(change.mRefreshRate);
+        result.mRefreshRateChangeTimesNs.push_back(change.mTimeNs);
+    }
+    std::ostringstream os;
+    for (const auto& [profile, record] : pipeline.getStatistic().getStatistics()) {
+        os << profile.toString() << " : " << record.toString() << "\n";
+    }
+    result.mStatistics = os.str();
+    result.mDump = pipeline.getStatistic()
+                           .dumpStatistics(false,
+                                           static_cast<RefreshSource>(kRefreshSourcePresentMask)) +
+            pipeline.getStatistic()
+                    .dumpStatistics(false,
+                                    static_cast<RefreshSource>(kRefreshSourceNonPresentMask));
+    return result;
+}
+
+} // namespace
+
+TEST(PresentRecordQueueTest, FeedsConsumersInPushOrder) {
+    auto calculator = std::make_shared<RecordingCalculator>();
+    auto reporter = std::make_shared<RecordingCalculator>();
+    std::vector<int> fences;
+    PresentRecordQueue queue;
+    queue.setConsumers(calculator, reporter, nullptr, [&](int fence) { fences.push_back(fence); });
+
+    /* one more than fits, the oldest ones are drained on the pushing thread */
+    std::vector<std::pair<int64_t, int>> expected;
+    for (int i = 0; i <= static_cast<int>(PresentRecordQueue::kCapacity); i++) {
+        const int flag = (i % 2) ? PresentFrameFlag::kIsYuv : 0;
+        queue.push({.mTime = i * kMsNs, .mFlag = flag, .mFence = -1});
+        expected.push_back({i * kMsNs, flag});
+    }
+    EXPECT_EQ(queue.size(), 1u);
+    EXPECT_EQ(calculator->mPresents.size(), PresentRecordQueue::kCapacity);
+
+    queue.drain();
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(calculator->mPresents, expected);
+    /* the frame rate reporter doesn't see the flags */
+    ASSERT_EQ(reporter->mPresents.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        EXPECT_EQ(reporter->mPresents[i], std::make_pair(expected[i].first, 0));
+    }
+    EXPECT_TRUE(fences.empty());
+}
+
+TEST(PresentRecordQueueTest, HandsOverOrClosesFences) {
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    const int kept = dup(fds[0]);
+    const int dropped = dup(fds[0]);
+    std::vector<int> fences;
+    PresentRecordQueue queue;
+    queue.setConsumers(nullptr, nullptr, nullptr, [&](int fence) { fences.push_back(fence); });
+
+    queue.push({.mTime = 0, .mFlag = 0, .mFence = kept});
+    queue.drain();
+    EXPECT_EQ(fences, std::vector<int>{kept});
+    EXPECT_TRUE(isOpen(kept));
+
+    queue.push({.mTime = kMsNs, .mFlag = 0, .mFence = dropped});
+    queue.drop();
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(isOpen(dropped));
+    EXPECT_EQ(fences.size(), 1u);
+
+    close(kept);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(PresentRecordQueueTest, TimelineIsMeaningful) {
+    auto timeline = buildRecordedTimeline();
+    auto result = replay(timeline, PresentPipeline::kSynchronous);
+    /* the calculators reacted to the content and the statistics have several buckets */
+    EXPECT_GT(result.mRefreshRates.size(), 5u);
+    EXPECT_GT(std::count(result.mStatistics.begin(), result.mStatistics.end(), '\n'), 5);
+}
+
+TEST(PresentRecordQueueTest, QueuedMatchesSynchronous) {
+    auto timeline = buildRecordedTimeline();
+    auto synchronous = replay(timeline, PresentPipeline::kSynchronous);
+    /* from a prompt wakeup to one long enough for the queue to fill up */
+    for (int64_t latencyNs : std::vector<int64_t>{0, kMsNs, 4 * kMsNs, 250 * kMsNs}) {
+        auto queued = replay(timeline, latencyNs);
+        EXPECT_EQ(queued.mRefreshRates, synchronous.mRefreshRates) << latencyNs;
+        EXPECT_EQ(queued.mRefreshRatesAtSteps, synchronous.mRefreshRatesAtSteps) << latencyNs;
+        EXPECT_EQ(queued.mStatistics, synchronous.mStatistics) << latencyNs;
+        EXPECT_EQ(queued.mDump, synchronous.mDump) << latencyNs;
+        /* a change is reported at most one wakeup later than it would be synchronously */
+        ASSERT_EQ(queued.mRefreshRateChangeTimesNs.size(),
+                  synchronous.mRefreshRateChangeTimesNs.size());
+        for (size_t i = 0; i < queued.mRefreshRateChangeTimesNs.size(); i++) {
+            EXPECT_GE(queued.mRefreshRateChangeTimesNs[i],
+                      synchronous.mRefreshRateChangeTimesNs[i]);
+            EXPECT_LE(queued.mRefreshRateChangeTimesNs[i],
+                      synchronous.mRefreshRateChangeTimesNs[i] + latencyNs)
+                    << latencyNs << " change " << i;
+        }
+    }
+}
+
+TEST(PresentRecordQueueTest, AodTimeoutCountsFromPresent) {
+    ScopedVirtualClock clock;
+    EventQueue eventQueue;
+    AODRefreshRateCalculator calculator(&eventQueue);
+    const int64_t presentTimeNs = clock.getSteadyClockTimeNs();
+
+    /* the present reaches the calculator late */
+    clock.advanceNs(50 * kMsNs);
+    calculator.onPresent(presentTimeNs, PresentFrameFlag::kPresentingWhenDoze);
+    EXPECT_EQ(calculator.getRefreshRate(), 30);
+    ASSERT_EQ(eventQueue.size(), 1u);
+    EXPECT_EQ(eventQueue.top().mWhenNs, presentTimeNs + 8 * (std::nano::den / 30));
+}
+
+TEST(PresentRecordQueueTest, QueuedMatchesSynchronousOnRandomTimelines) {
+    const std::vector<int> frameRates = {1, 24, 30, 60, 90, 120};
+    for (uint32_t seed = 1; seed <= 20; seed++) {
+        std::mt19937 random(seed);
+        TimelineBuilder timeline(seed);
+        timeline.powerMode(HWC_POWER_MODE_NORMAL);
+        for (int i = 0; i < 30; i++) {
+            switch (random() % 8) {
+                case 0:
+                    timeline.idle((random() % 2000) * kMsNs);
+                    break;
+                case 1:
+                    timeline.config(random() % 2);
+                    break;
+                case 2:
+                    timeline.present(30, (random() % 1000) * kMsNs, 300000,
+                                     PresentFrameFlag::kIsYuv);
+                    break;
+                default:
+                    timeline.present(frameRates[random() % frameRates.size()],
+                                     (random() % 1500) * kMsNs, (random() % 2000000));
+                    break;
+            }
+        }
+        auto synchronous = replay(timeline, PresentPipeline::kSynchronous);
+        auto queued = replay(timeline, 4 * kMsNs);
+        EXPECT_EQ(queued.mRefreshRates, synchronous.mRefreshRates) << "seed " << seed;
+        EXPECT_EQ(queued.mStatistics, synchronous.mStatistics) << "seed " << seed;
+    }
+}
+
+} // namespace android::hardware::graphics::composer
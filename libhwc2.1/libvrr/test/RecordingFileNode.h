@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <fcntl.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "FileNode.h"
+#include "Utils.h"
+
+namespace android::hardware::graphics::composer {
+
+// A FileNode whose nodes are backed by /dev/null. It records what is written to them and when,
+// by the steady clock, instead of commanding a panel.
+class RecordingFileNode : public FileNode {
+public:
+    struct Write {
+        int64_t mTimeNs;
+        std::string mNodeName;
+        std::string mValue;
+    };
+
+    static constexpr char kNodePath[] = "/sys/devices/platform/fake-panel/";
+
+    RecordingFileNode() : FileNode(kNodePath) {}
+
+    const std::vector<Write>& getWrites() const { return mWrites; }
+
+    // Returns how many times |nodeName| was written to.
+    size_t countWrites(const std::string& nodeName) const {
+        size_t count = 0;
+        for (const auto& write : mWrites) {
+            if (write.mNodeName == nodeName) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+protected:
+    int openNode(const std::string& fullPath) override {
+        int fd = open("/dev/null", O_WRONLY);
+        if (fd >= 0) {
+            mNodeNames[fd] = fullPath.substr(std::string(kNodePath).size());
+        }
+        return fd;
+    }
+
+    ssize_t writeNode(int fd, const std::string& str) override {
+        mWrites.push_back({getSteadyClockTimeNs(), mNodeNames[fd], str});
+        return str.size();
+    }
+
+private:
+    std::unordered_map<int, std::string> mNodeNames;
+    std::vector<Write> mWrites;
+};
+
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <functional>
+
+#include "FakeDisplayContextProvider.h"
+#include "MapPeriodRefreshRateCalculator.h"
+#include "MapRefreshStatistic.h"
+#include "RefreshRateCalculator/PeriodRefreshRateCalculator.h"
+#include "Statistics/VariableRefreshRateStatistic.h"
+#include "VirtualClock.h"
+
+namespace android::hardware::graphics::composer {
+
+namespace {
+
+constexpr int64_t k240HzPeriodNs = 4166667;
+
+// Presents on a 240Hz TE at a mix of 240Hz down to 20Hz, so that several buckets are in use.
+int64_t getNextPresentTimeNs(int64_t timeNs, int frame) {
+    return timeNs + k240HzPeriodNs * (1 + (frame * 7) % 12);
+}
+
+// The per-present cost of the period calculator, with a measurement every 250ms as on device.
+template <typename Calculator>
+void runPeriodCalculator(benchmark::State& state, VirtualClock& clock, Calculator& calculator,
+                         const std::function<void()>& measure) {
+    calculator.setVrrConfigAttributes(k240HzPeriodNs, 2 * k240HzPeriodNs);
+    int64_t timeNs = clock.getSteadyClockTimeNs();
+    int64_t measureTimeNs = timeNs + 250000000;
+    int frame = 0;
+    for (auto _ : state) {
+        timeNs = getNextPresentTimeNs(timeNs, frame++);
+        clock.setTimeNs(timeNs);
+        calculator.onPresent(timeNs, 0);
+        if (timeNs >= measureTimeNs) {
+            measure();
+            measureTimeNs += 250000000;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_PeriodRefreshRateCalculatorPresent(benchmark::State& state) {
+    ScopedVirtualClock clock;
+    EventQueue eventQueue;
+    PeriodRefreshRateCalculator calculator(&eventQueue);
+    calculator.onPowerStateChange(HWC_POWER_MODE_OFF, HWC_POWER_MODE_NORMAL);
+    runPeriodCalculator(state, clock, calculator,
+                        [&eventQueue]() { eventQueue.pop().mFunctor(); });
+}
+BENCHMARK(BM_PeriodRefreshRateCalculatorPresent);
+
+void BM_MapPeriodRefreshRateCalculatorPresent(benchmark::State& state) {
+    ScopedVirtualClock clock;
+    EventQueue eventQueue;
+    MapPeriodRefreshRateCalculator calculator((PeriodRefreshRateCalculatorParameters()));
+    // Goes through the event queue like the dense calculator, which reposts its measure event.
+    VrrControllerEvent measureEvent;
+    measureEvent.mEventType = VrrControllerEventType::kPeriodRefreshRateCalculatorUpdate;
+    measureEvent.mFunctor = [&calculator]() { return calculator.measure(); };
+    runPeriodCalculator(state, clock, calculator, [&eventQueue, &measureEvent]() {
+        measureEvent.mWhenNs = getSteadyClockTimeNs();
+        eventQueue.postEvent(measureEvent);
+        eventQueue.pop().mFunctor();
+    });
+}
+BENCHMARK(BM_MapPeriodRefreshRateCalculatorPresent);
+
+// The per-present cost of the statistic, with the display on at 120Hz.
+template <typename Statistic>
+void runStatistic(benchmark::State& state, VirtualClock& clock, Statistic& statistic) {
+    statistic.setActiveVrrConfiguration(FakeDisplayContextProvider::k120HzConfig,
+                                        FakeDisplayContextProvider::kTeFrequency);
+    statistic.onPowerStateChange(HWC_POWER_MODE_OFF, HWC_POWER_MODE_NORMAL);
+    int64_t timeNs = clock.getSteadyClockTimeNs();
+    int frame = 0;
+    for (auto _ : state) {
+        timeNs = getNextPresentTimeNs(timeNs, frame++);
+        clock.setTimeNs(timeNs);
+        statistic.onPresent(timeNs, 0);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_VariableRefreshRateStatisticPresent(benchmark::State& state) {
+    ScopedVirtualClock clock;
+    FakeDisplayContextProvider displayContextProvider;
+    EventQueue eventQueue;
+    VariableRefreshRateStatistic statistic(&displayContextProvider, &eventQueue, 120,
+                                           FakeDisplayContextProvider::kTeFrequency,
+                                           std::nano::den);
+    runStatistic(state, clock, statistic);
+}
+BENCHMARK(BM_VariableRefreshRateStatisticPresent);
+
+void BM_MapRefreshStatisticPresent(benchmark::State& state) {
+    ScopedVirtualClock clock;
+    FakeDisplayContextProvider displayContextProvider;
+    MapRefreshStatistic statistic(&displayContextProvider, 120);
+    runStatistic(state, clock, statistic);
+}
+BENCHMARK(BM_MapRefreshStatisticPresent);
+
+} // namespace
+
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+
+#include "FakeDisplayContextProvider.h"
+#include "MapRefreshStatistic.h"
+#include "Statistics/VariableRefreshRateStatistic.h"
+#include "VirtualClock.h"
+
+namespace android::hardware::graphics::composer {
+
+namespace {
+
+constexpr int64_t kMsNs = 1000000;
+constexpr int kMaxFrameRate = 120;
+constexpr int kMaxTeFrequency = 240;
+constexpr auto kAllRefreshSources =
+        static_cast<RefreshSource>(kRefreshSourcePresentMask | kRefreshSourceNonPresentMask);
+
+std::string toString(const DisplayRefreshStatistics& statistics) {
+    std::string res;
+    for (const auto& [profile, record] : statistics) {
+        res += profile.toString() + ", " + std::to_string(profile.mWidth) + "x" +
+                std::to_string(profile.mHeight) + ", te = " +
+                std::to_string(profile.mTeFrequency) + " : " + record.toString() +
+                (record.mUpdated ? ", updated\n" : "\n");
+    }
+    return res;
+}
+
+} // namespace
+
+// Drives the dense statistic and the map-based one with the same random presents, non-present
+// refreshes, power, configuration, brightness and fixed refresh rate changes, and reads them back
+// in every way the power stats and dumpsys do.
+TEST(VariableRefreshRateStatisticTest, DenseMatchesMap) {
+    const std::vector<hwc2_config_t> configs = {FakeDisplayContextProvider::k120HzConfig,
+                                                FakeDisplayContextProvider::k60HzConfig,
+                                                FakeDisplayContextProvider::k60HzTe120Config};
+    const std::vector<int> powerModes = {HWC_POWER_MODE_OFF, HWC_POWER_MODE_DOZE,
+                                         HWC_POWER_MODE_NORMAL, HWC_POWER_MODE_DOZE_SUSPEND};
+    for (uint32_t seed = 1; seed <= 100; seed++) {
+        std::mt19937 random(seed);
+        ScopedVirtualClock clock;
+        FakeDisplayContextProvider displayContextProvider;
+        EventQueue eventQueue;
+        VariableRefreshRateStatistic dense(&displayContextProvider, &eventQueue, kMaxFrameRate,
+                                           kMaxTeFrequency, std::nano::den);
+        MapRefreshStatistic map(&displayContextProvider, kMaxFrameRate);
+        int powerMode = HWC_POWER_MODE_OFF;
+
+        for (int step = 0; step < 400; step++) {
+            clock.advanceNs((random() % 50) * kMsNs + random() % kMsNs);
+            const int64_t nowNs = clock.getSteadyClockTimeNs();
+            const int op = random() % 100;
+            if (op < 70) {
+                int flag = (random() % 10 == 0) ? PresentFrameFlag::kPresentingWhenDoze : 0;
+                dense.onPresent(nowNs, flag);
+                map.onPresent(nowNs, flag);
+            } else if (op < 78) {
+                auto source = (random() % 2) ? RefreshSource::kRefreshSourceFrameInsertion
+                                             : RefreshSource::kRefreshSourceBrightness;
+                dense.onNonPresentRefresh(nowNs, source);
+                map.onNonPresentRefresh(nowNs, source);
+            } else if (op < 86) {
+                int to = powerModes[random() % powerModes.size()];
+                dense.onPowerStateChange(powerMode, to);
+                map.onPowerStateChange(powerMode, to);
+                powerMode = to;
+            } else if (op < 91) {
+                hwc2_config_t config = configs[random() % configs.size()];
+                displayContextProvider.setActiveConfig(config);
+                int teFrequency = displayContextProvider.getTeFrequency(config);
+                dense.setActiveVrrConfiguration(config, teFrequency);
+                map.setActiveVrrConfiguration(config, teFrequency);
+            } else if (op < 95) {
+                displayContextProvider.setBrightnessMode(
+                        (random() % 2) ? BrightnessMode::kNormalBrightnessMode
+                                       : BrightnessMode::kHighBrightnessMode);
+            } else if (op < 97) {
+                uint32_t rate = (random() % 2) ? 0 : 10;
+                dense.setFixedRefreshRate(rate);
+                map.setFixedRefreshRate(rate);
+            } else {
+                ASSERT_EQ(toString(dense.getUpdatedStatistics()),
+                          toString(map.getUpdatedStatistics()))
+                        << "seed " << seed << ", step " << step;
+                bool updatedOnly = random() % 2;
+                auto source = static_cast<RefreshSource>(1 << (random() % 4));
+                ASSERT_EQ(dense.dumpStatistics(updatedOnly, source),
+                          map.dumpStatistics(updatedOnly, source))
+                        << "seed " << seed << ", step " << step;
+            }
+            ASSERT_EQ(dense.getPowerOffDurationNs(), map.getPowerOffDurationNs())
+                    << "seed " << seed << ", step " << step;
+        }
+        ASSERT_EQ(toString(dense.getStatistics()), toString(map.getStatistics()))
+                << "seed " << seed;
+        ASSERT_EQ(dense.dumpStatistics(false, kAllRefreshSources),
+                  map.dumpStatistics(false, kAllRefreshSources))
+                << "seed " << seed;
+    }
+}
+
+} // namespace android::hardware::graphics::composer
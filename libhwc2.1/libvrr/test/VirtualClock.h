@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Clock.h"
+
+namespace android::hardware::graphics::composer {
+
+// Clock whose time only moves when the test advances it. Waits return a timeout immediately, the
+// test is expected to advance the time to the deadline it is interested in.
+class VirtualClock : public Clock {
+public:
+    static constexpr int64_t kDefaultStartTimeNs = 1000000000;
+
+    explicit VirtualClock(int64_t nowNs = kDefaultStartTimeNs) : mNowNs(nowNs) {}
+
+    int64_t getSteadyClockTimeNs() const override { return mNowNs; }
+    int64_t getBootClockTimeNs() const override { return mNowNs + kBootClockOffsetNs; }
+
+    std::cv_status waitFor(std::condition_variable&, std::unique_lock<std::mutex>&,
+                           int64_t durationNs) override {
+        mNowNs += durationNs;
+        return std::cv_status::timeout;
+    }
+
+    void setTimeNs(int64_t nowNs) { mNowNs = nowNs; }
+    void advanceNs(int64_t durationNs) { mNowNs += durationNs; }
+
+private:
+    // The boot clock also counts suspend, keep it apart from the steady clock.
+    static constexpr int64_t kBootClockOffsetNs = 5000000000;
+
+    int64_t mNowNs;
+};
+
+// Installs a VirtualClock for the lifetime of the scope.
+class ScopedVirtualClock : public VirtualClock {
+public:
+    explicit ScopedVirtualClock(int64_t nowNs = kDefaultStartTimeNs) : VirtualClock(nowNs) {
+        setClock(this);
+    }
+    ~ScopedVirtualClock() { setClock(nullptr); }
+};
+
+} // namespace android::hardware::graphics::composer
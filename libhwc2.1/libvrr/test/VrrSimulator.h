@@ -0,0 +1,281 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <istream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "FrameInsertionScheduler.h"
+#include "PresentCadencePredictor.h"
+#include "PresentPipeline.h"
+#include "RecordingFileNode.h"
+#include "interface/Panel_def.h"
+
+namespace android::hardware::graphics::composer {
+
+// One line of a trace: what the composer told the VRR controller and when.
+struct VrrTraceEvent {
+    enum Type { kPresent, kConfig, kPowerMode, kBrightnessMode };
+    int64_t mTimeNs;
+    Type mType;
+    // The present frame flags, the configuration, the power mode or the brightness mode.
+    int mValue;
+};
+
+struct VrrSimulatorParameters {
+    // How long the controller thread takes to pick up a present.
+    int64_t mPresentLatencyNs = 0;
+    PeriodRefreshRateCalculatorParameters mPeriodParameters =
+            PresentPipeline::getDefaultPeriodParameters();
+    // The vendor present timeout: the first frame is inserted this long after a present.
+    int64_t mPresentTimeoutNs = 33000000;
+    // The frame insertions made on the timeout, as (count, interval) pairs in the order they are
+    // made, the first insertion included.
+    std::vector<std::pair<uint32_t, uint32_t>> mInsertionSchedule = {{3, 33000000}};
+    int64_t mAheadOfTimeNs = 1000000;
+    // Whether frame insertions are postponed, by up to half of |mAheadOfTimeNs|, when the cadence
+    // of the presents predicts one within that time, as the controller does.
+    bool mPostponeFrameInsertions = true;
+};
+
+struct VrrSimulationReport {
+    // The times are relative to the start of the trace.
+    std::vector<PresentPipeline::RefreshRateChange> mRefreshRateChanges;
+    std::vector<RecordingFileNode::Write> mPanelCommands;
+    size_t mNumberOfPresents = 0;
+    size_t mNumberOfFrameInsertions = 0;
+    size_t mNumberOfWakeups = 0;
+
+    std::string toString() const {
+        std::ostringstream os;
+        os << "presents: " << mNumberOfPresents << "\n";
+        os << "frame insertions: " << mNumberOfFrameInsertions << "\n";
+        os << "wakeups: " << mNumberOfWakeups << "\n";
+        os << "refresh rate changes:\n";
+        for (const auto& change : mRefreshRateChanges) {
+            os << "  " << change.mTimeNs / 1000000.0 << " ms: " << change.mRefreshRate << "\n";
+        }
+        os << "panel commands:\n";
+        for (const auto& command : mPanelCommands) {
+            os << "  " << command.mTimeNs / 1000000.0 << " ms: " << command.mNodeName << " = "
+               << command.mValue << "\n";
+        }
+        return os.str();
+    }
+};
+
+// Replays a trace through the refresh rate calculators, the statistics and the frame insertions
+// of the VRR controller on a virtual clock, with a RecordingFileNode standing in for the panel.
+// Frame insertions are scheduled the way the controller schedules them with a vendor present
+// timeout in effect, while the display is on.
+//
+// The calculators, the statistics, the present queue, the cadence predictor and the insertion
+// scheduler are the controller's own classes, but the orchestration around them is re-implemented
+// here, since the controller itself needs an ExynosDisplay. What is not modelled:
+//  - the kRendering/kHibernate state machine, the system rendering timeout that leads to it and
+//    notifyExpectedPresent that wakes it up;
+//  - the minimum refresh rate set by setFixedRefreshRateRange, its peak refresh rate lock after a
+//    present and the hardware present timeout controller it switches to;
+//  - the refresh_ctrl writes of both, so the panel commands only hold the frame insertions;
+//  - expected present time and frame interval notifications to the panel.
+// Reports of traces that rely on any of these do not match the device.
+//
+// A trace has one event per line, at a time in milliseconds from its start, in time order:
+//   <time> present [yuv] [doze] [rri]
+//   <time> config <id>
+//   <time> power on|off|doze|doze_suspend
+//   <time> brightness normal|hbm
+// Empty lines and the ones starting with '#' are skipped.
+class VrrSimulator {
+public:
+    explicit VrrSimulator(VrrSimulatorParameters params = VrrSimulatorParameters())
+          : mParams(std::move(params)) {}
+
+    // Returns false and describes the line in |error| if the trace is malformed.
+    static bool parseTrace(std::istream& is, std::vector<VrrTraceEvent>& trace,
+                           std::string& error) {
+        std::string line;
+        for (int lineNumber = 1; std::getline(is, line); lineNumber++) {
+            std::istringstream tokens(line);
+            std::string time, name, argument;
+            if (!(tokens >> time) || (time[0] == '#')) {
+                continue;
+            }
+            VrrTraceEvent event = {};
+            char* end = nullptr;
+            double timeMs = std::strtod(time.c_str(), &end);
+            if ((*end != '\0') || (timeMs < 0) || !(tokens >> name)) {
+                error = "line " + std::to_string(lineNumber) + ": " + line;
+                return false;
+            }
+            event.mTimeNs = std::llround(timeMs * 1000000);
+            bool valid = trace.empty() || (trace.back().mTimeNs <= event.mTimeNs);
+            if (name == "present") {
+                event.mType = VrrTraceEvent::kPresent;
+                while (valid && (tokens >> argument)) {
+                    if (argument == "yuv") {
+                        event.mValue |= PresentFrameFlag::kIsYuv;
+                    } else if (argument == "doze") {
+                        event.mValue |= PresentFrameFlag::kPresentingWhenDoze;
+                    } else if (argument == "rri") {
+                        event.mValue |= PresentFrameFlag::kUpdateRefreshRateIndicatorLayerOnly;
+                    } else {
+                        valid = false;
+                    }
+                }
+            } else if (name == "config") {
+                event.mType = VrrTraceEvent::kConfig;
+                valid = valid && (tokens >> event.mValue) && (event.mValue >= 0);
+            } else if (name == "power") {
+                event.mType = VrrTraceEvent::kPowerMode;
+                valid = valid && (tokens >> argument);
+                if (argument == "on") {
+                    event.mValue = HWC_POWER_MODE_NORMAL;
+                } else if (argument == "off") {
+                    event.mValue = HWC_POWER_MODE_OFF;
+                } else if (argument == "doze") {
+                    event.mValue = HWC_POWER_MODE_DOZE;
+                } else if (argument == "doze_suspend") {
+                    event.mValue = HWC_POWER_MODE_DOZE_SUSPEND;
+                } else {
+                    valid = false;
+                }
+            } else if (name == "brightness") {
+                event.mType = VrrTraceEvent::kBrightnessMode;
+                valid = valid && (tokens >> argument);
+                if (argument == "normal") {
+                    event.mValue = static_cast<int>(BrightnessMode::kNormalBrightnessMode);
+                } else if (argument == "hbm") {
+                    event.mValue = static_cast<int>(BrightnessMode::kHighBrightnessMode);
+                } else {
+                    valid = false;
+                }
+            } else {
+                valid = false;
+            }
+            if (!valid || (tokens >> argument)) {
+                error = "line " + std::to_string(lineNumber) + ": " + line;
+                return false;
+            }
+            trace.push_back(event);
+        }
+        return true;
+    }
+
+    // Replays |trace|, then lets the pending timeouts run for |tailNs| after its last event.
+    VrrSimulationReport run(const std::vector<VrrTraceEvent>& trace, int64_t tailNs = 0) {
+        const int64_t startNs = VirtualClock::kDefaultStartTimeNs;
+        ScopedVirtualClock clock(startNs);
+        PresentPipeline pipeline(mParams.mPresentLatencyNs, mParams.mPeriodParameters);
+        RecordingFileNode fileNode;
+        PresentCadencePredictor predictor(mParams.mAheadOfTimeNs / 2);
+        FrameInsertionScheduler::InsertionTimeAdjuster insertionTimeAdjuster;
+        if (mParams.mPostponeFrameInsertions) {
+            insertionTimeAdjuster = [&predictor](int64_t whenNs) {
+                return predictor.getFrameInsertionTimeNs(whenNs);
+            };
+        }
+        FrameInsertionScheduler scheduler(&pipeline.getEventQueue(), mParams.mAheadOfTimeNs,
+                                          insertionTimeAdjuster);
+        VrrSimulationReport report;
+
+        auto insertFrame = [&]() {
+            if (FrameInsertionScheduler::insertFrame(fileNode)) {
+                report.mNumberOfFrameInsertions++;
+            }
+            pipeline.getStatistic()
+                    .onNonPresentRefresh(getSteadyClockTimeNs(),
+                                         RefreshSource::kRefreshSourceFrameInsertion);
+            scheduler.scheduleNextInsertion();
+        };
+        pipeline.setEventHandler([&](const VrrControllerEvent& event) {
+            if (event.mEventType == VrrControllerEventType::kVendorRenderingTimeoutInit) {
+                int64_t whenFromNowNs = 0;
+                for (const auto& [count, intervalNs] : mParams.mInsertionSchedule) {
+                    for (uint32_t i = 0; i < count; i++) {
+                        scheduler.addInsertion(whenFromNowNs);
+                        whenFromNowNs += intervalNs;
+                    }
+                }
+                if (scheduler.startInsertions()) {
+                    insertFrame();
+                }
+            } else if (event.mEventType == VrrControllerEventType::kVendorRenderingTimeoutPost) {
+                insertFrame();
+            }
+        });
+
+        // The panel starts with a minimum refresh rate of 1Hz and the frame insertion made by
+        // software.
+        uint32_t command = 0;
+        setBitField(command, 1, kPanelRefreshCtrlMinimumRefreshRateOffset,
+                    kPanelRefreshCtrlMinimumRefreshRateMask);
+        fileNode.writeValue(kRefreshControlNodeName, command);
+
+        for (const auto& event : trace) {
+            const int64_t timeNs = startNs + event.mTimeNs;
+            pipeline.runUntil(clock, timeNs);
+            switch (event.mType) {
+                case VrrTraceEvent::kPresent:
+                    report.mNumberOfPresents++;
+                    pipeline.onPresent(timeNs, event.mValue);
+                    predictor.onPresent(timeNs);
+                    // The expected present time of this frame cancelled the pending insertions.
+                    scheduler.cancel();
+                    if (pipeline.getPowerMode() == HWC_POWER_MODE_NORMAL) {
+                        scheduler.onPresent(timeNs, mParams.mPresentTimeoutNs);
+                    }
+                    break;
+                case VrrTraceEvent::kConfig:
+                    pipeline.setActiveConfig(event.mValue);
+                    break;
+                case VrrTraceEvent::kPowerMode:
+                    if (event.mValue != HWC_POWER_MODE_NORMAL) {
+                        scheduler.cancel();
+                    }
+                    pipeline.setPowerMode(event.mValue);
+                    break;
+                case VrrTraceEvent::kBrightnessMode:
+                    pipeline.setBrightnessMode(static_cast<BrightnessMode>(event.mValue));
+                    break;
+            }
+        }
+        const int64_t endNs = (trace.empty() ? startNs : startNs + trace.back().mTimeNs) + tailNs;
+        pipeline.runUntil(clock, endNs);
+        pipeline.drainPresents();
+
+        for (auto change : pipeline.getRefreshRateChanges()) {
+            change.mTimeNs -= startNs;
+            report.mRefreshRateChanges.push_back(change);
+        }
+        for (auto write : fileNode.getWrites()) {
+            write.mTimeNs -= startNs;
+            report.mPanelCommands.push_back(write);
+        }
+        report.mNumberOfWakeups = pipeline.getNumberOfWakeups();
+        return report;
+    }
+
+private:
+    const VrrSimulatorParameters mParams;
+};
+
+} // namespace android::hardware::graphics::composer
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "VrrSimulator.h"
+
+using android::hardware::graphics::composer::VrrSimulator;
+using android::hardware::graphics::composer::VrrSimulatorParameters;
+using android::hardware::graphics::composer::VrrTraceEvent;
+
+namespace {
+
+constexpr double kMsNs = 1000000.0;
+
+void usage(const char* name) {
+    std::cerr << "Usage: " << name << " [options] <trace>\n"
+              << "  --latency-ms <ms>        delay of the controller thread after a present\n"
+              << "  --timeout-ms <ms>        vendor present timeout before the first insertion\n"
+              << "  --schedule <n>:<ms>,...  frame insertions made on the timeout\n"
+              << "  --period-ms <ms>         measure period of the period calculator\n"
+              << "  --confidence <percent>   confidence of the period calculator\n"
+              << "  --tail-ms <ms>           time to run after the last event of the trace\n"
+              << "  --no-postpone            never postpone an insertion to a predicted present\n";
+}
+
+int64_t msToNs(const char* value) {
+    return std::llround(std::strtod(value, nullptr) * kMsNs);
+}
+
+bool parseSchedule(const std::string& value, VrrSimulatorParameters& params) {
+    params.mInsertionSchedule.clear();
+    std::istringstream is(value);
+    std::string item;
+    while (std::getline(is, item, ',')) {
+        auto separator = item.find(':');
+        if (separator == std::string::npos) {
+            return false;
+        }
+        params.mInsertionSchedule.emplace_back(std::stoul(item.substr(0, separator)),
+                                               msToNs(item.c_str() + separator + 1));
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    VrrSimulatorParameters params;
+    int64_t tailNs = 0;
+    const char* tracePath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg == "--latency-ms" && hasValue) {
+            params.mPresentLatencyNs = msToNs(argv[++i]);
+        } else if (arg == "--timeout-ms" && hasValue) {
+            params.mPresentTimeoutNs = msToNs(argv[++i]);
+        } else if (arg == "--schedule" && hasValue) {
+            if (!parseSchedule(argv[++i], params)) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (arg == "--period-ms" && hasValue) {
+            params.mPeriodParameters.mMeasurePeriodNs = msToNs(argv[++i]);
+        } else if (arg == "--confidence" && hasValue) {
+            params.mPeriodParameters.mConfidencePercentage = std::atoi(argv[++i]);
+        } else if (arg == "--tail-ms" && hasValue) {
+            tailNs = msToNs(argv[++i]);
+        } else if (arg == "--no-postpone") {
+            params.mPostponeFrameInsertions = false;
+        } else if (!tracePath && (arg[0] != '-')) {
+            tracePath = argv[i];
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (!tracePath) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream trace(tracePath);
+    if (!trace) {
+        std::cerr << "Cannot open " << tracePath << "\n";
+        return EXIT_FAILURE;
+    }
+    std::vector<VrrTraceEvent> events;
+    std::string error;
+    if (!VrrSimulator::parseTrace(trace, events, error)) {
+        std::cerr << "Malformed trace, " << error << "\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << VrrSimulator(params).run(events, tailNs).toString();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,265 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <vector>
+
+#include "VrrSimulator.h"
+
+namespace android::hardware::graphics::composer {
+
+namespace {
+
+constexpr int64_t kMsNs = 1000000;
+
+std::vector<VrrTraceEvent> parse(const std::string& text) {
+    std::istringstream is(text);
+    std::vector<VrrTraceEvent> trace;
+    std::string error;
+    EXPECT_TRUE(VrrSimulator::parseTrace(is, trace, error)) << error;
+    return trace;
+}
+
+bool isMalformed(const std::string& text) {
+    std::istringstream is(text);
+    std::vector<VrrTraceEvent> trace;
+    std::string error;
+    return !VrrSimulator::parseTrace(is, trace, error) && !error.empty();
+}
+
+// Presents at |frameRate| from |startMs| for |durationMs|.
+std::string presents(int frameRate, double startMs, double durationMs) {
+    std::ostringstream os;
+    const int count = durationMs * frameRate / 1000;
+    for (int i = 0; i < count; i++) {
+        os << startMs + i * 1000.0 / frameRate << " present\n";
+    }
+    return os.str();
+}
+
+std::vector<int64_t> getInsertionTimesNs(const VrrSimulationReport& report) {
+    std::vector<int64_t> timesNs;
+    // The first command is the initial state of the panel.
+    for (size_t i = 1; i < report.mPanelCommands.size(); i++) {
+        timesNs.push_back(report.mPanelCommands[i].mTimeNs);
+    }
+    return timesNs;
+}
+
+} // namespace
+
+TEST(VrrSimulatorTest, ParsesTrace) {
+    auto trace = parse("# a comment\n"
+                       "0 power on\n"
+                       "\n"
+                       "8.5 present yuv rri\n"
+                       "10 config 1\n"
+                       "12 brightness hbm\n"
+                       "20 present doze\n");
+    ASSERT_EQ(trace.size(), 5);
+    EXPECT_EQ(trace[0].mType, VrrTraceEvent::kPowerMode);
+    EXPECT_EQ(trace[0].mValue, HWC_POWER_MODE_NORMAL);
+    EXPECT_EQ(trace[1].mTimeNs, 8500000);
+    EXPECT_EQ(trace[1].mType, VrrTraceEvent::kPresent);
+    EXPECT_EQ(trace[1].mValue,
+              PresentFrameFlag::kIsYuv | PresentFrameFlag::kUpdateRefreshRateIndicatorLayerOnly);
+    EXPECT_EQ(trace[2].mType, VrrTraceEvent::kConfig);
+    EXPECT_EQ(trace[2].mValue, 1);
+    EXPECT_EQ(trace[3].mType, VrrTraceEvent::kBrightnessMode);
+    EXPECT_EQ(trace[3].mValue, static_cast<int>(BrightnessMode::kHighBrightnessMode));
+    EXPECT_EQ(trace[4].mValue, PresentFrameFlag::kPresentingWhenDoze);
+}
+
+TEST(VrrSimulatorTest, RejectsMalformedTrace) {
+    EXPECT_TRUE(isMalformed("10 flip\n"));
+    EXPECT_TRUE(isMalformed("10 present hdr\n"));
+    EXPECT_TRUE(isMalformed("10 power standby\n"));
+    EXPECT_TRUE(isMalformed("10 config\n"));
+    EXPECT_TRUE(isMalformed("10 config 1 2\n"));
+    EXPECT_TRUE(isMalformed("10ms present\n"));
+    EXPECT_TRUE(isMalformed("20 present\n10 present\n"));
+}
+
+TEST(VrrSimulatorTest, InsertsFramesAfterPresentTimeout) {
+    VrrSimulatorParameters params;
+    params.mPresentTimeoutNs = 33 * kMsNs;
+    params.mInsertionSchedule = {{1, 20 * kMsNs}, {2, 50 * kMsNs}};
+    auto report = VrrSimulator(params).run(parse("0 power on\n10 present\n"), 1000 * kMsNs);
+
+    EXPECT_EQ(report.mNumberOfPresents, 1);
+    EXPECT_EQ(report.mNumberOfFrameInsertions, 3);
+    EXPECT_EQ(getInsertionTimesNs(report),
+              (std::vector<int64_t>{42 * kMsNs, 62 * kMsNs, 112 * kMsNs}));
+    for (const auto& command : report.mPanelCommands) {
+        EXPECT_EQ(command.mNodeName, kRefreshControlNodeName);
+    }
+}
+
+TEST(VrrSimulatorTest, PresentsCancelInsertions) {
+    VrrSimulatorParameters params;
+    params.mPresentTimeoutNs = 33 * kMsNs;
+    params.mInsertionSchedule = {{3, 33 * kMsNs}};
+    auto report = VrrSimulator(params).run(parse("0 power on\n" + presents(60, 10, 1000)),
+                                           1000 * kMsNs);
+    EXPECT_EQ(report.mNumberOfPresents, 60);
+    // Only the presents after the last one are followed by insertions.
+    ASSERT_EQ(report.mNumberOfFrameInsertions, 3);
+    EXPECT_GT(getInsertionTimesNs(report).front(), 1000 * kMsNs);
+
+    // At 20Hz, each present is followed by one insertion before the next one cancels the others.
+    report = VrrSimulator(params).run(parse("0 power on\n" + presents(20, 10, 1000)),
+                                      1000 * kMsNs);
+    EXPECT_EQ(report.mNumberOfPresents, 20);
+    EXPECT_EQ(report.mNumberOfFrameInsertions, 19 + 3);
+}
+
+TEST(VrrSimulatorTest, InsertsFramesOnlyWhenOn) {
+    auto report = VrrSimulator().run(parse("0 power doze\n"
+                                           "10 present doze\n"
+                                           "1010 present doze\n"
+                                           "2000 power on\n"
+                                           "2010 power off\n"),
+                                     1000 * kMsNs);
+    EXPECT_EQ(report.mNumberOfPresents, 2);
+    EXPECT_EQ(report.mNumberOfFrameInsertions, 0);
+
+    // Turning the display off drops the pending insertions.
+    report = VrrSimulator().run(parse("0 power on\n10 present\n20 power off\n"), 1000 * kMsNs);
+    EXPECT_EQ(report.mNumberOfFrameInsertions, 0);
+}
+
+TEST(VrrSimulatorTest, RefreshRateFollowsContent) {
+    auto report = VrrSimulator().run(parse("0 power on\n" + presents(120, 10, 2000) +
+                                           presents(30, 2010, 2000)),
+                                     100 * kMsNs);
+    ASSERT_FALSE(report.mRefreshRateChanges.empty());
+    bool reached120 = false;
+    for (const auto& change : report.mRefreshRateChanges) {
+        if (change.mTimeNs < 2010 * kMsNs) {
+            reached120 |= (change.mRefreshRate == 120);
+        }
+    }
+    EXPECT_TRUE(reached120);
+    EXPECT_EQ(report.mRefreshRateChanges.back().mRefreshRate, 30);
+    EXPECT_GT(report.mNumberOfWakeups, 0);
+}
+
+TEST(VrrSimulatorTest, PresentLatencyKeepsDecisions) {
+    const auto trace = parse("0 power on\n" + presents(120, 10, 1000) + "1500 config 1\n" +
+                             presents(24, 1500, 2000));
+    auto synchronous = VrrSimulator().run(trace, 1000 * kMsNs);
+    VrrSimulatorParameters params;
+    params.mPresentLatencyNs = 2 * kMsNs;
+    auto queued = VrrSimulator(params).run(trace, 1000 * kMsNs);
+
+    EXPECT_EQ(queued.mNumberOfFrameInsertions, synchronous.mNumberOfFrameInsertions);
+    ASSERT_EQ(queued.mRefreshRateChanges.size(), synchronous.mRefreshRateChanges.size());
+    for (size_t i = 0; i < queued.mRefreshRateChanges.size(); i++) {
+        EXPECT_EQ(queued.mRefreshRateChanges[i].mRefreshRate,
+                  synchronous.mRefreshRateChanges[i].mRefreshRate);
+    }
+}
+
+TEST(VrrSimulatorTest, PostponesInsertionsBeforePredictedPresents) {
+    // Content at about 31fps, with a jitter of up to 0.09ms: each present is due just after the
+    // first insertion of the previous one would be made, within the postponement.
+    std::ostringstream trace;
+    trace << "0 power on\n";
+    double timeMs = 10;
+    for (int i = 0; i < 300; i++) {
+        trace << timeMs << " present\n";
+        timeMs += 32.3 + ((i * 5) % 7 - 3) * 0.03;
+    }
+    VrrSimulatorParameters params;
+    params.mPresentTimeoutNs = 33 * kMsNs;
+    params.mInsertionSchedule = {{3, 33 * kMsNs}};
+    params.mPostponeFrameInsertions = false;
+    auto immediate = VrrSimulator(params).run(parse(trace.str()), 1000 * kMsNs);
+    params.mPostponeFrameInsertions = true;
+    auto postponed = VrrSimulator(params).run(parse(trace.str()), 1000 * kMsNs);
+
+    EXPECT_EQ(immediate.mNumberOfPresents, 300);
+    EXPECT_EQ(postponed.mNumberOfPresents, 300);
+    // Without the prediction, a frame is inserted before every present but the first.
+    EXPECT_EQ(immediate.mNumberOfFrameInsertions, 299 + 3);
+    // With it, once four intervals have been seen, the presents land before the postponed
+    // insertions, and only the three after the last present remain. The first of them is still
+    // made half of the margin ahead of the present timeout.
+    ASSERT_EQ(postponed.mNumberOfFrameInsertions, 4 + 3);
+    const int64_t lastPresentNs = parse(trace.str()).back().mTimeNs;
+    EXPECT_EQ(getInsertionTimesNs(postponed)[4],
+              lastPresentNs + 33 * kMsNs - params.mAheadOfTimeNs / 2);
+}
+
+TEST(VrrSimulatorTest, PostponementAtCommonFrameRates) {
+    // At the vendor present timeout of the controller, the presents of common frame rates are
+    // never predicted within the postponement, which only spares insertions for cadences that
+    // land in its last half millisecond. It must not cost any insertion either.
+    constexpr int64_t kPresentTimeoutNs = 33 * kMsNs;
+    struct {
+        int mFrameRate;
+        size_t mImmediateInsertions;
+        size_t mPostponedInsertions;
+    } cases[] = {
+            // Every present but the first is preceded by one insertion.
+            {24, 239 + 3, 239 + 3},
+            {30, 299 + 3, 299 + 3},
+            // The presents always come before the present timeout.
+            {60, 3, 3},
+    };
+    for (const auto& c : cases) {
+        // Ten seconds of content with a jitter of up to 1ms, as seen from the composer.
+        std::ostringstream trace;
+        trace << "0 power on\n";
+        const int count = c.mFrameRate * 10;
+        for (int i = 0; i < count; i++) {
+            trace << 10 + i * 1000.0 / c.mFrameRate + ((i * 3) % 5 - 2) * 0.5 << " present\n";
+        }
+        const auto events = parse(trace.str());
+        VrrSimulatorParameters params;
+        params.mPresentTimeoutNs = kPresentTimeoutNs;
+        params.mPostponeFrameInsertions = false;
+        auto immediate = VrrSimulator(params).run(events, 1000 * kMsNs);
+        params.mPostponeFrameInsertions = true;
+        auto postponed = VrrSimulator(params).run(events, 1000 * kMsNs);
+
+        EXPECT_EQ(immediate.mNumberOfFrameInsertions, c.mImmediateInsertions) << c.mFrameRate;
+        EXPECT_EQ(postponed.mNumberOfFrameInsertions, c.mPostponedInsertions) << c.mFrameRate;
+
+        // The first insertion after a present, postponed or not, is still made ahead of the
+        // present timeout.
+        size_t nextEvent = 0;
+        int64_t lastPresentNs = -1;
+        for (int64_t insertionNs : getInsertionTimesNs(postponed)) {
+            for (; (nextEvent < events.size()) && (events[nextEvent].mTimeNs <= insertionNs);
+                 nextEvent++) {
+                if (events[nextEvent].mType == VrrTraceEvent::kPresent) {
+                    lastPresentNs = events[nextEvent].mTimeNs;
+                }
+            }
+            if (lastPresentNs >= 0) {
+                EXPECT_LE(insertionNs - lastPresentNs,
+                          kPresentTimeoutNs - params.mAheadOfTimeNs / 2)
+                        << c.mFrameRate;
+                lastPresentNs = -1;
+            }
+        }
+    }
+}
+
+} // namespace android::hardware::graphics::composer